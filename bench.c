@@ -0,0 +1,388 @@
+/*****************************************************//**
+ * @brief   Micro-benchmarks of loading, rendering & searching.
+ * @file    bench.c
+ * @par Language:
+ *      C (ANSI C99) + POSIX (clock_gettime, ftruncate, posix_fadvise)
+ * @par Usage:
+ *      hexview-bench [maxmb]  (or: make bench)
+ *      \n
+ *      Times the very functions of the viewer (hexview.c is compiled
+ *      in, without its main()) on synthetic files of several kinds &
+ *      sizes (up to maxmb Mb, 64 by default), and prints the results
+ *      as a JSON report to stdout. The files are generated from a
+ *      fixed seed, so reports of different versions are comparable.
+ *
+ * @remark  Every benchmark is run BENCH_RUNS times, reporting the min
+ *      and median times. Rendering goes to /dev/null (so the terminal
+ *      is not timed), as does everything else the viewer prints.
+ *      Files just generated are in the page cache, so loads are timed
+ *      warm: it is the code that is measured, not the disk. But for
+ *      the *_cold & *_warm benchmarks of files of 16 Mb or more, which
+ *      search them & jump about them with the file's mapping advised
+ *      (hv_advise(): read at random but for scans, by huge pages) and
+ *      not (*_plain), from the disk (the file dropped from the page
+ *      cache before each run) and from the page cache.
+ *********************************************************
+ */
+
+#define HV_NOMAIN
+#include "hexview.c"
+
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#define BENCH_SEED      0x9E3779B97F4A7C15ULL    /* of the synthetic files */
+#define BENCH_RUNS      5           /* runs per benchmark                 */
+#define BENCH_MAXMB     64          /* default max size of the files      */
+#define BENCH_SCREENS   200         /* screens rendered per run           */
+#define BENCH_GENLEN    (1024*1024) /* bytes generated at a time          */
+#define BENCH_CACHEMB   16          /* min Mb of the files timed cold/warm */
+
+enum BenchKind { BK_RANDOM = 0, BK_ZERO, BK_TEXT, BK_SPARSE, BK_NKINDS };
+
+static const char *bench_kinds[ BK_NKINDS ] = { "random", "zero", "text", "sparse" };
+
+static FILE *report;                /* the JSON report (stdout) */
+static int  nresults;
+
+/*********************************************************//**
+ * Return the time in ms (monotonic).
+ *************************************************************
+ */
+static double bench_now( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static uint64_t bench_rand( uint64_t *state )    /* xorshift64* */
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/*********************************************************//**
+ * Generate the file fname of size bytes of kind (enum BenchKind):
+ * random bytes, zeros, words of text in lines, or a sparse file
+ * with a block of random bytes every Mb (holes in between).
+ *************************************************************
+ */
+static _Bool bench_generate( const char *fname, int kind, size_t size )
+{
+    static const char *words[] = {
+        "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog",
+        "hexview", "offset", "buffer", "page", "row", "byte", "search",
+        "0x7f", "ELF", "data", "text", "=", "{", "}", ";", "return"
+    };
+    uint64_t state = BENCH_SEED + kind;
+    Byte    *chunk = calloc( BENCH_GENLEN, 1 );
+    FILE    *fp = fopen( fname, "wb" );
+    size_t  done, n, i, col = 0;
+
+    if ( !chunk || !fp )
+        goto ret_failure;
+
+    if ( BK_SPARSE == kind ) {
+        if ( 0 != ftruncate( fileno(fp), (off_t) size ) )
+            goto ret_failure;
+        for (done=0; done < size; done += BENCH_GENLEN) {
+            n = myMIN( (size_t) 4096, size - done );
+            for (i=0; i < n; i++)
+                chunk[i] = (Byte) bench_rand( &state );
+            if ( 0 != fseeko( fp, (off_t) done, SEEK_SET ) || n != fwrite( chunk, 1, n, fp ) )
+                goto ret_failure;
+        }
+        free( chunk );
+        return 0 == fclose( fp );
+    }
+
+    for (done=0; done < size; done += n)
+    {
+        n = myMIN( (size_t) BENCH_GENLEN, size - done );
+        if ( BK_RANDOM == kind )
+            for (i=0; i < n; i++)
+                chunk[i] = (Byte) (bench_rand( &state ) >> 56);
+        else if ( BK_TEXT == kind )
+            for (i=0; i < n; ) {
+                const char *w = words[ bench_rand( &state ) % (sizeof(words) / sizeof(*words)) ];
+                for (; *w && i < n; w++, col++)
+                    chunk[i++] = (Byte) *w;
+                if ( i < n )
+                    chunk[i++] = (col > 70) ? '\n' : ' ';
+                col = (col > 70) ? 0 : col + 1;
+            }
+        if ( n != fwrite( chunk, 1, n, fp ) )
+            goto ret_failure;
+    }
+
+    free( chunk );
+    return 0 == fclose( fp );
+
+ret_failure:
+    free( chunk );
+    if ( fp )
+        fclose( fp );
+    return false;
+}
+
+/*********************************************************//**
+ * Add the result of a benchmark to the report: the min & median of
+ * the times of its runs, and the throughput of the median one over
+ * the bytes it processed.
+ *************************************************************
+ */
+static int bench_cmpms( const void *a, const void *b )
+{
+    const double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static void bench_result( const char *bench, int kind, size_t size, double *ms, size_t bytes )
+{
+    qsort( ms, BENCH_RUNS, sizeof(double), bench_cmpms );
+    fprintf( report,
+        "%s\n    {\"bench\":\"%s\",\"input\":\"%s\",\"size\":%llu,\"runs\":%d,"
+        "\"min_ms\":%.3f,\"median_ms\":%.3f,\"mb_s\":%.1f}",
+        nresults++ ? "," : "", bench, bench_kinds[kind], (unsigned long long) size,
+        BENCH_RUNS, ms[0], ms[BENCH_RUNS/2],
+        ms[BENCH_RUNS/2] > 0 ? bytes / (1024.0*1024) / (ms[BENCH_RUNS/2] / 1e3) : 0.0
+    );
+    fflush( report );
+    return;
+}
+
+/*********************************************************//**
+ * Time the loaders on the file fname.
+ *************************************************************
+ */
+static _Bool bench_load( const char *fname, int kind, size_t size )
+{
+    Buffer  buffer;
+    double  ms[ BENCH_RUNS ], t;
+    int     r;
+
+    for (r=0; r < BENCH_RUNS; r++) {
+        t = bench_now();
+        if ( !buffer_read_file_longmax( &buffer, fname, 0U ) )
+            return false;
+        ms[r] = bench_now() - t;
+        buffer_cleanup( &buffer );
+    }
+    bench_result( "load_longmax", kind, size, ms, size );
+
+    for (r=0; r < BENCH_RUNS; r++) {
+        t = bench_now();
+        if ( !buffer_read_file( &buffer, fname, LOAD_CHUNKLEN, 0U ) )
+            return false;
+        ms[r] = bench_now() - t;
+        buffer_cleanup( &buffer );
+    }
+    bench_result( "load_chunked", kind, size, ms, size );
+
+    for (r=0; r < BENCH_RUNS; r++) {
+        t = bench_now();
+        if ( !buffer_map_file( &buffer, fname, 0U ) )
+            return false;
+        ms[r] = bench_now() - t;
+        buffer_cleanup( &buffer );
+    }
+    bench_result( "load_map", kind, size, ms, size );
+
+    return true;
+}
+
+/*********************************************************//**
+ * Time rendering BENCH_SCREENS screens (whole, and row by row) spread
+ * over the buffer, uncolored & colored, and searching it all for a
+ * sequence it does not hold, ahead & backwards.
+ *************************************************************
+ */
+static void bench_view( Buffer *buffer, int kind, Settings *settings )
+{
+    static const Byte absent[] = "\xDE\xAD\xBE\xEF hexview-bench";
+    const size_t npage = FMT_PGLINES * FMT_NCOLS;
+    double  ms[ BENCH_RUNS ], t;
+    size_t  i, j;
+    int     r, colored;
+
+    for (colored=0; colored < 2; colored++)
+    {
+        settings->colorize = colored;
+
+        for (r=0; r < BENCH_RUNS; r++) {
+            t = bench_now();
+            for (i=0; i < BENCH_SCREENS; i++)
+                view_screen( i * (buffer->len / BENCH_SCREENS), buffer, settings );
+            fflush( stdout );
+            ms[r] = bench_now() - t;
+        }
+        bench_result( colored ? "view_screen_color" : "view_screen", kind, buffer->len, ms,
+                      BENCH_SCREENS * npage );
+
+        for (r=0; r < BENCH_RUNS; r++) {
+            t = bench_now();
+            for (i=0; i < BENCH_SCREENS; i++) {
+                const size_t row = i * (buffer->nrows / BENCH_SCREENS);
+                for (j=row; j < row + FMT_PGLINES && j < buffer->nrows; j++) {
+                    view_row( j, row * FMT_NCOLS, buffer, NULL, settings );
+                    putchar('\n');
+                }
+            }
+            fflush( stdout );
+            ms[r] = bench_now() - t;
+        }
+        bench_result( colored ? "view_row_color" : "view_row", kind, buffer->len, ms,
+                      BENCH_SCREENS * npage );
+    }
+    settings->colorize = false;
+
+    for (r=0; r < BENCH_RUNS; r++) {
+        t = bench_now();
+        buffer_find( buffer, 0, absent, sizeof(absent) - 1, false );
+        ms[r] = bench_now() - t;
+    }
+    bench_result( "search_forward", kind, buffer->len, ms, buffer->len );
+
+    for (r=0; r < BENCH_RUNS; r++) {
+        t = bench_now();
+        buffer_find( buffer, buffer->len - 1, absent, sizeof(absent) - 1, true );
+        ms[r] = bench_now() - t;
+    }
+    bench_result( "search_backward", kind, buffer->len, ms, buffer->len );
+
+    return;
+}
+
+/*********************************************************//**
+ * Drop the file of the buffer from the page cache (& its mapping),
+ * and then read it back in the page cache if warm.
+ *************************************************************
+ */
+static void bench_cached( Buffer *buffer, _Bool warm )
+{
+    const int fd = open( buffer->fname, O_RDONLY );
+    Byte    *chunk;
+
+    madvise( buffer->data, buffer->len, MADV_DONTNEED );
+    if ( -1 == fd )
+        return;
+    fdatasync( fd );
+    posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED );
+    if ( warm && NULL != (chunk = malloc( BENCH_GENLEN )) ) {
+        while ( read( fd, chunk, BENCH_GENLEN ) > 0 )
+            ;
+        free( chunk );
+    }
+    close( fd );
+    return;
+}
+
+/*********************************************************//**
+ * Time searching the buffer for a sequence it does not hold, and
+ * rendering BENCH_SCREENS screens at random offsets, cold & warm (see
+ * above), with the mapping advised and not.
+ *************************************************************
+ */
+static void bench_cache( Buffer *buffer, int kind, Settings *settings )
+{
+    static const Byte absent[] = "\xDE\xAD\xBE\xEF hexview-bench";
+    static const char *names[2][2][2] = {    /* [bench][warm][advised] */
+        { { "search_forward_cold_plain", "search_forward_cold" },
+          { "search_forward_warm_plain", "search_forward_warm" } },
+        { { "view_jump_cold_plain", "view_jump_cold" },
+          { "view_jump_warm_plain", "view_jump_warm" } }
+    };
+    double  ms[ BENCH_RUNS ], t;
+    uint64_t state;
+    size_t  i;
+    int     b, warm, advised, r;
+
+    for (b=0; b < 2; b++)
+        for (warm=0; warm < 2; warm++)
+            for (advised=0; advised < 2; advised++)
+            {
+                hv_advise( buffer->file, advised ? HV_ADVISE_PATTERN | HV_ADVISE_HUGE : 0U );
+                for (r=0; r < BENCH_RUNS; r++) {
+                    bench_cached( buffer, warm );
+                    state = BENCH_SEED + r;
+                    t = bench_now();
+                    if ( 0 == b )
+                        buffer_find( buffer, 0, absent, sizeof(absent) - 1, false );
+                    else
+                        for (i=0; i < BENCH_SCREENS; i++)
+                            view_screen( bench_rand( &state ) % buffer->len, buffer, settings );
+                    fflush( stdout );
+                    ms[r] = bench_now() - t;
+                }
+                bench_result( names[b][warm][advised], kind, buffer->len, ms,
+                              0 == b ? buffer->len : BENCH_SCREENS * FMT_PGLINES * FMT_NCOLS );
+            }
+    hv_advise( buffer->file, HV_ADVISE_PATTERN | HV_ADVISE_HUGE );
+
+    return;
+}
+
+int main( int argc, char *argv[] )
+{
+    const char *dir = getenv( "BENCH_DIR" ) ? getenv( "BENCH_DIR" ) : "/tmp";
+    const size_t maxmb = argc > 1 ? strtoul( argv[1], NULL, 10 ) : BENCH_MAXMB;
+    char    fname[ MAXINPUT ];
+    size_t  size;
+    int     kind, fd;
+    Settings settings = {
+        .colorize   = false,
+        .charset    = FMT_ASCII,
+        .mode       = MODE_VIEW,
+        .strminlen  = STR_MINLEN,
+        .strkinds   = STR_ASCII | STR_UTF16,
+        .entblocklen = ENT_BLOCKLEN
+    };
+
+    if ( 0 == maxmb ) {
+        fprintf( stderr, "usage: %s [maxmb]\n", argv[0] );
+        exit( EXIT_FAILURE );
+    }
+
+    /* the report to stdout, anything else the viewer prints nowhere */
+    fflush( stdout );
+    if ( -1 == (fd = dup( STDOUT_FILENO )) || NULL == (report = fdopen( fd, "w" ))
+        || !freopen( "/dev/null", "w", stdout )
+    ) {
+        perror( "stdout" );
+        exit( EXIT_FAILURE );
+    }
+
+    fprintf( report, "{\n  \"program\":\"%s\",\"seed\":\"%llx\",\"runs\":%d,\"screens\":%d,\n"
+        "  \"results\":[", NAME_VERSION, (unsigned long long) BENCH_SEED, BENCH_RUNS, BENCH_SCREENS );
+
+    for (size = 1; size <= maxmb; size *= (size < 16 ? 16 : 4))
+        for (kind=0; kind < BK_NKINDS; kind++)
+        {
+            Buffer buffer;
+
+            snprintf( fname, MAXINPUT, "%s/hexview-bench-%s-%llu.bin", dir, bench_kinds[kind],
+                      (unsigned long long) size );
+            if ( !bench_generate( fname, kind, size * 1024 * 1024 )
+                || !bench_load( fname, kind, size * 1024 * 1024 )
+                || !buffer_map_file( &buffer, fname, 0U )
+            ) {
+                perror( fname );
+                remove( fname );
+                exit( EXIT_FAILURE );
+            }
+            bench_view( &buffer, kind, &settings );
+            if ( size >= BENCH_CACHEMB )
+                bench_cache( &buffer, kind, &settings );
+            buffer_cleanup( &buffer );
+            remove( fname );
+        }
+
+    fprintf( report, "\n  ]\n}\n" );
+    fclose( report );
+
+    exit( EXIT_SUCCESS );
+}
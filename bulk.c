@@ -0,0 +1,244 @@
+/*****************************************************//**
+ * @brief   Vectorized kernels of bulk operations over byte ranges.
+ * @file    bulk.c
+ * @par Language:
+ *      C (ANSI C99) (SSE2 intrinsics when available)
+ *
+ * @remark  Patterns & keys are tiled into a small block first, whose
+ *      length is a multiple of both their length and of the vector
+ *      width, so the inner loops only load a vector of the tile, an
+ *      unaligned one of the data, combine them and store the result.
+ *      Searches test the 1st & last byte of the sequence 16 offsets
+ *      at a time, and compare the rest only where both of them match.
+ *      Matches are counted in byte lanes, 32 bytes per round, summed
+ *      up (by _mm_sad_epu8) before any lane can overflow.
+ *********************************************************
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "hexview.h"
+#include "bulk.h"
+
+#define TILE_MAXLEN    4096            /* max bytes of a tiled pattern */
+
+/*********************************************************//**
+ * Fill dst[0..n) with pat[0..patlen) repeated, starting from its
+ * phase'th byte.
+ *************************************************************
+ */
+void bulk_fill( unsigned char *dst, size_t n, const unsigned char *pat, size_t patlen, size_t phase )
+{
+    unsigned char tile[ TILE_MAXLEN ];
+    size_t tilelen, i, k;
+
+    if ( 0 == patlen )
+        return;
+    if ( patlen > TILE_MAXLEN / 2 ) {        /* too long to tile: copy it */
+        for (phase %= patlen; n > 0; phase = 0) {
+            k = myMIN( n, patlen - phase );
+            memcpy( dst, &pat[phase], k );
+            dst += k;
+            n   -= k;
+        }
+        return;
+    }
+
+    /* as many whole patterns as fit in the tile (memcpy does the rest) */
+    tilelen = TILE_MAXLEN - TILE_MAXLEN % patlen;
+    for (i=0; i < tilelen; i += patlen)
+        memcpy( &tile[i], pat, patlen );
+
+    for (phase %= patlen; n > 0; phase = 0) {
+        k = myMIN( n, tilelen - phase );
+        memcpy( dst, &tile[phase], k );
+        dst += k;
+        n   -= k;
+    }
+
+    return;
+}
+
+/*********************************************************//**
+ * Store into dst[0..n) src[0..n) combined by op with key[0..keylen)
+ * repeated, starting from its phase'th byte (dst may be src).
+ *************************************************************
+ */
+#define LOGIC_SCALAR( OP )                        \
+    for (; i < n; i++, j = (j + 1 == keylen ? 0 : j + 1))            \
+        dst[i] = src[i] OP key[j]
+
+#define LOGIC_VECTOR( VOP, OP )                        \
+    for (; i + 16 <= n; i += 16) {                    \
+        const __m128i v = _mm_loadu_si128( (const __m128i *) &src[i] );    \
+        const __m128i k = _mm_loadu_si128( (const __m128i *) &tile[t] );    \
+        _mm_storeu_si128( (__m128i *) &dst[i], VOP(v, k) );        \
+        if ( (t += 16) >= tilelen )                    \
+            t -= tilelen;                        \
+    }                                    \
+    j = t % keylen;                            \
+    LOGIC_SCALAR( OP )
+
+void bulk_logic( unsigned char *dst, const unsigned char *src, size_t n, enum BulkOp op,
+                 const unsigned char *key, size_t keylen, size_t phase )
+{
+    size_t i = 0, j;
+
+    if ( 0 == keylen )
+        return;
+    j = phase % keylen;
+
+#if defined(__SSE2__)
+    if ( keylen <= BULK_MAXKEYLEN && n >= 16 )
+    {
+        /* tile length: a multiple of 16 & of keylen (+16 to load across its end) */
+        unsigned char tile[ 16 * BULK_MAXKEYLEN + 16 ];
+        size_t tilelen = keylen, t;
+
+        while ( tilelen % 16 )
+            tilelen += keylen;
+        for (t=0; t < tilelen + 16; t++)
+            tile[t] = key[t % keylen];
+        t = j;
+
+        switch ( op ) {
+        case BULK_AND: LOGIC_VECTOR( _mm_and_si128, & ); break;
+        case BULK_OR:  LOGIC_VECTOR( _mm_or_si128,  | ); break;
+        default:       LOGIC_VECTOR( _mm_xor_si128, ^ ); break;
+        }
+        return;
+    }
+#endif
+
+    switch ( op ) {
+    case BULK_AND: LOGIC_SCALAR( & ); break;
+    case BULK_OR:  LOGIC_SCALAR( | ); break;
+    default:       LOGIC_SCALAR( ^ ); break;
+    }
+
+    return;
+}
+
+/*********************************************************//**
+ * Return the offset of the 1st occurrence of pat[0..patlen) in
+ * hay[0..n), or BULK_NONE if there is none.
+ *************************************************************
+ */
+size_t bulk_find( const unsigned char *hay, size_t n, const unsigned char *pat, size_t patlen )
+{
+    size_t i = 0, last;
+
+    if ( 0 == patlen || patlen > n )
+        return BULK_NONE;
+    last = n - patlen;                /* the last candidate offset */
+
+#if defined(__SSE2__)
+    {
+        const __m128i first = _mm_set1_epi8( (char) pat[0] );
+        const __m128i final = _mm_set1_epi8( (char) pat[patlen-1] );
+
+        for (; i + 16 <= last + 1; i += 16)
+        {
+            const __m128i hf = _mm_loadu_si128( (const __m128i *) &hay[i] );
+            const __m128i hl = _mm_loadu_si128( (const __m128i *) &hay[i + patlen - 1] );
+            unsigned mask = _mm_movemask_epi8(
+                _mm_and_si128( _mm_cmpeq_epi8(hf, first), _mm_cmpeq_epi8(hl, final) ) );
+
+            while ( mask ) {
+                const size_t k = i + __builtin_ctz( mask );
+                if ( 0 == memcmp( &hay[k], pat, patlen ) )
+                    return k;
+                mask &= mask - 1;
+            }
+        }
+    }
+#endif
+
+    for (; i <= last; i++)
+        if ( hay[i] == pat[0] && 0 == memcmp( &hay[i], pat, patlen ) )
+            return i;
+
+    return BULK_NONE;
+}
+
+/*********************************************************//**
+ * Return the # of offsets i in [0,n) where a[i] == b[i].
+ *************************************************************
+ */
+size_t bulk_matches( const unsigned char *a, const unsigned char *b, size_t n )
+{
+    size_t i = 0, count = 0;
+
+#if defined(__SSE2__)
+    {
+        const __m128i zero = _mm_setzero_si128();
+
+        while ( i + 32 <= n )
+        {
+            /* every byte lane counts up to 255 matches, then they are summed */
+            const size_t end = i + myMIN( (n - i) / 32, (size_t) 255 ) * 32;
+            __m128i acc = zero, acc2 = zero;
+
+            for (; i < end; i += 32) {
+                acc  = _mm_sub_epi8( acc, _mm_cmpeq_epi8(
+                        _mm_loadu_si128( (const __m128i *) &a[i] ),
+                        _mm_loadu_si128( (const __m128i *) &b[i] ) ) );
+                acc2 = _mm_sub_epi8( acc2, _mm_cmpeq_epi8(
+                        _mm_loadu_si128( (const __m128i *) &a[i + 16] ),
+                        _mm_loadu_si128( (const __m128i *) &b[i + 16] ) ) );
+            }
+            acc = _mm_add_epi64( _mm_sad_epu8( acc, zero ), _mm_sad_epu8( acc2, zero ) );
+            count += (size_t) _mm_cvtsi128_si32( acc ) + (size_t) _mm_extract_epi16( acc, 4 );
+        }
+    }
+#endif
+
+    for (; i < n; i++)
+        count += (a[i] == b[i]);
+
+    return count;
+}
+
+/*********************************************************//**
+ * Copy src to dst, replacing every occurrence of a[0..alen) starting
+ * in src[0..n) with b[0..blen), left to right, without overlaps
+ * (src[n..avail) is only read to complete occurrences starting
+ * before n). The offset in src past the copied bytes goes into
+ * consumed (n, or the end of an occurrence crossing it), and the #
+ * of occurrences into nfound. Return the # of bytes stored in dst,
+ * which must have room for n + (n / alen + 1) * blen bytes.
+ *************************************************************
+ */
+size_t bulk_replace( unsigned char *dst, const unsigned char *src, size_t n, size_t avail,
+                     const unsigned char *a, size_t alen, const unsigned char *b, size_t blen,
+                     size_t *consumed, size_t *nfound )
+{
+    size_t i = 0, out = 0, at;
+    const size_t limit = myMIN( avail, n + alen - 1 );  /* occurrences start before n */
+
+    *nfound = 0;
+    while ( i < n && BULK_NONE != (at = bulk_find( &src[i], limit - i, a, alen )) )
+    {
+        memcpy( &dst[out], &src[i], at );
+        out += at;
+        memcpy( &dst[out], b, blen );
+        out += blen;
+        i   += at + alen;
+        (*nfound)++;
+    }
+    if ( i < n ) {
+        memcpy( &dst[out], &src[i], n - i );
+        out += n - i;
+        i    = n;
+    }
+    *consumed = i;
+
+    return out;
+}
@@ -0,0 +1,30 @@
+#ifndef BULK_H                    /* start of inclusion guard */
+#define BULK_H
+
+#include <stddef.h>
+
+/* -----------------------------------
+ * Vectorized kernels of bulk operations over byte ranges
+ * -----------------------------------
+ */
+
+#define BULK_CHUNKLEN        (4*1024*1024)    /* bytes per step of a bulk operation */
+#define BULK_MAXKEYLEN        64        /* keys longer than this are not vectorized */
+#define BULK_NONE        ((size_t)-1)    /* no such offset                     */
+
+enum BulkOp {
+    BULK_XOR = 0,
+    BULK_AND,
+    BULK_OR
+};
+
+void    bulk_fill( unsigned char *dst, size_t n, const unsigned char *pat, size_t patlen, size_t phase );
+void    bulk_logic( unsigned char *dst, const unsigned char *src, size_t n, enum BulkOp op,
+                    const unsigned char *key, size_t keylen, size_t phase );
+size_t  bulk_find( const unsigned char *hay, size_t n, const unsigned char *pat, size_t patlen );
+size_t  bulk_matches( const unsigned char *a, const unsigned char *b, size_t n );
+size_t  bulk_replace( unsigned char *dst, const unsigned char *src, size_t n, size_t avail,
+                      const unsigned char *a, size_t alen, const unsigned char *b, size_t blen,
+                      size_t *consumed, size_t *nfound );
+
+#endif                        /* end of inclusion guard            */
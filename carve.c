@@ -0,0 +1,174 @@
+/*****************************************************//**
+ * @brief   Carving of embedded files, by their header & footer signatures.
+ * @file    carve.c
+ * @par Language:
+ *      C (ANSI C99) (SSE2 intrinsics when available)
+ *
+ * @remark  The headers of every kind are looked for in one scan, 16
+ *      offsets at a time: where the 1st two bytes of any of them
+ *      match, the rest of it is compared (and checked a bit further,
+ *      for the kinds whose header is short), and then its footer is
+ *      looked for (by bulk_find()), up to the max length of its kind.
+ *      The object carved ends past its footer (& the comment of zip
+ *      archives). Objects are not nested: the scan goes on past the
+ *      end of the last one carved, and a header whose footer is not
+ *      found is skipped. As with any carving, objects fragmented, or
+ *      whose footer may occur inside them (e.g. a thumbnail in a jpg,
+ *      or the %%EOF of a pdf updated incrementally), are cut short.
+ *********************************************************
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "hexview.h"
+#include "bulk.h"
+#include "carve.h"
+
+typedef struct CarveSig {
+    const char  *name;            /* also the extension of its files    */
+    const char  *head, *foot;
+    size_t      headlen, footlen;
+    size_t      maxlen;            /* max length of an object            */
+} CarveSig;
+
+static const CarveSig sigs[ CARVE_NKINDS ] = {
+    [CARVE_JPG] = { "jpg", "\xFF\xD8\xFF", "\xFF\xD9", 3, 2, 64UL << 20 },
+    [CARVE_PNG] = { "png", "\x89PNG\r\n\x1A\n", "IEND\xAE\x42\x60\x82", 8, 8, 256UL << 20 },
+    [CARVE_GIF] = { "gif", "GIF8", "\x00\x3B", 4, 2, 64UL << 20 },
+    [CARVE_PDF] = { "pdf", "%PDF-", "%%EOF", 5, 5, 512UL << 20 },
+    [CARVE_ZIP] = { "zip", "PK\x03\x04", "PK\x05\x06", 4, 4, 1024UL << 20 },
+};
+
+#define CARVE_ZIPTAIL    18            /* bytes of the end record past "PK\5\6", but the comment */
+
+/*********************************************************//**
+ * Return the name of a kind of objects (& the extension of its files).
+ *************************************************************
+ */
+const char *carve_name( int kind )
+{
+    return kind >= 0 && kind < CARVE_NKINDS ? sigs[kind].name : "?";
+}
+
+/*********************************************************//**
+ * Return true if a header of kind is at p (of n bytes at most).
+ *************************************************************
+ */
+static _Bool carve_ishead( const unsigned char *p, size_t n, int kind )
+{
+    const CarveSig *s = &sigs[kind];
+
+    if ( n < s->headlen + 2 || 0 != memcmp( p, s->head, s->headlen ) )
+        return false;
+
+    switch ( kind ) {
+    case CARVE_JPG:                /* an APPn, DQT, SOF, DHT or COM marker */
+        return 0xE0 == (p[3] & 0xF0) || 0xDB == p[3] || 0xC0 == p[3] || 0xC4 == p[3] || 0xFE == p[3];
+    case CARVE_GIF:                /* GIF87a or GIF89a */
+        return ('7' == p[4] || '9' == p[4]) && 'a' == p[5];
+    case CARVE_PDF:                /* %PDF-1. or %PDF-2. */
+        return ('1' == p[5] || '2' == p[5]);
+    }
+    return true;
+}
+
+/*********************************************************//**
+ * Return the length of the object of kind whose header is at data[h]
+ * (of len bytes), up to its footer's end, or 0 if it has none.
+ *************************************************************
+ */
+static size_t carve_length( const unsigned char *data, size_t len, size_t h, int kind )
+{
+    const CarveSig *s = &sigs[kind];
+    const size_t   n = myMIN( len - h, s->maxlen );
+    size_t  f, end;
+
+    f = bulk_find( &data[h + s->headlen], n - s->headlen,
+                   (const unsigned char *) s->foot, s->footlen );
+    if ( BULK_NONE == f )
+        return 0;
+    end = s->headlen + f + s->footlen;
+
+    if ( CARVE_ZIP == kind ) {            /* the end record & its comment */
+        if ( end + CARVE_ZIPTAIL > n )
+            return 0;
+        end += CARVE_ZIPTAIL + (data[h + end + 16] | (size_t) data[h + end + 17] << 8);
+        end  = myMIN( end, n );
+    }
+    return end;
+}
+
+/*********************************************************//**
+ * Return the offset of the 1st byte of data[from..len) where the 1st
+ * two bytes of a header of any kind are, or len if none.
+ *************************************************************
+ */
+static size_t carve_scan( const unsigned char *data, size_t len, size_t from )
+{
+    size_t i = from;
+    int    k;
+
+    if ( len < 2 )
+        return len;
+
+#if defined(__SSE2__)
+    {
+        __m128i b0[ CARVE_NKINDS ], b1[ CARVE_NKINDS ];
+
+        for (k=0; k < CARVE_NKINDS; k++) {
+            b0[k] = _mm_set1_epi8( sigs[k].head[0] );
+            b1[k] = _mm_set1_epi8( sigs[k].head[1] );
+        }
+        for (; i + 17 <= len; i += 16)
+        {
+            const __m128i v0 = _mm_loadu_si128( (const __m128i *) &data[i] );
+            const __m128i v1 = _mm_loadu_si128( (const __m128i *) &data[i + 1] );
+            __m128i hits = _mm_setzero_si128();
+
+            for (k=0; k < CARVE_NKINDS; k++)
+                hits = _mm_or_si128( hits,
+                    _mm_and_si128( _mm_cmpeq_epi8(v0, b0[k]), _mm_cmpeq_epi8(v1, b1[k]) ) );
+            if ( _mm_movemask_epi8( hits ) )
+                return i + __builtin_ctz( _mm_movemask_epi8( hits ) );
+        }
+    }
+#endif
+
+    for (; i + 1 < len; i++)
+        for (k=0; k < CARVE_NKINDS; k++)
+            if ( data[i] == (unsigned char) sigs[k].head[0]
+                && data[i+1] == (unsigned char) sigs[k].head[1] )
+                return i;
+    return len;
+}
+
+/*********************************************************//**
+ * Find the 1st object of data[0..len) at or after from, whose header
+ * & footer are both there, into hit. Return false if there is none.
+ *************************************************************
+ */
+_Bool carve_next( const unsigned char *data, size_t len, size_t from, CarveHit *hit )
+{
+    size_t h, n;
+    int    k;
+
+    for (h = carve_scan( data, len, from ); h < len; h = carve_scan( data, len, h + 1 ))
+        for (k=0; k < CARVE_NKINDS; k++)
+            if ( carve_ishead( &data[h], len - h, k )
+                && 0 != (n = carve_length( data, len, h, k ))
+            ) {
+                hit->off  = h;
+                hit->len  = n;
+                hit->kind = k;
+                return true;
+            }
+
+    return false;
+}
@@ -0,0 +1,29 @@
+#ifndef CARVE_H                    /* start of inclusion guard */
+#define CARVE_H
+
+#include <stddef.h>
+
+/* -----------------------------------
+ * Carving of embedded files, by their header & footer signatures
+ * -----------------------------------
+ */
+
+enum CarveKind {
+    CARVE_JPG = 0,
+    CARVE_PNG,
+    CARVE_GIF,
+    CARVE_PDF,
+    CARVE_ZIP,
+    CARVE_NKINDS
+};
+
+typedef struct CarveHit {
+    size_t      off;            /* offset of the header ...           */
+    size_t      len;            /* ... & length up to the footer's end */
+    int         kind;            /* enum CarveKind                     */
+} CarveHit;
+
+const char *carve_name( int kind );
+_Bool   carve_next( const unsigned char *data, size_t len, size_t from, CarveHit *hit );
+
+#endif                        /* end of inclusion guard            */
@@ -0,0 +1,627 @@
+/*****************************************************//**
+ * @brief   Shift-tolerant binary diff, by rsync-style block matching.
+ * @file    delta.c
+ * @par Language:
+ *      C (ANSI C99) + POSIX threads
+ *
+ * @remark  The 1st file is signed by the rolling checksum & XXH64 of
+ *      each of its blocks. A window rolls over the 2nd file one byte
+ *      at a time; when its checksum & hash match a block, the match
+ *      is stretched both ways byte by byte and the window jumps past
+ *      it, so identical stretches cost next to nothing. Whatever is
+ *      not matched was inserted, and the parts of the 1st file no
+ *      match covers were deleted. Signatures take 12 bytes per block
+ *      (blocks grow so there are at most DELTA_MAXBLOCKS of them).
+ *********************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "hexview.h"
+#include "hash.h"
+#include "delta.h"
+
+#ifdef HV_POSIX
+#include <unistd.h>
+#endif
+
+#define SIG_MAGIC    "HVSIG01"        /* signature of saved signatures (+'\0') */
+
+typedef struct SigJob {
+    const unsigned char *data;    /* the signed data                    */
+    size_t      first, last;        /* blocks [first,last) are ours       */
+    DeltaSig    *sig;            /* where the sums go                  */
+} SigJob;
+
+typedef struct SigTable {
+    uint32_t    *heads;            /* 1 + 1st block of each bucket       */
+    uint32_t    *next;            /* 1 + next block in the same bucket  */
+    unsigned    bits;            /* log2 of the # of buckets           */
+} SigTable;
+
+/*********************************************************//**
+ * Rolling checksum (rsync's): a = sum of bytes, b = sum of prefix
+ * sums, both kept in full and packed mod 2^16.
+ *************************************************************
+ */
+#define WEAK_PACK(a,b)        ( ((a) & 0xFFFFU) | ((uint32_t)(b) << 16) )
+
+static void weak_init( const unsigned char *p, size_t n, uint32_t *a, uint32_t *b )
+{
+    size_t i;
+
+    for (*a = *b = 0, i=0; i < n; i++) {
+        *a += p[i];
+        *b += *a;
+    }
+    return;
+}
+
+static uint64_t strong_sum( const unsigned char *p, size_t n )
+{
+    unsigned char digest[ HASH_MAXLEN ];
+    uint64_t h = 0;
+    HashCtx  ctx;
+    int      i;
+
+    hash_init( &ctx, HASH_XXH64 );
+    hash_update( &ctx, p, n );
+    hash_final( &ctx, digest );
+    for (i=0; i < 8; i++)
+        h = (h << 8) | digest[i];
+
+    return h;
+}
+
+static inline uint32_t bucket( uint32_t weak, unsigned bits )
+{
+    return (weak * 0x9E3779B1U) >> (32 - bits);
+}
+
+/*********************************************************//**
+ * Thread entry: sums of the job's blocks.
+ *************************************************************
+ */
+static void *sig_job( void *arg )
+{
+    SigJob   *job = arg;
+    DeltaSig *sig = job->sig;
+    size_t   i;
+
+    for (i=job->first; i < job->last; i++)
+    {
+        const unsigned char *p = &job->data[ i * sig->blocklen ];
+        uint32_t a, b;
+
+        weak_init( p, sig->blocklen, &a, &b );
+        sig->weak[i]   = WEAK_PACK( a, b );
+        sig->strong[i] = strong_sum( p, sig->blocklen );
+    }
+
+    return NULL;
+}
+
+/*********************************************************//**
+ * Sign the whole blocks of data, using up to nthreads threads.
+ *************************************************************
+ */
+_Bool deltasig_compute( const unsigned char *data, size_t len, unsigned nthreads, DeltaSig *sig )
+{
+    SigJob    *jobs = NULL;
+    pthread_t *tids = NULL;
+    size_t    per;
+    unsigned  t, nstarted = 0;
+
+    if ( !data || !sig )
+        return false;
+    memset( sig, 0, sizeof(DeltaSig) );
+
+    sig->datalen = len;
+    for (sig->blocklen = DELTA_BLOCKLEN; len / sig->blocklen > DELTA_MAXBLOCKS; sig->blocklen *= 2)
+        ;
+    sig->nblocks = len / sig->blocklen;
+
+    if ( nthreads < 1 )
+        nthreads = 1;
+    if ( nthreads > sig->nblocks )
+        nthreads = sig->nblocks > 0 ? sig->nblocks : 1;
+
+    sig->weak   = malloc( (sig->nblocks + 1) * sizeof(uint32_t) );
+    sig->strong = malloc( (sig->nblocks + 1) * sizeof(uint64_t) );
+    jobs = calloc( nthreads, sizeof(SigJob) );
+    tids = calloc( nthreads, sizeof(pthread_t) );
+    if ( !sig->weak || !sig->strong || !jobs || !tids ) {
+        free( jobs ); free( tids );
+        deltasig_cleanup( sig );
+        return false;
+    }
+
+    per = sig->nblocks / nthreads;
+    for (t=0; t < nthreads; t++) {
+        jobs[t].data  = data;
+        jobs[t].first = t * per;
+        jobs[t].last  = (t == nthreads-1) ? sig->nblocks : (t+1) * per;
+        jobs[t].sig   = sig;
+    }
+
+    /* the calling thread takes care of the 1st job itself */
+    for (t=1; t < nthreads; t++, nstarted++)
+        if ( 0 != pthread_create( &tids[t], NULL, sig_job, &jobs[t] ) )
+            break;
+    sig_job( &jobs[0] );
+    for (t=1; t <= nstarted; t++)
+        pthread_join( tids[t], NULL );
+    for (t=nstarted+1; t < nthreads; t++)
+        sig_job( &jobs[t] );
+
+    free( jobs );
+    free( tids );
+
+    return true;
+}
+
+/*********************************************************//**
+ * Read a signature previously saved with deltasig_save() under the
+ * same key. Return false (and leave sig zeroed) if there is none.
+ *************************************************************
+ */
+_Bool deltasig_load( DeltaSig *sig, const char *path, uint64_t key )
+{
+    char     magic[ sizeof(SIG_MAGIC) ];
+    uint64_t hdr[4];            /* key, datalen, blocklen, nblocks   */
+    FILE     *fp;
+
+    if ( !sig || !path )
+        return false;
+    memset( sig, 0, sizeof(DeltaSig) );
+
+    if ( NULL == (fp = fopen(path, "rb")) )
+        return false;
+
+    if ( 1 != fread(magic, sizeof(magic), 1, fp) || memcmp(magic, SIG_MAGIC, sizeof(magic))
+        || 1 != fread(hdr, sizeof(hdr), 1, fp) || hdr[0] != key
+        || hdr[2] < 1 || hdr[3] != hdr[1] / hdr[2] || hdr[3] > DELTA_MAXBLOCKS
+    )
+        goto ret_failure;
+
+    sig->datalen  = hdr[1];
+    sig->blocklen = hdr[2];
+    sig->nblocks  = hdr[3];
+    if ( NULL == (sig->weak = malloc( (sig->nblocks + 1) * sizeof(uint32_t) ))
+        || NULL == (sig->strong = malloc( (sig->nblocks + 1) * sizeof(uint64_t) ))
+        || sig->nblocks != fread( sig->weak, sizeof(uint32_t), sig->nblocks, fp )
+        || sig->nblocks != fread( sig->strong, sizeof(uint64_t), sig->nblocks, fp )
+    )
+        goto ret_failure;
+
+    fclose( fp );
+    return true;
+
+ret_failure:
+    fclose( fp );
+    deltasig_cleanup( sig );
+    return false;
+}
+
+/*********************************************************//**
+ * Save a signature to a file, tagged with key (so deltasig_load()
+ * can tell if it still describes the same data), through a temp file
+ * renamed to path once complete, as entmap_save() does.
+ *************************************************************
+ */
+_Bool deltasig_save( const DeltaSig *sig, const char *path, uint64_t key )
+{
+    uint64_t hdr[4];
+    FILE     *fp = NULL;
+    char     *tmp;
+    _Bool    success;
+
+    if ( !sig || !sig->weak || !path
+        || NULL == (tmp = malloc( strlen(path) + sizeof(".XXXXXX") )) )
+        return false;
+#ifdef HV_POSIX
+    {
+        const int fd = mkstemp( strcat( strcpy( tmp, path ), ".XXXXXX" ) );
+        if ( -1 != fd && NULL == (fp = fdopen( fd, "wb" )) ) {
+            close( fd );
+            remove( tmp );
+        }
+    }
+#else
+    fp = fopen( strcat( strcpy( tmp, path ), ".tmp" ), "wb" );
+#endif
+    if ( NULL == fp ) {
+        free( tmp );
+        return false;
+    }
+
+    hdr[0] = key;
+    hdr[1] = sig->datalen;
+    hdr[2] = sig->blocklen;
+    hdr[3] = sig->nblocks;
+
+    success = 1 == fwrite( SIG_MAGIC, sizeof(SIG_MAGIC), 1, fp )
+        && 1 == fwrite( hdr, sizeof(hdr), 1, fp )
+        && sig->nblocks == fwrite( sig->weak, sizeof(uint32_t), sig->nblocks, fp )
+        && sig->nblocks == fwrite( sig->strong, sizeof(uint64_t), sig->nblocks, fp );
+#ifdef HV_POSIX
+    success = success && 0 == fflush(fp) && 0 == fsync( fileno(fp) );
+#endif
+
+    if ( 0 != fclose(fp) )
+        success = false;
+    if ( !success || 0 != rename( tmp, path ) ) {
+        remove( tmp );
+        success = false;
+    }
+    free( tmp );
+
+    return success;
+}
+
+/*********************************************************//**
+ *
+ *************************************************************
+ */
+void deltasig_cleanup( DeltaSig *sig )
+{
+    if ( !sig )
+        return;
+
+    free( sig->weak );
+    free( sig->strong );
+    memset( sig, 0, sizeof(DeltaSig) );
+    return;
+}
+
+/*********************************************************//**
+ * Index the blocks of a signature by their rolling checksums (the
+ * chains list the blocks in file order).
+ *************************************************************
+ */
+static _Bool table_build( const DeltaSig *sig, SigTable *tab )
+{
+    size_t i;
+
+    for (tab->bits = 10; ((size_t) 1 << tab->bits) < 2 * sig->nblocks; tab->bits++)
+        ;
+    tab->heads = calloc( (size_t) 1 << tab->bits, sizeof(uint32_t) );
+    tab->next  = calloc( sig->nblocks + 1, sizeof(uint32_t) );
+    if ( !tab->heads || !tab->next ) {
+        free( tab->heads );
+        free( tab->next );
+        return false;
+    }
+
+    for (i=sig->nblocks; i-- > 0; ) {
+        const uint32_t h = bucket( sig->weak[i], tab->bits );
+        tab->next[i] = tab->heads[h];
+        tab->heads[h] = (uint32_t)(i + 1);
+    }
+
+    return true;
+}
+
+/*********************************************************//**
+ * Return the block matching the window p (of blocklen bytes) whose
+ * rolling checksum is weak, or -1. The block expected to follow the
+ * last match (prefer) wins over earlier ones.
+ *************************************************************
+ */
+static long table_match( const DeltaSig *sig, const SigTable *tab, uint32_t weak,
+                         const unsigned char *p, size_t prefer )
+{
+    uint32_t blk = tab->heads[ bucket(weak, tab->bits) ];
+    uint64_t strong = 0;
+    long     found = -1;
+    int      n;
+
+    for (n=0; blk && n < DELTA_MAXCHAIN; blk = tab->next[blk-1], n++)
+    {
+        if ( sig->weak[blk-1] != weak )
+            continue;
+        if ( 0 == strong )            /* hash the window once, lazily */
+            strong = strong_sum( p, sig->blocklen ) | 1;
+        if ( (sig->strong[blk-1] | 1) != strong )
+            continue;
+        if ( blk-1 == prefer )
+            return (long) prefer;
+        if ( -1 == found )
+            found = (long)(blk-1);
+    }
+
+    return found;
+}
+
+/*********************************************************//**
+ * Return the length of the common prefix of a & b (up to n bytes).
+ *************************************************************
+ */
+static size_t common_prefix( const unsigned char *a, const unsigned char *b, size_t n )
+{
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        uint64_t wa, wb;
+        memcpy( &wa, &a[i], sizeof(wa) );
+        memcpy( &wb, &b[i], sizeof(wb) );
+        if ( wa != wb )
+            break;
+    }
+    while ( i < n && a[i] == b[i] )
+        i++;
+
+    return i;
+}
+
+/*********************************************************//**
+ * Append a hunk (a copy adjacent to the last one in both files is
+ * merged into it).
+ *************************************************************
+ */
+static _Bool delta_add( Delta *d, int kind, size_t offa, size_t lena, size_t offb, size_t lenb )
+{
+    Hunk *last = d->n > 0 ? &d->hunks[d->n - 1] : NULL;
+
+    if ( HUNK_COPY == kind && last && HUNK_COPY == last->kind
+        && last->offa + last->lena == offa && last->offb + last->lenb == offb
+    ) {
+        last->lena += lena;
+        last->lenb += lenb;
+        return true;
+    }
+
+    if ( d->n == d->cap ) {
+        const size_t cap = d->cap ? 2 * d->cap : 256;
+        Hunk *try = realloc( d->hunks, cap * sizeof(Hunk) );
+        if ( !try )
+            return false;
+        d->hunks = try;
+        d->cap   = cap;
+    }
+    d->hunks[d->n].kind = (unsigned char) kind;
+    d->hunks[d->n].offa = offa;
+    d->hunks[d->n].lena = lena;
+    d->hunks[d->n].offb = offb;
+    d->hunks[d->n].lenb = lenb;
+    d->n++;
+
+    return true;
+}
+
+/*********************************************************//**
+ * Orderings of hunks: by 2nd file offset (deletions, insertions, then
+ * copies at the same offset), and by 1st file offset.
+ *************************************************************
+ */
+typedef struct HunkKey {
+    size_t      off;            /* the offset sorted by               */
+    size_t      idx;            /* index of the hunk                  */
+} HunkKey;
+
+static int hunk_cmpb( const void *x, const void *y )
+{
+    static const int rank[] = { 2, 0, 1 };    /* by enum HunkKind            */
+    const Hunk *h1 = x, *h2 = y;
+
+    if ( h1->offb != h2->offb )
+        return h1->offb < h2->offb ? -1 : 1;
+    if ( h1->kind != h2->kind )
+        return rank[h1->kind] - rank[h2->kind];
+    return h1->offa < h2->offa ? -1 : h1->offa > h2->offa;
+}
+
+static int hunkkey_cmp( const void *x, const void *y )
+{
+    const HunkKey *k1 = x, *k2 = y;
+
+    if ( k1->off != k2->off )
+        return k1->off < k2->off ? -1 : 1;
+    return k1->idx < k2->idx ? -1 : k1->idx > k2->idx;
+}
+
+/*********************************************************//**
+ * Add the deletions (the parts of a no copy covers), sort the hunks
+ * by 2nd file offset and index the copies & deletions by 1st file
+ * offset.
+ *************************************************************
+ */
+static _Bool delta_finish( Delta *d, size_t lena, size_t lenb )
+{
+    HunkKey *keys = NULL;
+    size_t  i, n, cover = 0, ncopies = d->n;
+
+    if ( NULL == (keys = malloc( (d->n + 1) * sizeof(HunkKey) )) )
+        return false;
+
+    for (i=n=0; i < ncopies; i++)
+        if ( HUNK_COPY == d->hunks[i].kind ) {
+            keys[n].off = d->hunks[i].offa;
+            keys[n].idx = i;
+            n++;
+        }
+    qsort( keys, n, sizeof(HunkKey), hunkkey_cmp );
+
+    for (i=0; i <= n; i++)
+    {
+        const Hunk *h  = i < n ? &d->hunks[ keys[i].idx ] : NULL;
+        const size_t to = h ? h->offa : lena;
+        if ( to > cover
+            && !delta_add( d, HUNK_DELETE, cover, to - cover, h ? h->offb : lenb, 0 )
+        ) {
+            free( keys );
+            return false;
+        }
+        if ( h )
+            cover = myMAX( cover, h->offa + h->lena );
+    }
+    free( keys );
+
+    qsort( d->hunks, d->n, sizeof(Hunk), hunk_cmpb );
+
+    /* copies & deletions by 1st file offset */
+    if ( NULL == (keys = malloc( (d->n + 1) * sizeof(HunkKey) ))
+        || NULL == (d->bya = malloc( (d->n + 1) * sizeof(size_t) ))
+    ) {
+        free( keys );
+        return false;
+    }
+    for (i=n=0; i < d->n; i++)
+        if ( HUNK_INSERT != d->hunks[i].kind ) {
+            keys[n].off = d->hunks[i].offa;
+            keys[n].idx = i;
+            n++;
+        }
+    qsort( keys, n, sizeof(HunkKey), hunkkey_cmp );
+    for (i=0; i < n; i++)
+        d->bya[i] = keys[i].idx;
+    d->nbya = n;
+    free( keys );
+
+    return true;
+}
+
+/*********************************************************//**
+ * Diff b[0..lenb) against a[0..lena), signed by sig, into out.
+ *************************************************************
+ */
+_Bool delta_compute( const DeltaSig *sig, const unsigned char *a, size_t lena,
+                     const unsigned char *b, size_t lenb, Delta *out )
+{
+    SigTable tab = { NULL, NULL, 0 };
+    const size_t L = sig ? sig->blocklen : 0;
+    size_t   j = 0, lit = 0, aend = 0;
+    uint32_t wa = 0, wb = 0;
+    _Bool    rolling = false;
+
+    if ( !sig || !out || (!a && lena) || (!b && lenb) || sig->datalen != lena )
+        return false;
+    memset( out, 0, sizeof(Delta) );
+
+    if ( sig->nblocks > 0 && !table_build( sig, &tab ) )
+        return false;
+
+    /* blocks cannot match a common prefix shorter than a block */
+    if ( 0 != (j = common_prefix( a, b, myMIN(lena, lenb) )) ) {
+        if ( !delta_add( out, HUNK_COPY, 0, j, 0, j ) )
+            goto ret_failure;
+        lit = aend = j;
+    }
+
+    while ( sig->nblocks > 0 && j + L <= lenb )
+    {
+        long   blk;
+        size_t ao, len;
+
+        if ( !rolling ) {
+            weak_init( &b[j], L, &wa, &wb );
+            rolling = true;
+        }
+
+        /* the block right after the last match is the likeliest one */
+        blk = table_match( sig, &tab, WEAK_PACK(wa, wb), &b[j], 0 == aend % L ? aend / L : (size_t) -1 );
+
+        if ( -1 == blk )
+        {
+            /* roll the window 1 byte ahead */
+            if ( j + L >= lenb )
+                break;
+            wa = wa - b[j] + b[j+L];
+            wb = wb - (uint32_t)(L * b[j]) + wa;
+            j++;
+            continue;
+        }
+
+        /* stretch the match back into the literal, and ahead */
+        ao  = (size_t) blk * L;
+        len = L;
+        while ( j > lit && ao > 0 && a[ao-1] == b[j-1] ) {
+            j--;
+            ao--;
+            len++;
+        }
+        len += common_prefix( &a[ao+len], &b[j+len], myMIN( lena - ao - len, lenb - j - len ) );
+
+        if ( out->n + 2 >= DELTA_MAXHUNKS ) {
+            out->truncated = true;
+            break;
+        }
+        if ( (j > lit && !delta_add( out, HUNK_INSERT, aend, 0, lit, j - lit ))
+            || !delta_add( out, HUNK_COPY, ao, len, j, len )
+        )
+            goto ret_failure;
+
+        j += len;
+        lit = j;
+        aend = ao + len;
+        rolling = false;
+    }
+
+    /* ... nor a common suffix */
+    for (j=0; j < lenb - lit && j < lena - myMIN(aend, lena) && a[lena-1-j] == b[lenb-1-j]; j++)
+        ;
+    if ( lit < lenb - j && !delta_add( out, HUNK_INSERT, aend, 0, lit, lenb - j - lit ) )
+        goto ret_failure;
+    if ( j > 0 && !delta_add( out, HUNK_COPY, lena - j, j, lenb - j, j ) )
+        goto ret_failure;
+    if ( !delta_finish( out, lena, lenb ) )
+        goto ret_failure;
+
+    free( tab.heads );
+    free( tab.next );
+    return true;
+
+ret_failure:
+    free( tab.heads );
+    free( tab.next );
+    delta_cleanup( out );
+    return false;
+}
+
+/*********************************************************//**
+ * Return the copy or deletion covering offset offa of the 1st file
+ * (NULL if none does).
+ *************************************************************
+ */
+const Hunk *delta_hunk_at( const Delta *delta, size_t offa )
+{
+    size_t lo = 0, hi, n;
+
+    if ( !delta || !delta->bya )
+        return NULL;
+
+    /* the last one starting at or before offa, or a few before it */
+    for (hi=delta->nbya; lo < hi; ) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if ( delta->hunks[ delta->bya[mid] ].offa <= offa )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    for (n=0; lo > 0 && n < 8; lo--, n++) {
+        const Hunk *h = &delta->hunks[ delta->bya[lo-1] ];
+        if ( offa < h->offa + h->lena )
+            return h;
+    }
+
+    return NULL;
+}
+
+/*********************************************************//**
+ *
+ *************************************************************
+ */
+void delta_cleanup( Delta *delta )
+{
+    if ( !delta )
+        return;
+
+    free( delta->hunks );
+    free( delta->bya );
+    memset( delta, 0, sizeof(Delta) );
+    return;
+}
@@ -0,0 +1,58 @@
+#ifndef DELTA_H                    /* start of inclusion guard */
+#define DELTA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* -----------------------------------
+ * Shift-tolerant binary diff (rsync-style block matching)
+ * -----------------------------------
+ */
+
+#define DELTA_BLOCKLEN        2048        /* min bytes per signature block      */
+#define DELTA_MAXBLOCKS        (4*1024*1024)    /* blocks grow to stay below this     */
+#define DELTA_MAXCHAIN        16        /* max blocks tried per weak sum      */
+#define DELTA_MAXHUNKS        (1024*1024)    /* matching stops beyond this         */
+
+enum HunkKind {
+    HUNK_COPY = 0,                /* the same bytes in both files       */
+    HUNK_DELETE,                /* bytes of the 1st file only         */
+    HUNK_INSERT                    /* bytes of the 2nd file only         */
+};
+
+#define NAME_HUNKKIND(k)                        \
+    ( (k) == HUNK_COPY ? 'c' : (k) == HUNK_DELETE ? 'd' : (k) == HUNK_INSERT ? 'i' : '?' )
+
+typedef struct Hunk {
+    size_t      offa, lena;        /* where in the 1st file (lena 0: ins) */
+    size_t      offb, lenb;        /* where in the 2nd file (lenb 0: del) */
+    unsigned char kind;            /* enum HunkKind                      */
+} Hunk;
+
+typedef struct DeltaSig {
+    size_t      datalen;        /* length of the signed data          */
+    size_t      blocklen;        /* bytes per block                    */
+    size_t      nblocks;        /* # of whole blocks                  */
+    uint32_t    *weak;            /* rolling checksum of each block     */
+    uint64_t    *strong;        /* XXH64 of each block                */
+} DeltaSig;
+
+typedef struct Delta {
+    Hunk        *hunks;            /* in 2nd file order (dels 1st)       */
+    size_t      n, cap;            /* # of used & allocated hunks        */
+    size_t      *bya;            /* copies & deletions in 1st file order */
+    size_t      nbya;            /* ... and their #                    */
+    _Bool       truncated;        /* DELTA_MAXHUNKS reached             */
+} Delta;
+
+_Bool   deltasig_compute( const unsigned char *data, size_t len, unsigned nthreads, DeltaSig *sig );
+_Bool   deltasig_load( DeltaSig *sig, const char *path, uint64_t key );
+_Bool   deltasig_save( const DeltaSig *sig, const char *path, uint64_t key );
+void    deltasig_cleanup( DeltaSig *sig );
+
+_Bool   delta_compute( const DeltaSig *sig, const unsigned char *a, size_t lena,
+                       const unsigned char *b, size_t lenb, Delta *out );
+const Hunk *delta_hunk_at( const Delta *delta, size_t offa );
+void    delta_cleanup( Delta *delta );
+
+#endif                        /* end of inclusion guard            */
@@ -0,0 +1,347 @@
+/*****************************************************//**
+ * @brief   Byte-for-byte comparison of two buffers, by differing runs.
+ * @file    diff.c
+ * @par Language:
+ *      C (ANSI C99) + POSIX threads (SSE2 intrinsics when available)
+ *
+ * @remark  Bytes are compared 64 at a time: the XORs of 4 vectors are
+ *      OR-ed together, so identical stretches cost a single test per
+ *      step, and only blocks with differences are turned into a bit
+ *      mask. Bytes past the end of the shorter buffer differ. A
+ *      background thread lists the differing runs in file order, and
+ *      queries scan directly whatever it has not listed yet.
+ *********************************************************
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "hexview.h"
+#include "diff.h"
+
+/*********************************************************//**
+ * Return a mask with bit i set if a[i] != b[i], for i in [0,64).
+ *************************************************************
+ */
+static inline uint64_t diff_mask64( const unsigned char *a, const unsigned char *b )
+{
+#if defined(__SSE2__)
+    const __m128i x0 = _mm_xor_si128( _mm_loadu_si128((const __m128i *)(a + 0x00)),
+                                      _mm_loadu_si128((const __m128i *)(b + 0x00)) );
+    const __m128i x1 = _mm_xor_si128( _mm_loadu_si128((const __m128i *)(a + 0x10)),
+                                      _mm_loadu_si128((const __m128i *)(b + 0x10)) );
+    const __m128i x2 = _mm_xor_si128( _mm_loadu_si128((const __m128i *)(a + 0x20)),
+                                      _mm_loadu_si128((const __m128i *)(b + 0x20)) );
+    const __m128i x3 = _mm_xor_si128( _mm_loadu_si128((const __m128i *)(a + 0x30)),
+                                      _mm_loadu_si128((const __m128i *)(b + 0x30)) );
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i any = _mm_or_si128( _mm_or_si128(x0, x1), _mm_or_si128(x2, x3) );
+
+    if ( 0xFFFF == _mm_movemask_epi8( _mm_cmpeq_epi8(any, zero) ) )
+        return 0;                /* the common case: all equal */
+
+    return (uint64_t)(uint16_t) ~_mm_movemask_epi8( _mm_cmpeq_epi8(x0, zero) )
+        | (uint64_t)(uint16_t) ~_mm_movemask_epi8( _mm_cmpeq_epi8(x1, zero) ) << 16
+        | (uint64_t)(uint16_t) ~_mm_movemask_epi8( _mm_cmpeq_epi8(x2, zero) ) << 32
+        | (uint64_t)(uint16_t) ~_mm_movemask_epi8( _mm_cmpeq_epi8(x3, zero) ) << 48;
+#else
+    uint64_t wa, wb, m = 0;
+    int i;
+
+    for (i=0; i < 64; i += 8) {
+        memcpy( &wa, &a[i], sizeof(wa) );
+        memcpy( &wb, &b[i], sizeof(wb) );
+        if ( wa != wb ) {
+            int k;
+            for (k=0; k < 8; k++)
+                m |= (uint64_t)(a[i+k] != b[i+k]) << (i+k);
+        }
+    }
+    return m;
+#endif
+}
+
+/*********************************************************//**
+ * Return true if the i'th bytes of the buffers differ.
+ *************************************************************
+ */
+_Bool diff_at( const Diff *d, size_t i )
+{
+    if ( i >= myMAX(d->lena, d->lenb) )
+        return false;
+    return i >= myMIN(d->lena, d->lenb) || d->a[i] != d->b[i];
+}
+
+/*********************************************************//**
+ * Return the 1st offset in [from,to) where the bytes differ (or are
+ * equal, if !differ), or to if there is none.
+ *************************************************************
+ */
+size_t diff_find( const Diff *d, size_t from, size_t to, _Bool differ )
+{
+    const size_t common = myMIN( d->lena, d->lenb );
+    size_t i = from;
+
+    to = myMIN( to, myMAX(d->lena, d->lenb) );
+    while ( i < to && i < common )
+    {
+        if ( i + 64 <= common ) {
+            uint64_t m = diff_mask64( &d->a[i], &d->b[i] );
+            if ( !differ )
+                m = ~m;
+            if ( m )
+                return myMIN( i + __builtin_ctzll(m), to );
+            i += 64;
+        }
+        else if ( (d->a[i] != d->b[i]) == differ )
+            return i;
+        else
+            i++;
+    }
+
+    /* past the shorter buffer everything differs */
+    return (i < to && differ) ? i : to;
+}
+
+/*********************************************************//**
+ * Return the last offset in [from,to) where the bytes differ (or are
+ * equal, if !differ), or DIFF_NONE if there is none.
+ *************************************************************
+ */
+size_t diff_rfind( const Diff *d, size_t from, size_t to, _Bool differ )
+{
+    const size_t common = myMIN( d->lena, d->lenb );
+    size_t i;
+
+    to = myMIN( to, myMAX(d->lena, d->lenb) );
+    if ( from >= to )
+        return DIFF_NONE;
+
+    /* past the shorter buffer everything differs */
+    if ( to > common ) {
+        if ( differ )
+            return to - 1;
+        to = myMAX( common, from );
+    }
+
+    for (i=to; i > from; )
+    {
+        if ( i - from >= 64 ) {
+            uint64_t m = diff_mask64( &d->a[i-64], &d->b[i-64] );
+            if ( !differ )
+                m = ~m;
+            if ( m )
+                return i - 64 + (63 - __builtin_clzll(m));
+            i -= 64;
+        }
+        else {
+            i--;
+            if ( (d->a[i] != d->b[i]) == differ )
+                return i;
+        }
+    }
+
+    return DIFF_NONE;
+}
+
+/*********************************************************//**
+ * Append a run (extending the last one, if it is adjacent).
+ *************************************************************
+ */
+static _Bool diff_add( Diff *d, size_t off, size_t len )
+{
+    if ( d->nruns > 0 && d->runs[d->nruns-1].off + d->runs[d->nruns-1].len == off ) {
+        d->runs[d->nruns-1].len += len;
+        return true;
+    }
+    if ( d->nruns >= DIFF_MAXRUNS )
+        return false;
+
+    if ( d->nruns == d->cap ) {
+        const size_t cap = d->cap ? 2 * d->cap : 1024;
+        DiffRun *try = realloc( d->runs, cap * sizeof(DiffRun) );
+        if ( !try )
+            return false;
+        d->runs = try;
+        d->cap  = cap;
+    }
+    d->runs[d->nruns].off = off;
+    d->runs[d->nruns].len = len;
+    d->nruns++;
+
+    return true;
+}
+
+/*********************************************************//**
+ * Thread entry: list the differing runs, DIFF_CHUNKLEN bytes at a time.
+ *************************************************************
+ */
+static void *diff_list( void *arg )
+{
+    Diff *d = arg;
+    const size_t len = myMAX( d->lena, d->lenb );
+    size_t off, end, i, j;
+    _Bool  ok = true;
+
+    for (off=0; off < len && ok && !d->stop; off = end)
+    {
+        end = myMIN( len - off, (size_t) DIFF_CHUNKLEN ) + off;
+
+        pthread_mutex_lock( &d->lock );
+        for (i=off; ok && (i = diff_find(d, i, end, true)) < end; i = j) {
+            j  = diff_find( d, i, end, false );
+            ok = diff_add( d, i, j - i );
+        }
+        if ( ok )
+            d->done = end;
+        else
+            d->full = true;
+        pthread_mutex_unlock( &d->lock );
+    }
+
+    return NULL;
+}
+
+/*********************************************************//**
+ * Set up the comparison of a[0..lena) with b[0..lenb), and start
+ * listing its differing runs in the background if so requested.
+ *************************************************************
+ */
+_Bool diff_init( Diff *d, const unsigned char *a, size_t lena,
+                 const unsigned char *b, size_t lenb, _Bool background )
+{
+    if ( !d || !a || !b )
+        return false;
+    memset( d, 0, sizeof(Diff) );
+
+    d->a    = a;
+    d->b    = b;
+    d->lena = lena;
+    d->lenb = lenb;
+    if ( 0 != pthread_mutex_init( &d->lock, NULL ) )
+        return false;
+
+    if ( background )
+        d->running = (0 == pthread_create( &d->tid, NULL, diff_list, d ));
+
+    return true;
+}
+
+/*********************************************************//**
+ * Return the offset of the 1st differing run starting after off, or
+ * DIFF_NONE if there is none.
+ *************************************************************
+ */
+size_t diff_next( Diff *d, size_t off )
+{
+    const size_t len = myMAX( d->lena, d->lenb );
+    size_t lo, hi, done, i;
+
+    /* 1st listed run starting after off (the list is complete up to done) */
+    pthread_mutex_lock( &d->lock );
+    done = d->done;
+    for (lo=0, hi=d->nruns; lo < hi; ) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if ( d->runs[mid].off > off )
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    if ( lo < d->nruns ) {
+        i = d->runs[lo].off;
+        pthread_mutex_unlock( &d->lock );
+        return i;
+    }
+    pthread_mutex_unlock( &d->lock );
+
+    /* not listed yet: look for a byte that differs right after an equal one */
+    for (i = myMAX( off + 1, done ); i < len; )
+    {
+        if ( (i = diff_find(d, i, len, true)) >= len )
+            break;
+        if ( 0 == i || !diff_at(d, i-1) )
+            return i;
+        i = diff_find( d, i, len, false );
+    }
+
+    return DIFF_NONE;
+}
+
+/*********************************************************//**
+ * Return the offset of the last differing run starting before off,
+ * or DIFF_NONE if there is none.
+ *************************************************************
+ */
+size_t diff_prev( Diff *d, size_t off )
+{
+    size_t lo, hi, done, i;
+
+    pthread_mutex_lock( &d->lock );
+    done = d->done;
+    pthread_mutex_unlock( &d->lock );
+
+    /* not listed yet: the last differing byte, back to its run's start */
+    if ( off > done && DIFF_NONE != (i = diff_rfind( d, done, off, true )) ) {
+        const size_t eq = diff_rfind( d, 0, i, false );
+        return DIFF_NONE == eq ? 0 : eq + 1;
+    }
+
+    /* last listed run starting before off */
+    pthread_mutex_lock( &d->lock );
+    for (lo=0, hi=d->nruns; lo < hi; ) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if ( d->runs[mid].off < off )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    i = lo > 0 ? d->runs[lo-1].off : DIFF_NONE;
+    pthread_mutex_unlock( &d->lock );
+
+    return i;
+}
+
+/*********************************************************//**
+ * Return the share (0.0 to 1.0) of the bytes listed so far, and the
+ * # of runs found in them into nruns (if not NULL).
+ *************************************************************
+ */
+double diff_progress( Diff *d, size_t *nruns )
+{
+    const size_t len = myMAX( d->lena, d->lenb );
+    double done;
+
+    pthread_mutex_lock( &d->lock );
+    done = len > 0 ? (double) d->done / len : 1.0;
+    if ( nruns )
+        *nruns = d->nruns;
+    pthread_mutex_unlock( &d->lock );
+
+    return done;
+}
+
+/*********************************************************//**
+ * Stop the background listing (if any) & free the runs.
+ *************************************************************
+ */
+void diff_cleanup( Diff *d )
+{
+    if ( !d || !d->a )
+        return;
+
+    if ( d->running ) {
+        d->stop = 1;
+        pthread_join( d->tid, NULL );
+    }
+    pthread_mutex_destroy( &d->lock );
+    free( d->runs );
+    memset( d, 0, sizeof(Diff) );
+
+    return;
+}
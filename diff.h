@@ -0,0 +1,44 @@
+#ifndef DIFF_H                    /* start of inclusion guard */
+#define DIFF_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+/* -----------------------------------
+ * Byte-for-byte comparison of two buffers
+ * -----------------------------------
+ */
+
+#define DIFF_CHUNKLEN        (4*1024*1024)    /* bytes listed per locking step      */
+#define DIFF_MAXRUNS        (4*1024*1024)    /* listing stops beyond this          */
+#define DIFF_NONE        ((size_t)-1)    /* no such offset                     */
+
+typedef struct DiffRun {
+    size_t      off;            /* offset of the 1st differing byte   */
+    size_t      len;            /* # of consecutive differing bytes   */
+} DiffRun;
+
+typedef struct Diff {
+    const unsigned char *a, *b;        /* the compared data ...              */
+    size_t      lena, lenb;        /* ... and their lengths              */
+    DiffRun     *runs;            /* maximal differing runs, by offset  */
+    size_t      nruns, cap;        /* # of used & allocated runs         */
+    size_t      done;            /* runs before this offset are listed */
+    _Bool       full;            /* DIFF_MAXRUNS reached, listing quit */
+    pthread_mutex_t lock;        /* guards runs, nruns, done & full    */
+    pthread_t   tid;            /* the background lister              */
+    _Bool       running;        /* ... is it started?                 */
+    volatile int stop;            /* ... should it stop?                */
+} Diff;
+
+_Bool   diff_init( Diff *d, const unsigned char *a, size_t lena,
+                   const unsigned char *b, size_t lenb, _Bool background );
+_Bool   diff_at( const Diff *d, size_t i );
+size_t  diff_find( const Diff *d, size_t from, size_t to, _Bool differ );
+size_t  diff_rfind( const Diff *d, size_t from, size_t to, _Bool differ );
+size_t  diff_next( Diff *d, size_t off );
+size_t  diff_prev( Diff *d, size_t off );
+double  diff_progress( Diff *d, size_t *nruns );
+void    diff_cleanup( Diff *d );
+
+#endif                        /* end of inclusion guard            */
@@ -0,0 +1,366 @@
+/*****************************************************//**
+ * @brief   Scanning files past the page cache: O_DIRECT reads by io_uring.
+ * @file    direct.c
+ * @par Language:
+ *      C (ANSI C99) (+ Linux io_uring & O_DIRECT, or POSIX pread)
+ *
+ * @remark  Full-file scans (searches, hashes, strings) of mapped files
+ *      fill the page cache with pages read just once, evicting those
+ *      of everything else running. Here the file is opened O_DIRECT,
+ *      so the reads go from the device into DIRECT_QDEPTH buffers of
+ *      our own (aligned as O_DIRECT wants), without being cached, and
+ *      they are queued on an io_uring (set up by the raw syscalls: no
+ *      liburing needed), so the device always has the next reads to
+ *      do while the caller scans the chunk read last: each buffer is
+ *      queued again for the next chunk as soon as it is scanned. Where
+ *      io_uring is not available the chunks are read by pread() in
+ *      turn, and where O_DIRECT is not (e.g. tmpfs) the pages of each
+ *      chunk are dropped from the cache (by posix_fadvise()) once it
+ *      is scanned, which is the best that can be done there.
+ *********************************************************
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE                /* O_DIRECT */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#include "hexview.h"
+#include "stats.h"
+#include "direct.h"
+
+#ifdef HV_POSIX
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+#define DIRECT_URING                /* io_uring available */
+#endif
+
+#define DIRECT_ALIGN        4096        /* of buffers, offsets & lengths (O_DIRECT) */
+
+typedef struct Slot {
+    unsigned char *buf;            /* DIRECT_HEADROOM + DIRECT_CHUNKLEN  */
+    unsigned long long off;        /* the chunk read into it ...         */
+    long        res;            /* ... its bytes read, or -errno      */
+    _Bool       done;            /* ... once read                      */
+} Slot;
+
+#ifdef DIRECT_URING
+typedef struct Ring {
+    int         fd;
+    unsigned    *sqhead, *sqtail, *sqmask, *sqarray;
+    unsigned    *cqhead, *cqtail, *cqmask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void        *sq, *cq;        /* the rings mapped ...               */
+    size_t      sqlen, cqlen, sqeslen;    /* ... & their lengths                */
+    unsigned    nqueued;        /* sqes queued but not submitted yet  */
+    unsigned    ninflight;        /* reads queued but not ended yet     */
+} Ring;
+
+/*********************************************************//**
+ * Set up an io_uring of n entries (& map its rings). Return false
+ * if io_uring is not available.
+ *************************************************************
+ */
+static _Bool ring_init( Ring *r, unsigned n )
+{
+    struct io_uring_params p;
+    unsigned char *sq, *cq;
+
+    memset( r, 0, sizeof(Ring) );
+    memset( &p, 0, sizeof(p) );
+    if ( (r->fd = (int) syscall( __NR_io_uring_setup, n, &p )) < 0 )
+        return false;
+
+    r->sqlen   = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cqlen   = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    r->sqeslen = p.sq_entries * sizeof(struct io_uring_sqe);
+    if ( p.features & IORING_FEAT_SINGLE_MMAP )
+        r->sqlen = r->cqlen = myMAX( r->sqlen, r->cqlen );
+
+    r->sq = mmap( NULL, r->sqlen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                  r->fd, IORING_OFF_SQ_RING );
+    r->cq = (p.features & IORING_FEAT_SINGLE_MMAP) ? r->sq
+        : mmap( NULL, r->cqlen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                r->fd, IORING_OFF_CQ_RING );
+    r->sqes = mmap( NULL, r->sqeslen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    r->fd, IORING_OFF_SQES );
+    if ( MAP_FAILED == r->sq || MAP_FAILED == r->cq || MAP_FAILED == r->sqes ) {
+        if ( MAP_FAILED != r->sq )
+            munmap( r->sq, r->sqlen );
+        if ( MAP_FAILED != r->cq && r->cq != r->sq )
+            munmap( r->cq, r->cqlen );
+        if ( MAP_FAILED != r->sqes )
+            munmap( r->sqes, r->sqeslen );
+        close( r->fd );
+        return false;
+    }
+
+    sq = r->sq;
+    cq = r->cq;
+    r->sqhead  = (unsigned *) (sq + p.sq_off.head);
+    r->sqtail  = (unsigned *) (sq + p.sq_off.tail);
+    r->sqmask  = (unsigned *) (sq + p.sq_off.ring_mask);
+    r->sqarray = (unsigned *) (sq + p.sq_off.array);
+    r->cqhead  = (unsigned *) (cq + p.cq_off.head);
+    r->cqtail  = (unsigned *) (cq + p.cq_off.tail);
+    r->cqmask  = (unsigned *) (cq + p.cq_off.ring_mask);
+    r->cqes    = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+
+    return true;
+}
+
+static void ring_exit( Ring *r )
+{
+    munmap( r->sqes, r->sqeslen );
+    if ( r->cq != r->sq )
+        munmap( r->cq, r->cqlen );
+    munmap( r->sq, r->sqlen );
+    close( r->fd );
+    return;
+}
+
+/*********************************************************//**
+ * Queue a read of n bytes of fd at off into buf (tagged with user).
+ *************************************************************
+ */
+static void ring_read( Ring *r, int fd, void *buf, size_t n, unsigned long long off, unsigned user )
+{
+    const unsigned tail = *r->sqtail;
+    const unsigned i    = tail & *r->sqmask;
+    struct io_uring_sqe *sqe = &r->sqes[i];
+
+    memset( sqe, 0, sizeof(*sqe) );
+    sqe->opcode    = IORING_OP_READ;
+    sqe->fd        = fd;
+    sqe->addr      = (unsigned long long) (size_t) buf;
+    sqe->len       = (unsigned) n;
+    sqe->off       = off;
+    sqe->user_data = user;
+    r->sqarray[i]  = i;
+    __atomic_store_n( r->sqtail, tail + 1, __ATOMIC_RELEASE );
+    r->nqueued++;
+    r->ninflight++;
+
+    return;
+}
+
+/*********************************************************//**
+ * Submit the reads queued & wait for at least wait of them to end,
+ * marking the slots of those ended done.
+ *************************************************************
+ */
+static _Bool ring_wait( Ring *r, unsigned wait, Slot *slots )
+{
+    unsigned head;
+
+    while ( r->nqueued > 0 || wait > 0 )
+    {
+        const int got = (int) syscall( __NR_io_uring_enter, r->fd, r->nqueued, wait,
+                                       wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0 );
+        if ( got < 0 ) {
+            if ( EINTR == errno )
+                continue;
+            return false;
+        }
+        r->nqueued -= myMIN( (unsigned) got, r->nqueued );
+
+        /* reap the reads ended */
+        for (head = *r->cqhead; head != __atomic_load_n( r->cqtail, __ATOMIC_ACQUIRE ); head++)
+        {
+            const struct io_uring_cqe *cqe = &r->cqes[ head & *r->cqmask ];
+            slots[ cqe->user_data ].res  = cqe->res;
+            slots[ cqe->user_data ].done = true;
+            r->ninflight--;
+            wait -= wait > 0;
+        }
+        __atomic_store_n( r->cqhead, head, __ATOMIC_RELEASE );
+    }
+
+    return true;
+}
+#endif
+
+#ifdef HV_POSIX
+/*********************************************************//**
+ * Read up to n bytes of fd at off into buf (by pread, until n or the
+ * end of the file). Return the # read, or -errno.
+ *************************************************************
+ */
+static long direct_pread( int fd, unsigned char *buf, size_t n, unsigned long long off )
+{
+    size_t  got = 0;
+    ssize_t r;
+
+    while ( got < n ) {
+        if ( (r = pread( fd, &buf[got], n - got, (off_t) (off + got) )) < 0 ) {
+            if ( EINTR == errno )
+                continue;
+            return -errno;
+        }
+        if ( 0 == r )
+            break;
+        got += (size_t) r;
+    }
+    return (long) got;
+}
+
+/*********************************************************//**
+ * Scan the file fname chunk by chunk, in order, by fn (with ctx),
+ * reading it past the page cache (see above). The bytes read & how
+ * long it took go into stats (unless NULL). Return false on failure
+ * (errno set), or if fn stopped the scan.
+ *************************************************************
+ */
+_Bool direct_scan( const char *fname, DirectFn fn, void *ctx, DirectStats *stats )
+{
+    Slot    slots[ DIRECT_QDEPTH ];
+    DirectStats st = { 0, 0.0, true, false };
+    unsigned long long size, next = 0, head = 0;
+    struct stat sb;
+    _Bool   ok = false;
+    int     fd, i;
+    long    res;
+#ifdef DIRECT_URING
+    Ring    ring;
+#endif
+
+    memset( slots, 0, sizeof(slots) );
+    st.us = stats_now();
+
+#ifdef O_DIRECT
+    if ( (fd = open( fname, O_RDONLY | O_DIRECT )) < 0 && EINVAL == errno )
+#endif
+    {
+        st.odirect = false;            /* not supported by its fs */
+        fd = open( fname, O_RDONLY );
+    }
+    if ( fd < 0 )
+        return false;
+    if ( 0 != fstat( fd, &sb ) )
+        goto ret;
+    if ( !S_ISREG( sb.st_mode ) ) {
+        errno = S_ISDIR( sb.st_mode ) ? EISDIR : ENOTSUP;
+        goto ret;
+    }
+    size = (unsigned long long) sb.st_size;
+
+    for (i=0; i < DIRECT_QDEPTH; i++)
+        if ( 0 != posix_memalign( (void **) &slots[i].buf, DIRECT_ALIGN,
+                                  DIRECT_HEADROOM + DIRECT_CHUNKLEN )
+        ) {
+            slots[i].buf = NULL;
+            errno = ENOMEM;
+            goto ret;
+        }
+
+#ifdef DIRECT_URING
+    st.uring = ring_init( &ring, DIRECT_QDEPTH );
+#endif
+
+    /* read the chunks in turn (DIRECT_QDEPTH ahead, by io_uring) */
+    for (head=0; head < size; head += DIRECT_CHUNKLEN)
+    {
+        Slot *s = &slots[ (head / DIRECT_CHUNKLEN) % DIRECT_QDEPTH ];
+        size_t want = (size_t) myMIN( (unsigned long long) DIRECT_CHUNKLEN, size - head );
+
+#ifdef DIRECT_URING
+        if ( st.uring )
+        {
+            /* queue the chunks not queued yet, as slots are free */
+            for (; next < size && next < head + (unsigned long long) DIRECT_QDEPTH * DIRECT_CHUNKLEN;
+                next += DIRECT_CHUNKLEN)
+            {
+                Slot *q = &slots[ (next / DIRECT_CHUNKLEN) % DIRECT_QDEPTH ];
+                q->off  = next;
+                q->done = false;
+                ring_read( &ring, fd, &q->buf[DIRECT_HEADROOM], DIRECT_CHUNKLEN, next,
+                           (unsigned) (q - slots) );
+            }
+            if ( !ring_wait( &ring, s->done ? 0 : 1, slots ) )
+                goto ret;
+            while ( !s->done )
+                if ( !ring_wait( &ring, 1, slots ) )
+                    goto ret;
+            res = s->res;
+
+            /* a short read (not at the end): read the rest in place */
+            if ( res >= 0 && (size_t) res < want && (!st.odirect || 0 == res % DIRECT_ALIGN) ) {
+                const long more = direct_pread( fd, &s->buf[DIRECT_HEADROOM + res],
+                                                DIRECT_CHUNKLEN - (size_t) res, head + res );
+                res = more < 0 ? more : res + more;
+            }
+        }
+        else
+#endif
+        res = direct_pread( fd, &s->buf[DIRECT_HEADROOM], DIRECT_CHUNKLEN, head );
+
+        if ( res < 0 ) {
+            errno = (int) -res;
+            goto ret;
+        }
+        if ( 0 == res )                /* truncated meanwhile */
+            break;
+        res = myMIN( res, (long) want );        /* ... or grown */
+        st.nbytes += (unsigned long long) res;
+
+        if ( !fn( &s->buf[DIRECT_HEADROOM], (size_t) res, head, ctx ) )
+            goto ret;
+#if defined(POSIX_FADV_DONTNEED)
+        if ( !st.odirect )
+            posix_fadvise( fd, (off_t) head, (off_t) res, POSIX_FADV_DONTNEED );
+#endif
+    }
+    ok = true;
+
+ret:
+    {
+        const int saved = errno;
+#ifdef DIRECT_URING
+        if ( st.uring ) {
+            /* let the reads still in flight end, before their buffers go */
+            while ( ring.ninflight > 0 && ring_wait( &ring, 1, slots ) )
+                ;
+            ring_exit( &ring );
+        }
+#endif
+        for (i=0; i < DIRECT_QDEPTH; i++)
+            free( slots[i].buf );
+        close( fd );
+        errno = saved;
+    }
+
+    st.us = stats_now() - st.us;
+    if ( stats )
+        *stats = st;
+    return ok;
+}
+
+#else                        /* no pread, no O_DIRECT */
+
+_Bool direct_scan( const char *fname, DirectFn fn, void *ctx, DirectStats *stats )
+{
+    (void) fname;
+    (void) fn;
+    (void) ctx;
+    (void) stats;
+    errno = ENOTSUP;
+    return false;
+}
+#endif
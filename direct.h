@@ -0,0 +1,32 @@
+#ifndef DIRECT_H                    /* start of inclusion guard */
+#define DIRECT_H
+
+#include <stddef.h>
+
+/* -----------------------------------
+ * Scanning files past the page cache (O_DIRECT reads, by io_uring)
+ * -----------------------------------
+ *
+ * A file is read DIRECT_CHUNKLEN bytes at a time, DIRECT_QDEPTH reads
+ * in flight, and handed to fn chunk by chunk, in order, while the next
+ * ones are read. fn may write the DIRECT_HEADROOM bytes before data
+ * (e.g. to prepend the end of the previous chunk), and returns false
+ * to stop the scan.
+ */
+
+#define DIRECT_CHUNKLEN        (1024*1024)    /* bytes per read                     */
+#define DIRECT_QDEPTH        16        /* reads in flight                    */
+#define DIRECT_HEADROOM        (64*1024)    /* bytes fn may write before data     */
+
+typedef _Bool (*DirectFn)( unsigned char *data, size_t n, unsigned long long off, void *ctx );
+
+typedef struct DirectStats {
+    unsigned long long nbytes;        /* bytes read ...                     */
+    double      us;            /* ... in us (scanning them included) */
+    _Bool       odirect;        /* read past the page cache?          */
+    _Bool       uring;            /* ... by io_uring (else by pread())? */
+} DirectStats;
+
+_Bool   direct_scan( const char *fname, DirectFn fn, void *ctx, DirectStats *stats );
+
+#endif                        /* end of inclusion guard            */
@@ -0,0 +1,378 @@
+/*****************************************************//**
+ * @brief   Per-block Shannon entropy & byte histograms of a buffer.
+ * @file    entropy.c
+ * @par Language:
+ *      C (ANSI C99) + POSIX threads
+ *
+ * @remark  Histograms are counted into 4 interleaved tables, 8 bytes
+ *      per load, so consecutive equal bytes do not stall on the
+ *      same counter. The blocks are split evenly over the threads,
+ *      each one keeping its own whole-data histogram to be summed
+ *      up at the end.
+ *********************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "hexview.h"
+#include "entropy.h"
+
+#ifdef HV_POSIX
+#include <unistd.h>
+#endif
+
+#define ENT_MAGIC    "HVENT01"        /* signature of cache files (+'\0')  */
+
+typedef struct EntJob {
+    const unsigned char *data;    /* the whole data                     */
+    size_t      len;            /* ... and its length                 */
+    size_t      first, last;        /* blocks [first,last) are ours       */
+    const double *clogc;        /* c*log2(c) for c in [0,blocklen]    */
+    EntMap      *map;            /* where the results go               */
+    uint64_t    hist[256];        /* our share of the total histogram   */
+} EntJob;
+
+/*********************************************************//**
+ * Count the bytes of p[0..n) into 4 interleaved tables.
+ *************************************************************
+ */
+static void hist_count( const unsigned char *p, size_t n, uint32_t h[4][256] )
+{
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        uint64_t w;
+        memcpy( &w, &p[i], sizeof(w) );
+        h[0][ w        & 0xFF ]++;
+        h[1][ (w >> 8)  & 0xFF ]++;
+        h[2][ (w >> 16) & 0xFF ]++;
+        h[3][ (w >> 24) & 0xFF ]++;
+        h[0][ (w >> 32) & 0xFF ]++;
+        h[1][ (w >> 40) & 0xFF ]++;
+        h[2][ (w >> 48) & 0xFF ]++;
+        h[3][ (w >> 56) & 0xFF ]++;
+    }
+    for (; i < n; i++)
+        h[0][ p[i] ]++;
+
+    return;
+}
+
+/*********************************************************//**
+ * Add the bytes of p[0..n) to a 256-bin histogram.
+ *************************************************************
+ */
+void ent_histogram( const unsigned char *p, size_t n, uint64_t *hist )
+{
+    uint32_t h[4][256];
+    size_t   step, c;
+
+    if ( !p || !hist )
+        return;
+
+    /* keep the 32-bit counters of hist_count() from overflowing */
+    for (; n > 0; n -= step, p += step)
+    {
+        step = myMIN( n, ENT_MAXBLOCKLEN );
+        memset( h, 0, sizeof(h) );
+        hist_count( p, step, h );
+        for (c=0; c < 256; c++)
+            hist[c] += h[0][c] + h[1][c] + h[2][c] + h[3][c];
+    }
+
+    return;
+}
+
+/*********************************************************//**
+ * Return the # of printable bytes (7-bit, TAB, CR or LF) in a histogram.
+ *************************************************************
+ */
+uint64_t ent_printable( const uint64_t *hist )
+{
+    uint64_t n = hist['\t'] + hist['\n'] + hist['\r'];
+    int c;
+
+    for (c=0x20; c <= 0x7E; c++)
+        n += hist[c];
+    return n;
+}
+
+/*********************************************************//**
+ * Thread entry: histogram & entropy of the job's blocks.
+ *************************************************************
+ */
+static void *entmap_job( void *arg )
+{
+    EntJob  *job = arg;
+    EntMap  *map = job->map;
+    size_t  b;
+
+    for (b=job->first; b < job->last; b++)
+    {
+        uint32_t h[4][256];
+        const size_t off = b * map->blocklen;
+        const size_t n = myMIN( map->blocklen, job->len - off );
+        double   sum = 0.0;
+        uint32_t nprint = 0;
+        int      c;
+
+        memset( h, 0, sizeof(h) );
+        hist_count( &job->data[off], n, h );
+
+        for (c=0; c < 256; c++)
+        {
+            const uint32_t cnt = h[0][c] + h[1][c] + h[2][c] + h[3][c];
+            sum += job->clogc[ cnt ];
+            job->hist[c] += cnt;
+            if ( (c >= 0x20 && c <= 0x7E) || c == '\t' || c == '\n' || c == '\r' )
+                nprint += cnt;
+            if ( 0 == c )
+                map->blocks[b].nzero = cnt;
+        }
+
+        /* H = log2(n) - sum( c*log2(c) ) / n */
+        map->blocks[b].bits   = (float)( n > 0 ? log2((double)n) - sum / n : 0.0 );
+        map->blocks[b].nprint = nprint;
+    }
+
+    return NULL;
+}
+
+/*********************************************************//**
+ * Compute the histogram & entropy of every blocklen bytes of data
+ * (and the histogram of the whole data) using up to nthreads threads.
+ *************************************************************
+ */
+_Bool entmap_compute( const unsigned char *data, size_t len, size_t blocklen,
+                      unsigned nthreads, EntMap *map )
+{
+    EntJob      *jobs = NULL;
+    pthread_t   *tids = NULL;
+    double      *clogc = NULL;
+    size_t      per, i;
+    unsigned    t, nstarted = 0;
+
+    if ( !data || !map || blocklen < 1 || blocklen > ENT_MAXBLOCKLEN )
+        return false;
+
+    memset( map, 0, sizeof(EntMap) );
+    map->datalen  = len;
+    map->blocklen = blocklen;
+    map->nblocks  = len / blocklen + (len % blocklen != 0 ? 1 : 0);
+
+    if ( nthreads < 1 )
+        nthreads = 1;
+    if ( nthreads > map->nblocks )
+        nthreads = map->nblocks > 0 ? map->nblocks : 1;
+
+    map->blocks = calloc( map->nblocks + 1, sizeof(EntBlock) );
+    clogc = malloc( (blocklen + 1) * sizeof(double) );
+    jobs  = calloc( nthreads, sizeof(EntJob) );
+    tids  = calloc( nthreads, sizeof(pthread_t) );
+    if ( !map->blocks || !clogc || !jobs || !tids ) {
+        free( clogc ); free( jobs ); free( tids );
+        entmap_cleanup( map );
+        return false;
+    }
+
+    for (i=0; i <= blocklen; i++)
+        clogc[i] = i > 0 ? i * log2( (double)i ) : 0.0;
+
+    per = map->nblocks / nthreads;
+    for (t=0; t < nthreads; t++)
+    {
+        jobs[t].data  = data;
+        jobs[t].len   = len;
+        jobs[t].first = t * per;
+        jobs[t].last  = (t == nthreads-1) ? map->nblocks : (t+1) * per;
+        jobs[t].clogc = clogc;
+        jobs[t].map   = map;
+    }
+
+    /* the calling thread takes care of the 1st job itself */
+    for (t=1; t < nthreads; t++, nstarted++)
+        if ( 0 != pthread_create( &tids[t], NULL, entmap_job, &jobs[t] ) )
+            break;
+    entmap_job( &jobs[0] );
+    for (t=1; t <= nstarted; t++)
+        pthread_join( tids[t], NULL );
+    for (t=nstarted+1; t < nthreads; t++)
+        entmap_job( &jobs[t] );
+
+    for (t=0; t < nthreads; t++)
+        for (i=0; i < 256; i++)
+            map->hist[i] += jobs[t].hist[i];
+
+    free( clogc );
+    free( jobs );
+    free( tids );
+
+    return true;
+}
+
+/*********************************************************//**
+ * Return the Shannon entropy (bits per byte) of a 256-bin histogram
+ * counting n bytes in total.
+ *************************************************************
+ */
+double entmap_bits( const uint64_t *hist, uint64_t n )
+{
+    double sum = 0.0;
+    int    c;
+
+    if ( !hist || 0 == n )
+        return 0.0;
+
+    for (c=0; c < 256; c++)
+        if ( hist[c] )
+            sum += hist[c] * log2( (double) hist[c] );
+
+    return log2( (double) n ) - sum / n;
+}
+
+/*********************************************************//**
+ * Return the enum EntClass of a block.
+ *************************************************************
+ */
+int entmap_class( const EntMap *map, size_t iblock )
+{
+    const EntBlock *blk;
+    size_t n;
+
+    if ( !map || !map->blocks || iblock >= map->nblocks )
+        return ENT_ZERO;
+
+    blk = &map->blocks[iblock];
+    n   = myMIN( map->blocklen, map->datalen - iblock * map->blocklen );
+
+    if ( blk->nzero == n )
+        return ENT_ZERO;
+    if ( blk->nprint >= ENT_TEXTRATIO * n )
+        return ENT_TEXT;
+    if ( blk->bits > ENT_HIGHBITS )
+        return ENT_HIGH;
+    if ( blk->bits < ENT_LOWBITS )
+        return ENT_LOW;
+
+    return ENT_MID;
+}
+
+/*********************************************************//**
+ * Read a map previously saved with entmap_save() under the same key.
+ * Return false (and leave map zeroed) if there is no such map.
+ *************************************************************
+ */
+_Bool entmap_load( EntMap *map, const char *path, uint64_t key )
+{
+    char     magic[ sizeof(ENT_MAGIC) ];
+    uint64_t hdr[4];            /* key, datalen, blocklen, nblocks   */
+    FILE     *fp;
+
+    if ( !map || !path )
+        return false;
+    memset( map, 0, sizeof(EntMap) );
+
+    if ( NULL == (fp = fopen(path, "rb")) )
+        return false;
+
+    if ( 1 != fread(magic, sizeof(magic), 1, fp) || memcmp(magic, ENT_MAGIC, sizeof(magic))
+        || 1 != fread(hdr, sizeof(hdr), 1, fp) || hdr[0] != key
+        || hdr[2] < 1 || hdr[2] > ENT_MAXBLOCKLEN
+        || hdr[3] != hdr[1] / hdr[2] + (hdr[1] % hdr[2] != 0)
+    )
+        goto ret_failure;
+
+    map->datalen  = hdr[1];
+    map->blocklen = hdr[2];
+    map->nblocks  = hdr[3];
+    if ( NULL == (map->blocks = calloc( map->nblocks + 1, sizeof(EntBlock) ))
+        || 1 != fread( map->hist, sizeof(map->hist), 1, fp )
+        || map->nblocks != fread( map->blocks, sizeof(EntBlock), map->nblocks, fp )
+    )
+        goto ret_failure;
+
+    fclose( fp );
+    return true;
+
+ret_failure:
+    fclose( fp );
+    entmap_cleanup( map );
+    return false;
+}
+
+/*********************************************************//**
+ * Save a map to a file, tagged with key (so entmap_load() can tell
+ * if it still describes the same data). It is written to a temp file
+ * next to path, then renamed to path: another hexview loading it at
+ * the same time, or a later one after a crash, never reads it torn.
+ *************************************************************
+ */
+_Bool entmap_save( const EntMap *map, const char *path, uint64_t key )
+{
+    uint64_t hdr[4];
+    FILE     *fp = NULL;
+    char     *tmp;
+    _Bool    success;
+
+    if ( !map || !map->blocks || !path
+        || NULL == (tmp = malloc( strlen(path) + sizeof(".XXXXXX") )) )
+        return false;
+#ifdef HV_POSIX
+    {
+        const int fd = mkstemp( strcat( strcpy( tmp, path ), ".XXXXXX" ) );
+        if ( -1 != fd && NULL == (fp = fdopen( fd, "wb" )) ) {
+            close( fd );
+            remove( tmp );
+        }
+    }
+#else
+    fp = fopen( strcat( strcpy( tmp, path ), ".tmp" ), "wb" );
+#endif
+    if ( NULL == fp ) {
+        free( tmp );
+        return false;
+    }
+
+    hdr[0] = key;
+    hdr[1] = map->datalen;
+    hdr[2] = map->blocklen;
+    hdr[3] = map->nblocks;
+
+    success = 1 == fwrite( ENT_MAGIC, sizeof(ENT_MAGIC), 1, fp )
+        && 1 == fwrite( hdr, sizeof(hdr), 1, fp )
+        && 1 == fwrite( map->hist, sizeof(map->hist), 1, fp )
+        && map->nblocks == fwrite( map->blocks, sizeof(EntBlock), map->nblocks, fp );
+#ifdef HV_POSIX
+    success = success && 0 == fflush(fp) && 0 == fsync( fileno(fp) );
+#endif
+
+    if ( 0 != fclose(fp) )
+        success = false;
+    if ( !success || 0 != rename( tmp, path ) ) {
+        remove( tmp );
+        success = false;
+    }
+    free( tmp );
+
+    return success;
+}
+
+/*********************************************************//**
+ *
+ *************************************************************
+ */
+void entmap_cleanup( EntMap *map )
+{
+    if ( !map )
+        return;
+
+    free( map->blocks );
+    memset( map, 0, sizeof(EntMap) );
+    return;
+}
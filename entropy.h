@@ -0,0 +1,61 @@
+#ifndef ENTROPY_H                /* start of inclusion guard */
+#define ENTROPY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* -----------------------------------
+ * Per-block Shannon entropy & byte histograms
+ * -----------------------------------
+ */
+
+#define ENT_BLOCKLEN        4096        /* default block length, in bytes     */
+#define ENT_MAXBLOCKLEN        (1024*1024)    /* max block length, in bytes         */
+
+/* block classes, from the entropy & the share of zero/printable bytes */
+enum EntClass {
+    ENT_ZERO = 0,                /* nothing but zero bytes             */
+    ENT_TEXT,                    /* mostly printable (text)            */
+    ENT_LOW,                    /* structured binary data             */
+    ENT_MID,                    /* e.g. machine code                  */
+    ENT_HIGH                    /* compressed or encrypted            */
+};
+
+#define ENT_HIGHBITS        7.2        /* entropy above this: ENT_HIGH       */
+#define ENT_LOWBITS        4.0        /* entropy below this: ENT_LOW        */
+#define ENT_TEXTRATIO        0.90        /* printable share above this: text   */
+
+/* glyph & name of each enum EntClass */
+#define ENT_GLYPHS        "_t.+#"
+#define NAME_ENTCLASS(c)                        \
+(                                    \
+    (c) == ENT_ZERO ? "zero" : (c) == ENT_TEXT ? "text"        \
+    : (c) == ENT_LOW ? "low" : (c) == ENT_MID ? "mid"        \
+    : (c) == ENT_HIGH ? "high" : "?"                \
+)
+
+typedef struct EntBlock {
+    float       bits;            /* Shannon entropy, in bits per byte  */
+    uint32_t    nzero;            /* # of zero bytes                    */
+    uint32_t    nprint;            /* # of printable (7-bit) bytes       */
+} EntBlock;
+
+typedef struct EntMap {
+    size_t      datalen;        /* length of the analyzed data        */
+    size_t      blocklen;        /* length of each block (last: less)  */
+    size_t      nblocks;        /* # of blocks                        */
+    uint64_t    hist[256];        /* byte histogram of the whole data   */
+    EntBlock    *blocks;        /* the per-block statistics           */
+} EntMap;
+
+_Bool   entmap_compute( const unsigned char *data, size_t len, size_t blocklen,
+                        unsigned nthreads, EntMap *map );
+int     entmap_class( const EntMap *map, size_t iblock );
+double  entmap_bits( const uint64_t *hist, uint64_t n );
+void    ent_histogram( const unsigned char *p, size_t n, uint64_t *hist );
+uint64_t ent_printable( const uint64_t *hist );
+_Bool   entmap_load( EntMap *map, const char *path, uint64_t key );
+_Bool   entmap_save( const EntMap *map, const char *path, uint64_t key );
+void    entmap_cleanup( EntMap *map );
+
+#endif                        /* end of inclusion guard            */
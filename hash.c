@@ -0,0 +1,786 @@
+/*****************************************************//**
+ * @brief   Checksums & hashes: CRC32, CRC32C, XXH64, MD5, SHA-1, SHA-256.
+ * @file    hash.c
+ * @par Language:
+ *      C (ANSI C99) + POSIX threads (x86 CRC instructions when available)
+ *
+ * @remark  CRC32 folds 64 bytes per step with PCLMULQDQ and CRC32C uses
+ *      the SSE4.2 crc32 instruction, both picked at run-time (slicing
+ *      by 8 tables otherwise). CRCs of adjacent chunks can be combined,
+ *      so hash_data() splits large buffers over threads for them. The
+ *      other algorithms are inherently sequential: a tree of them would
+ *      give a different digest than the standard one, so they are not.
+ *********************************************************
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <strings.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HASH_X86                /* CRC instructions may be there  */
+#endif
+
+#include "hexview.h"
+#include "hash.h"
+
+#define CRC32_POLY      0xEDB88320U        /* reflected polynomials      */
+#define CRC32C_POLY     0x82F63B78U
+
+#define HASH_MINCHUNK   (4*1024*1024)        /* min bytes per thread       */
+
+static const char *hash_names[ HASH_NALGS ] = {
+    "crc32", "crc32c", "xxh64", "md5", "sha1", "sha256"
+};
+
+static uint32_t crc32_table[8][256];        /* slicing by 8 tables        */
+static uint32_t crc32c_table[8][256];
+static _Bool    has_pclmul, has_sse42;        /* what the CPU can do        */
+static pthread_once_t hash_once = PTHREAD_ONCE_INIT;
+
+/* little & big endian loads/stores */
+#define LOAD32LE(p)                            \
+    ( (uint32_t)(p)[0] | (uint32_t)(p)[1] << 8            \
+    | (uint32_t)(p)[2] << 16 | (uint32_t)(p)[3] << 24 )
+#define LOAD64LE(p)    ( (uint64_t)LOAD32LE(p) | (uint64_t)LOAD32LE((p)+4) << 32 )
+#define LOAD32BE(p)                            \
+    ( (uint32_t)(p)[0] << 24 | (uint32_t)(p)[1] << 16        \
+    | (uint32_t)(p)[2] << 8 | (uint32_t)(p)[3] )
+#define ROTL32(x,n)    ( ((x) << (n)) | ((x) >> (32-(n))) )
+#define ROTR32(x,n)    ( ((x) >> (n)) | ((x) << (32-(n))) )
+#define ROTL64(x,n)    ( ((x) << (n)) | ((x) >> (64-(n))) )
+
+/*********************************************************//**
+ * Build the CRC tables & detect the CPU features (once).
+ *************************************************************
+ */
+static void hash_setup( void )
+{
+    uint32_t i, k, c32, c32c;
+
+    for (i=0; i < 256; i++)
+    {
+        for (c32=c32c=i, k=0; k < 8; k++) {
+            c32  = (c32 & 1)  ? (c32 >> 1)  ^ CRC32_POLY  : c32 >> 1;
+            c32c = (c32c & 1) ? (c32c >> 1) ^ CRC32C_POLY : c32c >> 1;
+        }
+        crc32_table[0][i]  = c32;
+        crc32c_table[0][i] = c32c;
+    }
+    for (i=0; i < 256; i++)
+        for (k=1; k < 8; k++) {
+            crc32_table[k][i] = (crc32_table[k-1][i] >> 8)
+                ^ crc32_table[0][ crc32_table[k-1][i] & 0xFF ];
+            crc32c_table[k][i] = (crc32c_table[k-1][i] >> 8)
+                ^ crc32c_table[0][ crc32c_table[k-1][i] & 0xFF ];
+        }
+
+#ifdef HASH_X86
+    __builtin_cpu_init();
+    has_pclmul = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+    has_sse42  = __builtin_cpu_supports("sse4.2");
+#endif
+
+    return;
+}
+
+/*********************************************************//**
+ * Update a (pre-inverted) CRC with slicing by 8 tables.
+ *************************************************************
+ */
+static uint32_t crc_slice8( const uint32_t t[8][256], uint32_t crc, const unsigned char *p, size_t n )
+{
+    for (; n >= 8; n -= 8, p += 8)
+    {
+        const uint32_t lo = LOAD32LE(p) ^ crc, hi = LOAD32LE(p+4);
+        crc = t[7][ lo & 0xFF ] ^ t[6][ (lo >> 8) & 0xFF ]
+            ^ t[5][ (lo >> 16) & 0xFF ] ^ t[4][ lo >> 24 ]
+            ^ t[3][ hi & 0xFF ] ^ t[2][ (hi >> 8) & 0xFF ]
+            ^ t[1][ (hi >> 16) & 0xFF ] ^ t[0][ hi >> 24 ];
+    }
+    while ( n-- )
+        crc = (crc >> 8) ^ t[0][ (crc ^ *p++) & 0xFF ];
+
+    return crc;
+}
+
+#ifdef HASH_X86
+/*********************************************************//**
+ * Update a (pre-inverted) CRC32 by folding 64 bytes per step with
+ * carry-less multiplications (Intel's "Fast CRC Computation for
+ * Generic Polynomials Using PCLMULQDQ"). n >= 64, n multiple of 16.
+ *************************************************************
+ */
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32_pclmul( uint32_t crc, const unsigned char *p, size_t n )
+{
+    static const uint64_t k1k2[2] __attribute__((aligned(16))) = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+    static const uint64_t k3k4[2] __attribute__((aligned(16))) = { 0x01751997d0ULL, 0x00ccaa009eULL };
+    static const uint64_t k5k0[2] __attribute__((aligned(16))) = { 0x0163cd6124ULL, 0x0000000000ULL };
+    static const uint64_t poly[2] __attribute__((aligned(16))) = { 0x01db710641ULL, 0x01f7011641ULL };
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+    x1 = _mm_loadu_si128( (const __m128i *)(p + 0x00) );
+    x2 = _mm_loadu_si128( (const __m128i *)(p + 0x10) );
+    x3 = _mm_loadu_si128( (const __m128i *)(p + 0x20) );
+    x4 = _mm_loadu_si128( (const __m128i *)(p + 0x30) );
+    x1 = _mm_xor_si128( x1, _mm_cvtsi32_si128( (int) crc ) );
+    x0 = _mm_load_si128( (const __m128i *) k1k2 );
+    p += 64;
+    n -= 64;
+
+    /* fold 4 x 128 bits in parallel */
+    for (; n >= 64; n -= 64, p += 64)
+    {
+        x5 = _mm_clmulepi64_si128( x1, x0, 0x00 );
+        x6 = _mm_clmulepi64_si128( x2, x0, 0x00 );
+        x7 = _mm_clmulepi64_si128( x3, x0, 0x00 );
+        x8 = _mm_clmulepi64_si128( x4, x0, 0x00 );
+        x1 = _mm_clmulepi64_si128( x1, x0, 0x11 );
+        x2 = _mm_clmulepi64_si128( x2, x0, 0x11 );
+        x3 = _mm_clmulepi64_si128( x3, x0, 0x11 );
+        x4 = _mm_clmulepi64_si128( x4, x0, 0x11 );
+        x1 = _mm_xor_si128( _mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *)(p + 0x00)) );
+        x2 = _mm_xor_si128( _mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *)(p + 0x10)) );
+        x3 = _mm_xor_si128( _mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *)(p + 0x20)) );
+        x4 = _mm_xor_si128( _mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *)(p + 0x30)) );
+    }
+
+    /* fold into 128 bits */
+    x0 = _mm_load_si128( (const __m128i *) k3k4 );
+    x5 = _mm_clmulepi64_si128( x1, x0, 0x00 );
+    x1 = _mm_clmulepi64_si128( x1, x0, 0x11 );
+    x1 = _mm_xor_si128( _mm_xor_si128(x1, x2), x5 );
+    x5 = _mm_clmulepi64_si128( x1, x0, 0x00 );
+    x1 = _mm_clmulepi64_si128( x1, x0, 0x11 );
+    x1 = _mm_xor_si128( _mm_xor_si128(x1, x3), x5 );
+    x5 = _mm_clmulepi64_si128( x1, x0, 0x00 );
+    x1 = _mm_clmulepi64_si128( x1, x0, 0x11 );
+    x1 = _mm_xor_si128( _mm_xor_si128(x1, x4), x5 );
+
+    /* fold the remaining blocks of 16 bytes */
+    for (; n >= 16; n -= 16, p += 16)
+    {
+        x5 = _mm_clmulepi64_si128( x1, x0, 0x00 );
+        x1 = _mm_clmulepi64_si128( x1, x0, 0x11 );
+        x1 = _mm_xor_si128( _mm_xor_si128(x1, _mm_loadu_si128((const __m128i *) p)), x5 );
+    }
+
+    /* fold 128 bits to 64 bits */
+    x2 = _mm_clmulepi64_si128( x1, x0, 0x10 );
+    x3 = _mm_setr_epi32( ~0, 0, ~0, 0 );
+    x1 = _mm_xor_si128( _mm_srli_si128(x1, 8), x2 );
+    x0 = _mm_loadl_epi64( (const __m128i *) k5k0 );
+    x2 = _mm_srli_si128( x1, 4 );
+    x1 = _mm_and_si128( x1, x3 );
+    x1 = _mm_clmulepi64_si128( x1, x0, 0x00 );
+    x1 = _mm_xor_si128( x1, x2 );
+
+    /* Barrett reduction to 32 bits */
+    x0 = _mm_load_si128( (const __m128i *) poly );
+    x2 = _mm_and_si128( x1, x3 );
+    x2 = _mm_clmulepi64_si128( x2, x0, 0x10 );
+    x2 = _mm_and_si128( x2, x3 );
+    x2 = _mm_clmulepi64_si128( x2, x0, 0x00 );
+    x1 = _mm_xor_si128( x1, x2 );
+
+    return (uint32_t) _mm_extract_epi32( x1, 1 );
+}
+
+/*********************************************************//**
+ * Update a (pre-inverted) CRC32C with the SSE4.2 crc32 instruction.
+ *************************************************************
+ */
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42( uint32_t crc, const unsigned char *p, size_t n )
+{
+#if defined(__x86_64__)
+    uint64_t c = crc;
+    for (; n >= 8; n -= 8, p += 8) {
+        uint64_t w;
+        memcpy( &w, p, sizeof(w) );
+        c = _mm_crc32_u64( c, w );
+    }
+    crc = (uint32_t) c;
+#endif
+    for (; n >= 4; n -= 4, p += 4) {
+        uint32_t w;
+        memcpy( &w, p, sizeof(w) );
+        crc = _mm_crc32_u32( crc, w );
+    }
+    while ( n-- )
+        crc = _mm_crc32_u8( crc, *p++ );
+
+    return crc;
+}
+#endif
+
+/*********************************************************//**
+ * Update a (pre-inverted) CRC, with the fastest way available.
+ *************************************************************
+ */
+static uint32_t crc_update( int alg, uint32_t crc, const unsigned char *p, size_t n )
+{
+#ifdef HASH_X86
+    if ( HASH_CRC32 == alg && has_pclmul && n >= 64 ) {
+        const size_t nfold = n & ~(size_t)15;
+        crc = crc32_pclmul( crc, p, nfold );
+        p += nfold;
+        n -= nfold;
+    }
+    if ( HASH_CRC32C == alg && has_sse42 )
+        return crc32c_sse42( crc, p, n );
+#endif
+    return crc_slice8( HASH_CRC32 == alg ? crc32_table : crc32c_table, crc, p, n );
+}
+
+/*********************************************************//**
+ * Return crc(A+B) from crc(A), crc(B) and len(B) (the zlib method:
+ * apply len(B) zero bytes to crc(A) via GF(2) matrix squaring).
+ *************************************************************
+ */
+static uint32_t gf2_times( const uint32_t *mat, uint32_t vec )
+{
+    uint32_t sum = 0;
+
+    for (; vec; vec >>= 1, mat++)
+        if ( vec & 1 )
+            sum ^= *mat;
+    return sum;
+}
+
+static void gf2_square( uint32_t *square, const uint32_t *mat )
+{
+    int n;
+
+    for (n=0; n < 32; n++)
+        square[n] = gf2_times( mat, mat[n] );
+    return;
+}
+
+static uint32_t crc_combine( uint32_t poly, uint32_t crc1, uint32_t crc2, uint64_t len2 )
+{
+    uint32_t even[32], odd[32], row = 1;
+    int n;
+
+    if ( 0 == len2 )
+        return crc1;
+
+    odd[0] = poly;                /* the operator for 1 zero bit */
+    for (n=1; n < 32; n++, row <<= 1)
+        odd[n] = row;
+    gf2_square( even, odd );            /* 2 zero bits                */
+    gf2_square( odd, even );            /* 4 zero bits                */
+
+    do {                    /* 1 zero byte, 2, 4, ...     */
+        gf2_square( even, odd );
+        if ( len2 & 1 )
+            crc1 = gf2_times( even, crc1 );
+        if ( 0 == (len2 >>= 1) )
+            break;
+        gf2_square( odd, even );
+        if ( len2 & 1 )
+            crc1 = gf2_times( odd, crc1 );
+        len2 >>= 1;
+    } while ( len2 );
+
+    return crc1 ^ crc2;
+}
+
+/*********************************************************//**
+ * XXH64 building blocks.
+ *************************************************************
+ */
+#define XXH_P1    11400714785074694791ULL
+#define XXH_P2    14029467366897019727ULL
+#define XXH_P3    1609587929392839161ULL
+#define XXH_P4    9650029242287828579ULL
+#define XXH_P5    2870177450012600261ULL
+
+static inline uint64_t xxh_round( uint64_t acc, uint64_t input )
+{
+    acc += input * XXH_P2;
+    acc  = ROTL64( acc, 31 );
+    return acc * XXH_P1;
+}
+
+static inline uint64_t xxh_merge( uint64_t acc, uint64_t val )
+{
+    acc ^= xxh_round( 0, val );
+    return acc * XXH_P1 + XXH_P4;
+}
+
+static void xxh_stripes( uint64_t *v, const unsigned char *p, size_t nstripes )
+{
+    for (; nstripes--; p += 32) {
+        v[0] = xxh_round( v[0], LOAD64LE(p) );
+        v[1] = xxh_round( v[1], LOAD64LE(p+8) );
+        v[2] = xxh_round( v[2], LOAD64LE(p+16) );
+        v[3] = xxh_round( v[3], LOAD64LE(p+24) );
+    }
+    return;
+}
+
+/*********************************************************//**
+ * MD5 compression of 64-byte blocks.
+ *************************************************************
+ */
+static void md5_blocks( uint32_t *h, const unsigned char *p, size_t nblocks )
+{
+    static const uint32_t K[64] = {
+        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+    };
+    static const unsigned char S[64] = {
+        7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+        5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+        4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+        6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+    };
+
+    for (; nblocks--; p += 64)
+    {
+        uint32_t m[16], a = h[0], b = h[1], c = h[2], d = h[3];
+        int i;
+
+        for (i=0; i < 16; i++)
+            m[i] = LOAD32LE( &p[4*i] );
+
+        for (i=0; i < 64; i++)
+        {
+            uint32_t f, tmp;
+            int g;
+
+            if ( i < 16 )      { f = (b & c) | (~b & d); g = i; }
+            else if ( i < 32 ) { f = (d & b) | (~d & c); g = (5*i + 1) % 16; }
+            else if ( i < 48 ) { f = b ^ c ^ d;          g = (3*i + 5) % 16; }
+            else               { f = c ^ (b | ~d);       g = (7*i) % 16; }
+
+            tmp = d;
+            d = c;
+            c = b;
+            b = b + ROTL32( a + f + K[i] + m[g], S[i] );
+            a = tmp;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    }
+
+    return;
+}
+
+/*********************************************************//**
+ * SHA-1 compression of 64-byte blocks.
+ *************************************************************
+ */
+static void sha1_blocks( uint32_t *h, const unsigned char *p, size_t nblocks )
+{
+    for (; nblocks--; p += 64)
+    {
+        uint32_t w[80], a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        int i;
+
+        for (i=0; i < 16; i++)
+            w[i] = LOAD32BE( &p[4*i] );
+        for (; i < 80; i++)
+            w[i] = ROTL32( w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1 );
+
+        for (i=0; i < 80; i++)
+        {
+            uint32_t f, k, tmp;
+
+            if ( i < 20 )      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+            else if ( i < 40 ) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+            else if ( i < 60 ) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else               { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+
+            tmp = ROTL32( a, 5 ) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = ROTL32( b, 30 );
+            b = a;
+            a = tmp;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+
+    return;
+}
+
+/*********************************************************//**
+ * SHA-256 compression of 64-byte blocks.
+ *************************************************************
+ */
+static void sha256_blocks( uint32_t *h, const unsigned char *p, size_t nblocks )
+{
+    static const uint32_t K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+
+    for (; nblocks--; p += 64)
+    {
+        uint32_t w[64], s[8];
+        int i;
+
+        for (i=0; i < 16; i++)
+            w[i] = LOAD32BE( &p[4*i] );
+        for (; i < 64; i++) {
+            const uint32_t s0 = ROTR32(w[i-15], 7) ^ ROTR32(w[i-15], 18) ^ (w[i-15] >> 3);
+            const uint32_t s1 = ROTR32(w[i-2], 17) ^ ROTR32(w[i-2], 19) ^ (w[i-2] >> 10);
+            w[i] = w[i-16] + s0 + w[i-7] + s1;
+        }
+
+        memcpy( s, h, sizeof(s) );
+        for (i=0; i < 64; i++)
+        {
+            const uint32_t S1 = ROTR32(s[4], 6) ^ ROTR32(s[4], 11) ^ ROTR32(s[4], 25);
+            const uint32_t ch = (s[4] & s[5]) ^ (~s[4] & s[6]);
+            const uint32_t t1 = s[7] + S1 + ch + K[i] + w[i];
+            const uint32_t S0 = ROTR32(s[0], 2) ^ ROTR32(s[0], 13) ^ ROTR32(s[0], 22);
+            const uint32_t mj = (s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]);
+
+            s[7] = s[6]; s[6] = s[5]; s[5] = s[4];
+            s[4] = s[3] + t1;
+            s[3] = s[2]; s[2] = s[1]; s[1] = s[0];
+            s[0] = t1 + S0 + mj;
+        }
+        for (i=0; i < 8; i++)
+            h[i] += s[i];
+    }
+
+    return;
+}
+
+/*********************************************************//**
+ * Feed whole blocks of a block algorithm (64 bytes, 32 for XXH64).
+ *************************************************************
+ */
+static void hash_blocks( HashCtx *ctx, const unsigned char *p, size_t nblocks )
+{
+    switch ( ctx->alg )
+    {
+        case HASH_XXH64:    xxh_stripes( ctx->v, p, nblocks );  break;
+        case HASH_MD5:      md5_blocks( ctx->h, p, nblocks );   break;
+        case HASH_SHA1:     sha1_blocks( ctx->h, p, nblocks );  break;
+        case HASH_SHA256:   sha256_blocks( ctx->h, p, nblocks ); break;
+        default:            break;
+    }
+    return;
+}
+
+/*********************************************************//**
+ * Return the enum HashAlg named name (case insensitive), or -1.
+ *************************************************************
+ */
+int hash_byname( const char *name )
+{
+    int alg;
+
+    for (alg=0; name && alg < HASH_NALGS; alg++)
+        if ( 0 == strcasecmp(name, hash_names[alg]) )
+            return alg;
+    return -1;
+}
+
+const char *hash_name( int alg )
+{
+    return (alg >= 0 && alg < HASH_NALGS) ? hash_names[alg] : "?";
+}
+
+/*********************************************************//**
+ * Return the bitmask (1 << alg) of a comma separated list of algorithm
+ * names ("all" for all of them), or 0 if any of the names is unknown.
+ *************************************************************
+ */
+unsigned hash_parselist( const char *names )
+{
+    unsigned mask = 0;
+    char     name[16];
+    size_t   len;
+
+    if ( !names || 0 == strcasecmp(names, "all") )
+        return names ? (1U << HASH_NALGS) - 1 : 0;
+
+    for (; *names; names += len + ('\0' != names[len]))
+    {
+        int alg;
+        len = strcspn( names, "," );
+        if ( len >= sizeof(name) )
+            return 0;
+        memcpy( name, names, len );
+        name[len] = '\0';
+        if ( -1 == (alg = hash_byname(name)) )
+            return 0;
+        mask |= 1U << alg;
+    }
+
+    return mask;
+}
+
+/*********************************************************//**
+ *
+ *************************************************************
+ */
+void hash_init( HashCtx *ctx, int alg )
+{
+    static const uint32_t md5_iv[4] = {
+        0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476
+    };
+    static const uint32_t sha1_iv[5] = {
+        0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+    };
+    static const uint32_t sha256_iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    pthread_once( &hash_once, hash_setup );
+
+    memset( ctx, 0, sizeof(HashCtx) );
+    ctx->alg = alg;
+    ctx->crc = 0xFFFFFFFFU;
+
+    switch ( alg )
+    {
+        case HASH_XXH64:
+            ctx->v[0] = XXH_P1 + XXH_P2;
+            ctx->v[1] = XXH_P2;
+            ctx->v[2] = 0;
+            ctx->v[3] = 0 - XXH_P1;
+            break;
+        case HASH_MD5:      memcpy( ctx->h, md5_iv, sizeof(md5_iv) );       break;
+        case HASH_SHA1:     memcpy( ctx->h, sha1_iv, sizeof(sha1_iv) );     break;
+        case HASH_SHA256:   memcpy( ctx->h, sha256_iv, sizeof(sha256_iv) ); break;
+        default:            break;
+    }
+
+    return;
+}
+
+/*********************************************************//**
+ *
+ *************************************************************
+ */
+void hash_update( HashCtx *ctx, const void *data, size_t len )
+{
+    const unsigned char *p = data;
+    const size_t blen = (HASH_XXH64 == ctx->alg) ? 32 : 64;
+    size_t pending = ctx->len % blen;
+
+    if ( HASH_CRC32 == ctx->alg || HASH_CRC32C == ctx->alg ) {
+        ctx->crc = crc_update( ctx->alg, ctx->crc, p, len );
+        ctx->len += len;
+        return;
+    }
+
+    ctx->len += len;
+
+    /* complete the pending block first */
+    if ( pending ) {
+        const size_t n = myMIN( len, blen - pending );
+        memcpy( &ctx->block[pending], p, n );
+        p += n;
+        len -= n;
+        if ( pending + n < blen )
+            return;
+        hash_blocks( ctx, ctx->block, 1 );
+    }
+
+    hash_blocks( ctx, p, len / blen );
+    memcpy( ctx->block, &p[ len - len % blen ], len % blen );
+
+    return;
+}
+
+/*********************************************************//**
+ * Finish hashing, write the digest (big endian) into digest and
+ * return its length in bytes.
+ *************************************************************
+ */
+size_t hash_final( HashCtx *ctx, unsigned char *digest )
+{
+    unsigned char pad[128] = { 0x80 };
+    uint64_t bits = ctx->len * 8, h;
+    size_t   i, npad;
+
+    switch ( ctx->alg )
+    {
+        case HASH_CRC32:
+        case HASH_CRC32C:
+            h = ~ctx->crc & 0xFFFFFFFFU;
+            for (i=0; i < 4; i++)
+                digest[i] = (unsigned char)( h >> (24 - 8*i) );
+            return 4;
+
+        case HASH_XXH64:
+        {
+            const unsigned char *p = ctx->block, *end = p + ctx->len % 32;
+            const uint64_t *v = ctx->v;
+
+            if ( ctx->len >= 32 ) {
+                h = ROTL64(v[0], 1) + ROTL64(v[1], 7) + ROTL64(v[2], 12) + ROTL64(v[3], 18);
+                h = xxh_merge( h, v[0] );
+                h = xxh_merge( h, v[1] );
+                h = xxh_merge( h, v[2] );
+                h = xxh_merge( h, v[3] );
+            }
+            else
+                h = XXH_P5;
+            h += ctx->len;
+
+            for (; p + 8 <= end; p += 8) {
+                h ^= xxh_round( 0, LOAD64LE(p) );
+                h  = ROTL64( h, 27 ) * XXH_P1 + XXH_P4;
+            }
+            if ( p + 4 <= end ) {
+                h ^= (uint64_t) LOAD32LE(p) * XXH_P1;
+                h  = ROTL64( h, 23 ) * XXH_P2 + XXH_P3;
+                p += 4;
+            }
+            for (; p < end; p++) {
+                h ^= *p * XXH_P5;
+                h  = ROTL64( h, 11 ) * XXH_P1;
+            }
+            h ^= h >> 33;  h *= XXH_P2;
+            h ^= h >> 29;  h *= XXH_P3;
+            h ^= h >> 32;
+
+            for (i=0; i < 8; i++)
+                digest[i] = (unsigned char)( h >> (56 - 8*i) );
+            return 8;
+        }
+
+        default:
+            break;
+    }
+
+    /* Merkle-Damgard padding: 0x80, zeros, 64-bit length in bits */
+    npad = (ctx->len % 64 < 56) ? 56 - ctx->len % 64 : 120 - ctx->len % 64;
+    for (i=0; i < 8; i++)
+        pad[npad + i] = (HASH_MD5 == ctx->alg)
+            ? (unsigned char)( bits >> (8*i) )
+            : (unsigned char)( bits >> (56 - 8*i) );
+    hash_update( ctx, pad, npad + 8 );
+
+    if ( HASH_MD5 == ctx->alg ) {
+        for (i=0; i < 16; i++)
+            digest[i] = (unsigned char)( ctx->h[i/4] >> (8 * (i%4)) );
+        return 16;
+    }
+    for (i=0; i < (HASH_SHA1 == ctx->alg ? 20U : 32U); i++)
+        digest[i] = (unsigned char)( ctx->h[i/4] >> (24 - 8 * (i%4)) );
+
+    return i;
+}
+
+/*********************************************************//**
+ * Write len digest bytes as a lowercase hex c-string.
+ *************************************************************
+ */
+void hash_tohex( const unsigned char *digest, size_t len, char *hex )
+{
+    static const char xdigits[] = "0123456789abcdef";
+    size_t i;
+
+    for (i=0; i < len; i++) {
+        hex[2*i]   = xdigits[ digest[i] >> 4 ];
+        hex[2*i+1] = xdigits[ digest[i] & 0xF ];
+    }
+    hex[2*len] = '\0';
+
+    return;
+}
+
+typedef struct CrcJob {
+    int         alg;
+    const unsigned char *data;
+    size_t      len;
+    uint32_t    crc;            /* the final (public) CRC of the chunk */
+} CrcJob;
+
+static void *crc_job( void *arg )
+{
+    CrcJob *job = arg;
+
+    job->crc = ~crc_update( job->alg, 0xFFFFFFFFU, job->data, job->len );
+    return NULL;
+}
+
+/*********************************************************//**
+ * Hash len bytes of data into hex (a c-string of HASH_HEXLEN chars at
+ * most). CRCs of large buffers are computed by up to nthreads threads
+ * and combined.
+ *************************************************************
+ */
+_Bool hash_data( int alg, const unsigned char *data, size_t len, unsigned nthreads, char *hex )
+{
+    unsigned char digest[ HASH_MAXLEN ];
+    HashCtx ctx;
+
+    if ( (!data && len) || !hex || alg < 0 || alg >= HASH_NALGS )
+        return false;
+
+    hash_init( &ctx, alg );
+
+    if ( nthreads > len / HASH_MINCHUNK )
+        nthreads = len / HASH_MINCHUNK;
+
+    if ( (HASH_CRC32 == alg || HASH_CRC32C == alg) && nthreads > 1 )
+    {
+        CrcJob    *jobs = calloc( nthreads, sizeof(CrcJob) );
+        pthread_t *tids = calloc( nthreads, sizeof(pthread_t) );
+        const size_t chunk = len / nthreads;
+        uint32_t  crc = 0;
+        unsigned  t, nstarted = 0;
+
+        if ( !jobs || !tids ) {
+            free( jobs );
+            free( tids );
+            return false;
+        }
+
+        for (t=0; t < nthreads; t++) {
+            jobs[t].alg  = alg;
+            jobs[t].data = &data[ t * chunk ];
+            jobs[t].len  = (t == nthreads-1) ? len - t * chunk : chunk;
+        }
+        for (t=1; t < nthreads; t++, nstarted++)
+            if ( 0 != pthread_create( &tids[t], NULL, crc_job, &jobs[t] ) )
+                break;
+        crc_job( &jobs[0] );
+        for (t=1; t <= nstarted; t++)
+            pthread_join( tids[t], NULL );
+        for (t=nstarted+1; t < nthreads; t++)
+            crc_job( &jobs[t] );
+
+        for (t=0; t < nthreads; t++)
+            crc = t ? crc_combine( HASH_CRC32 == alg ? CRC32_POLY : CRC32C_POLY,
+                                   crc, jobs[t].crc, jobs[t].len )
+                    : jobs[0].crc;
+        free( jobs );
+        free( tids );
+
+        ctx.crc = ~crc;
+        ctx.len = len;
+    }
+    else
+        hash_update( &ctx, data, len );
+
+    hash_tohex( digest, hash_final( &ctx, digest ), hex );
+    return true;
+}
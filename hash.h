@@ -0,0 +1,44 @@
+#ifndef HASH_H                    /* start of inclusion guard */
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* -----------------------------------
+ * Checksums & hashes
+ * -----------------------------------
+ */
+
+enum HashAlg {
+    HASH_CRC32 = 0,                /* IEEE 802.3 (zlib, PNG, ZIP)        */
+    HASH_CRC32C,                /* Castagnoli (iSCSI, ext4, btrfs)    */
+    HASH_XXH64,                    /* xxHash, 64-bit, seed 0             */
+    HASH_MD5,
+    HASH_SHA1,
+    HASH_SHA256,
+    HASH_NALGS
+};
+
+#define HASH_MAXLEN        32        /* max digest length, in bytes        */
+#define HASH_HEXLEN        (2*HASH_MAXLEN + 1)    /* ... as a hex c-string  */
+
+typedef struct HashCtx {
+    int         alg;            /* enum HashAlg                       */
+    uint64_t    len;            /* # of bytes hashed so far           */
+    uint32_t    crc;            /* CRC32 & CRC32C state               */
+    uint64_t    v[4];            /* XXH64 accumulators                 */
+    uint32_t    h[8];            /* MD5, SHA-1 & SHA-256 state         */
+    unsigned char block[64];        /* pending input (block algorithms)   */
+} HashCtx;
+
+int         hash_byname( const char *name );
+const char  *hash_name( int alg );
+unsigned    hash_parselist( const char *names );
+void        hash_init( HashCtx *ctx, int alg );
+void        hash_update( HashCtx *ctx, const void *data, size_t len );
+size_t      hash_final( HashCtx *ctx, unsigned char *digest );
+_Bool       hash_data( int alg, const unsigned char *data, size_t len,
+                       unsigned nthreads, char *hex );
+void        hash_tohex( const unsigned char *digest, size_t len, char *hex );
+
+#endif                        /* end of inclusion guard            */
@@ -8,10 +8,127 @@
  * @par Language:
  *      C (ANSI C99)
  * @par Usage:
- *      hexview [-raw] [filename]
+ *      hexview [-raw] [-strings[=n]] [-ascii] [-entropy[=n]]
+ *              [-hash[=algs]] [-loadhash=algs] [-compare=file2]
+ *              [-delta=file2] [-lines] [-batch[=script]] [-e=command]...
+ *              [-stats] [-trace=file] [-record=file | -replay=file]
+ *              [-budget=mb] [-serve=socket | -connect=socket]
+ *              [-extract=start,end:file] [-carve[=dir]] [-find=bytes]
+ *              [-direct] [-dump] [-json] [-count] [-threads=n]
+ *              [-period[=n]] [-ngrams[=n]] [filename... | pid:N]
  *      \n
  *      Use -raw as the 1st command-line argument to force raw output
  *      (useful for piping, e.g: hexview -raw file | less)
+ *      \n
+ *      Use -strings to print every run of at least n (default 4)
+ *      printable ASCII or UTF-16LE chars, tagged with its hex offset
+ *      and 'a' or 'u' respectively (-ascii skips UTF-16 runs).
+ *      \n
+ *      Use -entropy to print the regions of the file classified by the
+ *      Shannon entropy of every n bytes (default 4096), followed by the
+ *      byte histogram of the whole file.
+ *      \n
+ *      Use -hash to print checksums/hashes of the file (algs is a comma
+ *      separated list of crc32, crc32c, xxh64, md5, sha1, sha256 or all;
+ *      sha256 by default), and -loadhash to compute them while loading
+ *      the file to be viewed (so the # command reports them instantly).
+ *      \n
+ *      Use -compare to view file2 side by side with the file, sharing
+ *      the cursor, with the bytes that differ highlighted (or, with no
+ *      colors, preceded by a '>'), and -delta to print the regions of
+ *      the file copied to file2, deleted from it, or inserted in file2
+ *      (even when they are shifted).
+ *      \n
+ *      On terminals commands run as soon as their key is pressed (the
+ *      arrows, PgUp/PgDn & Home/End keys included); only those taking
+ *      an argument wait for ENTER. Use -lines to always wait for it.
+ *      \n
+ *      Use -batch to run the commands of a script (stdin if no script)
+ *      without viewing the file, preceded by those of any -e options:
+ *      one per line, as typed in the viewer, plus l [n] to list n rows
+ *      (a page by default). Each one prints a line of JSON to stdout,
+ *      e.g. {"cmd":"/text","ok":true,"at":1234,"len":5678} (search
+ *      commands are ok if found, # adds the digests, l the hex bytes;
+ *      commands that fail, or are none, are not ok, with an "error").
+ *      \n
+ *      Use -stats to print to stderr on exit how long loading, every
+ *      screen and every command took (count, total, mean, p50, p99 &
+ *      max per command), and the bytes they wrote to the terminal, and
+ *      -trace to also write every one of them into a Chrome trace-event
+ *      file (see chrome://tracing or ui.perfetto.dev).
+ *      \n
+ *      Use -record to save the commands typed in the viewer into file,
+ *      with the ms they were typed at (a TAB, then the command), and
+ *      -replay to run those of such a file (the times are optional, so
+ *      e.g. 10000 lines of ] page down 10000 times) in the viewer as if
+ *      typed, printing nowhere: a JSON line of the ms every step took
+ *      (the command, its screen & the next prompt) & the bytes it
+ *      printed goes to stdout, followed by one of the totals.
+ *      \n
+ *      Several files may be open in the viewer at once (see the f, n
+ *      & k commands), each one keeping its cursor & its last command.
+ *      Use -budget to cap the memory their data & edits may take (1024
+ *      Mb by default): past it, those viewed least recently give their
+ *      memory back (& page their data in again, when viewed).
+ *      \n
+ *      Use -serve to serve files on the Unix domain socket named, until
+ *      stopped (by Ctrl-C or SIGTERM): every file is loaded once, and
+ *      kept open for all of its clients (see server.h for the protocol
+ *      of requests). Use -connect to view filename as served on such a
+ *      socket: pages, searches & hashes are done by the server, so it
+ *      starts at once, however big the file is.
+ *      \n
+ *      Use -extract to write the bytes [start,end) of the file into a
+ *      new file (e.g. -extract=0x200,0x10200:part.img; no end for all
+ *      to the end of the file), and -carve to write every jpg, png,
+ *      gif, pdf & zip file found embedded in it (by its header & its
+ *      footer) into dir (. by default), as <offset>.<kind>. Both copy
+ *      the bytes file to file, in the kernel (as the g command does),
+ *      and print how fast.
+ *      \n
+ *      Use -find to print the offset of every occurrence of bytes in
+ *      the file (hex digit pairs, or a " followed by text). Use -direct
+ *      with -find, -hash or -strings to read the file past the page
+ *      cache (O_DIRECT, queued on an io_uring) instead of mapping it,
+ *      so that scanning a huge file does not evict the pages cached
+ *      for everything else running.
+ *      \n
+ *      Use -dump to print the rows of the file (as the viewer does). Both
+ *      -find & -dump take many files, & directories (their files, in
+ *      subdirectories too): files are split into chunks, searched or
+ *      dumped on a work-stealing pool of threads (-threads, one per CPU
+ *      by default), & printed in order, tagged with the file name (as
+ *      name:offset, & a ==> name <== header per dump). Use -count to
+ *      print the # of occurrences per file instead, and -json to print
+ *      JSON lines as soon as found, e.g. {"file":"a.bin","off":1234}
+ *      (or "count", "hex" of a row dumped, or "error").
+ *      \n
+ *      Use -period to print the likely record sizes of the file (its
+ *      periodic structure, up to n bytes long; 2048 by default), best
+ *      first, with how sure each one is (0..1), found by how often a
+ *      byte equals the one a stride later (over a sample of 1 Mb, for
+ *      big files). In the viewer, the a command lists them, and views
+ *      the file in rows of the one picked, so that fields line up.
+ *      \n
+ *      Use -ngrams to print the most frequent 2, 4 & 8-byte sequences
+ *      of the file (n-grams), and its most repeated blocks of n bytes
+ *      (4096 by default; e.g. pages of a memory image), each with an
+ *      offset where it is found. They are counted on all the CPUs into
+ *      sketches of fixed size (see ngram.h), so that even huge files
+ *      take little memory: past 2^18 distinct blocks, only the most
+ *      repeated ones are sure to be found, & the 4 & 8-grams may be
+ *      counted low by up to the error told (so those found no more
+ *      often than that may be missed). The offset is the 1st one when
+ *      nothing was undercounted (under FIRST), else only one of them
+ *      (under AT). In the viewer, the j command lists them, & goes to
+ *      the one picked.
+ *      \n
+ *      Use pid:N instead of a filename to view (search, hash ...) the
+ *      memory of the running process N: its readable regions (as in
+ *      /proc/N/maps) end to end, shown at their addresses (b goes to
+ *      an address, and the prompt shows the region of the cursor).
+ *      Only the pages viewed or scanned are read (by process_vm_readv,
+ *      many at once), as they are at that time: no core dump needed.
  *
  * @remark  Feel free to experiment with the values of the pre-processor
  *      constants: FMT_NCOLS, FMT_PGLINES and FMT_POS. They affect the
@@ -24,9 +141,38 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <signal.h>
 
 #include "con_color.h"
 #include "hexview.h"
+#include "strscan.h"
+#include "entropy.h"
+#include "minimap.h"
+#include "hash.h"
+#include "diff.h"
+#include "delta.h"
+#include "piece.h"
+#include "bulk.h"
+#include "xform.h"
+#include "keys.h"
+#include "stats.h"
+#include "session.h"
+#include "libhexview.h"
+#include "server.h"
+#include "carve.h"
+#include "procmem.h"
+#include "direct.h"
+#include "pool.h"
+#include "period.h"
+#include "ngram.h"
+
+#ifdef HV_POSIX
+#include <unistd.h>
+#include <sys/stat.h>
+#include <limits.h>
+#include <dirent.h>
+#include <pthread.h>
+#endif
 
 typedef unsigned char Byte;
 
@@ -35,15 +181,82 @@ typedef struct Buffer {
     size_t  len, nrows, npages; /* total Bytes, rows and pages        */
 //  size_t  bt, row, pg;        /* current byte, row & page indicies  */
     Byte    *data;          /* the actual data buffer             */
+    HvFile  *file;          /* data are mapped from it (if mapped)*/
+    ProcMem *proc;          /* ... or mirror a process (if a pid) */
+    EntMap  entmap;         /* per-block entropy (if computed)    */
+    Minimap minimap;        /* whole-file summary (if built)      */
+    unsigned hashmask;      /* algs hashed while loading ...      */
+    char    digest[ HASH_NALGS ][ HASH_HEXLEN ];  /* ... and digests */
+    size_t  mark;           /* other end of the selection ...     */
+    _Bool   marked;         /* ... if there is one                */
+    struct Buffer *peer;    /* the compared buffer (if any) ...   */
+    Diff    diff;           /* ... and the differences from it    */
+    Delta   delta;          /* shift-tolerant diff (if computed)  */
+    size_t  datalen;        /* length of data (len counts edits)  */
+    PieceTable edits;       /* edits over data ...                */
+    _Bool   editing;        /* ... if any were ever made          */
+    Xform   xform;          /* viewed transformed (if kind set)   */
+    size_t  rowlen;         /* bytes per row: records (0: FMT_NCOLS) */
 } Buffer;
 
+enum RunMode {
+    MODE_VIEW   = 0,            /* the interactive viewer             */
+    MODE_STRINGS,           /* print strings & exit               */
+    MODE_ENTROPY,           /* print entropy report & exit        */
+    MODE_HASH,              /* print checksums/hashes & exit      */
+    MODE_DELTA,             /* print shift-tolerant diff & exit   */
+    MODE_BATCH,             /* run a script of commands & exit    */
+    MODE_SERVE,             /* serve files on a socket, until stopped */
+    MODE_EXTRACT,           /* extract a range into a file & exit */
+    MODE_CARVE,             /* extract the files embedded & exit  */
+    MODE_FIND,              /* print where bytes are found & exit */
+    MODE_DUMP,              /* print the rows of files & exit     */
+    MODE_PERIOD,            /* print the record sizes found & exit */
+    MODE_NGRAMS             /* print frequent n-grams & repeated blocks & exit */
+};
+
 typedef struct Settings {
     _Bool colorize;
     unsigned short int charset;
     _Bool israw;
     _Bool unlimfsize;
+    enum RunMode mode;
+    size_t strminlen;           /* min length of extracted strings    */
+    unsigned strkinds;          /* bitmask of enum StrKind            */
+    size_t entblocklen;         /* block length for entropy analysis  */
+    _Bool showentropy;          /* show the entropy strip             */
+    _Bool showminimap;          /* show the minimap column            */
+    unsigned hashmask;          /* algs printed by MODE_HASH          */
+    unsigned loadhash;          /* algs hashed while loading files    */
+    const char *cmpfname;       /* file to compare with (if any)      */
+    _Bool rawkeys;              /* read keys unbuffered (if a tty)    */
+    const char *batchfname;     /* script of MODE_BATCH ("-": stdin)  */
+    const char **batchcmds;     /* ... preceded by these commands     */
+    size_t nbatchcmds;
+    _Bool stats;                /* print timings to stderr on exit ...*/
+    const char *tracefname;     /* ... & trace events (if not NULL)   */
+    const char *recordfname;    /* record the commands into it, ...   */
+    const char *replayfname;    /* ... or replay those recorded in it */
+    Session *session;           /* ... (if either)                    */
+    size_t membudget;           /* max bytes the buffers hold in memory */
+    unsigned ibuf, nbufs;       /* the buffer viewed & # of them open */
+    const char *sockname;       /* serve on it, or view as served on it */
+    unsigned long long xfrom, xto;  /* MODE_EXTRACT: [xfrom,xto) ...  */
+    const char *outname;        /* ... into it, or MODE_CARVE: into it (a dir) */
+    const char *findpat;        /* MODE_FIND: the bytes (as parse_bytes() takes) */
+    _Bool direct;               /* scan past the page cache (see direct.c) */
+    const char **paths;         /* MODE_FIND, MODE_DUMP: files & dirs ... */
+    size_t npaths;              /* ... named (fname is the 1st one)   */
+    _Bool json;                 /* ... results as tagged JSON lines   */
+    _Bool count;                /* MODE_FIND: just the # per file     */
+    unsigned nthreads;          /* ... run on so many threads         */
+    size_t maxstride;           /* MODE_PERIOD: longest record size looked for */
+    size_t dupblocklen;         /* MODE_NGRAMS: length of the blocks compared */
 } Settings;
 
+/* signature of callbacks describing the items listed by panel_pick() */
+typedef size_t (*PanelItem)( size_t i, char *line, size_t maxlen, const void *ctx );
+
 enum KeyCommand {
     KEY_HLP     = 'h',
     KEY_QUIT    = 'q',
@@ -67,11 +280,38 @@ enum KeyCommand {
     KEY_RFNDSTR = '\\',
     KEY_FNDSEQ  = ';',
     KEY_RFNDSEQ = ':',
+    KEY_STRINGS = 's',
+    KEY_ENTROPY = 'e',
+    KEY_MINIMAP = 'm',
+    KEY_HASH    = '#',
+    KEY_MARK    = 'v',
+    KEY_COMPARE = '=',
+    KEY_NEXTDIFF    = '+',
+    KEY_PREVDIFF    = '-',
+    KEY_DELTA   = '@',
+    KEY_OVERWRITE   = 'o',
+    KEY_INSERT  = 'i',
+    KEY_DELETE  = 'd',
+    KEY_UNDO    = 'u',
+    KEY_REDO    = 'z',
+    KEY_WRITE   = 'w',
+    KEY_BULK    = '!',
+    KEY_XFORM   = 'x',
+    KEY_EXTRACT = 'g',
+    KEY_NEXTBUF = 'n',
+    KEY_CLOSEBUF    = 'k',
+    KEY_PERIOD  = 'a',
+    KEY_NGRAMS  = 'j',
+    KEY_LIST    = 'l',          /* batch mode only                    */
 };
 
 void    buffer_cleanup( Buffer *buffer );
-_Bool   buffer_read_file_longmax( Buffer *buffer, const char *fname );
-_Bool   buffer_read_file( Buffer *buf, const char *fname, size_t chunklen );
+_Bool   buffer_map_file( Buffer *buffer, const char *fname, unsigned hashmask );
+_Bool   buffer_read_file_longmax( Buffer *buffer, const char *fname, unsigned hashmask );
+_Bool   buffer_read_file( Buffer *buf, const char *fname, size_t chunklen, unsigned hashmask );
+_Bool   buffer_extract( const Buffer *buffer, size_t from, size_t n, const char *fname );
+_Bool   buffer_map_proc( Buffer *buffer, const char *fname, unsigned hashmask );
+size_t  parse_bytes( const char *s, Byte *bytes, size_t maxlen );
 
 
 /*********************************************************//**
@@ -111,8 +351,14 @@ char *s_read( char *s, size_t maxlen )
 {
     size_t len = 0U;
 
-    if ( !s || !fgets( s, maxlen, stdin) )
+    const _Bool wasraw = keys_israw();    /* lines are edited cooked */
+
+    keys_raw( false );
+    if ( !s || !fgets( s, maxlen, stdin) ) {
+        keys_raw( wasraw );
         return NULL;
+    }
+    keys_raw( wasraw );
 
     if ( maxlen > MAXINPUT)
         maxlen = MAXINPUT;
@@ -138,26 +384,374 @@ _Bool fileexists(const char *fname)
 }
 
 /*********************************************************//**
- * Return the size of a file in bytes, or -1 on error (cannot be more than LONG_MAX).
+ * Return how the offset off of the buffer is shown: as the address
+ * it mirrors, in a process's memory (unless viewed transformed).
  *************************************************************
  */
-long int filesize(const char *fname)
+unsigned long long buffer_label( const Buffer *buffer, size_t off )
 {
-    long int size;
-    FILE     *fp;
+    if ( !buffer->proc || XF_NONE != buffer->xform.kind )
+        return off;
+    if ( off >= buffer->datalen && off > 0 )        /* the end of the last region */
+        return procmem_addr( buffer->proc, buffer->datalen - 1 ) + 1 + (off - buffer->datalen);
+    return procmem_addr( buffer->proc, off );
+}
 
-    if ( NULL == (fp = fopen(fname, "rb")) )    /* binary mode */
-        return -1;
+/*********************************************************//**
+ * Return the width of the offset column of the rows of buffer, viewed
+ * side by side with those of other (if not NULL).
+ *************************************************************
+ */
+int view_ofstw( const Buffer *buffer, const Buffer *other )
+{
+    return hv_ofst_width( myMAX( buffer_label( buffer, buffer->len ),
+                                 other ? buffer_label( other, other->len ) : 0 ) );
+}
 
-    if( fseek(fp, 0, SEEK_END) ) {
-        fclose(fp);
-        return -1;
+/*********************************************************//**
+ * Return the 64-bit FNV-1a hash of n bytes, continuing from h
+ * (use FNV_SEED to start a new hash).
+ *************************************************************
+ */
+#define FNV_SEED    0xCBF29CE484222325ULL
+
+uint64_t fnv1a64( const void *data, size_t n, uint64_t h )
+{
+    const Byte *p = data;
+
+    while ( n-- ) {
+        h ^= *p++;
+        h *= 0x100000001B3ULL;
     }
+    return h;
+}
 
-    size = ftell(fp);
-    fclose(fp);
+/*********************************************************//**
+ * Build into path the name of the cache file holding the results of
+ * an analysis (named by tag) of the file fname, and into key a
+ * fingerprint of the file's identity & version, so that stale cache
+ * files can be told apart. Return false if caching is not possible.
+ *************************************************************
+ */
+_Bool cache_path( const char *fname, const char *tag, char *path, size_t maxlen, uint64_t *key )
+{
+#ifdef HV_POSIX
+    char        abspath[ PATH_MAX ], dir[ PATH_MAX ];
+    const char  *base = NULL;
+    struct stat st;
+    uint64_t    id[5];
+
+    if ( !fname || !tag || !path || !key
+        || -1 == stat(fname, &st) || !realpath(fname, abspath)
+    )
+        return false;
+
+    /* $XDG_CACHE_HOME/hexview or else $HOME/.cache/hexview */
+    if ( NULL != (base = getenv("XDG_CACHE_HOME")) && '\0' != *base )
+        snprintf( dir, PATH_MAX, "%s/hexview", base );
+    else if ( NULL != (base = getenv("HOME")) && '\0' != *base ) {
+        snprintf( dir, PATH_MAX, "%s/.cache", base );
+        mkdir( dir, 0700 );
+        snprintf( dir, PATH_MAX, "%s/.cache/hexview", base );
+    }
+    else
+        return false;
+    if ( -1 == mkdir(dir, 0700) && EEXIST != errno )
+        return false;
+
+    if ( (int) maxlen <= snprintf( path, maxlen, "%s/%016llx.%s", dir,
+            (unsigned long long) fnv1a64(abspath, strlen(abspath), FNV_SEED), tag )
+    )
+        return false;
+
+    id[0] = st.st_dev;
+    id[1] = st.st_ino;
+    id[2] = st.st_size;
+    id[3] = st.st_mtim.tv_sec;
+    id[4] = st.st_mtim.tv_nsec;
+    *key = fnv1a64( id, sizeof(id), FNV_SEED );
+
+    return true;
+#else
+    (void) fname; (void) tag; (void) path; (void) maxlen; (void) key;
+    return false;
+#endif
+}
+
+/*********************************************************//**
+ * Copy up to n bytes of the buffer (as edited, but not transformed),
+ * starting at off, into dst. Return the # of bytes copied. This is
+ * an XformSrc, so ctx is the buffer.
+ *************************************************************
+ */
+static size_t buffer_rawget( const void *ctx, size_t off, unsigned char *dst, size_t n )
+{
+    const Buffer *buffer = ctx;
+
+    if ( buffer->editing )
+        return piece_read( &buffer->edits, off, dst, n );
+
+    if ( off >= buffer->datalen )
+        return 0;
+    n = myMIN( n, buffer->datalen - off );
+    memcpy( dst, &buffer->data[off], n );
+
+    return n;
+}
+
+/*********************************************************//**
+ * Copy up to n bytes of the buffer as viewed (edited & transformed),
+ * starting at off, into dst. Return the # of bytes copied.
+ *************************************************************
+ */
+size_t buffer_get( const Buffer *buffer, size_t off, Byte *dst, size_t n )
+{
+    if ( XF_NONE != buffer->xform.kind )
+        return xform_read( &buffer->xform, off, dst, n );
+    return buffer_rawget( buffer, off, dst, n );
+}
+
+/*********************************************************//**
+ * Convert an offset of the buffer as viewed to one of its (edited)
+ * data, or back. They differ only in a transformed view.
+ *************************************************************
+ */
+size_t buffer_rawoff( const Buffer *buffer, size_t off )
+{
+    return XF_NONE != buffer->xform.kind ? xform_tosrc( &buffer->xform, off ) : off;
+}
+
+size_t buffer_viewoff( const Buffer *buffer, size_t rawoff )
+{
+    return XF_NONE != buffer->xform.kind ? xform_fromsrc( &buffer->xform, rawoff ) : rawoff;
+}
+
+/*********************************************************//**
+ * Return the # of bytes the rows of the buffer step by when viewed:
+ * the record size picked after the a command (see period_panel()),
+ * or FMT_NCOLS (always while comparing, so both sides stay in step).
+ * Rows of records longer than FMT_NCOLS show their 1st bytes only,
+ * so the fields of every record line up in columns.
+ *************************************************************
+ */
+size_t buffer_rowlen( const Buffer *buffer )
+{
+    return buffer->rowlen && !buffer->peer ? buffer->rowlen : FMT_NCOLS;
+}
+
+/*********************************************************//**
+ * Return the # of rows of the buffer viewed in rows of rowlen bytes.
+ *************************************************************
+ */
+size_t buffer_nrows( const Buffer *buffer, size_t rowlen )
+{
+    return FMT_NCOLS == rowlen
+        ? buffer->nrows
+        : buffer->len / rowlen + (buffer->len % rowlen != 0 ? 1 : 0);
+}
+
+/*********************************************************//**
+ * Return the byte of the buffer (as edited) at off, or 0 past its end.
+ *************************************************************
+ */
+Byte buffer_at( const Buffer *buffer, size_t off )
+{
+    Byte byte = 0;
+
+    buffer_get( buffer, off, &byte, 1 );
+    return byte;
+}
+
+/*********************************************************//**
+ * Return a pointer to n bytes of the buffer (as viewed) starting at
+ * off: straight into its data while it is neither edited nor viewed
+ * transformed, or else into scratch (with room for n bytes), where
+ * they are copied. The # of bytes available there goes into got.
+ *************************************************************
+ */
+const Byte *buffer_window( const Buffer *buffer, size_t off, size_t n, Byte *scratch, size_t *got )
+{
+    if ( !buffer->editing && XF_NONE == buffer->xform.kind ) {
+        *got = off < buffer->len ? myMIN( n, buffer->len - off ) : 0;
+        return &buffer->data[ myMIN(off, buffer->len) ];
+    }
+    *got = buffer_get( buffer, off, scratch, n );
+    return scratch;
+}
+
+/*********************************************************//**
+ * Return true if the buffer has edits not saved yet.
+ *************************************************************
+ */
+_Bool buffer_dirty( const Buffer *buffer )
+{
+    return buffer->editing && piece_dirty( &buffer->edits );
+}
+
+/*********************************************************//**
+ * Set the length of the buffer (as edited), in bytes, rows & pages.
+ *************************************************************
+ */
+void buffer_setlen( Buffer *buffer, size_t len )
+{
+    buffer->len    = len;
+    buffer->nrows  = len / FMT_NCOLS + (len % FMT_NCOLS != 0 ? 1 : 0);
+    buffer->npages = buffer->nrows / FMT_PGLINES
+            + (buffer->nrows % FMT_PGLINES != 0 ? 1 : 0 );
+    return;
+}
+
+/*********************************************************//**
+ * Start editing the buffer (unless already started). Its data are
+ * never written: edits are kept apart, by a piece table.
+ *************************************************************
+ */
+_Bool buffer_edit( Buffer *buffer )
+{
+    if ( !buffer->editing )
+        buffer->editing = piece_init( &buffer->edits, buffer->data, buffer->datalen );
+    return buffer->editing;
+}
+
+/*********************************************************//**
+ * Return the offset of the 1st occurrence of pat[0..n) in the buffer
+ * (as edited) at or after from, or of the last one at or before from
+ * if backward, or (size_t)-1 if there is none. The buffer is scanned
+ * FIND_CHUNKLEN bytes at a time (overlapping by n-1 bytes), forward
+ * by the vectorized bulk_find(). The memory of a process is read a
+ * chunk at a time too, as it is now (by one call, mostly). A file
+ * (not edited) is read ahead of the scan, and given back behind it.
+ *************************************************************
+ */
+#define FIND_CHUNKLEN    (1024*1024)
+
+size_t buffer_find( const Buffer *buffer, size_t from, const Byte *pat, size_t n, _Bool backward )
+{
+    Byte   *scratch = NULL;
+    size_t found = (size_t) -1, off, got, i;
+    HvScan scan;
+
+    if ( 0 == n || n > buffer->len )
+        return found;
+    if ( (buffer->editing || XF_NONE != buffer->xform.kind)
+        && NULL == (scratch = malloc( FIND_CHUNKLEN + n - 1 ))
+    )
+        return found;
+
+    if ( !backward )
+    {
+        hv_scan_begin( &scan, buffer->editing ? NULL : buffer->file, from, buffer->len );
+        for (off=from; found == (size_t)-1 && off <= buffer->len - n; off += FIND_CHUNKLEN)
+        {
+            const Byte *w;
+            size_t at;
+
+            hv_scan_at( &scan, off );
+            if ( buffer->proc && !buffer->editing )
+                procmem_fetch( buffer->proc, off, FIND_CHUNKLEN + n - 1, true );
+            w  = buffer_window( buffer, off, FIND_CHUNKLEN + n - 1, scratch, &got );
+            at = bulk_find( w, got, pat, n );
+
+            if ( BULK_NONE != at )
+                found = off + at;
+        }
+    }
+    else
+    {
+        size_t hi = myMIN( from, buffer->len - n );        /* last candidate */
+
+        hv_scan_begin( &scan, buffer->editing ? NULL : buffer->file, 0, hi + n );
+        for (;;)
+        {
+            const size_t lo = hi >= FIND_CHUNKLEN - 1 ? hi - (FIND_CHUNKLEN - 1) : 0;
+            const Byte *w;
+
+            hv_scan_at( &scan, hi + n - 1 );
+            if ( buffer->proc && !buffer->editing )
+                procmem_fetch( buffer->proc, lo, hi - lo + n, true );
+            w = buffer_window( buffer, lo, hi - lo + n, scratch, &got );
+
+            for (i = hi - lo + 1; i-- > 0; )
+                if ( w[i] == pat[0] && 0 == memcmp( &w[i], pat, n ) ) {
+                    found = lo + i;
+                    break;
+                }
+            if ( found != (size_t)-1 || 0 == lo )
+                break;
+            hi = lo - 1;
+        }
+    }
+    hv_scan_end( &scan );
+
+    free( scratch );
+    return found;
+}
+
+/*********************************************************//**
+ * Display a paged list of nitems items (each one described by itemfn)
+ * and let the user pick one of them. Return the index of the picked
+ * item, or -1 if the user did not pick any.
+ *************************************************************
+ */
+long panel_pick(
+    const char      *title,
+    const size_t    nitems,
+    PanelItem       itemfn,
+    const void      *ctx,
+    const Settings  *settings
+)
+{
+    size_t first = 0U, i;
+    char line[ FMT_PANELCOLS+1 ], answer[ MAXINPUT ] = {'\0'};
+
+    if ( !title || !itemfn || !settings )
+        return -1;
+
+    for (;;)
+    {
+        CLS();
+        colorPRINTF(
+            settings->colorize, FGCLR_EM1, BG_NOCHANGE,
+            " %s (%llu items)\n\n", title, (unsigned long long) nitems
+        );
+
+        for (i=first; i < nitems && i < first + FMT_PGLINES; i++)
+        {
+            size_t off = itemfn( i, line, FMT_PANELCOLS+1, ctx );
+            colorPRINTF(
+                settings->colorize, FGCLR_EM3, BG_NOCHANGE,
+                "%7llu ", (unsigned long long) i
+            );
+            colorPRINTF(
+                settings->colorize, FGCLR_ROWOFST, BG_NOCHANGE,
+                "%0*llX ", FMT_OFST, (unsigned long long) off
+            );
+            printf( "%s\n", line );
+        }
+        for (; i < first + FMT_PGLINES; i++)
+            putchar('\n');
 
-    return size;
+        colorPRINTF(
+            settings->colorize, FGCLR_EM1, BG_NOCHANGE,
+            " ENTER: more, %c: previous, n: goto item n, %c: back : ",
+            KEY_PGUP, KEY_QUIT
+        );
+        fflush( stdout );
+
+        if ( !s_read( answer, MAXINPUT ) || KEY_QUIT == tolower((int) *answer) )
+            return -1;
+
+        if ( '\0' == *answer )            /* next page (wraps around)   */
+            first = (first + FMT_PGLINES < nitems) ? first + FMT_PGLINES : 0;
+        else if ( KEY_PGUP == *answer )        /* previous page             */
+            first = (first > FMT_PGLINES) ? first - FMT_PGLINES : 0;
+        else if ( isdigit( (int) *answer ) ) {
+            size_t pick = strtoull( answer, NULL, 10 );
+            if ( pick < nitems )
+                return (long) pick;
+            BELL(1);
+        }
+    }
 }
 
 /*********************************************************//**
@@ -184,13 +778,20 @@ void show_help( const _Bool colorize )
 
     colorPRINTF( colorize, FGCLR_EM1, BG_NOCHANGE, "Available Commands\n" ); 
 
-    puts( "Commands are NOT case-sensitive but require you to press ENTER at the end.\n" );
+    puts( keys_israw()
+        ? "Commands are NOT case-sensitive and run at once, unless they take an argument\n"
+          "(then they wait for ENTER). The arrows, PgUp/PgDn & Home/End keys work too.\n"
+        : "Commands are NOT case-sensitive but require you to press ENTER at the end.\n" );
     printf( "%c \t\t This help screen\n",           KEY_HLP );
     printf( "%c \t\t Quit the program\n",           KEY_QUIT );
     puts( "ENTER \t\t Repeat last command" );
-    printf( "%cfilename\t Load a new file (leave NO blanks between %c and filename)\n",
+    printf( "%cfilename\t Open a file in a new buffer, or view it if open (leave NO blanks\n"
+            "\t\t between %c and filename)\n",
         KEY_LOADFILE, KEY_LOADFILE
     );
+    printf( "%c or %c \t\t View the next open buffer, or close the one viewed\n",
+        KEY_NEXTBUF, KEY_CLOSEBUF
+    );
     printf( "%c \t\t Toggle colorization (on/off)\n",   KEY_COLOR );
     printf( "%c\t\t Toggle ASCII character set (plain/extended)\n", KEY_CHARSET);
 
@@ -218,6 +819,62 @@ void show_help( const _Bool colorize )
     printf( "%c or %c sequence\t Search ahead or backwards for a byte-sequence\n",
         KEY_FNDSEQ, KEY_RFNDSEQ
     );
+    printf( "%c n \t\t List strings of at least n chars (%d is assumed if no n is present)\n",
+        KEY_STRINGS, STR_MINLEN
+    );
+    printf( "%c \t\t Toggle the entropy strip (on/off)\n", KEY_ENTROPY );
+    printf( "%c n \t\t List record sizes up to n bytes (of the selection, if any) & view\n"
+            "\t\t rows of the one picked (%d if no n, 0 for rows of %d again)\n",
+        KEY_PERIOD, PERIOD_MAXSTRIDE, FMT_NCOLS
+    );
+    printf( "%c n \t\t List frequent n-grams & repeated blocks of n bytes (of the selection,\n"
+            "\t\t if any) & go to the 1st of the one picked (%d if no n)\n",
+        KEY_NGRAMS, NGRAM_BLOCKLEN
+    );
+    printf( "%c \t\t Toggle the minimap column (on/off)\n", KEY_MINIMAP );
+    printf( "%c n \t\t Goto n'th minimap cell, or to fraction n of the file (0.n or n%%)\n",
+        KEY_MINIMAP
+    );
+    printf( "%c \t\t Mark the cursor as the other end of the selection (again to unmark)\n",
+        KEY_MARK
+    );
+    printf( "%cfilename\t Compare with a file, side by side (%c alone to stop comparing)\n",
+        KEY_COMPARE, KEY_COMPARE
+    );
+    printf( "%c or %c \t\t Next or previous run of differing bytes\n", KEY_NEXTDIFF, KEY_PREVDIFF );
+    printf( "%c \t\t Diff with the compared file even if shifted, align it & list the hunks\n",
+        KEY_DELTA
+    );
+    printf( "%calg [%c|p|n]\t Hash the file, or the selection, or the page, or n bytes at the\n"
+            "\t\t cursor (alg: crc32 crc32c xxh64 md5 sha1 sha256, all if none)\n",
+        KEY_HASH, KEY_MARK
+    );
+    printf( "%c [n] filename\t Extract n bytes at the cursor into filename (if no n, the\n"
+            "\t\t selection, or all the bytes from the cursor on)\n",
+        KEY_EXTRACT
+    );
+
+    putchar('\n');
+
+    printf( "%c or %c bytes\t Overwrite bytes at the cursor, or insert them before it (bytes\n"
+            "\t\t are hex digit pairs, or a %c followed by text)\n",
+        KEY_OVERWRITE, KEY_INSERT, '"'
+    );
+    printf( "%c n or %c %c\t Delete n bytes at the cursor (1 if no n is present), or the selection\n",
+        KEY_DELETE, KEY_DELETE, KEY_MARK
+    );
+    printf( "%c or %c n\t Undo or redo n edits (1 is assumed if no n is present)\n",
+        KEY_UNDO, KEY_REDO
+    );
+    printf( "%cop [bytes]\t Edit the selection (or the whole file) at once, by op: zero, fill,\n"
+            "\t\t xor, and, or (the bytes repeated), or repl a,b (every a with b)\n",
+        KEY_BULK
+    );
+    printf( "%c[filename]\t Save the edits (into filename & view it, if present)\n", KEY_WRITE );
+    printf( "%c how [key]\t View the selection (or the whole file) transformed: xor key,\n"
+            "\t\t swap16, swap32, swap64, nibble, base64 or hex (%c alone to stop)\n",
+        KEY_XFORM, KEY_XFORM
+    );
 
     putchar('\n');
     pressENTER();
@@ -226,33 +883,29 @@ void show_help( const _Bool colorize )
 }
 
 /*********************************************************//**
- * Display text labels and other info on the currently displayed page.
+ * Display the labels of the columns of rows with an offset column
+ * ofstw digits wide, marking the column col (none if FMT_NCOLS or more).
  *************************************************************
  */
-void show_header( const size_t btcurr, const Buffer *buffer, const Settings *settings )
+static void show_columns( const size_t col, const int ofstw, const Settings *settings )
 {
     unsigned short int i;
 
-    if ( !buffer || !buffer->data )
-        return;
-
-    CLS();
-
     /* text label for file-offset */
     colorPRINTF(
         settings->colorize, FGCLR_ROWOFST, BG_NOCHANGE,
-        " %-*s ", FMT_OFST,"OFFSET"
+        " %-*s ", ofstw, "OFFSET"
     );
 
     /* hex indicies for Bytes */
     for (i=0; i < FMT_NCOLS; i++)
     {
-        char *fmt = (btcurr % FMT_NCOLS == i) ? "%-1hX* " : "%-2hX ";
+        char *fmt = (col == i) ? "%-1hX* " : "%-2hX ";
 
         if ( i != 0 && i % FMT_GRPCOLS == 0 )       /* group columns      */
             putchar(' ');
 
-        if ( btcurr % FMT_NCOLS == i )
+        if ( col == i )
             colorPRINTF(settings->colorize,FGCLR_BYTCURR,BG_NOCHANGE, fmt,i);
         else
             colorPRINTF(settings->colorize,FGCLR_ROWOFST,BG_NOCHANGE, fmt,i);
@@ -262,7 +915,7 @@ void show_header( const size_t btcurr, const Buffer *buffer, const Settings *set
     putchar(' ');
     for (i=0; i < FMT_NCOLS; i++)
     {
-        if ( btcurr % FMT_NCOLS == i )
+        if ( col == i )
             colorPRINTF(
                 settings->colorize, FGCLR_BYTCURR, BG_NOCHANGE, "%hX", i
             );
@@ -277,7 +930,7 @@ void show_header( const size_t btcurr, const Buffer *buffer, const Settings *set
     /* separating lines */
 
     putchar(' ');
-    for (i=0; i < FMT_OFST + 1; i++)
+    for (i=0; (int) i < ofstw + 1; i++)
         colorPRINTF( settings->colorize, FGCLR_ROWOFST, BG_NOCHANGE, "-" );
 
     for (i=0; i < FMT_NCOLS; i++)
@@ -287,7 +940,7 @@ void show_header( const size_t btcurr, const Buffer *buffer, const Settings *set
 
         colorPRINTF(
             settings->colorize, FGCLR_ROWOFST, BG_NOCHANGE,
-            (btcurr % FMT_NCOLS == i) ? "..-" : "---"
+            (col == i) ? "..-" : "---"
         );
     }
     putchar('\b');
@@ -296,7 +949,7 @@ void show_header( const size_t btcurr, const Buffer *buffer, const Settings *set
     {
         colorPRINTF(
             settings->colorize, FGCLR_ROWOFST, BG_NOCHANGE,
-            (btcurr % FMT_NCOLS == i) ? "." : "-"
+            (col == i) ? "." : "-"
         );
     }
 
@@ -306,57 +959,213 @@ void show_header( const size_t btcurr, const Buffer *buffer, const Settings *set
 }
 
 /*********************************************************//**
- * Display the prompt (it conists of 2 lines).
+ * Display text labels and other info on the currently displayed page.
  *************************************************************
  */
-_Bool show_prompt(
-    const size_t    bt,
-    char        *cmd,
-    const char  *prevcmd,
-    const Buffer    *buffer,
-    const Settings  *settings
-)
+void show_header( const size_t btcurr, const Buffer *buffer, const Settings *settings )
 {
-    size_t row = 0U, slen = 0U;
-    char *cp = NULL, *bitstr = NULL;
+    if ( !buffer || !buffer->data )
+        return;
 
-    if ( !cmd || !prevcmd || !buffer || !settings || !buffer->data)
-        return false;
+    CLS();
+    show_columns( btcurr % buffer_rowlen( buffer ), view_ofstw( buffer, buffer->peer ), settings );
 
-    /* -----------------------
-     * display 1st prompt line
-     */
+    return;
+}
 
-    /* filename (display FNAME_SHOWLEN last chars, if longer) */
-    slen = strlen( buffer->fname );
-    if ( slen > FNAME_SHOWLEN )
-        cp = (char *) &buffer->fname[ slen-FNAME_SHOWLEN ];
-    else
-        cp = (char *) &buffer->fname;
-    colorPRINTF(
-        settings->colorize,
-        FGCLR_PMTFNAME,
-        BGCLR_PMTFNAME,
-        " %s%s ",
-        cp != buffer->fname ? "..." : "\0",
-        cp
-    );
+/*********************************************************//**
+ * Return the command char of a key (the arrows, PgUp/PgDn & Home/End
+ * keys move like , . < > [ ] ( and ) do).
+ *************************************************************
+ */
+static int key_command( int key )
+{
+    switch ( key ) {
+    case KEYS_UP:   return KEY_ROWUP;
+    case KEYS_DOWN: return KEY_ROWDN;
+    case KEYS_LEFT: return KEY_BYTEB;
+    case KEYS_RIGHT:return KEY_BYTEF;
+    case KEYS_PGUP: return KEY_PGUP;
+    case KEYS_PGDN: return KEY_PGDN;
+    case KEYS_HOME: return KEY_ROWSTA;
+    case KEYS_END:  return KEY_ROWEND;
+    }
+    return key;
+}
 
-    putchar(':');
+/*********************************************************//**
+ * Read a command from a terminal in raw mode into cmd: commands with
+ * no argument are read as soon as their key is pressed, while those
+ * of the rest are read as a line (edited by the terminal). Presses of
+ * the same step key that are already queued (auto-repeat) are read
+ * at once, as a single command stepping as many times. Return false
+ * on end of input.
+ *************************************************************
+ */
+static _Bool prompt_keys( char *cmd )
+{
+    static const char immediate[] = {
+        KEY_HLP, KEY_QUIT, KEY_COLOR, KEY_CHARSET, KEY_TOP, KEY_BOT,
+        KEY_ENTROPY, KEY_MARK, KEY_NEXTDIFF, KEY_PREVDIFF, KEY_DELTA,
+        KEY_PGUP, KEY_PGDN, KEY_ROWUP, KEY_ROWDN, KEY_ROWSTA, KEY_ROWEND,
+        KEY_BYTEB, KEY_BYTEF, KEY_UNDO, KEY_REDO, KEY_NEXTBUF, KEY_CLOSEBUF, '\0'
+    };
+    static const char counted[] = {
+        KEY_PGUP, KEY_PGDN, KEY_ROWUP, KEY_ROWDN, KEY_BYTEB, KEY_BYTEF,
+        KEY_UNDO, KEY_REDO, KEY_NEXTBUF, '\0'
+    };
 
-    /* filesize (in Mbytes) */
-    colorPRINTF(
-        settings->colorize, FGCLR_PMTFNAME, BGCLR_PMTFNAME,
-        " %.3f Mb :", ( (buffer->len * sizeof(Byte)) / (1024.0 * 1024) )
-    );
+    for (;;)
+    {
+        const int key = key_command( keys_read() );
+        size_t slen;
 
-    /* filesize in viewer-rows */
-    colorPRINTF(
-        settings->colorize, FGCLR_PMTFNAME, BGCLR_PMTFNAME,
-        " %llu rows ", (unsigned long long) (buffer->nrows)
-    );
+        if ( KEYS_EOF == key )
+            return false;
+        if ( '\n' == key ) {            /* repeat the last command    */
+            strcpy( cmd, "\n" );
+            return true;
+        }
 
-    row = BT2ROW(bt, buffer->len, buffer->nrows);   /* calc the row index for bt */
+        if ( key > 0 && key <= 0xFF && strchr( immediate, tolower(key) ) )
+        {
+            unsigned long n = 1;
+            if ( strchr( counted, tolower(key) ) ) {
+                while ( keys_pending() ) {
+                    const int next = key_command( keys_read() );
+                    if ( next != key ) {
+                        keys_unread( next );
+                        break;
+                    }
+                    n++;
+                }
+            }
+            if ( n > 1 )
+                snprintf( cmd, MAXINPUT, "%c%lu", key, n );
+            else
+                snprintf( cmd, MAXINPUT, "%c", key );
+            return true;
+        }
+
+        if ( key > 0 && key <= 0xFF && isgraph( key ) )
+        {
+            /* the rest of the command is a line, edited cooked */
+            putchar( key );
+            fflush( stdout );
+            cmd[0] = (char) key;
+            keys_raw( false );
+            if ( !fgets( &cmd[1], MAXINPUT-1, stdin ) ) {
+                keys_raw( true );
+                return false;
+            }
+            keys_raw( true );
+            slen = strlen( cmd );
+            if ( '\n' == cmd[ slen-1 ] )
+                cmd[ slen-1 ] = '\0';
+            return true;
+        }
+
+        BELL(1);                /* not a command key          */
+        fflush( stdout );
+    }
+}
+
+/*********************************************************//**
+ * Read the user command into cmd (or the next one of a replayed
+ * session). Return false on end of input.
+ *************************************************************
+ */
+static _Bool prompt_read( char *cmd, const Settings *settings )
+{
+    size_t slen;
+
+    if ( settings->session && settings->session->replaying )
+        return session_next( settings->session, cmd, MAXINPUT );
+    if ( keys_israw() )
+        return prompt_keys( cmd );
+    if ( !fgets( cmd, MAXINPUT, stdin ) )
+        return false;
+
+    /* if not just an ENTER, remove '\n' from the end */
+    slen = strlen(cmd);
+    if ( '\n' != *cmd && '\n' == cmd[ slen-1 ] )
+        cmd[ slen-1 ] = '\0';
+
+    return true;
+}
+
+/*********************************************************//**
+ * Display the prompt (it conists of 2 lines).
+ *************************************************************
+ */
+_Bool show_prompt(
+    const size_t    bt,
+    char        *cmd,
+    const char  *prevcmd,
+    const Buffer    *buffer,
+    const Settings  *settings
+)
+{
+    size_t row = 0U, slen = 0U, rawbt, rowlen, nrows;
+    char *cp = NULL, *bitstr = NULL;
+    Byte byte;
+
+    if ( !cmd || !prevcmd || !buffer || !settings || !buffer->data)
+        return false;
+    byte  = buffer_at( buffer, bt );
+    rawbt = buffer_rawoff( buffer, bt );     /* analyses are of the data */
+
+    /* -----------------------
+     * display 1st prompt line
+     */
+
+    /* filename (display FNAME_SHOWLEN last chars, if longer) */
+    slen = strlen( buffer->fname );
+    if ( slen > FNAME_SHOWLEN )
+        cp = (char *) &buffer->fname[ slen-FNAME_SHOWLEN ];
+    else
+        cp = (char *) &buffer->fname;
+    colorPRINTF(
+        settings->colorize,
+        FGCLR_PMTFNAME,
+        BGCLR_PMTFNAME,
+        " %s%s ",
+        cp != buffer->fname ? "..." : "\0",
+        cp
+    );
+
+    putchar(':');
+
+    /* which of the open buffers (if more than 1) */
+    if ( settings->nbufs > 1 )
+        colorPRINTF(
+            settings->colorize, FGCLR_PMTPG, BGCLR_PMTPG,
+            "[%u/%u]:", settings->ibuf + 1, settings->nbufs
+        );
+
+    /* filesize (in Mbytes) */
+    colorPRINTF(
+        settings->colorize, FGCLR_PMTFNAME, BGCLR_PMTFNAME,
+        " %.3f Mb :", ( (buffer->len * sizeof(Byte)) / (1024.0 * 1024) )
+    );
+
+    /* filesize in viewer-rows (of records, if viewed so) */
+    rowlen = buffer_rowlen( buffer );
+    nrows  = buffer_nrows( buffer, rowlen );
+    if ( FMT_NCOLS == rowlen )
+        colorPRINTF(
+            settings->colorize, FGCLR_PMTFNAME, BGCLR_PMTFNAME,
+            " %llu rows ", (unsigned long long) (buffer->nrows)
+        );
+    else
+        colorPRINTF(
+            settings->colorize, FGCLR_PMTFNAME, BGCLR_PMTFNAME,
+            " %llu rows of %llu ", (unsigned long long) nrows, (unsigned long long) rowlen
+        );
+
+    row = FMT_NCOLS == rowlen             /* calc the row index for bt */
+        ? BT2ROW(bt, buffer->len, buffer->nrows)
+        : myMIN( bt, buffer->len - 1 ) / rowlen;
 
     putchar('|');
 
@@ -364,8 +1173,9 @@ _Bool show_prompt(
     colorPRINTF(
         settings->colorize, FGCLR_PMTPG, BGCLR_PMTPG,
         " Pg:%llu/%llu ",
-        (unsigned long long) (1 + ROW2PG(row, buffer->nrows)),
-        (unsigned long long) (buffer->npages)
+        (unsigned long long) (1 + ROW2PG(row, nrows)),
+        (unsigned long long) (FMT_NCOLS == rowlen
+            ? buffer->npages : nrows / FMT_PGLINES + (nrows % FMT_PGLINES != 0))
     );
 
     putchar('|');
@@ -375,6 +1185,96 @@ _Bool show_prompt(
         settings->colorize, FGCLR_PMTCHRSET, BGCLR_PMTCHRSET,
         " %s ", NAME_CHARSET(settings->charset)
     );
+
+    /* entropy of the block under the cursor (if known) */
+    if ( buffer->entmap.blocks && rawbt / buffer->entmap.blocklen < buffer->entmap.nblocks )
+    {
+        const size_t iblock = rawbt / buffer->entmap.blocklen;
+        putchar('|');
+        colorPRINTF(
+            settings->colorize, FGCLR_PMTENT, BGCLR_PMTENT,
+            " H:%.2f %s ",
+            buffer->entmap.blocks[iblock].bits,
+            NAME_ENTCLASS( entmap_class(&buffer->entmap, iblock) )
+        );
+    }
+
+    /* the compared file & its differences listed so far */
+    if ( buffer->peer ) {
+        size_t nruns = 0;
+        const double done = diff_progress( (Diff *) &buffer->diff, &nruns );
+        putchar('|');
+        colorPRINTF(
+            settings->colorize, FGCLR_PMTENT, BGCLR_PMTENT,
+            done < 1.0 ? " %s %s %llu+ runs %.0f%% " : " %s %s %llu runs ",
+            diff_at( &buffer->diff, rawbt ) ? "!=" : "==",
+            &buffer->peer->fname[ myMAX(strlen(buffer->peer->fname), FNAME_SHOWLEN) - FNAME_SHOWLEN ],
+            (unsigned long long) nruns, 100.0 * done
+        );
+    }
+
+    /* the hunk under the cursor (once diffed by rolling hashes) */
+    if ( buffer->peer && buffer->delta.hunks ) {
+        const Hunk *h = delta_hunk_at( &buffer->delta, rawbt );
+        putchar('|');
+        if ( h && HUNK_COPY == h->kind )
+            colorPRINTF( settings->colorize, FGCLR_PMTENT, BGCLR_PMTENT,
+                " %c @%llx ", NAME_HUNKKIND(h->kind),
+                (unsigned long long)(h->offb + (rawbt - h->offa)) );
+        else
+            colorPRINTF( settings->colorize, FGCLR_PMTENT, BGCLR_PMTENT,
+                " %c ", h ? NAME_HUNKKIND(h->kind) : '?' );
+    }
+
+    /* the region of a process's memory under the cursor */
+    if ( buffer->proc && rawbt < buffer->datalen ) {
+        const ProcRegion *r = procmem_region( buffer->proc, rawbt );
+        putchar('|');
+        colorPRINTF(
+            settings->colorize, FGCLR_PMTENT, BGCLR_PMTENT,
+            " @%llx %s %.*s ", procmem_addr( buffer->proc, rawbt ), r->perms,
+            FNAME_SHOWLEN, &r->name[ myMAX(strlen(r->name), FNAME_SHOWLEN) - FNAME_SHOWLEN ]
+        );
+    }
+
+    /* the view transform (if any) & the data offset under the cursor */
+    if ( XF_NONE != buffer->xform.kind ) {
+        putchar('|');
+        colorPRINTF(
+            settings->colorize, FGCLR_PMTENT, BGCLR_PMTENT,
+            " X:%s @%llx ", xform_name( buffer->xform.kind ), (unsigned long long) rawbt
+        );
+    }
+
+    /* # of edits done (& undone, if any) */
+    if ( buffer->editing && buffer->edits.nedits > 0 ) {
+        putchar('|');
+        colorPRINTF(
+            settings->colorize, FGCLR_PMTENT, BGCLR_PMTENT,
+            buffer->edits.ndone < buffer->edits.nedits ? " Edits:%llu/%llu " : " Edits:%llu ",
+            (unsigned long long) buffer->edits.ndone,
+            (unsigned long long) buffer->edits.nedits
+        );
+    }
+
+    /* length of the selection (if any) */
+    if ( buffer->marked ) {
+        putchar('|');
+        colorPRINTF(
+            settings->colorize, FGCLR_PMTENT, BGCLR_PMTENT,
+            " Sel:%llu ",
+            (unsigned long long) (bt > buffer->mark ? bt - buffer->mark : buffer->mark - bt) + 1
+        );
+    }
+
+    /* progress of the minimap (while it is being refined) */
+    if ( settings->showminimap && minimap_progress(&buffer->minimap) < 1.0 ) {
+        putchar('|');
+        colorPRINTF(
+            settings->colorize, FGCLR_PMTENT, BGCLR_PMTENT,
+            " Map:%.0f%% ", 100.0 * minimap_progress(&buffer->minimap)
+        );
+    }
     puts("\0");
 
     /* -----------------------
@@ -401,8 +1301,8 @@ _Bool show_prompt(
     colorPRINTF(
         settings->colorize, FGCLR_PMTDEC, BGCLR_PMTDEC,
         " d:%hhu %hhd ",
-        buffer->data[bt],
-        buffer->data[bt] > 127 ? buffer->data[bt] - 256 : buffer->data[bt]
+        byte,
+        byte > 127 ? byte - 256 : byte
     );
 
     putchar('|');
@@ -410,7 +1310,7 @@ _Bool show_prompt(
     colorPRINTF(
         settings->colorize, FGCLR_PMTOCT, BGCLR_PMTOCT,
         " o:%hho ",
-        buffer->data[bt]
+        byte
     );
 
     putchar('|');
@@ -418,7 +1318,7 @@ _Bool show_prompt(
     colorPRINTF(
         settings->colorize, FGCLR_PMTBIN, BGCLR_PMTBIN,
         " %s ",
-        (bitstr = bin_byte2bitstring( buffer->data[bt] )) ? bitstr : "error"
+        (bitstr = bin_byte2bitstring( byte )) ? bitstr : "error"
     );
     if ( bitstr )
         free(bitstr);
@@ -433,56 +1333,79 @@ _Bool show_prompt(
 
     fflush( stdout );
 
-    /* read the user command */
-    if ( !fgets( cmd, MAXINPUT, stdin ) )
-        return false;
-
-    /* if not just an ENTER, remove '\n' from the end */
-    slen = strlen(cmd);
-    if ( '\n' != *cmd && '\n' == cmd[ slen-1 ] )
-        cmd[ slen-1 ] = '\0';
-
-    return true;
+    return prompt_read( cmd, settings );
 }
 
 /*********************************************************//**
- * List the contents of a row in hex/char format.
+ * List the contents of a row of ncols bytes in hex/char format: the
+ * 1st FMT_NCOLS of them (at most) starting at from (any offset, not
+ * just a multiple of FMT_NCOLS), highlighting those that differ from
+ * the bytes of other starting at otherfrom (uncolored, by a '>' just
+ * before their hex digits).
  *************************************************************
  */
-_Bool view_row(
-    const size_t    row,
+_Bool view_bytes(
+    const size_t    from,
+    const size_t    ncols,
     const size_t    btcurr,
     const Buffer    *buffer,
+    const Buffer    *other,     /* highlight bytes differing from it */
+    const size_t    otherfrom,
     const Settings  *settings
 )
 {
     char clead;                 /* leading displayed char     */
-    size_t i;
-    const size_t row2idx = row * FMT_NCOLS;
+    size_t i, n, nother = 0;
+    Byte bytes[ FMT_NCOLS ], others[ FMT_NCOLS ];
+    const size_t row2idx = from;
+    const _Bool iscurr = btcurr >= from && btcurr - from < ncols;
+    const int ofstw = view_ofstw( buffer, other );
 
     if ( !buffer || !buffer->data || row2idx > buffer->len )
         return false;
 
+    /* the row's bytes as edited (& those they are compared with) */
+    n = buffer_get( buffer, row2idx, bytes, myMIN( ncols, (size_t) FMT_NCOLS ) );
+
+    if ( other )
+        nother = buffer_get( other, otherfrom, others, FMT_NCOLS );
+
+    /* uncolored rows are formatted at once, the separator before the
+       hex digits of every byte differing from other turned into a '>' */
+    if ( !settings->colorize ) {
+        char line[ HV_ROWMAX ];
+        const size_t hex0 = 1 + (size_t) ofstw + 1;     /* 1st byte's digits */
+        hv_format_bytes( bytes, n, buffer_label( buffer, row2idx ), ofstw,
+            (FMT_XASCII == settings->charset ? HV_FMT_XASCII : 0U) | (iscurr ? HV_FMT_CURSOR : 0U),
+            line, sizeof(line) );
+        for (i=0; other && i < n; i++)
+            if ( i >= nother || others[i] != bytes[i] )
+                line[ hex0 + 3*i + i/FMT_GRPCOLS - 1 ] = '>';
+        fputs( line, stdout );
+        return true;
+    }
+
     /* display row offset */
-    clead   = row == btcurr / FMT_NCOLS ? '*' : ' ';
-    if ( row == btcurr / FMT_NCOLS )
+    clead   = iscurr ? '*' : ' ';
+    if ( iscurr )
         colorPRINTF(
             settings->colorize, FGCLR_BYTCURR, BG_NOCHANGE,
-            "%c%0*lX ", clead, FMT_OFST,(long unsigned)row2idx
+            "%c%0*llX ", clead, ofstw, buffer_label( buffer, row2idx )
         );
     else
         colorPRINTF(
             settings->colorize, FGCLR_ROWOFST, BG_NOCHANGE,
-            "%c%0*lX ", clead, FMT_OFST,(long unsigned)row2idx
+            "%c%0*llX ", clead, ofstw, buffer_label( buffer, row2idx )
         );
 
     /* display row's contents as bytes */
-    for (i=0; i < FMT_NCOLS && row2idx + i < buffer->len; i++)
+    for (i=0; i < n; i++)
     {
-        Byte byte = buffer->data[row2idx + i];
+        Byte byte = bytes[i];
         const _Bool isPrintable = (settings->charset == FMT_ASCII)
                     ? isprint((int)byte)
                     : byte > 31;
+        const _Bool differs = other && (i >= nother || others[i] != byte);
 
         if ( i != 0 && i % FMT_GRPCOLS == 0 )       /* group columns      */
             putchar(' ');
@@ -491,33 +1414,33 @@ _Bool view_row(
         {
             if ( btcurr != row2idx + i )
                 colorPRINTF(
-                    settings->colorize, FGCLR_BYTPRT1, BG_NOCHANGE,
+                    settings->colorize, FGCLR_BYTPRT1, BGCLR_DIFF(differs),
                     "%02hX ", byte );
             else
                 colorPRINTF(
-                    settings->colorize, FGCLR_BYTCURR, BG_NOCHANGE,
+                    settings->colorize, FGCLR_BYTCURR, BGCLR_DIFF(differs),
                     "%02hX ", byte );
         }
         else if ( byte == 0 )               /* zeroed byte        */
         {
             if ( btcurr != row2idx + i )
                 colorPRINTF(
-                    settings->colorize, FGCLR_BYTZERO, BG_NOCHANGE,
+                    settings->colorize, FGCLR_BYTZERO, BGCLR_DIFF(differs),
                     "%02hX ", byte );
             else
                 colorPRINTF(
-                    settings->colorize, FGCLR_BYTCURR, BG_NOCHANGE,
+                    settings->colorize, FGCLR_BYTCURR, BGCLR_DIFF(differs),
                     "%02hX ", byte );
         }
         else                        /* non-printable byte */
         {
             if ( btcurr != row2idx + i )
                 colorPRINTF(
-                    settings->colorize, FGCLR_BYTPRT0, BG_NOCHANGE,
+                    settings->colorize, FGCLR_BYTPRT0, BGCLR_DIFF(differs),
                     "%02hX ", byte );
             else
                 colorPRINTF(
-                    settings->colorize, FGCLR_BYTCURR, BG_NOCHANGE,
+                    settings->colorize, FGCLR_BYTCURR, BGCLR_DIFF(differs),
                     "%02hX ", byte );
         }
     }
@@ -526,438 +1449,3630 @@ _Bool view_row(
     putchar(' ');
 
     /* display row's contents as ASCII chars */
-    for (i=0; i < FMT_NCOLS && row2idx + i < buffer->len; i++)
+    for (i=0; i < n; i++)
     {
-        int c = (int)buffer->data[row2idx + i];
+        int c = (int)bytes[i];
         const _Bool isPrintable = (settings->charset == FMT_ASCII)
                     ? isprint(c)
                     : (c>31);
+        const _Bool differs = other && (i >= nother || others[i] != c);
 
         if ( isPrintable )              /* printable byte     */
         {
             if ( btcurr != row2idx + i )
                 colorPRINTF(
-                    settings->colorize, FGCLR_BYTPRT1, BG_NOCHANGE,
+                    settings->colorize, FGCLR_BYTPRT1, BGCLR_DIFF(differs),
                     "%c", c );
             else
                 colorPRINTF(
-                    settings->colorize, FGCLR_BYTCURR, BG_NOCHANGE,
+                    settings->colorize, FGCLR_BYTCURR, BGCLR_DIFF(differs),
                     "%c", c );
         }
         else if ( c == '\0' )               /* zero-byte char     */
         {
             if ( btcurr != row2idx + i )
                 colorPRINTF(
-                    settings->colorize, FGCLR_BYTZERO, BG_NOCHANGE, "." );
+                    settings->colorize, FGCLR_BYTZERO, BGCLR_DIFF(differs), "." );
             else
                 colorPRINTF(
-                    settings->colorize, FGCLR_BYTCURR, BG_NOCHANGE,
+                    settings->colorize, FGCLR_BYTCURR, BGCLR_DIFF(differs),
                     "." );
         }
         else                        /* non-printable char */
         {
             if ( btcurr != row2idx + i )
                 colorPRINTF(
-                    settings->colorize, FGCLR_BYTPRT0, BG_NOCHANGE, "." );
+                    settings->colorize, FGCLR_BYTPRT0, BGCLR_DIFF(differs), "." );
             else
                 colorPRINTF(
-                    settings->colorize, FGCLR_BYTCURR, BG_NOCHANGE, "." );
+                    settings->colorize, FGCLR_BYTCURR, BGCLR_DIFF(differs), "." );
         }
     }
     for (; i < FMT_NCOLS; i++)
         putchar(' ');
-    putchar('\n');
-
 
     return true;
 }
 
 /*********************************************************//**
- *
+ * List the contents of a row in hex/char format (highlighting the
+ * bytes that differ from the same bytes of other, if not NULL).
  *************************************************************
  */
-_Bool view_screen( const size_t btcurr, const Buffer *buffer, const Settings *settings )
+_Bool view_row(
+    const size_t    row,
+    const size_t    btcurr,
+    const Buffer    *buffer,
+    const Buffer    *other,
+    const Settings  *settings
+)
 {
-    size_t i, rowstart;             /* for parsing rows */
+    const size_t rowlen = buffer_rowlen( buffer );
 
-    if ( !buffer || !buffer->data )
-        return false;
+    return view_bytes( row * rowlen, rowlen, btcurr, buffer, other, row * rowlen, settings );
+}
+
+/*********************************************************//**
+ * Display the i'th line of the entropy strip: the blocks around the
+ * one under the cursor, with their class glyph and entropy in bits.
+ *************************************************************
+ */
+void view_entstrip( const size_t i, const size_t btcurr, const Buffer *buffer, const Settings *settings )
+{
+    const EntMap *map = &buffer->entmap;
+    size_t iblock, icurr;
+    int cls;
 
-    rowstart = BT2ROW(btcurr, buffer->len, buffer->nrows);
+    if ( !map->blocks || 0 == map->nblocks )
+        return;
 
-    for (i=0; i < FMT_PGLINES && (i+rowstart) < buffer->nrows; i++)
-        view_row( (i+rowstart), btcurr, buffer, settings );
+    icurr = myMIN( btcurr / map->blocklen, map->nblocks - 1 );
+    if ( icurr + i < FMT_PGLINES / 2 || icurr + i - FMT_PGLINES / 2 >= map->nblocks )
+        return;
+    iblock = icurr + i - FMT_PGLINES / 2;
+    cls = entmap_class( map, iblock );
 
-    /* if necessary, fill rest of the page with blank rows */
-    for (; i < FMT_PGLINES; i++)
-        putchar('\n');
+    printf( " %c", iblock == icurr ? '>' : ' ' );
+    colorPRINTF(
+        settings->colorize, FGCLR_ENTCLASS(cls), BG_NOCHANGE,
+        "%c%3.1f", ENT_GLYPHS[cls], map->blocks[iblock].bits
+    );
 
-    return true;
+    return;
+}
+
+/*********************************************************//**
+ * Return the index of the 1st byte summarized by the i'th minimap cell.
+ *************************************************************
+ */
+size_t minimap_cell2bt( const size_t i, const size_t len )
+{
+    /* i * len / FMT_PGLINES, without overflowing */
+    return i * (len / FMT_PGLINES) + i * (len % FMT_PGLINES) / FMT_PGLINES;
+}
+
+/*********************************************************//**
+ * Display the i'th cell of the minimap: the class glyph of the i'th
+ * FMT_PGLINES'th of the buffer (as loaded, before any edits), marked
+ * if the cursor lies in it.
+ *************************************************************
+ */
+void view_minimap( const size_t i, const size_t btcurr, Buffer *buffer, const Settings *settings )
+{
+    const size_t from = minimap_cell2bt( i, buffer->datalen );
+    const size_t to   = minimap_cell2bt( i+1, buffer->datalen );
+    MmNode node;
+    int cls;
+
+    if ( !buffer->minimap.nodes[0] || from >= to )
+        return;
+
+    minimap_region( &buffer->minimap, from, to, &node );
+    cls = minimap_class( &node );
+
+    printf( " %c", btcurr >= from && btcurr < to ? '>' : '|' );
+    colorPRINTF(
+        settings->colorize, FGCLR_ENTCLASS(cls), BG_NOCHANGE,
+        "%c", ENT_GLYPHS[cls]
+    );
+
+    return;
 }
 
 /*********************************************************//**
  *
  *************************************************************
  */
-_Bool do_command(
-    size_t      *bt,        /* by reference */
-    const char  *cmd,
-    const char  *prevcmd,
-    Buffer      *buffer,
-    Settings    *settings   /* by reference */
-)
+#define VIEW_ROWLEN( ofstw )    ( 1 + (ofstw) + 1 + 3*FMT_NCOLS + (FMT_NCOLS-1)/FMT_GRPCOLS + 1 + FMT_NCOLS )
+
+/*********************************************************//**
+ * Display the bytes of the compared buffer facing the row-th row of
+ * the buffer: those at the same offsets or, once the files have been
+ * diffed by rolling hashes, those the row's bytes were copied to.
+ *************************************************************
+ */
+void view_peerrow( const size_t row, const size_t btcurr, const Buffer *buffer,
+                   const _Bool pad, const Settings *settings )
 {
-    enum KeyCommand key;
-    size_t row;
+    const Buffer *peer = buffer->peer;
+    const size_t from = row * FMT_NCOLS;
+    const int ofstw = view_ofstw( buffer, peer );
+
+    if ( buffer->delta.hunks && from < buffer->len )
+    {
+        const Hunk *h  = delta_hunk_at( &buffer->delta, from );
+        const Hunk *hc = delta_hunk_at( &buffer->delta, btcurr );
+        const size_t pbt = (hc && HUNK_COPY == hc->kind)
+                    ? hc->offb + (btcurr - hc->offa)
+                    : (size_t) -1;
+
+        if ( h && HUNK_COPY == h->kind )
+            view_bytes( h->offb + (from - h->offa), FMT_NCOLS, pbt, peer, buffer, from, settings );
+        else
+            colorPRINTF( settings->colorize, FGCLR_BYTZERO, BG_NOCHANGE, "%-*s", VIEW_ROWLEN(ofstw),
+                h ? "  <deleted>" : "" );
+        return;
+    }
+
+    if ( row < peer->nrows )
+        view_row( row, btcurr, peer, buffer, settings );
+    else if ( pad )
+        printf( "%*s", VIEW_ROWLEN(ofstw), "" );
+
+    return;
+}
+
+_Bool view_screen( const size_t btcurr, Buffer *buffer, const Settings *settings )
+{
+    size_t i, rowstart, rowlen, nrows;      /* for parsing rows */
+    const Buffer *peer = buffer ? buffer->peer : NULL;
+    const _Bool strips = settings->showentropy || settings->showminimap;
+    int ofstw;
 
     if ( !buffer || !buffer->data )
         return false;
+    ofstw = view_ofstw( buffer, peer );
 
-    /* execute the command */
+    rowlen = buffer_rowlen( buffer );
+    nrows  = buffer_nrows( buffer, rowlen );
+    rowstart = FMT_NCOLS == rowlen
+        ? BT2ROW(btcurr, buffer->len, buffer->nrows)
+        : myMIN( btcurr, buffer->len - 1 ) / rowlen;
 
-    row = BT2ROW( *bt, buffer->len, buffer->nrows );
-    key = tolower( (int) *cmd );
+    /* the memory of a process is shown as it is now */
+    if ( buffer->proc && !buffer->editing )
+        procmem_fetch( buffer->proc, buffer_rawoff( buffer, rowstart * rowlen ),
+                       FMT_PGLINES * rowlen, true );
 
-    /* display the help screen */
-    if ( KEY_HLP == key ) {
-        show_help( settings->colorize );
-        return true;
+    for (i=0; i < FMT_PGLINES; i++)
+    {
+        if ( (i+rowstart) < nrows )
+            view_row( (i+rowstart), btcurr, buffer, peer, settings );
+        else if ( strips || peer )
+            printf( "%*s", VIEW_ROWLEN(ofstw), "" );
+
+        if ( peer ) {                /* compared file on the right */
+            printf( " |" );
+            view_peerrow( (i+rowstart), btcurr, buffer, strips, settings );
+        }
+
+        if ( settings->showminimap )        /* minimap 1st: fixed width  */
+            view_minimap( i, buffer_rawoff(buffer, btcurr), buffer, settings );
+        if ( settings->showentropy )
+            view_entstrip( i, buffer_rawoff(buffer, btcurr), buffer, settings );
+        putchar('\n');
     }
 
-    /* load a new file */
-    if ( KEY_LOADFILE == key )
-    {
-        _Bool success = false;
-        char answer[256+1] = {'n'};
-        char tmpfname[ MAXINPUT ] = {'\0'};
+    return true;
+}
 
-        if ( '\0' == cmd[1] ) {
-            printf( "f must be followed by a filename! " );
-            pressENTER();
-            return true;
-        }
+/*********************************************************//**
+ * PanelItem callback describing a string hit.
+ *************************************************************
+ */
+typedef struct StrPanel {
+    const Buffer    *buffer;        /* where the strings were found       */
+    const StrList   *list;        /* ... and the strings themselves     */
+} StrPanel;
 
-        strncpy( tmpfname, &cmd[1], MAXINPUT );
-        if ( !fileexists(tmpfname) ) {
-            printf( "No such file, keeping current one! " );
-            pressENTER();
-            return true;
-        }
+static size_t panel_strhit( size_t i, char *line, size_t maxlen, const void *ctx )
+{
+    const StrPanel *panel = ctx;
+    const StrHit *hit = &panel->list->hits[i];
 
-        colorPRINTF(
-            settings->colorize, FG_RED, BG_NOCHANGE,
-            "Current file will be closed, are you sure (y/) ? "
-        );
-        if ( 'y' != tolower( (int) *s_read(answer, 256+1) ) )
-            return true;
+    line[0] = NAME_STRKIND( hit->kind );
+    line[1] = ' ';
+    strscan_text( panel->buffer->data, hit, &line[2], maxlen - 2 );
 
-        buffer_cleanup( buffer );
-        success = (settings->unlimfsize) 
-            ? buffer_read_file( buffer, tmpfname, 100*1024*1024 )
-            : buffer_read_file_longmax( buffer, tmpfname );
-        if ( !success ) {
-            perror(NULL);
-            return true;
-        }
+    return hit->off;
+}
 
-        return true;
-    }
+/*********************************************************//**
+ * List the strings of the buffer in a panel, and move the cursor
+ * to the one the user picks. The last list is kept, so going back
+ * to the panel with the same min length costs nothing.
+ *************************************************************
+ */
+_Bool strings_panel( size_t *bt, size_t minlen, const Buffer *buffer, const Settings *settings )
+{
+    static StrList  list = { NULL, 0, 0 };
+    static const Byte *lastdata = NULL;
+    static size_t   lastlen = 0U, lastminlen = 0U;
+    StrPanel panel;
+    long pick;
 
-    /* toggle colorization */
-    if ( KEY_COLOR == key ) {
-        settings->colorize = (settings->colorize == true ) ? false : true;
-        return true;
+    if ( !bt || !buffer || !buffer->data || !settings )
+        return false;
+
+    if ( buffer->data != lastdata || buffer->datalen != lastlen || minlen != lastminlen )
+    {
+        strlist_cleanup( &list );
+        lastdata = NULL;
+
+        colorPRINTF(settings->colorize, FG_RED, BG_NOCHANGE, "extracting strings..." );
+        fflush( stdout );
+        if ( !strscan(buffer->data, buffer->datalen, minlen, settings->strkinds, hv_ncpus(), &list) )
+            return false;
+
+        lastdata   = buffer->data;
+        lastlen    = buffer->datalen;
+        lastminlen = minlen;
     }
 
-    /* toggle character set */
-    if ( KEY_CHARSET == key ) {
-        settings->charset =     (settings->charset == FMT_ASCII)
-                    ? FMT_XASCII : FMT_ASCII;
+    if ( 0 == list.n ) {
+        BELL(1);
         return true;
     }
 
-    /* byte back/forward */
-    if ( KEY_BYTEB == key || KEY_BYTEF == key )
-    {
-        /* get relative step (if any) */
-        long long step = strtoll( &cmd[1], NULL, 10 );
-        if (errno == ERANGE)            /* over/underflowed step     */
-            return true;
-        if ( step == 0 )            /* no step ? assume 1        */
-            step = 1;
-        else if ( step < 0 )            /* negative step? negate it  */
-            step = -step;
+    panel.buffer = buffer;
+    panel.list   = &list;
+    pick = panel_pick( "Strings", list.n, panel_strhit, &panel, settings );
+    if ( pick >= 0 )
+        *bt = buffer_viewoff( buffer, list.hits[pick].off );
 
-        /* apply relative row-step */
-        if ( KEY_BYTEB == key )
-            *bt =   (*bt > step - 1) ? *bt - step : 0;
-        else /* KEY_BYTEF == key */
-            *bt =   (*bt < buffer->len - 1 - step)
-                ? *bt + step
-                : buffer->len - 1;
+    return true;
+}
 
-        return true;
+/*********************************************************//**
+ * Print every string of the buffer, one per line, preceded by its
+ * hex offset and its kind ('a' for ASCII, 'u' for UTF-16LE).
+ *************************************************************
+ */
+_Bool strings_report( const Buffer *buffer, const Settings *settings )
+{
+    StrList list;
+    HvScan  scan;
+    size_t  i, j;
+    int     ofstw;
+
+    if ( !buffer || !buffer->data || !settings )
+        return false;
+    ofstw = hv_ofst_width( buffer->len );
+
+    hv_scan_begin( &scan, buffer->file, 0, buffer->len );
+    hv_scan_at( &scan, HV_NOTFOUND );        /* scanned in parallel */
+    if ( !strscan(buffer->data, buffer->len, settings->strminlen, settings->strkinds, hv_ncpus(), &list) ) {
+        hv_scan_end( &scan );
+        return false;
     }
 
-    /* row start/end */
-    if ( KEY_ROWSTA == key ) {
-        *bt = ROW2BT(row, buffer->nrows);
-        return true;
+    for (i=0; i < list.n; i++)
+    {
+        const StrHit *hit = &list.hits[i];
+
+        printf( "%0*llX %c ", ofstw, (unsigned long long) hit->off, NAME_STRKIND(hit->kind) );
+        if ( STR_ASCII == hit->kind )
+            fwrite( &buffer->data[hit->off], sizeof(Byte), hit->len, stdout );
+        else
+            for (j=0; j < hit->len; j += 2)
+                putchar( buffer->data[hit->off + j] );
+        putchar('\n');
     }
-    if ( KEY_ROWEND == key ) {
-        *bt = ROW2BT(row, buffer->nrows) + FMT_NCOLS - 1;
+
+    hv_scan_end( &scan );            /* the strings printed too */
+    strlist_cleanup( &list );
+    fflush( stdout );
+
+    return !ferror( stdout );
+}
+
+/*********************************************************//**
+ * Make sure the entropy map of the buffer is computed with blocks of
+ * blocklen bytes, reusing the cached map of the file if it is valid.
+ *************************************************************
+ */
+_Bool buffer_entropy( Buffer *buffer, size_t blocklen )
+{
+    char     path[ MAXINPUT+64 ];
+    uint64_t key = 0;
+    HvScan   scan;
+    _Bool    cacheable, ok;
+
+    if ( !buffer || !buffer->data )
+        return false;
+
+    if ( buffer->entmap.blocks && buffer->entmap.blocklen == blocklen )
         return true;
-    }
+    entmap_cleanup( &buffer->entmap );
 
-    /* row up/down */
-    if ( KEY_ROWUP == key || KEY_ROWDN == key )
+    cacheable = cache_path( buffer->fname, "ent", path, sizeof(path), &key );
+    if ( cacheable && entmap_load( &buffer->entmap, path, key ) )
     {
-        /* get relative row-step (if any) */
-        long long step = strtoll( &cmd[1], NULL, 10 );
-        if (errno == ERANGE)            /* over/underflowed step     */
+        if ( buffer->entmap.blocklen == blocklen && buffer->entmap.datalen == buffer->datalen )
             return true;
-        if ( step == 0 )            /* no step ? assume 1        */
-            step = 1;
-        else if ( step < 0 )            /* negative step? negate it  */
-            step = -step;
-
-        /* apply relative row-step */
-        if ( KEY_ROWUP == key )
-            row =   (row > step - 1) ? row - step : 0;
-        else /* KEY_ROWDN == key */
-            row =   (row < buffer->nrows - 1 - step)
-                ? row + step
-                : buffer->nrows - 1;
+        entmap_cleanup( &buffer->entmap );
     }
 
-    /* page up/down */
-    else if ( KEY_PGUP == key || KEY_PGDN == key )
+    hv_scan_begin( &scan, buffer->file, 0, buffer->datalen );
+    hv_scan_at( &scan, HV_NOTFOUND );        /* computed in parallel */
+    ok = entmap_compute( buffer->data, buffer->datalen, blocklen, hv_ncpus(), &buffer->entmap );
+    hv_scan_end( &scan );
+    if ( !ok )
+        return false;
+    if ( cacheable )
+        entmap_save( &buffer->entmap, path, key );
+
+    return true;
+}
+
+/*********************************************************//**
+ * Print the regions of the buffer (runs of blocks of the same entropy
+ * class), followed by the byte histogram of the whole buffer.
+ *************************************************************
+ */
+_Bool entropy_report( Buffer *buffer, const Settings *settings )
+{
+    const EntMap *map = &buffer->entmap;
+    const int ofstw = hv_ofst_width( buffer->len );
+    size_t b, first;
+    int    c;
+
+    if ( !buffer_entropy( buffer, settings->entblocklen ) )
+        return false;
+
+    printf( "# %s: %llu bytes, %llu blocks of %llu bytes, %.4f bits/byte\n",
+        buffer->fname,
+        (unsigned long long) buffer->len,
+        (unsigned long long) map->nblocks,
+        (unsigned long long) map->blocklen,
+        entmap_bits( map->hist, buffer->len )
+    );
+    printf( "# %-*s %-*s %-5s %10s %6s %6s %6s\n",
+        ofstw, "START", ofstw, "END", "CLASS", "BLOCKS", "AVG-H", "MIN-H", "MAX-H" );
+
+    for (first=0; first < map->nblocks; first=b)
     {
-        /* get relative page-step (if any) */
-        long long step = strtoll( &cmd[1], NULL, 10 );
-        if (errno == ERANGE)            /* over/underflowed step     */
-            return true;
-        if ( step == 0 )            /* no step ? assume 1        */
-            step = 1;
-        else if ( step < 0 )            /* negative step? negate it  */
-            step = -step;
+        const int cls = entmap_class( map, first );
+        double sum = 0.0, lo = 8.0, hi = 0.0;
 
-        /* apply relative page-step */
-        if ( KEY_PGUP == key )
-            row =   row > step * (FMT_PGLINES - 1)
-                ? row - step * FMT_PGLINES
-                : 0;
-        else /* KEY_PGDN == key */
-            row =   myMIN( (row + step * FMT_PGLINES), buffer->nrows - 1 );
+        for (b=first; b < map->nblocks && entmap_class(map, b) == cls; b++) {
+            sum += map->blocks[b].bits;
+            lo = myMIN( lo, map->blocks[b].bits );
+            hi = myMAX( hi, map->blocks[b].bits );
+        }
+        printf( "  %0*llX %0*llX %-5s %10llu %6.3f %6.3f %6.3f\n",
+            ofstw, (unsigned long long) (first * map->blocklen),
+            ofstw, (unsigned long long) myMIN( b * map->blocklen, buffer->len ),
+            NAME_ENTCLASS(cls),
+            (unsigned long long) (b - first),
+            sum / (b - first), lo, hi
+        );
     }
 
-    /* top/bottom of file */
-    else if ( KEY_TOP == key ) {
-        *bt = 0;
-        return true;
+    printf( "# histogram (byte:count)" );
+    for (c=0; c < 256; c++)
+        printf( "%s%02X:%llu", c % 16 ? " " : "\n  ", c, (unsigned long long) map->hist[c] );
+    putchar('\n');
+    fflush( stdout );
+
+    return !ferror( stdout );
+}
+
+/*********************************************************//**
+ * Find the record sizes (see period.h) of the data of the selection
+ * if there is one, else of the whole buffer (analyses are of the data:
+ * not edited, nor transformed), strides up to maxstride bytes long (0
+ * for PERIOD_MAXSTRIDE), into p. The offsets of the data analyzed go
+ * into from & to.
+ *************************************************************
+ */
+_Bool buffer_period( size_t bt, size_t maxstride, const Buffer *buffer, Period *p,
+                     size_t *from, size_t *to )
+{
+    HvScan  scan;
+    _Bool   ok;
+
+    *from = 0;
+    *to   = buffer->datalen;
+    if ( buffer->marked ) {
+        *from = myMIN( buffer_rawoff( buffer, myMIN( bt, buffer->mark ) ), buffer->datalen );
+        *to   = myMIN( buffer_rawoff( buffer, myMAX( bt, buffer->mark ) ) + 1, buffer->datalen );
+        *to   = myMAX( *from, *to );
     }
-    else if ( KEY_BOT == key ) {
-        *bt = buffer->len - 1;
+
+    hv_scan_begin( &scan, buffer->file, *from, *to );
+    hv_scan_at( &scan, HV_NOTFOUND );        /* sampled in parallel */
+    ok = period_detect( &buffer->data[ *from ], *to - *from, maxstride, hv_ncpus(), p );
+    hv_scan_end( &scan );
+    return ok;
+}
+
+/*********************************************************//**
+ * PanelItem callback describing a record size found.
+ *************************************************************
+ */
+static size_t panel_stride( size_t i, char *line, size_t maxlen, const void *ctx )
+{
+    const PeriodHit *hit = &((const Period *) ctx)->top[i];
+
+    snprintf( line, maxlen, "%6llu bytes, confidence %5.3f, %6.2f%% equal a stride later",
+        (unsigned long long) hit->stride, hit->confidence, 100.0 * hit->match );
+    return hit->stride;
+}
+
+/*********************************************************//**
+ * List the record sizes of the selection (or of the whole buffer) in
+ * a panel, strides up to maxstride bytes long (0 for the default), and
+ * view the buffer in rows of the one the user picks (see rowlen).
+ *************************************************************
+ */
+_Bool period_panel( size_t bt, size_t maxstride, Buffer *buffer, const Settings *settings )
+{
+    Period  p;
+    size_t  from, to;
+    long    pick;
+
+    colorPRINTF( settings->colorize, FG_RED, BG_NOCHANGE, "looking for record sizes..." );
+    fflush( stdout );
+    if ( !buffer_period( bt, maxstride, buffer, &p, &from, &to ) )
+        return false;
+    if ( 0 == p.ntop ) {
+        BELL(1);
         return true;
     }
 
-    /* goto to specified byte */
-    else if ( KEY_GBYTE == key ) {
-        size_t newbt;
-        sscanf( &cmd[1], "%li", (long int *)&newbt );
-        row =   BT2ROW(newbt, buffer->len, buffer->nrows);
-        *bt = newbt > buffer->len - 1 ? buffer->len - 1 : newbt;
-        return true;
+    pick = panel_pick( "Record sizes (stride in hex; pick one to view rows of it)",
+                       p.ntop, panel_stride, &p, settings );
+    if ( pick >= 0 )
+        buffer->rowlen = p.top[pick].stride;
+    return true;
+}
+
+/*********************************************************//**
+ * Print the record sizes of the buffer (strides up to settings->maxstride
+ * bytes long), best 1st: their stride, how sure they are (0..1), and
+ * the share of the bytes equal to the one a stride later.
+ *************************************************************
+ */
+_Bool period_report( const Buffer *buffer, const Settings *settings )
+{
+    Period  p;
+    size_t  from, to, i;
+
+    if ( !buffer || !buffer->data || !settings )
+        return false;
+    if ( !buffer_period( 0, settings->maxstride, buffer, &p, &from, &to ) )
+        return false;
+
+    printf( "# %s: %llu bytes, %llu sampled per stride (up to %llu), %.2f%% equal by chance\n",
+        buffer->fname, (unsigned long long) (to - from), p.nsampled,
+        (unsigned long long) p.maxstride, 100.0 * p.chance );
+    printf( "# %8s %10s %8s\n", "STRIDE", "CONFIDENCE", "MATCH" );
+    for (i=0; i < p.ntop; i++)
+        printf( "  %8llu %10.3f %7.2f%%\n", (unsigned long long) p.top[i].stride,
+            p.top[i].confidence, 100.0 * p.top[i].match );
+    fflush( stdout );
+
+    return !ferror( stdout );
+}
+
+/*********************************************************//**
+ * Find the most frequent n-grams & the most repeated blocks of blocklen
+ * bytes (0 for NGRAM_BLOCKLEN; see ngram.h) of the data of the selection
+ * if there is one, else of the whole buffer, into ng. The offsets of
+ * the data analyzed go into from & to (those of ng are from from).
+ *************************************************************
+ */
+_Bool buffer_ngrams( size_t bt, size_t blocklen, const Buffer *buffer, Ngrams *ng,
+                     size_t *from, size_t *to )
+{
+    HvScan  scan;
+    _Bool   ok;
+
+    *from = 0;
+    *to   = buffer->datalen;
+    if ( buffer->marked ) {
+        *from = myMIN( buffer_rawoff( buffer, myMIN( bt, buffer->mark ) ), buffer->datalen );
+        *to   = myMIN( buffer_rawoff( buffer, myMAX( bt, buffer->mark ) ) + 1, buffer->datalen );
+        *to   = myMAX( *from, *to );
     }
-    /* goto to specified row */
-    else if ( KEY_GROW == key ) {
-        size_t newrow;
-        sscanf( &cmd[1], "%li", (long int *)&newrow );
-        row =   newrow > buffer->nrows - 1
-            ? buffer->nrows - 1
-            : newrow > 0 ? newrow : 0;
+
+    hv_scan_begin( &scan, buffer->file, *from, *to );
+    hv_scan_at( &scan, HV_NOTFOUND );        /* counted in parallel */
+    ok = ngram_scan( &buffer->data[ *from ], *to - *from, blocklen, hv_ncpus(), ng );
+    hv_scan_end( &scan );
+    return ok;
+}
+
+/*********************************************************//**
+ * Write the n-gram of the i-th length of hit into hex (as hex digit
+ * pairs, separated by sep if not '\0') & into ascii (printable chars
+ * as they are, others as dots), if not NULL.
+ *************************************************************
+ */
+static void ngram_text( const NgramHit *hit, size_t i, char sep, char *hex, char *ascii )
+{
+    size_t  j;
+
+    for (j=0; j < NGRAM_LEN(i); j++) {
+        if ( hex && sep && j )
+            *hex++ = sep;
+        if ( hex )
+            hex += sprintf( hex, "%02X", hit->gram[j] );
+        if ( ascii )
+            *ascii++ = isprint( hit->gram[j] ) ? (char) hit->gram[j] : '.';
     }
-    /* goto to specified page */
-    else if ( KEY_GPAGE == key ) {
-        size_t newpg = strtoul( &cmd[1], NULL, 10 );
-        --newpg;
-        row = PG2ROW(newpg, buffer->npages);
+    if ( ascii )
+        *ascii = '\0';
+}
+
+typedef struct NgramPanel {
+    const Ngrams *ng;
+    size_t      from;            /* offset of the data analyzed        */
+} NgramPanel;
+
+/*********************************************************//**
+ * PanelItem callback describing a frequent n-gram (the 1st items, by
+ * length) or a repeated block (the last ones).
+ *************************************************************
+ */
+static size_t panel_ngram( size_t i, char *line, size_t maxlen, const void *ctx )
+{
+    const NgramPanel *panel = ctx;
+    const Ngrams *ng = panel->ng;
+    char    hex[ 3*8 ], ascii[ 8+1 ];
+    size_t  k;
+
+    for (k=0; k < NGRAM_NLENS && i >= ng->ntop[k]; k++)
+        i -= ng->ntop[k];
+    if ( k == NGRAM_NLENS ) {
+        const NgramDup *dup = &ng->dups[i];
+        snprintf( line, maxlen, "block of %llu bytes, %llu times, xxh64 %016llx",
+            (unsigned long long) ng->blocklen, dup->count, (unsigned long long) dup->hash );
+        return panel->from + dup->off;
     }
 
-    /* search forward for text-string */
-    else if ( KEY_FNDSTR == key )
+    ngram_text( &ng->top[k][i], k, ' ', hex, ascii );
+    snprintf( line, maxlen, "%u-gram %-23s %-8s %11llu %6.2f%%", NGRAM_LEN(k), hex, ascii,
+        ng->top[k][i].count, 100.0 * ng->top[k][i].count / myMAX( 1, ng->total[k] ) );
+    return panel->from + ng->top[k][i].off;
+}
+
+/*********************************************************//**
+ * List the most frequent n-grams & the most repeated blocks of blocklen
+ * bytes (0 for the default) of the selection (or of the whole buffer)
+ * in a panel, and move the cursor to the 1st of the one the user picks.
+ * The last ones found are kept, so going back to the panel for the
+ * same data & blocks costs nothing.
+ *************************************************************
+ */
+_Bool ngram_panel( size_t *bt, size_t blocklen, const Buffer *buffer, const Settings *settings )
+{
+    static Ngrams   ng;
+    static const Byte *lastdata = NULL;
+    static size_t   lastfrom = 0U, lastto = 0U, lastblocklen = 0U;
+    NgramPanel panel;
+    char    line[ FMT_PANELCOLS+1 ];
+    size_t  from, to, n, k;
+    long    pick;
+
+    if ( !bt || !buffer || !buffer->data || !settings )
+        return false;
+
+    from = 0;
+    to   = buffer->datalen;
+    if ( buffer->marked ) {
+        from = myMIN( buffer_rawoff( buffer, myMIN( *bt, buffer->mark ) ), buffer->datalen );
+        to   = myMAX( from, myMIN( buffer_rawoff( buffer, myMAX( *bt, buffer->mark ) ) + 1, buffer->datalen ) );
+    }
+    if ( buffer->data != lastdata || from != lastfrom || to != lastto || blocklen != lastblocklen )
     {
-        size_t ibt = *bt;           /* remember cursor position   */
-        size_t slen = strlen( &cmd[1] );
-        int tmp = 1;
+        lastdata = NULL;
+        colorPRINTF( settings->colorize, FG_RED, BG_NOCHANGE, "counting n-grams & blocks..." );
+        fflush( stdout );
+        if ( !buffer_ngrams( *bt, blocklen, buffer, &ng, &from, &to ) )
+            return false;
+        lastdata     = buffer->data;
+        lastfrom     = from;
+        lastto       = to;
+        lastblocklen = blocklen;
+    }
 
-        if ( !strcmp(cmd, prevcmd) )        /* fix ibt if cmd == prevcmd  */
-            ibt = ibt > 0 ? ibt+1 : 1;
+    for (n = ng.ndups, k=0; k < NGRAM_NLENS; k++)
+        n += ng.ntop[k];
+    if ( 0 == n ) {
+        BELL(1);
+        return true;
+    }
 
-        /* do the search */
-        colorPRINTF(settings->colorize, FG_RED, BG_NOCHANGE, "searching..." );
-        while ( slen && ibt < buffer->len - slen + 1
-            && (tmp = memcmp(&buffer->data[ibt], (Byte *)&cmd[1], slen * sizeof(Byte)))
-        )
-            ibt++;
-            
-        if ( 0 == tmp )             /* string found               */
-            *bt = ibt;          /* ... update cursor position */
+    panel.ng   = &ng;
+    panel.from = from;
+    pick = panel_pick( "N-grams & repeated blocks (pick one to go to it)",
+                       n, panel_ngram, &panel, settings );
+    if ( pick >= 0 )
+        *bt = buffer_viewoff( buffer, panel_ngram( (size_t) pick, line, sizeof(line), &panel ) );
+    return true;
+}
+
+/*********************************************************//**
+ * Print the most frequent 2, 4 & 8-grams of the buffer (where found,
+ * bytes, count & share of all), and its most repeated blocks of
+ * settings->dupblocklen bytes (where found, count & XXH64): found 1st
+ * (FIRST) where counted exactly, else at one of their offsets (AT).
+ *************************************************************
+ */
+_Bool ngram_report( const Buffer *buffer, const Settings *settings )
+{
+    Ngrams  ng;
+    char    hex[ 3*8 ], ascii[ 8+1 ];
+    size_t  from, to, i, k;
+    int     ofstw;
+
+    if ( !buffer || !buffer->data || !settings )
+        return false;
+    if ( !buffer_ngrams( 0, settings->dupblocklen, buffer, &ng, &from, &to ) )
+        return false;
+    ofstw = hv_ofst_width( buffer->len );
+
+    printf( "# %s: %llu bytes\n", buffer->fname, (unsigned long long) (to - from) );
+    for (k=0; k < NGRAM_NLENS; k++)
+    {
+        printf( "# %u-grams: %llu", NGRAM_LEN(k), ng.total[k] );
+        if ( ng.maxerr[k] )
+            printf( ", counts low by %llu at most\n", ng.maxerr[k] );
         else
-            BELL(1);
+            printf( ", counts exact\n" );
+        printf( "# %-*s %-23s %-8s %12s %7s\n", ofstw, ng.maxerr[k] ? "AT" : "FIRST",
+            "GRAM", "ASCII", "COUNT", "SHARE" );
+        for (i=0; i < ng.ntop[k]; i++) {
+            ngram_text( &ng.top[k][i], k, ' ', hex, ascii );
+            printf( "  %0*llX %-23s %-8s %12llu %6.2f%%\n", ofstw,
+                (unsigned long long) ng.top[k][i].off, hex, ascii, ng.top[k][i].count,
+                100.0 * ng.top[k][i].count / myMAX( 1, ng.total[k] ) );
+        }
+    }
+
+    printf( "# blocks of %llu bytes: %llu, %llu repeating an earlier one%s (%.2f%%)\n",
+        (unsigned long long) ng.blocklen, ng.nblocks, ng.nrepeats,
+        ng.exact ? "" : " at least", 100.0 * ng.nrepeats / myMAX( 1, ng.nblocks ) );
+    printf( "# %-*s %12s %s\n", ofstw, ng.exact ? "FIRST" : "AT", "COUNT", "XXH64" );
+    for (i=0; i < ng.ndups; i++)
+        printf( "  %0*llX %12llu %016llx\n", ofstw, (unsigned long long) ng.dups[i].off,
+            ng.dups[i].count, (unsigned long long) ng.dups[i].hash );
+    fflush( stdout );
 
+    return !ferror( stdout );
+}
+
+/*********************************************************//**
+ * Hash the bytes [from,to) of the buffer as viewed (piece by piece,
+ * so not in parallel) with alg, into hex.
+ *************************************************************
+ */
+void buffer_hash( const Buffer *buffer, int alg, size_t from, size_t to, char *hex )
+{
+    unsigned char digest[ HASH_MAXLEN ];
+    Byte    *chunk = malloc( PIECE_IOLEN );
+    HashCtx ctx;
+    HvScan  scan;
+    size_t  n;
+
+    if ( !chunk ) {
+        strcpy( hex, "error" );
+        return;
+    }
+    hash_init( &ctx, alg );
+    hv_scan_begin( &scan, buffer->editing ? NULL : buffer->file, from, to );
+    for (; from < to; from += n) {
+        hv_scan_at( &scan, from );
+        n = buffer_get( buffer, from, chunk, myMIN(to - from, (size_t) PIECE_IOLEN) );
+        hash_update( &ctx, chunk, n );
+    }
+    hv_scan_end( &scan );
+    hash_tohex( digest, hash_final( &ctx, digest ), hex );
+    free( chunk );
+
+    return;
+}
+
+/*********************************************************//**
+ * Parse the hash command cmd (see show_help()) into the alg it asks
+ * for (-1 for all of them) and the range [from,to) of the buffer to
+ * hash: the whole buffer, the selection, the page, or n bytes from
+ * the cursor at bt. Return false if cmd is invalid.
+ *************************************************************
+ */
+_Bool hash_range( const size_t bt, const char *cmd, const Buffer *buffer,
+                  int *only, size_t *from, size_t *to, const char **what )
+{
+    char    name[16] = {'\0'}, scope[16] = {'\0'};
+
+    *from = 0;
+    *to   = buffer->len;
+    *what = "file";
+    *only = -1;
+
+    sscanf( &cmd[1], "%15s %15s", name, scope );
+    if ( '\0' == scope[0] && '\0' != name[0]
+        && ('\0' == name[1] || isdigit( (int) name[0] ))
+    ) {
+        strcpy( scope, name );            /* just a scope, all algs    */
+        name[0] = '\0';
+    }
+    if ( '\0' != name[0] && -1 == (*only = hash_byname(name)) )
+        return false;
+
+    if ( KEY_MARK == tolower((int) scope[0]) ) {
+        if ( !buffer->marked )
+            return false;
+        *from = myMIN( bt, buffer->mark );
+        *to   = myMIN( myMAX(bt, buffer->mark) + 1, buffer->len );
+        *what = "selection";
+    }
+    else if ( KEY_GPAGE == tolower((int) scope[0]) ) {
+        *from = ROW2BT( BT2ROW(bt, buffer->len, buffer->nrows), buffer->nrows );
+        *to   = myMIN( *from + FMT_PGLINES * FMT_NCOLS, buffer->len );
+        *what = "page";
+    }
+    else if ( isdigit( (int) scope[0] ) ) {
+        const unsigned long long n = strtoull( scope, NULL, 0 );
+        *from = bt;
+        *to   = bt + myMIN( n, (unsigned long long) (buffer->len - bt) );
+        *what = "range";
+    }
+    else if ( '\0' != scope[0] )
+        return false;
+
+    return true;
+}
+
+/*********************************************************//**
+ * Hash the bytes [from,to) of the buffer with alg, into hex. Digests
+ * of the whole buffer computed while loading it are reported as they
+ * are (unless it has unsaved edits or is viewed transformed).
+ *************************************************************
+ */
+void hash_digest( const Buffer *buffer, int alg, size_t from, size_t to, char *hex )
+{
+    HvScan scan;
+
+    if ( buffer_dirty( buffer ) || XF_NONE != buffer->xform.kind )
+        buffer_hash( buffer, alg, from, to, hex );
+    else if ( 0 == from && buffer->len == to && (buffer->hashmask & (1U << alg)) )
+        strcpy( hex, buffer->digest[alg] );
+    else {
+        hv_scan_begin( &scan, buffer->file, from, to );
+        hv_scan_at( &scan, HV_NOTFOUND );    /* hashed in parallel */
+        if ( !hash_data( alg, &buffer->data[from], to - from, hv_ncpus(), hex ) )
+            strcpy( hex, "error" );
+        hv_scan_end( &scan );
+    }
+    return;
+}
+
+/*********************************************************//**
+ * Display the checksums/hashes requested by cmd (see show_help()).
+ *************************************************************
+ */
+_Bool hash_show( const size_t bt, const char *cmd, const Buffer *buffer, const Settings *settings )
+{
+    char    hex[ HASH_HEXLEN ];
+    size_t  from, to;
+    const char *what;
+    int     alg, only;
+
+    if ( !hash_range( bt, cmd, buffer, &only, &from, &to, &what ) ) {
+        BELL(1);
         return true;
     }
-    /* search backwards for text-string */
-    else if ( KEY_RFNDSTR == key )
+
+    putchar('\n');
+    colorPRINTF( settings->colorize, FGCLR_EM1, BG_NOCHANGE,
+        "%s [%llX,%llX) = %llu bytes\n", what,
+        (unsigned long long) from, (unsigned long long) to, (unsigned long long) (to - from)
+    );
+    for (alg=0; alg < HASH_NALGS; alg++)
     {
-        size_t ibt = *bt;           /* remember cursor position   */
-        size_t slen = strlen( &cmd[1] );
-        int tmp = 1;
+        if ( -1 != only && alg != only )
+            continue;
+        hash_digest( buffer, alg, from, to, hex );
+        printf( "%-8s %s\n", hash_name(alg), hex );
+    }
+    pressENTER();
 
-        if ( !strcmp(cmd, prevcmd) )        /* fix ibt if cmd == prevcmd  */
-            ibt = ibt > 0 ? ibt-1 : 0;
+    return true;
+}
 
-        /* do the search */
-        colorPRINTF(settings->colorize, FG_RED, BG_NOCHANGE, "searching..." );
-        while ( slen && ibt > 0
-            && (tmp=memcmp(&buffer->data[ibt], (Byte *)&cmd[1], slen * sizeof(Byte)))
-        )
-            ibt--;
-        /* 0 is treaded separately because ibt is unsigned */
-        if ( ibt == 0 && tmp != 0 )
-            tmp = memcmp(&buffer->data[ibt], (Byte *)&cmd[1], slen * sizeof(Byte));
+/*********************************************************//**
+ * Print the checksums/hashes of settings->hashmask (already computed
+ * by buffer_map_file()), in the BSD tagged format: alg (file) = digest
+ *************************************************************
+ */
+_Bool hash_report( const Buffer *buffer, const Settings *settings )
+{
+    int alg;
 
-        if ( 0 == tmp )             /* string found               */
-            *bt = ibt;          /* ... update cursor position */
-        else
+    if ( !buffer || !settings )
+        return false;
+
+    for (alg=0; alg < HASH_NALGS; alg++)
+        if ( settings->hashmask & buffer->hashmask & (1U << alg) )
+            printf( "%s (%s) = %s\n", hash_name(alg), buffer->fname, buffer->digest[alg] );
+    fflush( stdout );
+
+    return !ferror( stdout );
+}
+
+/*********************************************************//**
+ * Extract the bytes [settings->xfrom,xto) of the buffer (clamped to
+ * its end) into settings->outname, and print how long it took.
+ *************************************************************
+ */
+_Bool extract_report( const Buffer *buffer, const Settings *settings )
+{
+    const size_t from = (size_t) myMIN( settings->xfrom, (unsigned long long) buffer->len );
+    const size_t to   = (size_t) myMIN( settings->xto, (unsigned long long) buffer->len );
+    double  start, ms;
+
+    if ( from >= to ) {
+        errno = EINVAL;                /* nothing there */
+        return false;
+    }
+    start = stats_now();
+    if ( !buffer_extract( buffer, from, to - from, settings->outname ) ) {
+        perror( settings->outname );
+        return false;
+    }
+    ms = (stats_now() - start) / 1e3;
+
+    printf( "# [%llX,%llX) = %llu bytes extracted into %s in %.3f ms (%.1f MB/s)\n",
+        (unsigned long long) from, (unsigned long long) to, (unsigned long long) (to - from),
+        settings->outname, ms, ms > 0.0 ? (to - from) / (ms * 1e3) : 0.0
+    );
+    fflush( stdout );
+
+    return !ferror( stdout );
+}
+
+/*********************************************************//**
+ * Extract every object embedded in the buffer, found by the header &
+ * footer signatures of its kind (see carve.c), into a file of its own
+ * in the directory settings->outname, named by its offset & kind, and
+ * print where each one was, followed by the totals & how fast the
+ * buffer was scanned & the objects copied.
+ *************************************************************
+ */
+_Bool carve_report( const Buffer *buffer, const Settings *settings )
+{
+    char    path[ MAXINPUT+64 ];
+    const int ofstw = hv_ofst_width( buffer->len );
+    unsigned long long nhits = 0, ncarved = 0;
+    double  start, copyus = 0.0, t, ms;
+    size_t  from = 0;
+    CarveHit hit;
+    HvScan  scan;
+
+#ifdef HV_POSIX
+    if ( -1 == mkdir( settings->outname, 0777 ) && EEXIST != errno ) {
+        perror( settings->outname );
+        return false;
+    }
+#endif
+
+    printf( "# %s: %llu bytes, carved into %s\n",
+        buffer->fname, (unsigned long long) buffer->len, settings->outname );
+    printf( "# %-*s %-*s %-4s %12s %s\n", ofstw, "START", ofstw, "END", "KIND", "BYTES", "FILE" );
+
+    start = stats_now();
+    hv_scan_begin( &scan, buffer->file, 0, buffer->len );
+    hv_scan_at( &scan, HV_NOTFOUND );        /* scanned by leaps */
+    while ( from < buffer->len && carve_next( buffer->data, buffer->len, from, &hit ) )
+    {
+        snprintf( path, sizeof(path), "%s/%0*llx.%s", settings->outname, ofstw,
+            (unsigned long long) hit.off, carve_name( hit.kind ) );
+        t = stats_now();
+        if ( !buffer_extract( buffer, hit.off, hit.len, path ) ) {
+            perror( path );
+            hv_scan_end( &scan );
+            return false;
+        }
+        copyus += stats_now() - t;
+
+        printf( "  %0*llX %0*llX %-4s %12llu %s\n",
+            ofstw, (unsigned long long) hit.off, ofstw, (unsigned long long) (hit.off + hit.len),
+            carve_name( hit.kind ), (unsigned long long) hit.len, path );
+        nhits++;
+        ncarved += hit.len;
+        from = hit.off + hit.len;
+    }
+    hv_scan_end( &scan );
+    ms = (stats_now() - start) / 1e3;
+
+    printf( "# %llu objects, %llu bytes in %.3f ms: scanned at %.1f MB/s, copied at %.1f MB/s\n",
+        nhits, ncarved, ms,
+        ms - copyus / 1e3 > 0.0 ? buffer->len / ((ms - copyus / 1e3) * 1e3) : 0.0,
+        copyus > 0.0 ? ncarved / copyus : 0.0
+    );
+    fflush( stdout );
+
+    return !ferror( stdout );
+}
+
+/*********************************************************//**
+ * Print the offset of every occurrence of the bytes settings->findpat
+ * (hex digit pairs, or a '"' followed by literal text) in the buffer,
+ * one per line.
+ *************************************************************
+ */
+_Bool find_report( const Buffer *buffer, const Settings *settings )
+{
+    Byte    pat[ MAXINPUT ];
+    const size_t n = parse_bytes( settings->findpat, pat, sizeof(pat) );
+    const int ofstw = hv_ofst_width( buffer->len );
+    size_t  off;
+
+    if ( 0 == n ) {
+        errno = EINVAL;
+        return false;
+    }
+    for (off = buffer_find( buffer, 0, pat, n, false ); (size_t)-1 != off;
+        off = buffer_find( buffer, off + 1, pat, n, false ))
+        printf( "%0*llX\n", ofstw, (unsigned long long) off );
+    fflush( stdout );
+
+    return !ferror( stdout );
+}
+
+/*********************************************************//**
+ * Scans of -direct (see direct_report()): the callbacks of direct_scan()
+ * for each mode, & what they keep from chunk to chunk. Searches and
+ * strings go on past the end of a chunk by prepending its last bytes
+ * to the next one (in the room direct_scan() leaves before it).
+ *************************************************************
+ */
+typedef struct DirectCtx {
+    const Settings *settings;
+    unsigned long long size;    /* of the file scanned                */
+    const char *fname;          /* ... & its name                     */
+    int     ofstw;
+    HashCtx hash[ HASH_NALGS ]; /* MODE_HASH                          */
+    Byte    pat[ MAXINPUT ];    /* MODE_FIND                          */
+    size_t  npat;
+    unsigned long long nfound;  /* ... found so far                   */
+    Byte    carry[ DIRECT_HEADROOM ];  /* the end of the last chunk ... */
+    size_t  ncarry;             /* ... prepended to this one          */
+} DirectCtx;
+
+static _Bool direct_hash( unsigned char *data, size_t n, unsigned long long off, void *ctx )
+{
+    DirectCtx *d = ctx;
+    int     alg;
+
+    (void) off;
+    for (alg=0; alg < HASH_NALGS; alg++)
+        if ( d->settings->hashmask & (1U << alg) )
+            hash_update( &d->hash[alg], data, n );
+    return true;
+}
+
+static _Bool direct_find( unsigned char *data, size_t n, unsigned long long off, void *ctx )
+{
+    DirectCtx *d = ctx;
+    Byte    *w = data - d->ncarry;
+    const size_t wn = n + d->ncarry;
+    size_t  from = 0, at;
+
+    memcpy( w, d->carry, d->ncarry );
+    while ( from + d->npat <= wn && BULK_NONE != (at = bulk_find( &w[from], wn - from, d->pat, d->npat )) ) {
+        d->nfound++;
+        if ( d->settings->count )
+            ;
+        else if ( d->settings->json ) {
+            fputs( "{\"file\":", stdout );
+            stats_json( stdout, d->fname );
+            printf( ",\"off\":%llu}\n", off - d->ncarry + from + at );
+        }
+        else
+            printf( "%0*llX\n", d->ofstw, off - d->ncarry + from + at );
+        from += at + 1;
+    }
+
+    d->ncarry = myMIN( d->npat - 1, wn );
+    memcpy( d->carry, &w[wn - d->ncarry], d->ncarry );
+    return !ferror( stdout );
+}
+
+static _Bool direct_strings( unsigned char *data, size_t n, unsigned long long off, void *ctx )
+{
+    DirectCtx *d = ctx;
+    const size_t prev = d->ncarry;
+    Byte    *w = data - prev;
+    const size_t wn = n + prev;
+    const _Bool last = off + n >= d->size;
+    size_t  i, j, keep;
+    StrList list;
+
+    memcpy( w, d->carry, prev );
+    if ( !strscan( w, wn, d->settings->strminlen, d->settings->strkinds, hv_ncpus(), &list ) )
+        return false;
+
+    /* keep the end: a run reaching it may go on (unless too long to) */
+    keep = myMIN( 4 * d->settings->strminlen + 4, (size_t) DIRECT_HEADROOM );
+    keep = wn - myMIN( keep, wn );
+    for (i=0; i < list.n && !last; i++)
+        if ( list.hits[i].off + list.hits[i].len + 1 >= wn )
+            keep = wn - list.hits[i].off <= DIRECT_HEADROOM
+                ? myMIN( keep, list.hits[i].off )
+                : wn;            /* split: it goes on as another run */
+
+    /* the runs ended (but those printed already, in the bytes kept) */
+    for (i=0; i < list.n; i++)
+    {
+        const StrHit *hit = &list.hits[i];
+
+        if ( hit->off + hit->len + 1 < prev
+            || (!last && hit->off + hit->len + 1 >= wn && wn != keep)
+        )
+            continue;
+        printf( "%0*llX %c ", d->ofstw, off - prev + hit->off, NAME_STRKIND(hit->kind) );
+        if ( STR_ASCII == hit->kind )
+            fwrite( &w[hit->off], sizeof(Byte), hit->len, stdout );
+        else
+            for (j=0; j < hit->len; j += 2)
+                putchar( w[hit->off + j] );
+        putchar('\n');
+    }
+    strlist_cleanup( &list );
+
+    d->ncarry = wn - keep;
+    memcpy( d->carry, &w[keep], d->ncarry );
+    return !ferror( stdout );
+}
+
+/*********************************************************//**
+ * Print the digests, strings or offsets found in the file fname (as
+ * -hash, -strings or -find do, honoring -count & -json), scanned past
+ * the page cache by direct_scan(), which is timed (to stderr) if
+ * settings->stats.
+ *************************************************************
+ */
+_Bool direct_report( const char *fname, const Settings *settings )
+{
+    unsigned char digest[ HASH_MAXLEN ];
+    char    hex[ HASH_HEXLEN ];
+    DirectStats st;
+    DirectCtx *d;
+    _Bool   ok;
+    int     alg;
+
+    if ( NULL == (d = calloc( 1, sizeof(DirectCtx) )) )
+        return false;
+    d->settings = settings;
+    d->fname    = fname;
+    d->size     = (unsigned long long) myMAX( hv_filesize( fname ), 0LL );
+    d->ofstw    = hv_ofst_width( d->size );
+
+    if ( MODE_HASH == settings->mode ) {
+        for (alg=0; alg < HASH_NALGS; alg++)
+            if ( settings->hashmask & (1U << alg) )
+                hash_init( &d->hash[alg], alg );
+        ok = direct_scan( fname, direct_hash, d, &st );
+        for (alg=0; ok && alg < HASH_NALGS; alg++)
+            if ( settings->hashmask & (1U << alg) ) {
+                hash_tohex( digest, hash_final( &d->hash[alg], digest ), hex );
+                printf( "%s (%s) = %s\n", hash_name(alg), fname, hex );
+            }
+    }
+    else if ( MODE_FIND == settings->mode ) {
+        if ( 0 == (d->npat = parse_bytes( settings->findpat, d->pat, sizeof(d->pat) )) ) {
+            free( d );
+            errno = EINVAL;
+            return false;
+        }
+        ok = direct_scan( fname, direct_find, d, &st );
+        if ( ok && settings->count && settings->json ) {
+            fputs( "{\"file\":", stdout );
+            stats_json( stdout, fname );
+            printf( ",\"count\":%llu}\n", d->nfound );
+        }
+        else if ( ok && settings->count )
+            printf( "%llu\n", d->nfound );
+    }
+    else
+        ok = direct_scan( fname, direct_strings, d, &st );
+    fflush( stdout );
+
+    if ( ok && settings->stats )
+        fprintf( stderr, "# direct: %llu bytes in %.3f ms (%.1f MB/s), %s%s\n",
+            st.nbytes, st.us / 1e3, st.us > 0.0 ? st.nbytes / st.us : 0.0,
+            st.odirect ? "O_DIRECT" : "page cache dropped", st.uring ? " by io_uring" : " by pread" );
+
+    free( d );
+    return ok && !ferror( stdout );
+}
+
+/*********************************************************//**
+ * Runs over many files (see multi_report()): the files named, & those
+ * found in the directories named, split into jobs of a chunk each, run
+ * by a work-stealing pool (pool.c). Every job prints into a buffer of
+ * its own: with -json it is written as soon as the job is run, else
+ * the jobs are run MULTI_BATCH per thread at a time, & their output is
+ * written in order after each batch (so that the output held stays
+ * bounded, however much a dump prints). A file is opened by the 1st of
+ * its jobs run, & closed by the last one.
+ *************************************************************
+ */
+#define MULTI_FINDCHUNK (16*1024*1024)  /* bytes searched per job         */
+#define MULTI_DUMPCHUNK (1024*1024)     /* bytes dumped per job           */
+#define MULTI_BATCH     8               /* jobs per thread run before writing */
+
+#ifdef HV_POSIX
+typedef struct MultiFile {
+    char    *name;
+    unsigned long long size;    /* when listed                        */
+    size_t  firstjob;           /* its jobs ...                       */
+    size_t  left;               /* ... not run yet                    */
+    HvFile  *hv;                /* open while they run (if not empty) */
+    int     err;                /* errno of opening it (if failed)    */
+    unsigned long long nfound;  /* MODE_FIND: occurrences (-count)    */
+} MultiFile;
+
+typedef struct MultiJob {
+    size_t  file;
+    unsigned long long off, len;    /* the chunk of the file          */
+    char    *out;               /* what it prints ...                 */
+    size_t  outlen;
+    _Bool   done;               /* ... if it could (not out of memory) */
+} MultiJob;
+
+typedef struct MultiCtx {
+    const Settings *settings;
+    MultiFile *files;
+    size_t  nfiles, maxfiles;
+    MultiJob *jobs;
+    size_t  njobs;
+    Byte    pat[ MAXINPUT ];    /* MODE_FIND                          */
+    size_t  npat;
+    _Bool   tagged;             /* output tagged with the file names  */
+    _Bool   failed;             /* a file could not be read ...       */
+    size_t  base;               /* the 1st job of the batch run       */
+    unsigned long long nbytes;  /* scanned                            */
+    pthread_mutex_t lock;       /* of opening files & of the output   */
+} MultiCtx;
+
+/*********************************************************//**
+ * List the file fname (of size bytes) in m, or the error err (errno)
+ * of reading it (if not 0).
+ *************************************************************
+ */
+static _Bool multi_add( MultiCtx *m, const char *fname, unsigned long long size, int err )
+{
+    MultiFile *f;
+
+    if ( m->nfiles == m->maxfiles ) {
+        size_t  n = m->maxfiles ? 2 * m->maxfiles : 64;
+        if ( NULL == (f = realloc( m->files, n * sizeof(MultiFile) )) )
+            return false;
+        m->files    = f;
+        m->maxfiles = n;
+    }
+    f = &m->files[ m->nfiles ];
+    memset( f, 0, sizeof(MultiFile) );
+    if ( NULL == (f->name = malloc( strlen(fname) + 1 )) )
+        return false;
+    strcpy( f->name, fname );
+    f->size = size;
+    f->err  = err;
+    m->nfiles++;
+    return true;
+}
+
+/*********************************************************//**
+ * List the file fname named, that is not a regular one, in m: a block
+ * device as sized by hv_filesize(), a pipe, char device ... read to
+ * its end now (it has no size to split it by, nor can it be reread).
+ *************************************************************
+ */
+static _Bool multi_addstream( MultiCtx *m, const char *fname, const struct stat *st )
+{
+    long long size;
+    HvFile  *hv;
+
+    if ( S_ISBLK( st->st_mode ) )
+        return (size = hv_filesize( fname )) < 0
+            ? multi_add( m, fname, 0ULL, errno )
+            : multi_add( m, fname, (unsigned long long) size, 0 );
+    if ( NULL == (hv = hv_open( fname, false )) )
+        return multi_add( m, fname, 0ULL, errno );
+    if ( !multi_add( m, fname, hv_size( hv ), 0 ) ) {
+        hv_close( hv );
+        return false;
+    }
+    if ( 0 == hv_size( hv ) )
+        hv_close( hv );                /* empty: nothing to search */
+    else
+        m->files[ m->nfiles - 1 ].hv = hv;    /* closed by its last job */
+    return true;
+}
+
+/*********************************************************//**
+ * List path in m: a file, or the regular files of a directory & of its
+ * subdirectories (in the order of their names; links to directories
+ * are not followed, so there are no loops).
+ *************************************************************
+ */
+static _Bool multi_walk( MultiCtx *m, const char *path )
+{
+    struct stat st;
+    struct dirent **ents;
+    char    *sub;
+    size_t  len = strlen( path );
+    int     i, n;
+    _Bool   ok = true;
+
+    if ( 0 != stat( path, &st ) )
+        return multi_add( m, path, 0ULL, errno );
+    if ( S_ISREG( st.st_mode ) )
+        return multi_add( m, path, (unsigned long long) st.st_size, 0 );
+    if ( !S_ISDIR( st.st_mode ) )
+        return multi_addstream( m, path, &st );
+
+    m->tagged = true;
+    if ( (n = scandir( path, &ents, NULL, alphasort )) < 0 )
+        return multi_add( m, path, 0ULL, errno );
+    for (i=0; i < n; i++) {
+        const char *name = ents[i]->d_name;
+        if ( ok && strcmp( name, "." ) && strcmp( name, ".." ) ) {
+            if ( NULL == (sub = malloc( len + strlen(name) + 2 )) )
+                ok = false;
+            else {
+                sprintf( sub, "%s%s%s", path, (len && '/' == path[len-1]) ? "" : "/", name );
+                if ( 0 != lstat( sub, &st ) )
+                    ok = multi_add( m, sub, 0ULL, errno );
+                else if ( S_ISDIR( st.st_mode ) )
+                    ok = multi_walk( m, sub );
+                else if ( S_ISLNK( st.st_mode ) ) {
+                    if ( 0 == stat( sub, &st ) && S_ISREG( st.st_mode ) )
+                        ok = multi_add( m, sub, (unsigned long long) st.st_size, 0 );
+                }
+                else if ( S_ISREG( st.st_mode ) )    /* no fifos, devices ... */
+                    ok = multi_add( m, sub, (unsigned long long) st.st_size, 0 );
+                free( sub );
+            }
+        }
+        free( ents[i] );
+    }
+    free( ents );
+    return ok;
+}
+
+/*********************************************************//**
+ * Print the occurrences of m->pat starting in the chunk of the job
+ * (reading past its end as needed), or count them if -count.
+ *************************************************************
+ */
+static void multi_find( MultiCtx *m, MultiFile *f, const MultiJob *job, FILE *out )
+{
+    const Byte *data = hv_data( f->hv );
+    const size_t size = hv_size( f->hv );
+    const size_t from = (size_t) myMIN( job->off, (unsigned long long) size );
+    const size_t to   = (size_t) myMIN( job->off + job->len, (unsigned long long) size );
+    const size_t end  = myMIN( to + m->npat - 1, size );
+    const int ofstw = hv_ofst_width( size );
+    unsigned long long n = 0;
+    size_t  i = from, at;
+    HvScan  scan;
+
+    hv_scan_begin( &scan, f->hv, from, end );
+    hv_scan_at( &scan, HV_NOTFOUND );
+    while ( i < to && BULK_NONE != (at = bulk_find( &data[i], end - i, m->pat, m->npat ))
+        && i + at < to
+    ) {
+        i += at;
+        n++;
+        if ( m->settings->count )
+            ;
+        else if ( m->settings->json ) {
+            fputs( "{\"file\":", out );
+            stats_json( out, f->name );
+            fprintf( out, ",\"off\":%llu}\n", (unsigned long long) i );
+        }
+        else if ( m->tagged )
+            fprintf( out, "%s:%0*llX\n", f->name, ofstw, (unsigned long long) i );
+        else
+            fprintf( out, "%0*llX\n", ofstw, (unsigned long long) i );
+        i++;
+    }
+    hv_scan_end( &scan );
+    __sync_fetch_and_add( &f->nfound, n );
+    return;
+}
+
+/*********************************************************//**
+ * Print the rows of the chunk of the job, as the viewer does (or their
+ * bytes in hex, as JSON lines).
+ *************************************************************
+ */
+static void multi_dump( MultiCtx *m, MultiFile *f, const MultiJob *job, FILE *out )
+{
+    const Byte *data = hv_data( f->hv );
+    const size_t size = hv_size( f->hv );
+    const size_t to = (size_t) myMIN( job->off + job->len, (unsigned long long) size );
+    char    row[ HV_ROWMAX ];
+    size_t  off, i, n;
+    HvScan  scan;
+
+    hv_scan_begin( &scan, f->hv, (size_t) job->off, to );
+    hv_scan_at( &scan, HV_NOTFOUND );
+    for (off = (size_t) job->off; off < to; off += HV_NCOLS)
+    {
+        if ( m->settings->json ) {
+            fputs( "{\"file\":", out );
+            stats_json( out, f->name );
+            fprintf( out, ",\"off\":%llu,\"hex\":\"", (unsigned long long) off );
+            for (i=off, n = myMIN( to, off + HV_NCOLS ); i < n; i++)
+                fprintf( out, "%02x", data[i] );
+            fputs( "\"}\n", out );
+        }
+        else {
+            n = hv_format_row( f->hv, off, 0U, row, sizeof(row) );
+            fwrite( row, 1, n, out );
+            fputc( '\n', out );
+        }
+    }
+    hv_scan_end( &scan );
+    return;
+}
+
+/*********************************************************//**
+ * Write the output of the job j (& the error of its file, if the 1st
+ * one of it), then let it go.
+ *************************************************************
+ */
+static void multi_write( MultiCtx *m, size_t j )
+{
+    MultiJob *job = &m->jobs[j];
+    const MultiFile *f = &m->files[ job->file ];
+
+    if ( f->err && j == f->firstjob ) {
+        if ( !m->settings->json )
+            fprintf( stderr, "%s: %s\n", f->name, strerror( f->err ) );
+        m->failed = true;
+    }
+    if ( !job->done )
+        m->failed = true;
+    else
+        fwrite( job->out, 1, job->outlen, stdout );
+    free( job->out );
+    job->out = NULL;
+    return;
+}
+
+/*********************************************************//**
+ * Run the job j of the batch run by the pool (see multi_report()): open
+ * its file (if the 1st job run on it), print what it finds or dumps,
+ * & close the file (if the last one). With -json, write it at once.
+ *************************************************************
+ */
+static void multi_job( size_t j, void *ctx )
+{
+    MultiCtx *m = ctx;
+    MultiJob *job = &m->jobs[ m->base + j ];
+    MultiFile *f = &m->files[ job->file ];
+    const Settings *settings = m->settings;
+    FILE    *out;
+
+    j += m->base;
+    pthread_mutex_lock( &m->lock );
+    if ( !f->hv && 0 == f->err && f->size > 0 && NULL == (f->hv = hv_open( f->name, true )) )
+        f->err = errno ? errno : EIO;
+    pthread_mutex_unlock( &m->lock );
+
+    if ( NULL == (out = open_memstream( &job->out, &job->outlen )) )
+        job->out = NULL;
+    else {
+        if ( j == f->firstjob && m->tagged && MODE_DUMP == settings->mode && !settings->json )
+            fprintf( out, "==> %s <==\n", f->name );
+        if ( f->err ) {
+            if ( j == f->firstjob && settings->json ) {
+                fputs( "{\"file\":", out );
+                stats_json( out, f->name );
+                fputs( ",\"error\":", out );
+                stats_json( out, strerror( f->err ) );
+                fputs( "}\n", out );
+            }
+        }
+        else if ( f->hv ) {
+            if ( MODE_DUMP == settings->mode )
+                multi_dump( m, f, job, out );
+            else
+                multi_find( m, f, job, out );
+            __sync_fetch_and_add( &m->nbytes, myMIN( job->len,
+                (unsigned long long) hv_size( f->hv ) - myMIN( job->off, hv_size( f->hv ) ) ) );
+        }
+    }
+
+    /* the last job run on the file: done with it */
+    if ( 0 == __sync_sub_and_fetch( &f->left, 1 ) ) {
+        if ( out && !f->err && MODE_FIND == settings->mode && settings->count ) {
+            if ( settings->json ) {
+                fputs( "{\"file\":", out );
+                stats_json( out, f->name );
+                fprintf( out, ",\"count\":%llu}\n", f->nfound );
+            }
+            else if ( m->tagged )
+                fprintf( out, "%s:%llu\n", f->name, f->nfound );
+            else
+                fprintf( out, "%llu\n", f->nfound );
+        }
+        if ( f->hv )
+            hv_close( f->hv );
+        f->hv = NULL;
+    }
+    if ( out )
+        fclose( out );
+    job->done = (NULL != out);
+
+    if ( settings->json ) {
+        pthread_mutex_lock( &m->lock );
+        multi_write( m, j );
+        pthread_mutex_unlock( &m->lock );
+    }
+    return;
+}
+#endif
+
+/*********************************************************//**
+ * Search (MODE_FIND) or dump (MODE_DUMP) the settings->npaths paths,
+ * directories walked recursively, splitting files into chunks run on
+ * a work-stealing pool of settings->nthreads threads (see multi_job()).
+ * Files that cannot be read are told to stderr (or as JSON lines), and
+ * the rest are done anyway: return false if any. Timed (to stderr) if
+ * settings->stats.
+ *************************************************************
+ */
+_Bool multi_report( const Settings *settings )
+{
+#ifdef HV_POSIX
+    MultiCtx *m;
+    PoolStats ps;
+    double  start, us;
+    size_t  i, k, n, chunk, batch;
+    unsigned nthreads = 0;
+    unsigned long long nsteals = 0;
+    _Bool   ok = false;
+
+    if ( NULL == (m = calloc( 1, sizeof(MultiCtx) )) )
+        return false;
+    m->settings = settings;
+    if ( MODE_FIND == settings->mode
+        && 0 == (m->npat = parse_bytes( settings->findpat, m->pat, sizeof(m->pat) ))
+    ) {
+        errno = EINVAL;
+        goto ret;
+    }
+
+    for (i=0; i < settings->npaths; i++)
+        if ( !multi_walk( m, settings->paths[i] ) )
+            goto ret;
+    m->tagged = m->tagged || m->nfiles > 1;
+
+    /* every file in chunks: at least 1, to tell its header, count or error */
+    chunk = MODE_DUMP == settings->mode ? MULTI_DUMPCHUNK : MULTI_FINDCHUNK;
+    for (i=0; i < m->nfiles; i++) {
+        m->files[i].firstjob = m->njobs;
+        m->files[i].left = myMAX( 1, (m->files[i].size + chunk - 1) / chunk );
+        m->njobs += m->files[i].left;
+    }
+    if ( m->njobs && NULL == (m->jobs = calloc( m->njobs, sizeof(MultiJob) )) )
+        goto ret;
+    for (i=0; i < m->nfiles; i++)
+        for (k=0, n = m->files[i].left; k < n; k++) {
+            MultiJob *job = &m->jobs[ m->files[i].firstjob + k ];
+            job->file = i;
+            job->off  = (unsigned long long) k * chunk;
+            job->len  = (k + 1 < n) ? chunk : ~0ULL - job->off;  /* the last: to the end */
+        }
+
+    /* all at once with -json, else a batch at a time (written in order) */
+    batch = settings->json ? m->njobs : (size_t) MULTI_BATCH * myMAX( settings->nthreads, 1U );
+    pthread_mutex_init( &m->lock, NULL );
+    start = stats_now();
+    for (ok = true; ok && m->base < m->njobs; m->base += n) {
+        n  = myMIN( batch, m->njobs - m->base );
+        ok = pool_run( n, settings->nthreads, multi_job, m, &ps );
+        for (k=0; ok && !settings->json && k < n; k++)
+            multi_write( m, m->base + k );
+        nthreads = myMAX( nthreads, ps.nthreads );
+        nsteals += ps.nsteals;
+    }
+    fflush( stdout );
+    us = stats_now() - start;
+    pthread_mutex_destroy( &m->lock );
+
+    if ( ok && settings->stats )
+        fprintf( stderr, "# multi: %zu files, %zu jobs, %llu bytes in %.3f ms (%.1f MB/s),"
+            " %u threads, %llu steals\n", m->nfiles, m->njobs, m->nbytes, us / 1e3,
+            us > 0.0 ? m->nbytes / us : 0.0, nthreads, nsteals );
+    ok = ok && !ferror( stdout ) && !m->failed;
+    if ( m->failed )
+        errno = 0;                    /* told file by file         */
+
+ret:
+    for (i=0; i < m->nfiles; i++) {
+        if ( m->files[i].hv )                /* a batch failed to run */
+            hv_close( m->files[i].hv );
+        free( m->files[i].name );
+    }
+    for (i=0; i < m->njobs; i++)
+        free( m->jobs[i].out );
+    free( m->files );
+    free( m->jobs );
+    free( m );
+    return ok;
+#else
+    (void) settings;
+    errno = ENOTSUP;
+    return false;
+#endif
+}
+
+/*********************************************************//**
+ * Start comparing the buffer with the file fname (loaded into a buffer
+ * of its own, owned by buffer), or stop comparing if fname is NULL.
+ *************************************************************
+ */
+_Bool buffer_compare( Buffer *buffer, const char *fname )
+{
+    Buffer *peer = NULL;
+
+    if ( !buffer || !buffer->data )
+        return false;
+
+    if ( buffer->peer ) {
+        delta_cleanup( &buffer->delta );
+        diff_cleanup( &buffer->diff );
+        buffer_cleanup( buffer->peer );
+        free( buffer->peer );
+        buffer->peer = NULL;
+    }
+    if ( !fname )
+        return true;
+
+    if ( NULL == (peer = calloc( 1, sizeof(Buffer) )) )
+        return false;
+    if ( !buffer_map_file( peer, fname, 0U ) ) {
+        free( peer );
+        return false;
+    }
+    if ( !diff_init( &buffer->diff, buffer->data, buffer->datalen, peer->data, peer->datalen, true ) ) {
+        buffer_cleanup( peer );
+        free( peer );
+        return false;
+    }
+    buffer->peer = peer;
+
+    return true;
+}
+
+/*********************************************************//**
+ * Diff the compared buffer against the buffer by rolling hashes
+ * (unless already done). The block signatures of the buffer are
+ * cached, so diffing other files against it skips rehashing it.
+ *************************************************************
+ */
+_Bool buffer_delta( Buffer *buffer )
+{
+    char     path[ MAXINPUT+64 ];
+    uint64_t key = 0;
+    DeltaSig sig = { 0, 0, 0, NULL, NULL };
+    _Bool    cacheable, success;
+
+    if ( !buffer || !buffer->data || !buffer->peer )
+        return false;
+    if ( buffer->delta.hunks )
+        return true;
+
+    cacheable = cache_path( buffer->fname, "sig", path, sizeof(path), &key );
+    if ( !cacheable || !deltasig_load( &sig, path, key ) || sig.datalen != buffer->datalen )
+    {
+        deltasig_cleanup( &sig );
+        if ( !deltasig_compute( buffer->data, buffer->datalen, hv_ncpus(), &sig ) )
+            return false;
+        if ( cacheable )
+            deltasig_save( &sig, path, key );
+    }
+
+    success = delta_compute( &sig, buffer->data, buffer->datalen,
+                             buffer->peer->data, buffer->peer->datalen, &buffer->delta );
+    deltasig_cleanup( &sig );
+
+    return success;
+}
+
+/*********************************************************//**
+ * PanelItem callback describing a hunk.
+ *************************************************************
+ */
+static size_t panel_hunk( size_t i, char *line, size_t maxlen, const void *ctx )
+{
+    const Hunk *h = &((const Delta *) ctx)->hunks[i];
+
+    snprintf( line, maxlen, "%c %0*llX+%llu -> %0*llX+%llu",
+        NAME_HUNKKIND(h->kind),
+        FMT_OFST, (unsigned long long) h->offa, (unsigned long long) h->lena,
+        FMT_OFST, (unsigned long long) h->offb, (unsigned long long) h->lenb
+    );
+
+    return h->offa;
+}
+
+/*********************************************************//**
+ * Print the hunks of the buffer's diff with the compared buffer, one
+ * per line: kind (c, d or i), then offset & length in either file.
+ *************************************************************
+ */
+_Bool delta_report( Buffer *buffer )
+{
+    const Delta *delta = &buffer->delta;
+    size_t i, ncopied = 0;
+    int    ofstw;
+
+    if ( !buffer_delta( buffer ) )
+        return false;
+    ofstw = view_ofstw( buffer, buffer->peer );
+
+    for (i=0; i < delta->n; i++)
+        if ( HUNK_COPY == delta->hunks[i].kind )
+            ncopied += delta->hunks[i].lena;
+
+    printf( "# %s: %llu bytes, %s: %llu bytes, %llu bytes copied in %llu hunks%s\n",
+        buffer->fname, (unsigned long long) buffer->len,
+        buffer->peer->fname, (unsigned long long) buffer->peer->len,
+        (unsigned long long) ncopied, (unsigned long long) delta->n,
+        delta->truncated ? " (truncated)" : ""
+    );
+    printf( "# K %-*s %10s %-*s %10s\n", ofstw, "A-OFFSET", "A-LEN", ofstw, "B-OFFSET", "B-LEN" );
+    for (i=0; i < delta->n; i++) {
+        const Hunk *h = &delta->hunks[i];
+        printf( "  %c %0*llX %10llu %0*llX %10llu\n", NAME_HUNKKIND(h->kind),
+            ofstw, (unsigned long long) h->offa, (unsigned long long) h->lena,
+            ofstw, (unsigned long long) h->offb, (unsigned long long) h->lenb
+        );
+    }
+    fflush( stdout );
+
+    return !ferror( stdout );
+}
+
+/*********************************************************//**
+ * Make sure the overviews shown (if any) are of the buffer, computing
+ * them if needed (or hiding them, if they cannot be).
+ *************************************************************
+ */
+void buffer_overviews( Buffer *buffer, Settings *settings )
+{
+    if ( settings->showentropy && !buffer_entropy( buffer, settings->entblocklen ) )
+        settings->showentropy = false;
+    if ( settings->showminimap && !buffer->minimap.data
+        && !minimap_init( &buffer->minimap, buffer->data, buffer->datalen, true )
+    )
+        settings->showminimap = false;
+    return;
+}
+
+/*********************************************************//**
+ * (Re)load the file fname into the buffer, going on comparing it with
+ * the same file (if any) and showing the same overviews, of the new
+ * data. The user is told about failures past the loading itself.
+ *************************************************************
+ */
+_Bool buffer_open( Buffer *buffer, const char *fname, Settings *settings )
+{
+    _Bool success = false;
+    char tmpfname[ MAXINPUT ] = {'\0'};   /* fname may be buffer->fname */
+    char peerfname[ MAXINPUT ] = {'\0'};
+
+    strncpy( tmpfname, fname, MAXINPUT-1 );
+
+    /* keep comparing with the same file (if any) */
+    if ( buffer->peer )
+        strcpy( peerfname, buffer->peer->fname );
+
+    buffer_cleanup( buffer );
+    success = (settings->unlimfsize)
+        ? buffer_read_file( buffer, tmpfname, 100*1024*1024, settings->loadhash )
+        : buffer_map_file( buffer, tmpfname, settings->loadhash );
+    if ( !success )
+        return false;
+    if ( '\0' != *peerfname && !buffer_compare( buffer, peerfname ) )
+        perror( peerfname );
+
+    /* keep showing the overviews, now of the new file */
+    buffer_overviews( buffer, settings );
+
+    return true;
+}
+
+/*********************************************************//**
+ * Convert the text-string s (either hex digit pairs, blanks allowed
+ * between them, or a '"' followed by literal text) into at most
+ * maxlen bytes. Return their #, or 0 on invalid input.
+ *************************************************************
+ */
+size_t parse_bytes( const char *s, Byte *bytes, size_t maxlen )
+{
+    size_t n = 0;
+
+    while ( isspace( (int) *s ) )
+        s++;
+    if ( '"' == *s ) {
+        const size_t len = strlen( &s[1] );
+        n = myMIN( len, maxlen );
+        memcpy( bytes, &s[1], n );
+        return n;
+    }
+
+    for (; '\0' != *s && n < maxlen; s += 2)
+    {
+        while ( isspace( (int) *s ) )
+            s++;
+        if ( '\0' == *s )
+            break;
+        if ( !isxdigit( (int) s[0] ) || !isxdigit( (int) s[1] ) )
+            return 0;
+        sscanf( s, "%2hhx", &bytes[n++] );
+    }
+
+    return n;
+}
+
+/*********************************************************//**
+ * Bring the length of the buffer, the cursor & the mark in line with
+ * the edits of the buffer (after making or undoing some).
+ *************************************************************
+ */
+void buffer_edited( Buffer *buffer, size_t *bt )
+{
+    buffer_setlen( buffer, buffer->edits.len );
+    if ( buffer->len > 0 ) {
+        *bt = myMIN( *bt, buffer->len - 1 );
+        buffer->mark = myMIN( buffer->mark, buffer->len - 1 );
+    }
+    return;
+}
+
+/*********************************************************//**
+ * Save the edits of the buffer into fname (the file of the buffer if
+ * NULL), and view the saved file.
+ *************************************************************
+ */
+_Bool buffer_save( size_t *bt, const char *fname, Buffer *buffer, Settings *settings )
+{
+    char target[ MAXINPUT ] = {'\0'};
+    _Bool inplace;
+
+    snprintf( target, sizeof(target), "%s", fname ? fname : buffer->fname );
+    inplace = !strcmp( target, buffer->fname );
+
+    if ( inplace && !buffer_dirty( buffer ) ) {
+        printf( "No edits to save! " );
+        pressENTER();
+        return true;
+    }
+
+    colorPRINTF( settings->colorize, FG_RED, BG_NOCHANGE, "saving..." );
+    fflush( stdout );
+    if ( !buffer_edit( buffer ) || !piece_save( &buffer->edits, target, inplace ) ) {
+        perror( target );
+        pressENTER();
+        return false;
+    }
+
+    if ( !buffer_open( buffer, target, settings ) ) {
+        perror( target );
+        pressENTER();
+        return false;
+    }
+    if ( buffer->len > 0 )
+        *bt = myMIN( *bt, buffer->len - 1 );
+
+    return true;
+}
+
+/*********************************************************//**
+ * ^C during a bulk operation cancels it (rather than the program).
+ *************************************************************
+ */
+static volatile sig_atomic_t interrupted = 0;
+
+static void on_interrupt( int sig )
+{
+    (void) sig;
+    interrupted = 1;
+    return;
+}
+
+/*********************************************************//**
+ * Apply the bulk operation of cmd (see show_help()) to the selection,
+ * or to the whole buffer, as a single edit. Fills store just their
+ * pattern; the other operations run BULK_CHUNKLEN bytes at a time
+ * into the add buffer, showing their progress, until done or ^C.
+ *************************************************************
+ */
+_Bool buffer_bulk( size_t *bt, const char *cmd, Buffer *buffer, Settings *settings )
+{
+    static const char *opnames[] = { "xor", "and", "or", "zero", "fill", "repl" };
+    enum { OP_ZERO = 3, OP_FILL, OP_REPL, OP_NONE };
+    char    name[8] = {'\0'};
+    Byte    a[ MAXINPUT ], b[ MAXINPUT ];
+    size_t  alen = 0, blen = 0, from = 0, to = buffer->len;
+    size_t  off, n, got, consumed, nfound, total = 0, written = 0;
+    Byte    *scratch = NULL, *room;
+    const char *arg = &cmd[1], *comma;
+    void    (*prev)( int );
+    int     op, len = 0;
+
+    sscanf( arg, " %7[a-z]%n", name, &len );
+    for (op=0; op < OP_NONE && strcmp(name, opnames[op]); op++)
+        ;
+    arg += len;
+
+    /* the operands */
+    if ( OP_ZERO == op ) {
+        a[0] = 0;
+        alen = 1;
+    }
+    else if ( OP_REPL == op && NULL != (comma = strchr(arg, ',')) ) {
+        char tmp[ MAXINPUT ] = {'\0'};
+        strncpy( tmp, arg, myMIN( (size_t)(comma - arg), (size_t) MAXINPUT-1 ) );
+        alen = parse_bytes( tmp, a, MAXINPUT );
+        blen = parse_bytes( comma + 1, b, MAXINPUT );
+        if ( 0 == blen && '\0' != comma[ 1 + strspn(comma+1, " ") ] )
+            alen = 0;                /* invalid b (empty b deletes) */
+    }
+    else if ( OP_REPL != op )
+        alen = parse_bytes( arg, a, MAXINPUT );
+    if ( OP_NONE == op || 0 == alen ) {
+        BELL(1);
+        return false;
+    }
+
+    /* the range */
+    if ( buffer->marked ) {
+        from = myMIN( *bt, buffer->mark );
+        to   = myMIN( myMAX(*bt, buffer->mark) + 1, buffer->len );
+    }
+    if ( !buffer_edit( buffer ) )
+        goto ret_nomem;
+
+    if ( OP_ZERO == op || OP_FILL == op ) {
+        if ( !piece_fill( &buffer->edits, from, to - from, a, alen ) )
+            goto ret_nomem;
+        buffer_edited( buffer, bt );
+        return true;
+    }
+
+    if ( NULL == (scratch = malloc( BULK_CHUNKLEN + alen )) )
+        goto ret_nomem;
+    interrupted = 0;
+    prev = signal( SIGINT, on_interrupt );
+
+    for (off=from; off < to && !interrupted; off += consumed)
+    {
+        const size_t need = (OP_REPL == op) ? BULK_CHUNKLEN + (BULK_CHUNKLEN / alen + 1) * blen
+                                            : BULK_CHUNKLEN;
+        const Byte *w;
+
+        n = myMIN( to - off, (size_t) BULK_CHUNKLEN );
+        w = buffer_window( buffer, off, myMIN( to - off, n + alen - 1 ), scratch, &got );
+        if ( NULL == (room = piece_reserve( &buffer->edits, written + need )) ) {
+            signal( SIGINT, prev );
+            goto ret_nomem;
+        }
+
+        if ( OP_REPL == op ) {
+            written += bulk_replace( &room[written], w, n, got, a, alen, b, blen, &consumed, &nfound );
+            total   += nfound;
+        }
+        else {
+            bulk_logic( &room[written], w, n, (enum BulkOp) op, a, alen, off - from );
+            written  += n;
+            consumed  = n;
+        }
+
+        colorPRINTF( settings->colorize, FG_RED, BG_NOCHANGE, "\r%s... %3.0f%% ",
+            opnames[op], 100.0 * (off + consumed - from) / (to - from) );
+        fflush( stdout );
+    }
+    signal( SIGINT, prev );
+    free( scratch );
+    scratch = NULL;
+
+    if ( interrupted ) {
+        printf( "Cancelled! " );
+        pressENTER();
+        return false;
+    }
+    if ( OP_REPL == op && 0 == total ) {
+        BELL(1);
+        return true;
+    }
+    if ( !piece_commit( &buffer->edits, from, to - from, written ) )
+        goto ret_nomem;
+    buffer_edited( buffer, bt );
+
+    if ( OP_REPL == op ) {
+        printf( "%llu replaced! ", (unsigned long long) total );
+        pressENTER();
+    }
+    return true;
+
+ret_nomem:
+    free( scratch );
+    printf( "Out of memory! " );
+    pressENTER();
+    return false;
+}
+
+/*********************************************************//**
+ * View the selection, or the whole buffer, transformed as cmd says
+ * (see show_help()), or end the transformed view if it says nothing.
+ * The cursor stays on the same data byte (or the nearest one).
+ *************************************************************
+ */
+_Bool buffer_transform( size_t *bt, const char *cmd, Buffer *buffer )
+{
+    char    name[16] = {'\0'};
+    Byte    key[ MAXINPUT ];
+    size_t  keylen = 0, rawbt = buffer_rawoff( buffer, *bt );
+    size_t  from = 0, to = buffer->editing ? buffer->edits.len : buffer->datalen;
+    int     kind = XF_NONE, len = 0;
+
+    sscanf( &cmd[1], " %15[a-z0-9]%n", name, &len );
+    if ( '\0' != name[0] ) {
+        if ( (kind = xform_byname(name)) <= XF_NONE ) {
+            BELL(1);
+            return false;
+        }
+        if ( XF_XOR == kind ) {
+            keylen = parse_bytes( &cmd[1+len], key, MAXINPUT );
+            if ( 0 == keylen || keylen > XFORM_MAXKEYLEN ) {
+                BELL(1);
+                return false;
+            }
+        }
+    }
+
+    /* the transformed data: the selection (of the data), or all of it */
+    if ( XF_NONE != kind && buffer->marked ) {
+        from = buffer_rawoff( buffer, myMIN(*bt, buffer->mark) );
+        to   = myMIN( buffer_rawoff( buffer, myMAX(*bt, buffer->mark) + 1 ), to );
+        buffer->marked = false;
+    }
+
+    xform_cleanup( &buffer->xform );
+    if ( XF_NONE != kind
+        && ( !xform_init( &buffer->xform, kind, key, keylen, from, to - from, buffer_rawget, buffer )
+            || 0 == buffer->xform.len )
+    ) {
+        xform_cleanup( &buffer->xform );
+        BELL(1);
+    }
+
+    buffer_setlen( buffer, XF_NONE != buffer->xform.kind ? buffer->xform.len
+                           : buffer->editing ? buffer->edits.len : buffer->datalen );
+    buffer->mark = 0;
+    *bt = buffer_viewoff( buffer, rawbt );
+    if ( buffer->len > 0 )
+        *bt = myMIN( *bt, buffer->len - 1 );
+
+    return XF_NONE == kind || XF_NONE != buffer->xform.kind;
+}
+
+/*********************************************************//**
+ * Parse the extract command cmd (see show_help()) into the range of
+ * the buffer to extract, [from,from+n), and the name of the file to
+ * extract it into: n bytes from the cursor at bt, or the selection,
+ * or the bytes from the cursor to the end. Return false if invalid.
+ *************************************************************
+ */
+_Bool extract_range( const size_t bt, const char *cmd, const Buffer *buffer,
+                     size_t *from, size_t *n, const char **fname )
+{
+    const char *arg = &cmd[1];
+    char *end = NULL;
+
+    *from = bt;
+    *n    = buffer->len - bt;
+
+    while ( isspace( (int) *arg ) )
+        arg++;
+    if ( isdigit( (int) *arg ) ) {
+        const unsigned long long len = strtoull( arg, &end, 0 );
+        if ( !isspace( (int) *end ) )
+            return false;
+        *n  = myMIN( len, (unsigned long long) *n );
+        arg = end;
+    }
+    else if ( buffer->marked ) {
+        *from = myMIN( bt, buffer->mark );
+        *n    = myMAX( bt, buffer->mark ) - *from + 1;
+    }
+    while ( isspace( (int) *arg ) )
+        arg++;
+
+    *fname = arg;
+    return '\0' != *arg && *n > 0;
+}
+
+/*********************************************************//**
+ * Write the n bytes of the buffer (as viewed) starting at from into
+ * the file fname: copied by the kernel, file to file, while the file
+ * is mapped & viewed as it is (see hv_extract()).
+ *************************************************************
+ */
+_Bool buffer_extract( const Buffer *buffer, size_t from, size_t n, const char *fname )
+{
+    FILE    *fp = NULL;
+    Byte    *scratch = NULL;
+    const Byte *window;
+    size_t  got;
+
+    if ( buffer->file && !buffer->editing && XF_NONE == buffer->xform.kind )
+        return hv_extract( buffer->file, from, n, fname );
+
+    fp      = fopen( fname, "wb" );
+    scratch = malloc( PIECE_IOLEN );
+    if ( !fp || !scratch )
+        goto ret_failure;
+
+    while ( n > 0 ) {
+        window = buffer_window( buffer, from, myMIN(n, (size_t) PIECE_IOLEN), scratch, &got );
+        if ( 0 == got || got != fwrite( window, 1, got, fp ) )
+            goto ret_failure;
+        from += got;
+        n    -= got;
+    }
+
+    free( scratch );
+    return 0 == fclose( fp );
+
+ret_failure:
+    free( scratch );
+    if ( fp )
+        fclose( fp );
+    return false;
+}
+
+/*********************************************************//**
+ * Move the cursor *bt over len bytes (len > 0) viewed in rows of rowlen
+ * bytes by cmd, if one of the commands moving it (by bytes, rows or
+ * pages, or to them). Return false if cmd is not one of them.
+ *************************************************************
+ */
+static _Bool cursor_command( size_t *bt, const char *cmd, size_t len, size_t rowlen )
+{
+    const size_t nrows  = len / rowlen + (len % rowlen != 0 ? 1 : 0);
+    const size_t npages = nrows / FMT_PGLINES + (nrows % FMT_PGLINES != 0 ? 1 : 0);
+    const int    key    = tolower( (int) *cmd );
+    size_t row = myMIN( *bt, len - 1 ) / rowlen;
+
+    /* byte back/forward */
+    if ( KEY_BYTEB == key || KEY_BYTEF == key )
+    {
+        /* get relative step (if any) */
+        long long step = (errno = 0, strtoll( &cmd[1], NULL, 10 ));
+        if (errno == ERANGE)            /* over/underflowed step     */
+            return true;
+        if ( step == 0 )            /* no step ? assume 1        */
+            step = 1;
+        else if ( step < 0 )            /* negative step? negate it  */
+            step = -step;
+
+        /* apply relative row-step (without overflowing) */
+        if ( KEY_BYTEB == key )
+            *bt =   ((unsigned long long) step <= *bt) ? *bt - step : 0;
+        else /* KEY_BYTEF == key */
+            *bt =   ((unsigned long long) step < len - 1 - *bt)
+                ? *bt + step
+                : len - 1;
+
+        return true;
+    }
+
+    /* row start/end */
+    if ( KEY_ROWSTA == key ) {
+        *bt = row * rowlen;
+        return true;
+    }
+    if ( KEY_ROWEND == key ) {
+        *bt = row * rowlen + rowlen - 1;
+        return true;
+    }
+
+    /* row up/down */
+    if ( KEY_ROWUP == key || KEY_ROWDN == key )
+    {
+        /* get relative row-step (if any) */
+        long long step = (errno = 0, strtoll( &cmd[1], NULL, 10 ));
+        if (errno == ERANGE)            /* over/underflowed step     */
+            return true;
+        if ( step == 0 )            /* no step ? assume 1        */
+            step = 1;
+        else if ( step < 0 )            /* negative step? negate it  */
+            step = -step;
+
+        /* apply relative row-step (without overflowing) */
+        if ( KEY_ROWUP == key )
+            row =   ((unsigned long long) step <= row) ? row - step : 0;
+        else /* KEY_ROWDN == key */
+            row =   ((unsigned long long) step < nrows - 1 - row)
+                ? row + step
+                : nrows - 1;
+    }
+
+    /* page up/down */
+    else if ( KEY_PGUP == key || KEY_PGDN == key )
+    {
+        /* get relative page-step (if any) */
+        long long step = (errno = 0, strtoll( &cmd[1], NULL, 10 ));
+        if (errno == ERANGE)            /* over/underflowed step     */
+            return true;
+        if ( step == 0 )            /* no step ? assume 1        */
+            step = 1;
+        else if ( step < 0 )            /* negative step? negate it  */
+            step = -step;
+
+        /* apply relative page-step (without overflowing) */
+        if ( (unsigned long long) step > npages )
+            step = npages;
+        if ( KEY_PGUP == key )
+            row =   row > step * FMT_PGLINES
+                ? row - step * FMT_PGLINES
+                : 0;
+        else /* KEY_PGDN == key */
+            row =   myMIN( (row + step * FMT_PGLINES), nrows - 1 );
+    }
+
+    /* top/bottom of file */
+    else if ( KEY_TOP == key ) {
+        *bt = 0;
+        return true;
+    }
+    else if ( KEY_BOT == key ) {
+        *bt = len - 1;
+        return true;
+    }
+
+    /* goto to specified byte */
+    else if ( KEY_GBYTE == key ) {
+        const unsigned long long newbt = strtoull( &cmd[1], NULL, 0 );
+        *bt = newbt > len - 1 ? len - 1 : (size_t) newbt;
+        return true;
+    }
+    /* goto to specified row */
+    else if ( KEY_GROW == key ) {
+        const unsigned long long newrow = strtoull( &cmd[1], NULL, 0 );
+        row =   newrow > nrows - 1
+            ? nrows - 1
+            : (size_t) newrow;
+    }
+    /* goto to specified page */
+    else if ( KEY_GPAGE == key ) {
+        unsigned long long newpg = strtoull( &cmd[1], NULL, 10 );
+        newpg = newpg > 0 ? newpg - 1 : 0;
+        row = PG2ROW(newpg, npages);
+    }
+    else
+        return false;
+
+    *bt = myMIN( row, nrows - 1 ) * rowlen + ( *bt % rowlen );
+
+    return true;
+}
+
+/*********************************************************//**
+ * Run the command cmd (prevcmd was the last one) on the buffer, as
+ * typed in the viewer. Return false if it failed (telling why, or by
+ * the bell), or is no command (errno ENOSYS).
+ *************************************************************
+ */
+_Bool do_command(
+    size_t      *bt,        /* by reference */
+    const char  *cmd,
+    const char  *prevcmd,
+    Buffer      *buffer,
+    Settings    *settings   /* by reference */
+)
+{
+    enum KeyCommand key;
+    _Bool   ok;
+
+    if ( !buffer || !buffer->data )
+        return false;
+
+    /* execute the command */
+
+    key = tolower( (int) *cmd );
+
+    /* display the help screen */
+    if ( KEY_HLP == key ) {
+        show_help( settings->colorize );
+        return true;
+    }
+
+    /* toggle colorization */
+    if ( KEY_COLOR == key ) {
+        settings->colorize = (settings->colorize == true ) ? false : true;
+        return true;
+    }
+
+    /* toggle character set */
+    if ( KEY_CHARSET == key ) {
+        settings->charset =     (settings->charset == FMT_ASCII)
+                    ? FMT_XASCII : FMT_ASCII;
+        return true;
+    }
+
+    /* toggle the entropy strip (computing the entropy if needed) */
+    if ( KEY_ENTROPY == key ) {
+        if ( !settings->showentropy ) {
+            colorPRINTF(settings->colorize, FG_RED, BG_NOCHANGE, "computing entropy..." );
+            fflush( stdout );
+            if ( !buffer_entropy( buffer, settings->entblocklen ) ) {
+                printf( "Out of memory! " );
+                pressENTER();
+                return false;
+            }
+        }
+        settings->showentropy = !settings->showentropy;
+        return true;
+    }
+
+    /* list record sizes & view rows of the picked one (0: plain rows again) */
+    if ( KEY_PERIOD == key ) {
+        long long maxstride = strtoll( &cmd[1], NULL, 10 );
+        if ( '0' == cmd[ 1 + strspn( &cmd[1], " " ) ] )
+            buffer->rowlen = 0;
+        else if ( !period_panel( *bt, maxstride > 0 ? (size_t) maxstride : 0, buffer, settings ) ) {
+            printf( "Out of memory! " );
+            pressENTER();
+            return false;
+        }
+        return true;
+    }
+
+    /* list frequent n-grams & repeated blocks, & go to the one picked */
+    if ( KEY_NGRAMS == key ) {
+        long long blocklen = strtoll( &cmd[1], NULL, 10 );
+        if ( blocklen != 0 && blocklen < NGRAM_MINBLOCKLEN ) {
+            BELL(1);
+            return false;
+        }
+        if ( !ngram_panel( bt, (size_t) blocklen, buffer, settings ) ) {
+            printf( "Out of memory! " );
+            pressENTER();
+            return false;
+        }
+        return true;
+    }
+
+    /* toggle the minimap, or jump to a minimap cell or a file fraction */
+    if ( KEY_MINIMAP == key )
+    {
+        const char *arg = &cmd[1];
+        while ( isspace( (int) *arg ) )
+            arg++;
+
+        if ( '\0' == *arg ) {
+            settings->showminimap = !settings->showminimap;
+            if ( settings->showminimap && !buffer->minimap.nodes[0]
+                && !minimap_init( &buffer->minimap, buffer->data, buffer->datalen, true )
+            ) {
+                settings->showminimap = false;
+                printf( "Out of memory! " );
+                pressENTER();
+                return false;
+            }
+            return true;
+        }
+
+        if ( 0 == buffer->len ) {           /* nowhere to jump to */
+            BELL(1);
+            return false;
+        }
+        if ( strchr(arg, '.') || strchr(arg, '%') ) {
+            double frac = strtod( arg, NULL );
+            if ( strchr(arg, '%') )
+                frac /= 100.0;
+            if ( frac < 0.0 || frac > 1.0 ) {
+                BELL(1);
+                return false;
+            }
+            *bt = (size_t)( frac * (buffer->len - 1) );
+        }
+        else {
+            size_t cell = strtoul( arg, NULL, 10 );
+            if ( cell >= FMT_PGLINES ) {
+                BELL(1);
+                return false;
+            }
+            *bt = myMIN( minimap_cell2bt(cell, buffer->len), buffer->len - 1 );
+        }
+        return true;
+    }
+
+    /* set/clear the other end of the selection */
+    if ( KEY_MARK == key ) {
+        buffer->mark   = *bt;
+        buffer->marked = !buffer->marked;
+        return true;
+    }
+
+    /* compare with a file, or stop comparing */
+    if ( KEY_COMPARE == key )
+    {
+        if ( '\0' != cmd[1] && !fileexists( &cmd[1] ) ) {
+            printf( "No such file! " );
+            pressENTER();
+            return false;
+        }
+        if ( !buffer_compare( buffer, '\0' != cmd[1] ? &cmd[1] : NULL ) ) {
+            perror( &cmd[1] );
+            pressENTER();
+            return false;
+        }
+        return true;
+    }
+
+    /* next/previous run of differing bytes */
+    if ( KEY_NEXTDIFF == key || KEY_PREVDIFF == key )
+    {
+        size_t at;
+
+        if ( !buffer->peer ) {
+            BELL(1);
+            return false;
+        }
+        at = (KEY_NEXTDIFF == key)
+            ? diff_next( &buffer->diff, buffer_rawoff(buffer, *bt) )
+            : diff_prev( &buffer->diff, buffer_rawoff(buffer, *bt) );
+        if ( DIFF_NONE != at )
+            at = buffer_viewoff( buffer, at );
+        if ( DIFF_NONE == at || (at >= buffer->len && *bt == buffer->len - 1) ) {
+            BELL(1);
+            return false;
+        }
+        *bt = myMIN( at, buffer->len - 1 );    /* maybe past our end: the peer is longer */
+        return true;
+    }
+
+    /* diff by rolling hashes, and list the hunks */
+    if ( KEY_DELTA == key )
+    {
+        long pick;
+
+        if ( !buffer->peer ) {
+            BELL(1);
+            return false;
+        }
+        colorPRINTF( settings->colorize, FG_RED, BG_NOCHANGE, "diffing..." );
+        fflush( stdout );
+        if ( !buffer_delta( buffer ) ) {
+            printf( "Out of memory! " );
+            pressENTER();
+            return false;
+        }
+        pick = panel_pick( "Hunks (kind, offset+length in this file -> in the compared one)",
+                    buffer->delta.n, panel_hunk, &buffer->delta, settings );
+        if ( pick >= 0 )
+            *bt = myMIN( buffer_viewoff(buffer, buffer->delta.hunks[pick].offa), buffer->len - 1 );
+        return true;
+    }
+
+    /* checksums/hashes of the buffer, the selection or the page */
+    if ( KEY_HASH == key )
+        return hash_show( *bt, cmd, buffer, settings );
+
+    /* extract bytes into a file */
+    if ( KEY_EXTRACT == key )
+    {
+        size_t from, n;
+        const char *fname;
+
+        if ( !extract_range( *bt, cmd, buffer, &from, &n, &fname ) ) {
+            BELL(1);
+            return false;
+        }
+        if ( !(ok = buffer_extract( buffer, from, n, fname )) )
+            perror( fname );
+        else
+            printf( "%llu bytes extracted into %s! ", (unsigned long long) n, fname );
+        pressENTER();
+        return ok;
+    }
+
+    /* view transformed, or not */
+    if ( KEY_XFORM == key )
+        return buffer_transform( bt, cmd, buffer );
+
+    /* the edits go to the data, not to their transformed view */
+    if ( XF_NONE != buffer->xform.kind
+        && ( KEY_OVERWRITE == key || KEY_INSERT == key || KEY_DELETE == key || KEY_UNDO == key
+            || KEY_REDO == key || KEY_BULK == key || KEY_WRITE == key )
+    ) {
+        printf( "No edits while viewing transformed (%c alone ends it)! ", KEY_XFORM );
+        pressENTER();
+        return false;
+    }
+
+    /* overwrite/insert bytes at the cursor, and move past them */
+    if ( KEY_OVERWRITE == key || KEY_INSERT == key )
+    {
+        Byte   bytes[ MAXINPUT ];
+        const size_t n = parse_bytes( &cmd[1], bytes, MAXINPUT );
+
+        if ( 0 == n || !buffer_edit( buffer )
+            || !piece_replace( &buffer->edits, *bt, KEY_OVERWRITE == key ? n : 0, bytes, n )
+        ) {
+            BELL(1);
+            return false;
+        }
+        *bt += n;
+        buffer_edited( buffer, bt );
+        return true;
+    }
+
+    /* delete n bytes at the cursor, or the selection */
+    if ( KEY_DELETE == key )
+    {
+        const char *arg = &cmd[1];
+        size_t from = *bt, n = 1;
+
+        while ( isspace( (int) *arg ) )
+            arg++;
+        if ( KEY_MARK == tolower( (int) *arg ) ) {
+            if ( !buffer->marked ) {
+                BELL(1);
+                return false;
+            }
+            from = myMIN( *bt, buffer->mark );
+            n    = myMAX( *bt, buffer->mark ) - from + 1;
+        }
+        else if ( '\0' != *arg )
+            n = strtoull( arg, NULL, 0 );
+
+        /* there must be something left to view */
+        n = myMIN( n, buffer->len - from );
+        if ( 0 == n || n >= buffer->len || !buffer_edit( buffer )
+            || !piece_replace( &buffer->edits, from, n, NULL, 0 )
+        ) {
+            BELL(1);
+            return false;
+        }
+        buffer->marked = false;
+        *bt = from;
+        buffer_edited( buffer, bt );
+        return true;
+    }
+
+    /* undo/redo the last n edits */
+    if ( KEY_UNDO == key || KEY_REDO == key )
+    {
+        long long n = strtoll( &cmd[1], NULL, 10 );
+        long long done = 0;
+
+        if ( n < 1 )                /* no n? assume 1             */
+            n = 1;
+        while ( buffer->editing && done < n
+            && (KEY_UNDO == key ? piece_undo( &buffer->edits ) : piece_redo( &buffer->edits ))
+        )
+            done++;
+        if ( 0 == done ) {
+            BELL(1);
+            return false;
+        }
+        buffer_edited( buffer, bt );
+        return true;
+    }
+
+    /* zero/fill/xor/and/or/replace-all, over the selection or all */
+    if ( KEY_BULK == key )
+        return buffer_bulk( bt, cmd, buffer, settings );
+
+    /* save the edits (into another file, if specified) */
+    if ( KEY_WRITE == key )
+        return buffer_save( bt, '\0' != cmd[1] ? &cmd[1] : NULL, buffer, settings );
+
+    /* list strings & jump to the picked one */
+    if ( KEY_STRINGS == key ) {
+        long long minlen = strtoll( &cmd[1], NULL, 10 );
+        if ( minlen < 1 )            /* no min length? the default */
+            minlen = settings->strminlen;
+        if ( !strings_panel( bt, (size_t) minlen, buffer, settings ) ) {
+            printf( "Out of memory! " );
+            pressENTER();
+            return false;
+        }
+        return true;
+    }
+
+    /* search forward for text-string */
+    if ( KEY_FNDSTR == key )
+    {
+        size_t ibt = *bt;           /* remember cursor position   */
+        size_t slen = strlen( &cmd[1] );
+
+        if ( !strcmp(cmd, prevcmd) )        /* fix ibt if cmd == prevcmd  */
+            ibt = ibt > 0 ? ibt+1 : 1;
+
+        /* do the search */
+        colorPRINTF(settings->colorize, FG_RED, BG_NOCHANGE, "searching..." );
+        ibt = buffer_find( buffer, ibt, (Byte *)&cmd[1], slen, false );
+
+        if ( (size_t)-1 != ibt )        /* string found               */
+            *bt = ibt;          /* ... update cursor position */
+        else
+            BELL(1);
+
+        return (size_t)-1 != ibt;
+    }
+    /* search backwards for text-string */
+    else if ( KEY_RFNDSTR == key )
+    {
+        size_t ibt = *bt;           /* remember cursor position   */
+        size_t slen = strlen( &cmd[1] );
+
+        if ( !strcmp(cmd, prevcmd) )        /* fix ibt if cmd == prevcmd  */
+            ibt = ibt > 0 ? ibt-1 : 0;
+
+        /* do the search */
+        colorPRINTF(settings->colorize, FG_RED, BG_NOCHANGE, "searching..." );
+        ibt = buffer_find( buffer, ibt, (Byte *)&cmd[1], slen, true );
+
+        if ( (size_t)-1 != ibt )        /* string found               */
+            *bt = ibt;          /* ... update cursor position */
+        else
+            BELL(1);
+
+        return (size_t)-1 != ibt;
+    }
+
+    /* search forward for byte-sequence */
+    else if ( KEY_FNDSEQ == key )
+    {
+        size_t  ibt = *bt;          /* remember cursor position   */
+        size_t  iseq;               /* eventually the len of seq[]*/
+        Byte    seq[MAXINPUT] = {0};        /* to hold the byte-sequence  */
+        int     tmp = 1;            /* general purpose temp int   */
+
+        if ( !strcmp(cmd, prevcmd) )        /* fix ibt if cmd == prevcmd  */
+            ibt = ibt > 0 ? ibt+1 : 1;
+
+        /* convert text-string &cmd[1] to byte-sequence seq[] */
+        tmp = iseq = 0;
+        while ( 1 == sscanf(&cmd[tmp+1], "%2hhx", (Byte *)&seq[iseq]) )
+        {
+            tmp += 2;
+            iseq++;
+        }
+        seq[iseq] = '\0';           /* this is just for debugging */
+
+        /* do the search */
+        colorPRINTF(settings->colorize, FG_RED, BG_NOCHANGE, "searching..." );
+        ibt = buffer_find( buffer, ibt, seq, iseq, false );
+
+        if ( (size_t)-1 != ibt )        /* sequence found             */
+            *bt = ibt;          /* ... update cursor position */
+        else
+            BELL(1);
+
+        return (size_t)-1 != ibt;
+    }
+    /* search backwards for byte-sequence */
+    else if ( KEY_RFNDSEQ == key )
+    {
+        size_t  ibt = *bt;          /* remember cursor position   */
+        size_t  iseq;               /* eventually the len of seq[]*/
+        Byte    seq[MAXINPUT] = {0};        /* to hold the byte-sequence  */
+        int     tmp = 1;            /* general purpose temp int   */
+
+        if ( !strcmp(cmd, prevcmd) )        /* fix ibt if cmd == prevcmd  */
+            ibt = ibt > 0 ? ibt-1 : 0;
+
+        /* convert text-string &cmd[1] to byte-sequence seq[] */
+        tmp = iseq = 0;
+        while ( 1 == sscanf(&cmd[tmp+1], "%2hhx", (Byte *)&seq[iseq]) )
+        {
+            tmp += 2;
+            iseq++;
+        }
+        seq[iseq] = '\0';           /* this is just for debugging */
+
+        /* do the search */
+        colorPRINTF(settings->colorize, FG_RED, BG_NOCHANGE, "searching..." );
+        ibt = buffer_find( buffer, ibt, seq, iseq, true );
+
+        if ( (size_t)-1 != ibt )        /* sequence found             */
+            *bt = ibt;          /* ... update cursor position */
+        else
+            BELL(1);
+
+        return (size_t)-1 != ibt;
+    }
+
+    /* goto to an address, in a process's memory (as the offsets shown) */
+    if ( KEY_GBYTE == tolower( (int) *cmd ) && buffer->proc && XF_NONE == buffer->xform.kind ) {
+        const size_t off = procmem_offset( buffer->proc, strtoull( &cmd[1], NULL, 0 ) );
+        if ( (size_t)-1 != off && off < buffer->len )
+            *bt = off;
+        else
+            BELL(1);
+        return (size_t)-1 != off && off < buffer->len;
+    }
+
+    /* the rest move the cursor (if any does: else it is no command) */
+    if ( !cursor_command( bt, cmd, buffer->len, buffer_rowlen( buffer ) ) ) {
+        BELL(1);
+        errno = ENOSYS;
+        return false;
+    }
+
+    return true;
+}
+
+/*********************************************************//**
+ * The buffers open in the viewer, each with its cursor & commands of
+ * its own (so ENTER repeats the search typed in the buffer viewed),
+ * switched to at no cost. The data they may hold in memory (mapped
+ * or not) & their edits share settings->membudget: once over it, the
+ * buffers viewed least recently give theirs back, mapped files by
+ * releasing the pages they touched (paged in again, from the OS
+ * cache, when viewed), the rest by being dropped (read again when
+ * viewed; unless edited). Views transformed share a single cache of
+ * pages too (see xform.c), whatever their #. The 1st buffer is that
+ * of the caller of view_buffer(), who frees it (it is just cleaned
+ * up, if closed).
+ *************************************************************
+ */
+#define VIEW_MAXBUFS    16          /* max # of buffers open at once      */
+#define VIEW_BUDGET     1024        /* default memory budget (in Mb)      */
+
+typedef struct View {
+    Buffer  *buffer;            /* the file viewed                    */
+    size_t  bt;                 /* its cursor ...                     */
+    char    cmd[ MAXINPUT ];    /* ... last command ...               */
+    char    prevcmd[ MAXINPUT ];    /* ... & the one before it        */
+    unsigned long used;         /* when it was last viewed            */
+    _Bool   released;           /* its mapped pages were released ... */
+    _Bool   dropped;            /* ... or its data dropped (see above)*/
+} View;
+
+typedef struct Views {
+    View    views[ VIEW_MAXBUFS ];
+    Buffer  *first;             /* the caller's buffer (not freed)    */
+    size_t  n, curr;            /* # of buffers open & the one viewed */
+    unsigned long clock;        /* stamps views                       */
+} Views;
+
+/*********************************************************//**
+ * Return the bytes of data the buffer of v may hold in memory (at
+ * most), and those of its edits.
+ *************************************************************
+ */
+static size_t view_memory( const View *v, size_t *edits )
+{
+    const Buffer *buffer = v->buffer;
+
+    *edits = buffer->editing ? buffer->edits.addcap : 0;
+    if ( buffer->proc )
+        return buffer->proc->nresident * buffer->proc->pagelen;
+    return (!buffer->data || v->released) ? 0 : buffer->datalen;
+}
+
+/*********************************************************//**
+ * Have the buffers viewed least recently give back their data (see
+ * above), until the buffers fit in the memory budget (or none has
+ * anything more to give back).
+ *************************************************************
+ */
+static void views_budget( Views *vs, const Settings *settings )
+{
+    for (;;)
+    {
+        size_t total = 0, i, lru = VIEW_MAXBUFS, data, edits;
+        View   *v;
+
+        for (i=0; i < vs->n; i++) {
+            v = &vs->views[i];
+            data   = view_memory( v, &edits );
+            total += data + edits;
+            if ( i != vs->curr && data > 0
+                && (v->buffer->file || v->buffer->proc || !v->buffer->editing)
+                && (VIEW_MAXBUFS == lru || v->used < vs->views[lru].used)
+            )
+                lru = i;
+        }
+        if ( total <= settings->membudget || VIEW_MAXBUFS == lru )
+            return;
+
+        v = &vs->views[lru];
+        if ( v->buffer->proc )            /* read again as touched */
+            procmem_drop( v->buffer->proc );
+        else if ( v->buffer->file ) {
+            hv_release( v->buffer->file );
+            v->released = true;
+        }
+        else {
+            char fname[ MAXINPUT ];
+
+            strcpy( fname, v->buffer->fname );
+            buffer_cleanup( v->buffer );
+            strcpy( v->buffer->fname, fname );
+            v->dropped = true;
+        }
+    }
+}
+
+/*********************************************************//**
+ * View the i'th buffer (reading its data again, if dropped).
+ *************************************************************
+ */
+static _Bool views_show( Views *vs, size_t i, Settings *settings )
+{
+    View *v = &vs->views[i];
+
+    if ( v->dropped ) {
+        if ( !buffer_open( v->buffer, v->buffer->fname, settings ) ) {
+            perror( v->buffer->fname );
+            pressENTER();
+            return false;
+        }
+        v->dropped = false;
+        if ( v->bt >= v->buffer->len )
+            v->bt = v->buffer->len > 0 ? v->buffer->len - 1 : 0;
+    }
+    else
+        buffer_overviews( v->buffer, settings );
+
+    vs->curr = i;
+    v->used  = ++vs->clock;
+    v->released = false;
+    settings->ibuf  = (unsigned) i;
+    settings->nbufs = (unsigned) vs->n;
+    views_budget( vs, settings );
+
+    return true;
+}
+
+/*********************************************************//**
+ * Open the file fname in a new buffer & view it (or just view it, if
+ * it is open already).
+ *************************************************************
+ */
+static _Bool views_open( Views *vs, const char *fname, Settings *settings )
+{
+    Buffer *buffer;
+    size_t i;
+
+    for (i=0; i < vs->n; i++)
+        if ( !strcmp( vs->views[i].buffer->fname, fname ) )
+            return views_show( vs, i, settings );
+
+    if ( vs->n == VIEW_MAXBUFS ) {
+        printf( "Too many open buffers (%d), close one first! ", VIEW_MAXBUFS );
+        pressENTER();
+        return false;
+    }
+    if ( NULL == (buffer = calloc( 1, sizeof(Buffer) )) || !buffer_open( buffer, fname, settings ) ) {
+        perror( fname );
+        free( buffer );
+        pressENTER();
+        return false;
+    }
+
+    memset( &vs->views[vs->n], 0, sizeof(View) );
+    vs->views[vs->n].buffer = buffer;
+    vs->views[vs->n].cmd[0] = KEY_PGDN;
+    return views_show( vs, vs->n++, settings );
+}
+
+/*********************************************************//**
+ * Close the buffer viewed (unless it is the only one), and view the
+ * one viewed before it.
+ *************************************************************
+ */
+static _Bool views_close( Views *vs, Settings *settings )
+{
+    View   *v = &vs->views[ vs->curr ];
+    size_t i, mru = 0;
+
+    if ( vs->n < 2 ) {
+        BELL(1);
+        return false;
+    }
+    if ( buffer_dirty( v->buffer ) ) {
+        char answer[256+1] = {'n'};
+        colorPRINTF(
+            settings->colorize, FG_RED, BG_NOCHANGE,
+            "The edits are not saved, close anyway (y/) ? "
+        );
+        if ( !s_read(answer, 256+1) || 'y' != tolower( (int) *answer ) )
+            return false;
+    }
+
+    buffer_cleanup( v->buffer );
+    if ( v->buffer != vs->first )
+        free( v->buffer );
+    memmove( &vs->views[vs->curr], &vs->views[vs->curr + 1], (vs->n - vs->curr - 1) * sizeof(View) );
+    vs->n--;
+
+    for (i=0, mru=0; i < vs->n; i++)
+        if ( vs->views[i].used > vs->views[mru].used )
+            mru = i;
+    return views_show( vs, mru, settings );
+}
+
+/*********************************************************//**
+ * Run the command cmd, if it is one of those of the buffers (open,
+ * view the next one, close): return false if it is not.
+ *************************************************************
+ */
+static _Bool views_command( Views *vs, const char *cmd, Settings *settings )
+{
+    const int key = tolower( (int) *cmd );
+
+    if ( KEY_LOADFILE == key )
+    {
+        if ( '\0' == cmd[1] ) {
+            printf( "f must be followed by a filename! " );
+            pressENTER();
+            return true;
+        }
+        if ( !fileexists( &cmd[1] ) ) {
+            printf( "No such file! " );
+            pressENTER();
+            return true;
+        }
+        views_open( vs, &cmd[1], settings );
+        return true;
+    }
+
+    if ( KEY_NEXTBUF == key ) {
+        const unsigned long n = '\0' == cmd[1] ? 1 : strtoul( &cmd[1], NULL, 10 );
+        if ( vs->n < 2 )
             BELL(1);
+        else
+            views_show( vs, (vs->curr + n) % vs->n, settings );
+        return true;
+    }
+
+    if ( KEY_CLOSEBUF == key ) {
+        views_close( vs, settings );
+        return true;
+    }
+
+    return false;
+}
+
+/*********************************************************//**
+ *
+ *************************************************************
+ */
+_Bool view_buffer( Buffer *buffer, Settings *settings )
+{
+    Views   *vs;
+    View    *v;
+    size_t  i;
+    int     ndirty;
+
+    if ( !buffer || !buffer->data || !settings )
+        return false;
+    if ( NULL == (vs = calloc( 1, sizeof(Views) )) )
+        return false;
+
+    vs->n = 1;
+    vs->first = buffer;
+    vs->views[0].buffer = buffer;
+    vs->views[0].cmd[0] = KEY_PGDN;
+    views_show( vs, 0, settings );
+
+    for (;;)
+    {
+        StatsSpan span;
+
+        v = &vs->views[ vs->curr ];     /* the buffer viewed         */
+        buffer = v->buffer;
+
+        STATS_BEGIN( span );
+        if ( !settings->israw )         /* no headers in raw-mode     */
+            show_header( v->bt, buffer, settings );
+
+        view_screen( v->bt, buffer, settings );
+        STATS_END( span, STATS_RENDER );
+
+        if ( settings->israw )          /* no interaction in raw-mode */
+            continue;
+
+        strcpy( v->prevcmd, v->cmd );   /* backup current command     */
+
+        /* get new command (none left? done) */
+        if ( !show_prompt(v->bt, v->cmd, v->prevcmd, buffer, settings) )
+            break;
+        if ( settings->session )
+            session_recorded( settings->session, v->cmd );
+
+        if ( KEY_QUIT == *v->cmd ) {
+            char answer[256+1] = {'n'};
+            for (i=0, ndirty=0; i < vs->n; i++)
+                ndirty += buffer_dirty( vs->views[i].buffer );
+            if ( 0 == ndirty )
+                break;
+            colorPRINTF(
+                settings->colorize, FG_RED, BG_NOCHANGE,
+                ndirty > 1 ? "The edits of %d files are not saved, quit anyway (y/) ? "
+                           : "The edits are not saved, quit anyway (y/) ? ", ndirty
+            );
+            if ( s_read(answer, 256+1) && 'y' == tolower( (int) *answer ) )
+                break;
+            continue;
+        }
+
+        if ( '\n' == *v->cmd )          /* restore previous command  */
+            strcpy( v->cmd, v->prevcmd );
+
+        STATS_BEGIN( span );
+        if ( !views_command( vs, v->cmd, settings ) )
+            do_command( &v->bt, v->cmd, v->prevcmd, buffer, settings );
+        STATS_END( span, tolower( (int) *v->cmd ) & 0xFF );
+        views_budget( vs, settings );   /* edits may have grown      */
+    }
+
+    putchar('\n');
+
+    /* close all the buffers but the caller's */
+    for (i=0; i < vs->n; i++)
+        if ( vs->views[i].buffer != vs->first ) {
+            buffer_cleanup( vs->views[i].buffer );
+            free( vs->views[i].buffer );
+        }
+    free( vs );
+
+    return true;
+}
+
+/*********************************************************//**
+ * Display the help screen of a file viewed as served.
+ *************************************************************
+ */
+static void remote_help( const Settings *settings )
+{
+    CLS();
+
+    colorPRINTF( settings->colorize, FGCLR_EM1, BG_NOCHANGE, "%52s\n\n", NAME_VERSION );
+    colorPRINTF( settings->colorize, FGCLR_EM1, BG_NOCHANGE,
+        "Available Commands (of a file served on %s)\n", settings->sockname );
+
+    puts( "The cursor moves as in the viewer (see its help screen), while searches and\n"
+          "hashes run in the server. Files cannot be edited, compared or analysed.\n" );
+    printf( "%c \t\t This help screen\n",           KEY_HLP );
+    printf( "%c \t\t Quit the program\n",           KEY_QUIT );
+    puts( "ENTER \t\t Repeat last command" );
+    printf( "%c or %c \t\t Toggle colorization, or the ASCII character set\n",
+        KEY_COLOR, KEY_CHARSET
+    );
+    printf( "%c %c %c %c %c %c %c %c\t Start/end of file, pages up/down, rows up/down, row start/end\n",
+        KEY_TOP, KEY_BOT, KEY_PGUP, KEY_PGDN, KEY_ROWUP, KEY_ROWDN, KEY_ROWSTA, KEY_ROWEND
+    );
+    printf( "%c %c n, %c %c %c n\t Move n bytes back or forward, goto n'th byte, row or page\n",
+        KEY_BYTEB, KEY_BYTEF, KEY_GBYTE, KEY_GROW, KEY_GPAGE
+    );
+    printf( "%c or %c string\t Search ahead or backwards for a text-string (case sensitive)\n",
+        KEY_FNDSTR, KEY_RFNDSTR
+    );
+    printf( "%c or %c sequence\t Search ahead or backwards for a byte-sequence\n",
+        KEY_FNDSEQ, KEY_RFNDSEQ
+    );
+    printf( "%c \t\t Mark the cursor as the other end of the selection (again to unmark)\n",
+        KEY_MARK
+    );
+    printf( "%calg [%c|p|n]\t Hash the file, or the selection, or the page, or n bytes at the\n"
+            "\t\t cursor (alg: crc32 crc32c xxh64 md5 sha1 sha256, all if none)\n",
+        KEY_HASH, KEY_MARK
+    );
+
+    putchar('\n');
+    pressENTER();
+
+    return;
+}
+
+/*********************************************************//**
+ * Search the file served as file on fd by the search command cmd, as
+ * do_command() searches buffers, moving the cursor *bt to the match.
+ * Return false if the server failed.
+ *************************************************************
+ */
+static _Bool remote_find( int fd, uint32_t file, size_t *bt, const char *cmd,
+                          const char *prevcmd, const Settings *settings )
+{
+    const int   key = tolower( (int) *cmd );
+    const _Bool backward = (KEY_RFNDSTR == key || KEY_RFNDSEQ == key);
+    Byte    pat[ MAXINPUT ];
+    size_t  n = 0, from = *bt;
+    ServerMsg msg;
+
+    if ( KEY_FNDSTR == key || KEY_RFNDSTR == key ) {
+        n = strlen( &cmd[1] );
+        memcpy( pat, &cmd[1], n );
+    }
+    else                    /* convert &cmd[1] to a byte-sequence */
+        while ( 1 == sscanf( &cmd[1 + 2*n], "%2hhx", &pat[n] ) )
+            n++;
+
+    if ( !strcmp(cmd, prevcmd) )        /* again? skip the last match */
+        from = backward ? (from > 0 ? from - 1 : 0) : from + 1;
+
+    colorPRINTF( settings->colorize, FG_RED, BG_NOCHANGE, "searching..." );
+    fflush( stdout );
+
+    memset( &msg, 0, sizeof(msg) );
+    msg.op    = SERVER_FIND;
+    msg.file  = file;
+    msg.off   = from;
+    msg.flags = backward ? SERVER_BACKWARD : 0;
+    msg.len   = (uint32_t) n;
+    if ( !server_call( fd, &msg, pat, NULL, 0 ) )
+        return false;
+
+    if ( HV_NOTFOUND == (size_t) msg.off )
+        BELL(1);
+    else
+        *bt = (size_t) msg.off;
+
+    return true;
+}
+
+/*********************************************************//**
+ * Show the digests of the hash command cmd (see hash_show()), of the
+ * file served as file on fd, of the length of shape. Return false if
+ * the server failed.
+ *************************************************************
+ */
+static _Bool remote_hash( int fd, uint32_t file, size_t bt, const char *cmd,
+                          const Buffer *shape, const Settings *settings )
+{
+    char    hex[ HV_HEXLEN ];
+    size_t  from, to;
+    const char *what;
+    int     alg, only;
+    ServerMsg msg;
+
+    if ( !hash_range( bt, cmd, shape, &only, &from, &to, &what ) ) {
+        BELL(1);
+        return true;
+    }
+
+    putchar('\n');
+    colorPRINTF( settings->colorize, FGCLR_EM1, BG_NOCHANGE,
+        "%s [%llX,%llX) = %llu bytes\n", what,
+        (unsigned long long) from, (unsigned long long) to, (unsigned long long) (to - from)
+    );
+    for (alg=0; alg < HASH_NALGS; alg++)
+    {
+        if ( -1 != only && alg != only )
+            continue;
+        memset( &msg, 0, sizeof(msg) );
+        msg.op   = SERVER_HASH;
+        msg.file = file;
+        msg.off  = from;
+        msg.n    = to;
+        msg.len  = (uint32_t) strlen( hash_name(alg) );
+        if ( !server_call( fd, &msg, hash_name(alg), hex, sizeof(hex) - 1 ) )
+            return false;
+        hex[ myMIN( (size_t) msg.len, sizeof(hex) - 1 ) ] = '\0';
+        printf( "%-8s %s\n", hash_name(alg), hex );
+    }
+    pressENTER();
+
+    return true;
+}
+
+/*********************************************************//**
+ * View the file fname as served on settings->sockname (see server.c):
+ * just the page shown (& the byte under the cursor) is sent over, as
+ * formatted by the server, so the file is never loaded here (and just
+ * once by the server, however many view it). The cursor moves as in
+ * the viewer, and searches & hashes run in the server; the rest of
+ * the commands of the viewer are not available.
+ *************************************************************
+ */
+#define REMOTE_ROWSLEN  (FMT_PGLINES * (HV_ROWMAX + 1))
+
+_Bool remote_view( const char *fname, Settings *settings )
+{
+    char    cmd[ MAXINPUT ] = {KEY_PGDN}, prevcmd[ MAXINPUT ] = {'\0'};
+    char    *path = NULL, *rows = NULL, *bitstr;
+    Buffer  *shape = NULL;          /* just the length of the file  */
+    ServerMsg msg;
+    uint32_t file;
+    size_t  bt = 0, slen;
+    Byte    byte = 0;
+    int     fd, ofstw, err;
+    _Bool   ok = true;
+
+    if ( -1 == (fd = server_connect( settings->sockname )) )
+        return false;
+    if ( NULL == (path = realpath( fname, NULL ))
+        || NULL == (rows = malloc( REMOTE_ROWSLEN + 1 ))
+        || NULL == (shape = calloc( 1, sizeof(Buffer) ))
+    )
+        goto ret_failure;
+
+    memset( &msg, 0, sizeof(msg) );
+    msg.op  = SERVER_OPEN;
+    msg.len = (uint32_t) strlen( path );
+    if ( !server_call( fd, &msg, path, NULL, 0 ) )
+        goto ret_failure;
+    if ( 0 == msg.n || msg.n >= SIZE_MAX ) {
+        errno = 0 == msg.n ? EINVAL : EFBIG;    /* nothing to view, or too much */
+        goto ret_failure;
+    }
+    file = msg.file;
+    strncpy( shape->fname, fname, MAXINPUT-1 );
+    buffer_setlen( shape, (size_t) msg.n );
+    ofstw = hv_ofst_width( shape->len );
+
+    for (;;)
+    {
+        StatsSpan span;
+        const size_t row = BT2ROW( bt, shape->len, shape->nrows );
+        char    *line, *eol;
+        size_t  i;
+        int     key;
+
+        /* a page of rows from that of the cursor, & the byte under it */
+        STATS_BEGIN( span );
+        memset( &msg, 0, sizeof(msg) );
+        msg.op    = SERVER_ROWS;
+        msg.file  = file;
+        msg.off   = ROW2BT( row, shape->nrows );
+        msg.n     = FMT_PGLINES;
+        msg.flags = FMT_XASCII == settings->charset ? HV_FMT_XASCII : 0;
+        if ( !server_call( fd, &msg, NULL, rows, REMOTE_ROWSLEN ) )
+            goto ret_failure;
+        rows[ myMIN( (size_t) msg.len, (size_t) REMOTE_ROWSLEN ) ] = '\0';
+
+        memset( &msg, 0, sizeof(msg) );
+        msg.op   = SERVER_READ;
+        msg.file = file;
+        msg.off  = bt;
+        msg.n    = 1;
+        if ( !server_call( fd, &msg, NULL, &byte, 1 ) )
+            goto ret_failure;
+
+        if ( !settings->israw ) {
+            CLS();
+            show_columns( bt % FMT_NCOLS, ofstw, settings );
+        }
+        for (i=0, line = rows; i < FMT_PGLINES; i++) {
+            if ( NULL == (eol = strchr( line, '\n' )) ) {
+                putchar('\n');         /* past the end of the file  */
+                continue;
+            }
+            *eol = '\0';
+            if ( 0 == i )               /* the cursor's              */
+                *line = '*';
+            colorPRINTF( settings->colorize, 0 == i ? FGCLR_BYTCURR : FGCLR_ROWOFST, BG_NOCHANGE,
+                "%.*s", ofstw + 1, line );
+            puts( &line[ ofstw + 1 ] );
+            line = eol + 1;
+        }
+        STATS_END( span, STATS_RENDER );
+
+        /* 1st prompt line: the file (& where it is served), its size & page */
+        slen = strlen( fname );
+        colorPRINTF(
+            settings->colorize, FGCLR_PMTFNAME, BGCLR_PMTFNAME,
+            " %s%s ", slen > FNAME_SHOWLEN ? "..." : "",
+            slen > FNAME_SHOWLEN ? &fname[ slen-FNAME_SHOWLEN ] : fname
+        );
+        putchar(':');
+        colorPRINTF( settings->colorize, FGCLR_PMTPG, BGCLR_PMTPG, "@%s:", settings->sockname );
+        colorPRINTF(
+            settings->colorize, FGCLR_PMTFNAME, BGCLR_PMTFNAME,
+            " %.3f Mb : %llu rows ", shape->len / (1024.0 * 1024),
+            (unsigned long long) shape->nrows
+        );
+        putchar('|');
+        colorPRINTF(
+            settings->colorize, FGCLR_PMTPG, BGCLR_PMTPG, " Pg:%llu/%llu ",
+            (unsigned long long) (1 + ROW2PG( row, shape->nrows )),
+            (unsigned long long) shape->npages
+        );
+        putchar('|');
+        colorPRINTF(
+            settings->colorize, FGCLR_PMTCHRSET, BGCLR_PMTCHRSET,
+            " %s ", NAME_CHARSET(settings->charset)
+        );
+        if ( shape->marked ) {
+            putchar('|');
+            colorPRINTF(
+                settings->colorize, FGCLR_PMTENT, BGCLR_PMTENT, " Sel:%llu ",
+                (unsigned long long) (bt > shape->mark ? bt - shape->mark : shape->mark - bt) + 1
+            );
+        }
+        puts("\0");
+
+        /* 2nd prompt line: the cursor & its byte, & the previous command */
+        colorPRINTF(
+            settings->colorize, FGCLR_PMTBYTPOS, BGCLR_PMTBYTPOS, " %llu=%llx/%llX ",
+            (unsigned long long) bt, (unsigned long long) bt,
+            (unsigned long long) shape->len - 1
+        );
+        colorPRINTF(
+            settings->colorize, FGCLR_PMTROWPOS, BGCLR_PMTROWPOS, "[%llx] ",
+            (unsigned long long) row
+        );
+        putchar('|');
+        colorPRINTF(
+            settings->colorize, FGCLR_PMTDEC, BGCLR_PMTDEC, " d:%hhu %hhd ",
+            byte, byte > 127 ? byte - 256 : byte
+        );
+        putchar('|');
+        colorPRINTF( settings->colorize, FGCLR_PMTOCT, BGCLR_PMTOCT, " o:%hho ", byte );
+        putchar('|');
+        colorPRINTF(
+            settings->colorize, FGCLR_PMTBIN, BGCLR_PMTBIN, " %s ",
+            (bitstr = bin_byte2bitstring( byte )) ? bitstr : "error"
+        );
+        free( bitstr );
+        putchar('|');
+        colorPRINTF( settings->colorize, FGCLR_PMTPRVCMD, BGCLR_PMTPRVCMD, " %s ", cmd );
+        colorPRINTF( settings->colorize, FGCLR_EM1, BG_NOCHANGE, ": " );
+        fflush( stdout );
+
+        /* get new command (none left? done) */
+        strcpy( prevcmd, cmd );
+        if ( !prompt_read( cmd, settings ) )
+            break;
+        if ( settings->session )
+            session_recorded( settings->session, cmd );
+        if ( KEY_QUIT == *cmd )
+            break;
+        if ( '\n' == *cmd )         /* restore previous command  */
+            strcpy( cmd, prevcmd );
 
-        return true;
+        STATS_BEGIN( span );
+        key = tolower( (int) *cmd );
+        if ( KEY_HLP == key )
+            remote_help( settings );
+        else if ( KEY_COLOR == key )
+            settings->colorize = !settings->colorize;
+        else if ( KEY_CHARSET == key )
+            settings->charset = FMT_ASCII == settings->charset ? FMT_XASCII : FMT_ASCII;
+        else if ( KEY_MARK == key ) {
+            shape->mark   = bt;
+            shape->marked = !shape->marked;
+        }
+        else if ( KEY_HASH == key )
+            ok = remote_hash( fd, file, bt, cmd, shape, settings );
+        else if ( KEY_FNDSTR == key || KEY_RFNDSTR == key
+            || KEY_FNDSEQ == key || KEY_RFNDSEQ == key
+        )
+            ok = remote_find( fd, file, &bt, cmd, prevcmd, settings );
+        else if ( !cursor_command( &bt, cmd, shape->len, FMT_NCOLS ) )
+            BELL(1);                /* not available here         */
+        STATS_END( span, key & 0xFF );
+        if ( !ok )
+            goto ret_failure;
     }
 
-    /* search forward for byte-sequence */
-    else if ( KEY_FNDSEQ == key )
-    {
-        size_t  ibt = *bt;          /* remember cursor position   */
-        size_t  iseq;               /* eventually the len of seq[]*/
-        Byte    seq[MAXINPUT] = {0};        /* to hold the byte-sequence  */
-        int     tmp = 1;            /* general purpose temp int   */
+    putchar('\n');
+    close( fd );
+    free( shape );
+    free( rows );
+    free( path );
 
-        if ( !strcmp(cmd, prevcmd) )        /* fix ibt if cmd == prevcmd  */
-            ibt = ibt > 0 ? ibt+1 : 1;
+    return true;
 
-        /* convert text-string &cmd[1] to byte-sequence seq[] */
-        tmp = iseq = 0;
-        while ( 1 == sscanf(&cmd[tmp+1], "%2hhx", (Byte *)&seq[iseq]) )
-        {
-            tmp += 2;
-            iseq++;
-        }
-        seq[iseq] = '\0';           /* this is just for debugging */
+ret_failure:
+    err = errno;
+    close( fd );
+    free( shape );
+    free( rows );
+    free( path );
+    errno = err;
+    return false;
+}
 
-        /* do the search */
-        colorPRINTF(settings->colorize, FG_RED, BG_NOCHANGE, "searching..." );
-        while ( iseq && ibt < buffer->len - iseq + 1
-            && (tmp=(memcmp( &buffer->data[ibt], seq, iseq*sizeof(Byte) )))
-        )
-            ibt++;
-            
-        if ( 0 == tmp )             /* sequence found             */
-            *bt = ibt;          /* ... update cursor position */
-        else
-            BELL(1);
+/*********************************************************//**
+ * Return true if the buffer holds the sequence searched by the search
+ * command cmd at off (where the search left the cursor, if found).
+ *************************************************************
+ */
+static _Bool batch_found( size_t off, const char *cmd, const Buffer *buffer )
+{
+    Byte    seq[ MAXINPUT ], got[ MAXINPUT ];
+    size_t  n = 0;
+    const int key = tolower( (int) *cmd );
 
-        return true;
+    if ( KEY_FNDSTR == key || KEY_RFNDSTR == key ) {
+        n = strlen( &cmd[1] );
+        memcpy( seq, &cmd[1], n );
+    }
+    else {                    /* as do_command() converts it */
+        const size_t len = strlen( cmd );
+        while ( 2*n + 1 < len && 1 == sscanf( &cmd[2*n + 1], "%2hhx", &seq[n] ) )
+            n++;
     }
-    /* search backwards for byte-sequence */
-    else if ( KEY_RFNDSEQ == key )
-    {
-        size_t  ibt = *bt;          /* remember cursor position   */
-        size_t  iseq;               /* eventually the len of seq[]*/
-        Byte    seq[MAXINPUT] = {0};        /* to hold the byte-sequence  */
-        int     tmp = 1;            /* general purpose temp int   */
 
-        if ( !strcmp(cmd, prevcmd) )        /* fix ibt if cmd == prevcmd  */
-            ibt = ibt > 0 ? ibt-1 : 0;
+    return n > 0 && n == buffer_get( buffer, off, got, n ) && 0 == memcmp( seq, got, n );
+}
 
-        /* convert text-string &cmd[1] to byte-sequence seq[] */
-        tmp = iseq = 0;
-        while ( 1 == sscanf(&cmd[tmp+1], "%2hhx", (Byte *)&seq[iseq]) )
-        {
-            tmp += 2;
-            iseq++;
+/*********************************************************//**
+ * Run the command cmd of a script (see batch_run()), and print its
+ * outcome to out, as a line of JSON.
+ *************************************************************
+ */
+static void batch_command( size_t *bt, const char *cmd, const char *prevcmd,
+                           Buffer *buffer, Settings *settings, FILE *out )
+{
+    const int key = tolower( (int) *cmd );
+    char    hex[ HASH_HEXLEN ];
+    size_t  from, to, n;
+    const char *what, *error = NULL;
+    _Bool   ok = true;
+    int     alg, only;
+
+    fputs( "{\"cmd\":", out );
+    stats_json( out, cmd );
+
+    switch ( key )
+    {
+    /* the hex of n rows (a page if no n), starting with the cursor's */
+    case KEY_LIST: {
+        Byte row[ FMT_NCOLS ];
+        unsigned long long nrows = strtoull( &cmd[1], NULL, 0 );
+        if ( 0 == nrows )
+            nrows = FMT_PGLINES;
+        from = ROW2BT( BT2ROW(*bt, buffer->len, buffer->nrows), buffer->nrows );
+        to   = from + myMIN( nrows * FMT_NCOLS, (unsigned long long) (buffer->len - from) );
+        fprintf( out, ",\"from\":%llu,\"hex\":\"", (unsigned long long) from );
+        for (; from < to; from += n)
+            for (n = buffer_get( buffer, from, row, myMIN(to - from, sizeof(row)) ), alg=0;
+                alg < (int) n; alg++)
+                fprintf( out, "%02x", row[alg] );
+        fputc( '"', out );
+        break;
+    }
+
+    case KEY_HASH:
+        if ( !(ok = hash_range( *bt, cmd, buffer, &only, &from, &to, &what )) ) {
+            error = "invalid alg or range";
+            break;
         }
-        seq[iseq] = '\0';           /* this is just for debugging */
+        fprintf( out, ",\"from\":%llu,\"to\":%llu",
+            (unsigned long long) from, (unsigned long long) to );
+        for (alg=0; alg < HASH_NALGS; alg++)
+            if ( -1 == only || alg == only ) {
+                hash_digest( buffer, alg, from, to, hex );
+                fprintf( out, ",\"%s\":\"%s\"", hash_name(alg), hex );
+            }
+        break;
+
+    /* the record sizes found (in the data of the selection, if any) */
+    case KEY_PERIOD: {
+        const long long maxstride = strtoll( &cmd[1], NULL, 10 );
+        Period  p;
+        if ( !(ok = buffer_period( *bt, maxstride > 0 ? (size_t) maxstride : 0, buffer, &p, &from, &to )) ) {
+            error = "out of memory";
+            break;
+        }
+        fprintf( out, ",\"from\":%llu,\"to\":%llu,\"strides\":[",
+            (unsigned long long) from, (unsigned long long) to );
+        for (n=0; n < p.ntop; n++)
+            fprintf( out, "%s{\"stride\":%llu,\"confidence\":%.3f,\"match\":%.4f}", n ? "," : "",
+                (unsigned long long) p.top[n].stride, p.top[n].confidence, p.top[n].match );
+        fputc( ']', out );
+        break;
+    }
 
-        /* do the search */
-        colorPRINTF(settings->colorize, FG_RED, BG_NOCHANGE, "searching..." );
-        while ( iseq && ibt > 0
-            && (tmp=memcmp(&buffer->data[ibt], seq, iseq * sizeof(Byte))) )
-            ibt--;
-        /* 0 is treaded separately because ibt is unsigned */
-        if ( ibt == 0 && tmp != 0 )
-            tmp = memcmp(&buffer->data[ibt], seq, iseq * sizeof(Byte));
-
-        if ( 0 == tmp )             /* string found               */
-            *bt = ibt;          /* ... update cursor position */
-        else
-            BELL(1);
+    /* the frequent n-grams & repeated blocks (of the selection, if any) */
+    case KEY_NGRAMS: {
+        const long long blocklen = strtoll( &cmd[1], NULL, 10 );
+        const char *sep = "";
+        char    gram[ 2*8+1 ];
+        Ngrams  ng;
+        size_t  k;
+        if ( blocklen != 0 && blocklen < NGRAM_MINBLOCKLEN ) {
+            ok = false;
+            error = "invalid block length";
+            break;
+        }
+        if ( !(ok = buffer_ngrams( *bt, (size_t) blocklen, buffer, &ng, &from, &to )) ) {
+            error = "out of memory";
+            break;
+        }
+        fprintf( out, ",\"from\":%llu,\"to\":%llu,\"ngrams\":[",
+            (unsigned long long) from, (unsigned long long) to );
+        for (k=0; k < NGRAM_NLENS; k++)
+            for (n=0; n < ng.ntop[k]; n++, sep=",") {
+                ngram_text( &ng.top[k][n], k, '\0', gram, NULL );
+                fprintf( out, "%s{\"n\":%u,\"gram\":\"%s\",\"count\":%llu,\"at\":%llu}", sep,
+                    NGRAM_LEN(k), gram, ng.top[k][n].count, (unsigned long long) (from + ng.top[k][n].off) );
+            }
+        fprintf( out, "],\"blocklen\":%llu,\"blocks\":%llu,\"repeats\":%llu,\"exact\":%s,\"dups\":[",
+            (unsigned long long) ng.blocklen, ng.nblocks, ng.nrepeats, ng.exact ? "true" : "false" );
+        for (n=0; n < ng.ndups; n++)
+            fprintf( out, "%s{\"xxh64\":\"%016llx\",\"count\":%llu,\"at\":%llu}", n ? "," : "",
+                (unsigned long long) ng.dups[n].hash, ng.dups[n].count,
+                (unsigned long long) (from + ng.dups[n].off) );
+        fputc( ']', out );
+        break;
+    }
 
-        return true;
+    case KEY_EXTRACT:
+        if ( !(ok = extract_range( *bt, cmd, buffer, &from, &n, &what )) ) {
+            error = "invalid range or no filename";
+            break;
+        }
+        fprintf( out, ",\"from\":%llu,\"n\":%llu,\"file\":",
+            (unsigned long long) from, (unsigned long long) n );
+        stats_json( out, what );
+        if ( !(ok = buffer_extract( buffer, from, n, what )) )
+            error = strerror( errno );
+        break;
+
+    case KEY_WRITE:
+    case KEY_BULK:
+        if ( XF_NONE != buffer->xform.kind ) {
+            ok = false;
+            error = "viewed transformed";
+        }
+        else if ( KEY_BULK == key ) {
+            if ( !(ok = buffer_bulk( bt, cmd, buffer, settings )) )
+                error = "invalid op or operands";
+        }
+        else if ( !(ok = buffer_save( bt, '\0' != cmd[1] ? &cmd[1] : NULL, buffer, settings )) )
+            error = strerror( errno );
+        break;
+
+    case KEY_XFORM:
+        if ( !(ok = buffer_transform( bt, cmd, buffer )) )
+            error = "invalid transform";
+        break;
+
+    /* those need the viewer */
+    case KEY_HLP: case KEY_LOADFILE: case KEY_STRINGS: case KEY_COMPARE: case KEY_DELTA:
+        ok = false;
+        error = "not in batch mode";
+        break;
+
+    default:
+        from  = *bt;
+        errno = 0;
+        ok    = do_command( bt, cmd, prevcmd, buffer, settings );
+
+        /* searches again (for the next one) must move to be found */
+        if ( KEY_FNDSTR == key || KEY_RFNDSTR == key || KEY_FNDSEQ == key || KEY_RFNDSEQ == key ) {
+            if ( !(ok = ok && batch_found( *bt, cmd, buffer ) && (*bt != from || strcmp(cmd, prevcmd))) )
+                error = "not found";
+        }
+        else if ( !ok )
+            error = ENOSYS == errno ? "unknown command" : "failed";
+        break;
     }
 
-/*
-    else
-        (*row) += FMT_PGLINES;
-*/
-    *bt = ROW2BT( row, buffer->nrows ) + ( *bt % FMT_NCOLS );
+    fprintf( out, ",\"ok\":%s,\"at\":%llu,\"len\":%llu",
+        ok ? "true" : "false", (unsigned long long) *bt, (unsigned long long) buffer->len );
+    if ( buffer->proc )
+        fprintf( out, ",\"addr\":%llu", buffer_label( buffer, *bt ) );
+    if ( error ) {
+        fputs( ",\"error\":", out );
+        stats_json( out, error );
+    }
+    fputs( "}\n", out );
 
-        return true;
+    return;
 }
 
 /*********************************************************//**
- *
+ * Run the commands of settings->batchcmds, then those of the script
+ * settings->batchfname (one per line, if any), through do_command()
+ * as the viewer does (an empty line repeats the last one, q stops),
+ * printing the outcome of each one to stdout as a line of JSON. The
+ * chatter of the commands meant for the viewer (messages, prompts)
+ * is discarded, and they read no input.
  *************************************************************
  */
-_Bool view_buffer( Buffer *buffer, Settings *settings )
+_Bool batch_run( Buffer *buffer, Settings *settings )
 {
-    size_t bt;                  /* current byte-index        */
-    char cmd[ MAXINPUT ] = {']'}, prevcmd[ MAXINPUT ] = {'\0'};
+    FILE    *out = stdout, *script = NULL;
+    char    cmd[ MAXINPUT ] = {'\0'}, prevcmd[ MAXINPUT ] = {'\0'};
+    size_t  bt = 0, i = 0, len;
+    _Bool   success;
+    StatsSpan span;
 
     if ( !buffer || !buffer->data || !settings )
         return false;
+    settings->colorize = false;
 
-    bt = 0;
-    for (;;)
-    {
-        if ( !settings->israw )         /* no headers in raw-mode     */
-            show_header( bt, buffer, settings );
-
-        view_screen( bt, buffer, settings );
+    if ( settings->batchfname && strcmp( settings->batchfname, "-" )
+        && NULL == (script = fopen( settings->batchfname, "r" ))
+    )
+        return false;
 
-        if ( settings->israw )          /* no interaction in raw-mode */
-            continue;
+#ifdef HV_POSIX
+    /* results to (a copy of) stdout, the rest nowhere */
+    {
+        int fd;
 
-        strcpy( prevcmd, cmd );         /* backup current command     */
+        fflush( stdout );
+        if ( -1 == (fd = dup( STDOUT_FILENO )) || NULL == (out = fdopen( fd, "w" )) )
+            goto ret_failure;
+        if ( settings->batchfname && !script ) {
+            if ( -1 == (fd = dup( STDIN_FILENO )) || NULL == (script = fdopen( fd, "r" )) )
+                goto ret_failure;
+            setvbuf( out, NULL, _IOLBF, 0 );    /* answer as asked */
+        }
+        if ( !freopen( "/dev/null", "w", stdout ) || !freopen( "/dev/null", "r", stdin ) )
+            goto ret_failure;
+    }
+#else
+    if ( settings->batchfname && !script )
+        script = stdin;
+#endif
 
-        /* get new command */
-        if ( !show_prompt(bt, cmd, prevcmd, buffer, settings) )
-            continue;
+    for (;;)
+    {
+        strcpy( prevcmd, cmd );
 
-        if ( KEY_QUIT == *cmd )
+        if ( i < settings->nbatchcmds )
+            strncpy( cmd, settings->batchcmds[i++], MAXINPUT-1 );
+        else if ( !script || !fgets( cmd, MAXINPUT, script ) )
             break;
 
-        if ( '\n' == *cmd )         /* restore previous command  */
+        len = strcspn( cmd, "\r\n" );
+        cmd[ len ] = '\0';
+        if ( 0 == len ) {            /* repeat the last command   */
+            if ( '\0' == *prevcmd )
+                continue;
             strcpy( cmd, prevcmd );
+        }
+        if ( KEY_QUIT == tolower( (int) *cmd ) )
+            break;
 
-        do_command( &bt, cmd, prevcmd, buffer, settings );
-
+        STATS_BEGIN( span );
+        batch_command( &bt, cmd, prevcmd, buffer, settings, out );
+        STATS_END( span, tolower( (int) *cmd ) & 0xFF );
     }
 
-    putchar('\n');
+    fflush( out );
+    success = !ferror( out );
+    if ( out != stdout )
+        fclose( out );
+    if ( script && script != stdin )
+        fclose( script );
+    return success;
 
-    return true;
+ret_failure:
+    if ( out != stdout )
+        fclose( out );
+    if ( script && script != stdin )
+        fclose( script );
+    return false;
 }
 
 /*********************************************************//**
@@ -988,42 +5103,202 @@ void buffer_cleanup( Buffer *buffer )
     if ( !buffer )
         return;
 
-    if ( buffer->data ) {
+    buffer_compare( buffer, NULL );         /* before data: it reads them */
+    xform_cleanup( &buffer->xform );
+    piece_cleanup( &buffer->edits );
+    minimap_cleanup( &buffer->minimap );
+    entmap_cleanup( &buffer->entmap );
+    if ( buffer->file )
+        hv_close( buffer->file );        /* the data are its mapping */
+    else if ( buffer->proc )
+        procmem_close( buffer->proc );        /* ... or its mirror */
+    else if ( buffer->data )
         free(buffer->data);
-        buffer->data = NULL;
-    }
+    buffer->data = NULL;
 
     memset( buffer, 0, sizeof(Buffer) );
     return;
 }
 
 /*********************************************************//**
- * Read into a Buffer structure the contents of a file with size up tp LONG_MAX bytes.
+ * Hash the data of a buffer as they are loaded, with the algs in
+ * hashmask: start, feed n more bytes, and keep the digests.
+ *************************************************************
+ */
+static void load_hash_init( HashCtx *ctx, unsigned hashmask )
+{
+    int alg;
+
+    for (alg=0; alg < HASH_NALGS; alg++)
+        if ( hashmask & (1U << alg) )
+            hash_init( &ctx[alg], alg );
+    return;
+}
+
+static void load_hash_update( HashCtx *ctx, unsigned hashmask, const Byte *data, size_t n )
+{
+    int alg;
+
+    for (alg=0; alg < HASH_NALGS; alg++)
+        if ( hashmask & (1U << alg) )
+            hash_update( &ctx[alg], data, n );
+    return;
+}
+
+static void load_hash_final( HashCtx *ctx, unsigned hashmask, Buffer *buffer )
+{
+    unsigned char digest[ HASH_MAXLEN ];
+    int alg;
+
+    for (alg=0; alg < HASH_NALGS; alg++)
+        if ( hashmask & (1U << alg) )
+            hash_tohex( digest, hash_final(&ctx[alg], digest), buffer->digest[alg] );
+    buffer->hashmask = hashmask;
+    return;
+}
+
+/*********************************************************//**
+ * Map a file into a Buffer structure, without reading it (the OS
+ * pages it in on demand), by libhexview. Where mmap is not available,
+ * or the file is empty (or a pipe ...), it is read by libhexview to
+ * its end instead, silently (so that reports print nothing else). A
+ * fname of pid:N is the memory of the process N (buffer_map_proc()).
+ *************************************************************
+ */
+_Bool buffer_map_file( Buffer *buffer, const char *fname, unsigned hashmask )
+{
+    HvFile *file;
+    HvScan scan;
+    int    alg;
+
+    if ( !buffer || !fname || '\0' == *fname )
+        return false;
+    if ( 0 == strncmp( fname, "pid:", 4 ) )
+        return buffer_map_proc( buffer, fname, hashmask );
+
+    /* mapped by the library (pipes, char devices ... are read instead) */
+    if ( NULL == (file = hv_open( fname, true ))
+        && (ENOTSUP != errno || NULL == (file = hv_open( fname, false )))
+    )
+        return false;
+
+    /* make sure our Buffer struct starts with zeroed fields */
+    memset( buffer, 0, sizeof(Buffer) );
+
+    /* update fields in our Buffer structure (the data are never written) */
+    strncpy( buffer->fname, fname, MAXINPUT-1 );
+    buffer->file    = file;
+    buffer->data    = (Byte *) hv_data( file );
+    buffer->len     = hv_size( file );
+    buffer->datalen = buffer->len;
+    buffer->nrows   = hv_nrows( file );
+    buffer->npages  = hv_npages( file );
+
+    /* nothing is read yet: hash in parallel where possible */
+    hv_scan_begin( &scan, hashmask ? file : NULL, 0, buffer->len );
+    hv_scan_at( &scan, HV_NOTFOUND );
+    for (alg=0; alg < HASH_NALGS; alg++)
+        if ( (hashmask & (1U << alg))
+            && !hash_data( alg, buffer->data, buffer->len, hv_ncpus(), buffer->digest[alg] )
+        ) {
+            hv_scan_end( &scan );
+            buffer_cleanup( buffer );
+            return false;
+        }
+    hv_scan_end( &scan );
+    buffer->hashmask = hashmask;
+
+    return true;
+}
+
+/*********************************************************//**
+ * Mirror the memory of the process of fname pid:N into a Buffer
+ * structure: its readable regions, end to end (see procmem.c), read
+ * from it as they are viewed or scanned.
+ *************************************************************
+ */
+_Bool buffer_map_proc( Buffer *buffer, const char *fname, unsigned hashmask )
+{
+    ProcMem *proc;
+    char    *end;
+    const long pid = strtol( &fname[4], &end, 10 );
+    int     alg;
+
+    if ( pid <= 0 || '\0' != *end ) {
+        errno = EINVAL;
+        return false;
+    }
+    if ( NULL == (proc = procmem_open( (int) pid, 0 )) )
+        return false;
+
+    memset( buffer, 0, sizeof(Buffer) );
+    strncpy( buffer->fname, fname, MAXINPUT-1 );
+    buffer->proc    = proc;
+    buffer->data    = proc->data;
+    buffer->datalen = proc->len;
+    buffer_setlen( buffer, proc->len );
+
+    for (alg=0; alg < HASH_NALGS; alg++)
+        if ( (hashmask & (1U << alg))
+            && !hash_data( alg, buffer->data, buffer->len, hv_ncpus(), buffer->digest[alg] )
+        ) {
+            buffer_cleanup( buffer );
+            return false;
+        }
+    buffer->hashmask = hashmask;
+
+    return true;
+}
+
+/*********************************************************//**
+ * Read into a Buffer structure the contents of a file (of any size that
+ * fits in memory).
+ * The file is read in chunks of LOAD_CHUNKLEN bytes, each one hashed
+ * with the algs of hashmask while it is still in the CPU cache.
  *************************************************************
  */
-_Bool buffer_read_file_longmax( Buffer *buffer, const char *fname )
+#define LOAD_CHUNKLEN    (1024*1024)
+
+_Bool buffer_read_file_longmax( Buffer *buffer, const char *fname, unsigned hashmask )
 {
-    long int buflen, bufsize;
+    long long bufsize;
+    size_t   buflen, n, got;
+    HashCtx  ctx[ HASH_NALGS ];
     FILE     *fp = NULL;
 
     if ( !buffer || !fname || '\0' == *fname )
         return false;
 
-    if ( -1 == (bufsize = filesize(fname)) || NULL == (fp = fopen(fname, "rb")) )
+    if ( -1 == (bufsize = hv_filesize(fname)) )
+        return false;
+    if ( (unsigned long long) bufsize >= SIZE_MAX ) {
+        errno = EFBIG;                /* cannot be addressed       */
+        return false;
+    }
+    if ( NULL == (fp = fopen(fname, "rb")) )
         return false;
 
     /* make sure our Buffer struct starts with zeroed fields */
     memset( buffer, 0, sizeof(Buffer) );
 
     /* allocate room in memory for our buffer->data (+1 for zero-terminator) */
-    buflen = bufsize / sizeof(Byte);
+    buflen = (size_t) bufsize / sizeof(Byte);
     if ( NULL == (buffer->data = calloc( buflen+1, sizeof(Byte) )) )
         goto ret_failure;
 
     printf("Loading \"%s\"... ", fname);
-    buflen = fread( buffer->data, sizeof(Byte), buflen, fp);
-    if ( ferror(fp) )
-        goto ret_failure;
+    load_hash_init( ctx, hashmask );
+    for (n=0; n < buflen; n += got)
+    {
+        got = fread( &buffer->data[n], sizeof(Byte), myMIN(buflen - n, LOAD_CHUNKLEN), fp );
+        if ( ferror(fp) )
+            goto ret_failure;
+        if ( 0 == got )
+            break;
+        load_hash_update( ctx, hashmask, &buffer->data[n], got );
+    }
+    buflen = n;
+    load_hash_final( ctx, hashmask, buffer );
 
     fclose(fp);
     puts("\nDone!");
@@ -1031,6 +5306,7 @@ _Bool buffer_read_file_longmax( Buffer *buffer, const char *fname )
     /* update fields in our Buffer structure */
     strcpy( buffer->fname, fname );
     buffer->len     = buflen;
+    buffer->datalen = buffer->len;
     buffer->nrows   = buffer->len/FMT_NCOLS + (buffer->len % FMT_NCOLS != 0 ?1 :0);
     buffer->npages  = buffer->nrows / FMT_PGLINES
             + (buffer->nrows % FMT_PGLINES != 0 ? 1 : 0 );
@@ -1051,9 +5327,10 @@ ret_failure:
  * Read contents of file of any size into the Buffer structure.
  *************************************************************
  */
-_Bool buffer_read_file( Buffer *buf, const char *fname, size_t chunklen )
+_Bool buffer_read_file( Buffer *buf, const char *fname, size_t chunklen, unsigned hashmask )
 {
-    size_t  n;              /* # of Bytes read from file to chunk*/
+    HashCtx ctx[ HASH_NALGS ];      /* hashed while loaded, if asked     */
+    size_t  n = 0;          /* # of Bytes read from file to chunk*/
     size_t  buflen = chunklen;      /* current length of our data buffer */
     Byte    *try = NULL;            /* to test reallocs before apply 'em */
     FILE    *fp = NULL;
@@ -1074,15 +5351,18 @@ _Bool buffer_read_file( Buffer *buf, const char *fname, size_t chunklen )
         (unsigned long long)(chunklen * sizeof(Byte))
     );
     printf( "Bytes loaded so far: ");
+    load_hash_init( ctx, hashmask );
 
     /* read the file into our Buffer structure */
     while ( !feof(fp) )
     {
         /* read data from file into the newely allocated part of the Buffer */
         n = fread( &buf->data[buflen-chunklen], sizeof(Byte), chunklen, fp);
-        if (ferror(fp) || n < chunklen) {
+        load_hash_update( ctx, hashmask, &buf->data[buflen-chunklen], n );
+        if ( ferror(fp) )
             goto ret_failure;
-        }
+        if ( n < chunklen )                 /* that was the last chunk   */
+            break;
 
         /* allocate ahead chunklen more Bytes */
         buflen += chunklen;
@@ -1104,10 +5384,12 @@ _Bool buffer_read_file( Buffer *buf, const char *fname, size_t chunklen )
     if (NULL == (try = realloc( buf->data, buflen * sizeof(Byte) )) )
         goto ret_failure;
     buf->data = try;
+    load_hash_final( ctx, hashmask, buf );
 
     /* update fields in our Buffer structure */
     strcpy( buf->fname, fname );
     buf->len    = buflen;
+    buf->datalen    = buf->len;
     buf->nrows  = buf->len / FMT_NCOLS + (buf->len % FMT_NCOLS != 0 ? 1 : 0);
     buf->npages     = buf->nrows / FMT_PGLINES
             + (buf->nrows % FMT_PGLINES != 0 ? 1 : 0 );
@@ -1124,6 +5406,202 @@ ret_failure:
     return false;
 }
 
+/*********************************************************//**
+ * Return true if arg is the command line option -name (or --name),
+ * optionally followed by =value (in which case *val points to it).
+ *************************************************************
+ */
+static _Bool cmdline_opt( const char *arg, const char *name, const char **val )
+{
+    size_t len = strlen( name );
+
+    if ( '-' != *arg++ )
+        return false;
+    if ( '-' == *arg )                /* --name is the same as -name */
+        arg++;
+    if ( strncmp(arg, name, len) || ('\0' != arg[len] && '=' != arg[len]) )
+        return false;
+
+    *val = ('=' == arg[len]) ? &arg[len+1] : NULL;
+    return true;
+}
+
+/*********************************************************//**
+ * Parse the command line options into settings, and the name of the
+ * file to be viewed into fname. Return false on an invalid option.
+ *************************************************************
+ */
+_Bool parse_cmdline( int argc, char *argv[], char *fname, Settings *settings )
+{
+    int i;
+    const char *val = NULL;
+
+    for (i=1; i < argc && '-' == argv[i][0]; i++)
+    {
+        if ( cmdline_opt(argv[i], "strings", &val) ) {
+            settings->mode = MODE_STRINGS;
+            if ( val && (settings->strminlen = strtoul(val, NULL, 10)) < 1 )
+                return false;
+        }
+        else if ( cmdline_opt(argv[i], "ascii", &val) )
+            settings->strkinds = STR_ASCII;
+        else if ( cmdline_opt(argv[i], "entropy", &val) ) {
+            settings->mode = MODE_ENTROPY;
+            if ( val ) {
+                settings->entblocklen = strtoul( val, NULL, 10 );
+                if ( settings->entblocklen < 1 || settings->entblocklen > ENT_MAXBLOCKLEN )
+                    return false;
+            }
+        }
+        else if ( cmdline_opt(argv[i], "hash", &val) ) {
+            settings->mode = MODE_HASH;
+            if ( 0 == (settings->hashmask = hash_parselist( val ? val : "sha256" )) )
+                return false;
+        }
+        else if ( cmdline_opt(argv[i], "compare", &val) || cmdline_opt(argv[i], "delta", &val) ) {
+            if ( !val || '\0' == *val )
+                return false;
+            settings->cmpfname = val;
+            if ( 'd' == argv[i][ strspn(argv[i], "-") ] )
+                settings->mode = MODE_DELTA;
+        }
+        else if ( cmdline_opt(argv[i], "loadhash", &val) ) {
+            if ( 0 == (settings->loadhash = hash_parselist( val )) )
+                return false;
+        }
+        else if ( cmdline_opt(argv[i], "lines", &val) )
+            settings->rawkeys = false;
+        else if ( cmdline_opt(argv[i], "stats", &val) )
+            settings->stats = true;
+        else if ( cmdline_opt(argv[i], "trace", &val) ) {
+            if ( !val || '\0' == *val )
+                return false;
+            settings->tracefname = val;
+            settings->stats = true;
+        }
+        else if ( cmdline_opt(argv[i], "record", &val) || cmdline_opt(argv[i], "replay", &val) ) {
+            if ( !val || '\0' == *val )
+                return false;
+            if ( 'c' == argv[i][ strspn(argv[i], "-") + 2 ] )
+                settings->recordfname = val;
+            else
+                settings->replayfname = val;
+        }
+        else if ( cmdline_opt(argv[i], "budget", &val) ) {
+            if ( !val || 0 == (settings->membudget = strtoul( val, NULL, 10 )) )
+                return false;
+            settings->membudget = settings->membudget > SIZE_MAX / (1024*1024)
+                ? SIZE_MAX : settings->membudget * 1024 * 1024;
+        }
+        else if ( cmdline_opt(argv[i], "serve", &val) || cmdline_opt(argv[i], "connect", &val) ) {
+            if ( !val || '\0' == *val )
+                return false;
+            settings->sockname = val;
+            if ( 's' == argv[i][ strspn(argv[i], "-") ] )
+                settings->mode = MODE_SERVE;
+        }
+        else if ( cmdline_opt(argv[i], "extract", &val) ) {
+            char *end;
+            if ( !val )
+                return false;
+            settings->mode  = MODE_EXTRACT;
+            settings->xfrom = strtoull( val, &end, 0 );
+            if ( ',' != *end++ )
+                return false;
+            settings->xto = (':' == *end) ? ULLONG_MAX : strtoull( end, &end, 0 );
+            if ( ':' != *end || '\0' == end[1] || settings->xto <= settings->xfrom )
+                return false;
+            settings->outname = &end[1];
+        }
+        else if ( cmdline_opt(argv[i], "carve", &val) ) {
+            settings->mode    = MODE_CARVE;
+            settings->outname = (val && '\0' != *val) ? val : ".";
+        }
+        else if ( cmdline_opt(argv[i], "find", &val) ) {
+            if ( !val || '\0' == *val )
+                return false;
+            settings->mode    = MODE_FIND;
+            settings->findpat = val;
+        }
+        else if ( cmdline_opt(argv[i], "direct", &val) )
+            settings->direct = true;
+        else if ( cmdline_opt(argv[i], "dump", &val) )
+            settings->mode = MODE_DUMP;
+        else if ( cmdline_opt(argv[i], "period", &val) ) {
+            settings->mode = MODE_PERIOD;
+            if ( val && (settings->maxstride = strtoul(val, NULL, 10)) < 2 )
+                return false;
+        }
+        else if ( cmdline_opt(argv[i], "ngrams", &val) ) {
+            settings->mode = MODE_NGRAMS;
+            if ( val && (settings->dupblocklen = strtoul(val, NULL, 10)) < NGRAM_MINBLOCKLEN )
+                return false;
+        }
+        else if ( cmdline_opt(argv[i], "json", &val) )
+            settings->json = true;
+        else if ( cmdline_opt(argv[i], "count", &val) )
+            settings->count = true;
+        else if ( cmdline_opt(argv[i], "threads", &val) ) {
+            if ( !val || 0 == (settings->nthreads = strtoul( val, NULL, 10 )) )
+                return false;
+        }
+        else if ( cmdline_opt(argv[i], "batch", &val) ) {
+            settings->mode = MODE_BATCH;
+            settings->batchfname = (val && '\0' != *val) ? val : "-";
+        }
+        else if ( cmdline_opt(argv[i], "e", &val) ) {
+            if ( !val || '\0' == *val )
+                return false;
+            if ( !settings->batchcmds
+                && NULL == (settings->batchcmds = malloc( argc * sizeof(char *) ))
+            )
+                return false;
+            settings->batchcmds[ settings->nbatchcmds++ ] = val;
+            settings->mode = MODE_BATCH;
+        }
+        else
+            return false;
+    }
+
+    if ( i < argc - 1 && MODE_FIND != settings->mode && MODE_DUMP != settings->mode )
+        return false;                /* at most 1 filename ...    */
+    if ( i < argc - 1 && settings->direct )
+        return false;                /* ... scanned past the cache */
+    if ( (settings->json && MODE_FIND != settings->mode && MODE_DUMP != settings->mode)
+        || (settings->count && MODE_FIND != settings->mode)
+    )
+        return false;
+    if ( (settings->recordfname || settings->replayfname)
+        && (MODE_VIEW != settings->mode || (settings->recordfname && settings->replayfname))
+    )
+        return false;                /* sessions are of the viewer */
+    if ( settings->sockname && MODE_VIEW != settings->mode && MODE_SERVE != settings->mode )
+        return false;                /* served files are just viewed */
+    if ( settings->direct && MODE_HASH != settings->mode && MODE_STRINGS != settings->mode
+        && MODE_FIND != settings->mode
+    )
+        return false;                /* the scans read past the cache */
+
+    /* no filename? view our own executable */
+    strncpy( fname, i < argc ? argv[i] : argv[0], MAXINPUT-1 );
+    settings->paths  = (const char **) (i < argc ? &argv[i] : &argv[0]);
+    settings->npaths = i < argc ? (size_t) (argc - i) : 1;
+
+    return true;
+}
+
+#ifndef HV_NOMAIN                /* bench.c has a main() of its own */
+/*********************************************************//**
+ * Print the timings (if asked) on exit, however it is reached.
+ *************************************************************
+ */
+static void stats_atexit( void )
+{
+    stats_report( stderr );
+    stats_cleanup();
+    return;
+}
+
 /*********************************************************//**
  *
  *************************************************************
@@ -1132,6 +5610,8 @@ int main( int argc, char *argv[] )
 {
     _Bool   success = false;
     char    tmpfname[ MAXINPUT ] = {'\0'};
+    StatsSpan span;
+    Session session;
 
     /* our Buffer structure */
     Buffer buffer = {               
@@ -1145,42 +5625,165 @@ int main( int argc, char *argv[] )
         .colorize   = true,
         .charset    = FMT_ASCII,        /* ... plain ASCII           */
         .israw      = false,
-        .unlimfsize = false
+        .unlimfsize = false,
+        .mode       = MODE_VIEW,
+        .strminlen  = STR_MINLEN,
+        .strkinds   = STR_ASCII | STR_UTF16,
+        .entblocklen = ENT_BLOCKLEN,
+        .showentropy = false,
+        .rawkeys    = true,
+        .membudget  = (size_t) VIEW_BUDGET * 1024 * 1024,
+        .nthreads   = hv_ncpus()
     };
 
+    /* parse the command line */
+    if ( !parse_cmdline( argc, argv, tmpfname, &settings ) ) {
+        fprintf( stderr, "usage: %s [-strings[=n]] [-ascii] [-entropy[=n]]"
+            " [-hash[=algs]] [-loadhash=algs] [-compare=file2] [-delta=file2] [-lines]"
+            " [-batch[=script]] [-e=command]... [-stats] [-trace=file]"
+            " [-record=file | -replay=file] [-budget=mb] [-serve=socket | -connect=socket]"
+            " [-extract=start,end:file] [-carve[=dir]] [-find=bytes] [-direct]"
+            " [-dump] [-json] [-count] [-threads=n] [-period[=n]] [-ngrams[=n]]"
+            " [filename... | pid:N]\n", argv[0] );
+        exit( EXIT_FAILURE );
+    }
+
+    /* record the session, or replay one (to a null terminal) */
+    if ( settings.recordfname || settings.replayfname ) {
+        if ( settings.recordfname ? !session_record( &session, settings.recordfname )
+                                  : !session_replay( &session, settings.replayfname )
+        ) {
+            perror( settings.recordfname ? settings.recordfname : settings.replayfname );
+            exit( EXIT_FAILURE );
+        }
+        settings.session = &session;
+    }
+
+    /* timings (of the terminal output too, if viewing; replays time it all) */
+    if ( settings.stats || settings.replayfname ) {
+        if ( !stats_init( settings.tracefname, MODE_VIEW == settings.mode ) ) {
+            perror( settings.tracefname );
+            exit( EXIT_FAILURE );
+        }
+        if ( settings.stats )
+            atexit( stats_atexit );
+    }
+
+    /* serve files to viewers (of -connect), until stopped */
+    if ( MODE_SERVE == settings.mode ) {
+        if ( !server_run( settings.sockname, hv_ncpus() ) ) {
+            perror( settings.sockname );
+            exit( EXIT_FAILURE );
+        }
+        exit( EXIT_SUCCESS );
+    }
+
+    /* scans past the page cache: nothing mapped */
+    if ( settings.direct ) {
+        STATS_BEGIN( span );
+        success = direct_report( tmpfname, &settings );
+        STATS_END( span, STATS_LOAD );
+        if ( !success )
+            perror( tmpfname );
+        exit( success ? EXIT_SUCCESS : EXIT_FAILURE );
+    }
+
+    /* dumps & searches of files (not of processes): on a pool of threads */
+    if ( MODE_DUMP == settings.mode
+        || (MODE_FIND == settings.mode && strncmp( tmpfname, "pid:", 4 ))
+    ) {
+        STATS_BEGIN( span );
+        success = multi_report( &settings );
+        STATS_END( span, STATS_LOAD );
+        if ( !success && errno )
+            perror( tmpfname );
+        exit( success ? EXIT_SUCCESS : EXIT_FAILURE );
+    }
+
+    /* non-interactive modes: no colors, no prompts */
+    if ( MODE_VIEW != settings.mode )
+    {
+        STATS_BEGIN( span );
+        success = buffer_map_file( &buffer, tmpfname,
+                MODE_BATCH == settings.mode ? settings.loadhash : settings.hashmask );
+        STATS_END( span, STATS_LOAD );
+        success = success
+            && ( MODE_STRINGS == settings.mode ? strings_report( &buffer, &settings )
+                : MODE_BATCH == settings.mode ? batch_run( &buffer, &settings )
+                : MODE_HASH == settings.mode ? hash_report( &buffer, &settings )
+                : MODE_EXTRACT == settings.mode ? extract_report( &buffer, &settings )
+                : MODE_CARVE == settings.mode ? carve_report( &buffer, &settings )
+                : MODE_FIND == settings.mode ? find_report( &buffer, &settings )
+                : MODE_PERIOD == settings.mode ? period_report( &buffer, &settings )
+                : MODE_NGRAMS == settings.mode ? ngram_report( &buffer, &settings )
+                : MODE_DELTA == settings.mode ? buffer_compare( &buffer, settings.cmpfname )
+                                                && delta_report( &buffer )
+                : entropy_report( &buffer, &settings ) );
+        if ( !success )
+            perror( tmpfname );
+        buffer_cleanup( &buffer );
+        free( settings.batchcmds );
+        exit( success ? EXIT_SUCCESS : EXIT_FAILURE );
+    }
+
     CONOUT_INIT();
     CONOUT_SET_COLOR( FGCLR_NORMAL );       /* set console fg color      */
 
-    /* parse the command line */
-    if ( 1 == argc )                /* no command line arguments */
-        strncpy(tmpfname, argv[0], MAXINPUT-1 );
-    else
-        strncpy(tmpfname, argv[1], MAXINPUT-1 );
+    /* view the file as served on a socket: nothing to load */
+    if ( settings.sockname ) {
+        if ( settings.rawkeys && keys_init() )
+            keys_raw( true );
+        success = remote_view( tmpfname, &settings );
+        keys_raw( false );
+        if ( !success ) {
+            perror( settings.sockname );
+            goto exit_failure;
+        }
+        if ( settings.session )
+            session_close( settings.session );
+        CONOUT_RESTORE();
+        exit( EXIT_SUCCESS );
+    }
 
-    /* read the file into the buffer */
+    /* map (or read) the file into the buffer: it may be huge */
+    STATS_BEGIN( span );
     success = (settings.unlimfsize) 
-        ? buffer_read_file( &buffer, tmpfname, 100*1024*1024 )
-        : buffer_read_file_longmax( &buffer, tmpfname );
+        ? buffer_read_file( &buffer, tmpfname, 100*1024*1024, settings.loadhash )
+        : buffer_map_file( &buffer, tmpfname, settings.loadhash );
+    STATS_END( span, STATS_LOAD );
     if ( !success ) {
         perror(NULL);
         goto exit_failure;
     }
+    if ( settings.cmpfname && !buffer_compare( &buffer, settings.cmpfname ) ) {
+        perror( settings.cmpfname );
+        goto exit_failure;
+    }
 
-    /* list the file contents */
-    if ( !view_buffer( &buffer, &settings ) ) {
+    /* list the file contents (reading keys unbuffered, on terminals) */
+    if ( settings.rawkeys && keys_init() )
+        keys_raw( true );
+    success = view_buffer( &buffer, &settings );
+    keys_raw( false );
+    if ( !success ) {
         perror(NULL);
         goto exit_failure;
     }
 
+    if ( settings.session )
+        session_close( settings.session );
     buffer_cleanup( &buffer );
 
     CONOUT_RESTORE();
     exit( EXIT_SUCCESS );
 
 exit_failure:
+    if ( settings.session )
+        session_close( settings.session );
     buffer_cleanup( &buffer );
 
     CONOUT_RESTORE();
     pressENTER();
     exit( EXIT_FAILURE );
 }
+#endif
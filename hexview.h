@@ -3,6 +3,11 @@
 
 #include <errno.h>
 
+#if defined(__linux__) || defined(__unix__) || defined(__unix)            \
+|| defined(__CYGWIN__) || defined(__GNU__) || defined(__APPLE__)
+    #define HV_POSIX                /* mmap, threads & friends available */
+#endif
+
 /* -----------------------------------
  * Program specific Constants & Macros
  * -----------------------------------
@@ -21,39 +26,50 @@ enum FmtCharSet { FMT_ASCII, FMT_XASCII };    /* plain or extended ASCII char se
     ( (cs) == FMT_ASCII ? "ASCII" : (cs) == FMT_XASCII ? "xASCII" : "Unknown" )
 #define FNAME_SHOWLEN        11        /* len of truncated fnames ( w/o '\0')*/
 #define FMT_GRPCOLS        4        /* # of bytes to group columns by     */
-#define FMT_OFST        8        /* offset column-width, in chars      */
+#define FMT_OFST        8        /* min offset column-width, in chars  */
 #define FMT_NCOLS        16        /* max # of bytes in a row (up to 16) */
 #define FMT_PGLINES        21        /* page length, in rows               */
+#define FMT_PANELCOLS        64        /* max # of chars per panel item text */
+
+/*
+ * The row/page macros clamp to the last row/page before multiplying,
+ * so they never overflow (that of the last one fits, as the file
+ * does), and are 0 when there are no rows/pages at all.
+ */
 
 /* calculate index of the FIRST byte in a given row */
 #define ROW2BT( row, nrows )                        \
 (                                    \
-    (row) > (nrows-1)                        \
-    ? ( (nrows-1) * FMT_NCOLS )                    \
+    0 == (nrows) ? 0                        \
+    : (row) > (nrows) - 1                        \
+    ? ( ((nrows) - 1) * FMT_NCOLS )                    \
     : (row) > 0 ? ( (row) * FMT_NCOLS ) : 0                \
 )
 
 /* calculate the page a given row lyes in */
 #define ROW2PG(row, nrows)                        \
 (                                    \
-    (row) > (nrows-1)                        \
-    ? ( (nrows-1) / FMT_PGLINES )                    \
+    0 == (nrows) ? 0                        \
+    : (row) > (nrows) - 1                        \
+    ? ( ((nrows) - 1) / FMT_PGLINES )                \
     : (row) > 0 ? ( (row) / FMT_PGLINES ) : 0            \
 )
 
 /* calculate the row a given byte lyes in */
 #define BT2ROW(bt, nbytes, nrows)                    \
 (                                    \
-    (bt) > (nbytes) - 1                        \
-    ? (nrows-1)                            \
+    0 == (nbytes) || 0 == (nrows) ? 0                \
+    : (bt) > (nbytes) - 1                        \
+    ? ((nrows) - 1)                            \
     : (bt) > 0 ? (bt) / FMT_NCOLS : 0                \
 )
 
 /* calculate the starting row of a given page */
 #define PG2ROW(pg, npages)                        \
 (                                    \
-    (pg) > (npages-1)                        \
-    ? ( (npages-1) * FMT_PGLINES )                    \
+    0 == (npages) ? 0                        \
+    : (pg) > (npages) - 1                        \
+    ? ( ((npages) - 1) * FMT_PGLINES )                \
     : (pg) > 0 ? ( (pg) * FMT_PGLINES ) : 0                \
 )
 
@@ -76,6 +92,7 @@ enum FmtCharSet { FMT_ASCII, FMT_XASCII };    /* plain or extended ASCII char se
     #define FGCLR_BYTPRT0    FG_DARKYELLOW        /* non-printable bytes fg-colr*/
     #define FGCLR_BYTZERO    FG_DARKGRAY        /* zeroed bytes fg-color      */
     #define FGCLR_BYTCURR    FG_MAGENTA        /* current byte fg-color      */
+    #define BGCLR_BYTDIFF    BG_DARKRED        /* bytes differing from the compared file */
 
     #define BGCLR_PMTFNAME    BG_NOCHANGE        /* filename bg-color in prompt*/
     #define FGCLR_PMTFNAME    FG_YELLOW        /* filename fg-color in prompt*/
@@ -96,6 +113,14 @@ enum FmtCharSet { FMT_ASCII, FMT_XASCII };    /* plain or extended ASCII char se
     #define FGCLR_PMTBIN    FG_WHITE        /* bin val fg-color in prompt */
     #define BGCLR_PMTPRVCMD    BG_NOCHANGE        /* prev cmd bg-color in prompt*/
     #define FGCLR_PMTPRVCMD    FG_WHITE        /* prev cmd fg-color in prompt*/
+    #define BGCLR_PMTENT    BG_DARKBLUE        /* entropy bg-color in prompt */
+    #define FGCLR_PMTENT    FG_WHITE        /* entropy fg-color in prompt */
+
+    #define FGCLR_ENTZERO    FG_DARKGRAY        /* zeroed blocks in entropy strip*/
+    #define FGCLR_ENTTEXT    FG_GREEN        /* text blocks in entropy strip  */
+    #define FGCLR_ENTLOW    FG_DARKCYAN        /* low entropy blocks            */
+    #define FGCLR_ENTMID    FG_YELLOW        /* medium entropy blocks         */
+    #define FGCLR_ENTHIGH    FG_RED            /* high entropy blocks           */
 
 #if 1
     #define FGCLR_EM1    FG_WHITE    /* 1st emphasised fg color on dark bg */
@@ -108,6 +133,16 @@ enum FmtCharSet { FMT_ASCII, FMT_XASCII };    /* plain or extended ASCII char se
 #endif
 #endif
 
+/* fg color of an entropy class (see enum EntClass in entropy.h) */
+#define FGCLR_ENTCLASS(c)                        \
+(                                    \
+    (c) == 0 ? FGCLR_ENTZERO : (c) == 1 ? FGCLR_ENTTEXT        \
+    : (c) == 2 ? FGCLR_ENTLOW : (c) == 3 ? FGCLR_ENTMID : FGCLR_ENTHIGH    \
+)
+
+/* bg color of a byte, depending on whether it differs from the compared file */
+#define BGCLR_DIFF(differs)    ( (differs) ? BGCLR_BYTDIFF : BG_NOCHANGE )
+
 #define colorPRINTF( colorize, fg, bg, ... )                \
 do {                                    \
     if ( (colorize) )                        \
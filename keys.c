@@ -0,0 +1,202 @@
+/*****************************************************//**
+ * @brief   Single keystroke input, from terminals in raw mode.
+ * @file    keys.c
+ * @par Language:
+ *      C (ANSI C99) + POSIX termios (nothing is done without it)
+ *
+ * @remark  In raw mode the terminal neither waits for ENTER nor echoes,
+ *      so every key is read as soon as it is pressed. The escape
+ *      sequences of arrows, PgUp/PgDn & Home/End are decoded into
+ *      codes of their own (a lone ESC is told apart by waiting a bit
+ *      for the rest of its sequence). stdin is made unbuffered, so
+ *      stdio never holds keys behind the back of keys_pending().
+ *      The terminal is restored on exit, and on fatal signals.
+ *********************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <signal.h>
+
+#include "hexview.h"
+#include "keys.h"
+
+#ifdef HV_POSIX
+#include <unistd.h>
+#include <termios.h>
+#include <poll.h>
+
+static struct termios orig;            /* the terminal as we found it */
+#endif
+
+static _Bool inited = false, israw = false;
+static int   pushed = KEYS_EOF;            /* a key read ahead (if any) */
+
+#ifdef HV_POSIX
+/*********************************************************//**
+ * Restore the terminal (at exit, or on a fatal signal).
+ *************************************************************
+ */
+static void keys_restore( void )
+{
+    if ( israw )
+        tcsetattr( STDIN_FILENO, TCSAFLUSH, &orig );
+    israw = false;
+    return;
+}
+
+static void keys_onsignal( int sig )
+{
+    keys_restore();
+    signal( sig, SIG_DFL );
+    raise( sig );
+    return;
+}
+
+/*********************************************************//**
+ * Return the next byte of input, or KEYS_EOF if there is none (if
+ * wait >= 0, none within wait ms).
+ *************************************************************
+ */
+static int keys_byte( int wait )
+{
+    unsigned char c;
+    struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+
+    if ( wait >= 0 && poll( &pfd, 1, wait ) <= 0 )
+        return KEYS_EOF;
+    return 1 == read( STDIN_FILENO, &c, 1 ) ? (int) c : KEYS_EOF;
+}
+#endif
+
+/*********************************************************//**
+ * Get ready to switch stdin to raw mode. Return false if it is not
+ * a terminal (or there is no termios).
+ *************************************************************
+ */
+_Bool keys_init( void )
+{
+#ifdef HV_POSIX
+    if ( inited )
+        return true;
+    if ( !isatty( STDIN_FILENO ) || 0 != tcgetattr( STDIN_FILENO, &orig ) )
+        return false;
+
+    setvbuf( stdin, NULL, _IONBF, 0 );
+    atexit( keys_restore );
+    signal( SIGTERM, keys_onsignal );
+    signal( SIGHUP, keys_onsignal );
+    signal( SIGINT, keys_onsignal );
+    inited = true;
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+/*********************************************************//**
+ * Switch stdin to raw mode (no waiting for ENTER, no echo), or back
+ * to the mode it was found in.
+ *************************************************************
+ */
+void keys_raw( _Bool raw )
+{
+#ifdef HV_POSIX
+    struct termios t;
+
+    if ( !inited || raw == israw )
+        return;
+    if ( raw ) {
+        t = orig;
+        t.c_lflag &= ~(ICANON | ECHO);        /* ENTER still reads as '\n' */
+        t.c_cc[VMIN]  = 1;
+        t.c_cc[VTIME] = 0;
+        israw = (0 == tcsetattr( STDIN_FILENO, TCSANOW, &t ));
+    }
+    else {
+        tcsetattr( STDIN_FILENO, TCSANOW, &orig );
+        israw = false;
+    }
+#else
+    (void) raw;
+#endif
+    return;
+}
+
+_Bool keys_israw( void )
+{
+    return israw;
+}
+
+/*********************************************************//**
+ * Read a key (waiting for it): a char, or one of enum KeysCode.
+ *************************************************************
+ */
+int keys_read( void )
+{
+#ifdef HV_POSIX
+    int c, arg = 0;
+
+    if ( KEYS_EOF != pushed ) {
+        c = pushed;
+        pushed = KEYS_EOF;
+        return c;
+    }
+
+    if ( 0x1B != (c = keys_byte( -1 )) )
+        return c;
+
+    /* ESC [ or ESC O, then an optional number, then the final char */
+    if ( KEYS_EOF == (c = keys_byte( KEYS_ESCWAIT )) )
+        return 0x1B;
+    if ( '[' != c && 'O' != c )
+        return c;
+    while ( KEYS_EOF != (c = keys_byte( KEYS_ESCWAIT )) && c >= '0' && c <= '9' )
+        arg = 10 * arg + (c - '0');
+
+    switch ( c ) {
+    case 'A': return KEYS_UP;
+    case 'B': return KEYS_DOWN;
+    case 'C': return KEYS_RIGHT;
+    case 'D': return KEYS_LEFT;
+    case 'H': return KEYS_HOME;
+    case 'F': return KEYS_END;
+    case '~':
+        switch ( arg ) {
+        case 1: case 7: return KEYS_HOME;
+        case 4: case 8: return KEYS_END;
+        case 5: return KEYS_PGUP;
+        case 6: return KEYS_PGDN;
+        }
+    }
+    return 0x1B;                /* not one we know: just ESC */
+#else
+    return getchar();
+#endif
+}
+
+/*********************************************************//**
+ * Return true if a key can be read without waiting.
+ *************************************************************
+ */
+_Bool keys_pending( void )
+{
+#ifdef HV_POSIX
+    struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+    return KEYS_EOF != pushed || poll( &pfd, 1, 0 ) > 0;
+#else
+    return KEYS_EOF != pushed;
+#endif
+}
+
+/*********************************************************//**
+ * Put back a key, to be read again by keys_read() (only one).
+ *************************************************************
+ */
+void keys_unread( int key )
+{
+    pushed = key;
+    return;
+}
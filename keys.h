@@ -0,0 +1,30 @@
+#ifndef KEYS_H                    /* start of inclusion guard */
+#define KEYS_H
+
+/* -----------------------------------
+ * Single keystroke input (terminals in raw mode)
+ * -----------------------------------
+ */
+
+#define KEYS_ESCWAIT        30        /* ms to wait for the rest of an ESC sequence */
+
+enum KeysCode {
+    KEYS_EOF    = -1,            /* no more input                      */
+    KEYS_UP     = 0x100,            /* codes past those of chars          */
+    KEYS_DOWN,
+    KEYS_LEFT,
+    KEYS_RIGHT,
+    KEYS_PGUP,
+    KEYS_PGDN,
+    KEYS_HOME,
+    KEYS_END
+};
+
+_Bool   keys_init( void );
+void    keys_raw( _Bool raw );
+_Bool   keys_israw( void );
+int     keys_read( void );
+_Bool   keys_pending( void );
+void    keys_unread( int key );
+
+#endif                        /* end of inclusion guard            */
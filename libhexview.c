@@ -0,0 +1,830 @@
+/*****************************************************//**
+ * @brief   libhexview: the engine of the viewer, as a C library.
+ * @file    libhexview.c
+ * @par Language:
+ *      C (ANSI C99) (+ POSIX mmap, where available)
+ *
+ * @remark  Built both as a static (libhexview.a) & a shared library
+ *      (libhexview.so) of this file, bulk.c & hash.c, and linked into
+ *      the viewer itself (see libhexview.h for the API). Files are
+ *      mapped read-only, so their bytes are handed out in place; only
+ *      those that cannot be mapped (pipes, char devices) are read into
+ *      memory. Rows are formatted with table lookups, with no stdio
+ *      calls, exactly as the viewer shows them uncolored.
+ *      \n
+ *      Mappings are advised of how they are read: at random while the
+ *      caller navigates (MADV_RANDOM: no readahead past the page shown),
+ *      and sequentially by a scan (see hv_scan_begin()), which has the
+ *      window ahead of it read in advance & the pages behind it given
+ *      back (those it brought into the page cache too: the cache is
+ *      left as the scan found it). Files of 2 Mb or more are mapped at
+ *      an address aligned to 2 Mb & advised MADV_HUGEPAGE, so where the
+ *      kernel & the filesystem can map them by huge pages (transparent
+ *      huge pages of the page cache) they take fewer TLB entries.
+ *********************************************************
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE                /* copy_file_range */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hexview.h"
+#include "libhexview.h"
+#include "bulk.h"
+#include "hash.h"
+
+#ifdef HV_POSIX
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <limits.h>
+#endif
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
+
+#if HV_NCOLS != FMT_NCOLS || HV_PGLINES != FMT_PGLINES
+#error "libhexview.h must agree with the row & page lengths of hexview.h"
+#endif
+
+#define HV_READLEN    (1024*1024)        /* bytes read at a time, if not mapped */
+#define HV_HUGELEN    (2*1024*1024)        /* length (& alignment) of a huge page */
+#define HV_SCANMIN    (8*1024*1024)        /* min bytes of a scan to be advised  */
+#define HV_SCANWINDOW    (8*1024*1024)        /* bytes read ahead of (& given back behind) a scan */
+
+struct HvFile {
+    unsigned char *data;        /* the bytes of the file ...          */
+    size_t  len;            /* ... & their #                      */
+    _Bool   ismapped;        /* data is mmap'ed rather than read   */
+    int     fd;            /* the file, if mapped (else -1)      */
+    unsigned advice;        /* HV_ADVISE_ flags                   */
+};
+
+typedef struct HvScanState {        /* what an HvScan holds (see hv_scan_begin()) */
+    const HvFile *hv;            /* the file (NULL: not advised)       */
+    size_t      start, end;        /* its range (start on a page) ...    */
+    size_t      from, to;        /* ... on huge pages, as noted        */
+    size_t      window;            /* the window it is in (or -1)        */
+    size_t      wfirst, wlast;        /* the windows noted ...              */
+    _Bool       noted;            /* ... if any                         */
+    _Bool       backward;        /* going from to to from?             */
+    unsigned char *cached;        /* 1 byte per page: cached before?    */
+} HvScanState;
+
+/* an HvScan must be room enough for it */
+typedef char HvScanFits[ sizeof(HvScanState) <= sizeof(HvScan) ? 1 : -1 ];
+
+/*********************************************************//**
+ * Return the version of the library.
+ *************************************************************
+ */
+const char *hv_version( void )
+{
+    return NAME_VERSION;
+}
+
+/*********************************************************//**
+ * Return the # of online processors (at least 1).
+ *************************************************************
+ */
+unsigned hv_ncpus( void )
+{
+#ifdef HV_POSIX
+    long n = sysconf( _SC_NPROCESSORS_ONLN );
+    return n > 0 ? (unsigned) n : 1U;
+#else
+    return 1U;
+#endif
+}
+
+#ifdef HV_POSIX
+/*********************************************************//**
+ * Return the size in bytes of the file open as fd, or -1 on error.
+ * Block devices report no size to fstat(), so they are seeked to
+ * their end instead. Pipes, char devices ... have no size (their 0
+ * is not one): -1, with errno ESPIPE.
+ *************************************************************
+ */
+static off_t fd_size( int fd )
+{
+    struct stat st;
+
+    if ( -1 == fstat(fd, &st) )
+        return -1;
+    if ( S_ISBLK(st.st_mode) )
+        return lseek( fd, 0, SEEK_END );
+    if ( !S_ISREG(st.st_mode) ) {
+        errno = ESPIPE;
+        return -1;
+    }
+    return st.st_size;
+}
+#endif
+
+/*********************************************************//**
+ * Return the size of a file in bytes, or -1 on error (64-bit even on
+ * 32-bit systems, where available): ESPIPE if it has none (a pipe, a
+ * char device ...), so it must be read to its end to be sized.
+ *************************************************************
+ */
+long long hv_filesize( const char *fname )
+{
+#ifdef HV_POSIX
+    long long size;
+    int      fd;
+
+    if ( -1 == (fd = open(fname, O_RDONLY)) )
+        return -1;
+    size = fd_size( fd );
+    close( fd );
+
+    return size;
+#else
+    long int size;
+    FILE     *fp;
+
+    if ( NULL == (fp = fopen(fname, "rb")) )    /* binary mode */
+        return -1;
+
+    if( fseek(fp, 0, SEEK_END) ) {
+        fclose(fp);
+        return -1;
+    }
+
+    size = ftell(fp);
+    fclose(fp);
+
+    return size;
+#endif
+}
+
+/*********************************************************//**
+ * Return the width of the offset column for nbytes of data: FMT_OFST
+ * hex digits, or as many as the last offset needs.
+ *************************************************************
+ */
+int hv_ofst_width( unsigned long long nbytes )
+{
+    int width = 1;
+
+    for (nbytes = nbytes > 0 ? nbytes - 1 : 0; nbytes >>= 4; )
+        width++;
+    return myMAX( width, FMT_OFST );
+}
+
+/*********************************************************//**
+ * Read all of the stream fp into hv (whatever its size).
+ *************************************************************
+ */
+static _Bool hv_readall( HvFile *hv, FILE *fp )
+{
+    size_t  cap = HV_READLEN, got;
+    unsigned char *try;
+
+    if ( NULL == (hv->data = malloc( cap + 1 )) )
+        return false;
+    while ( 0 < (got = fread( &hv->data[hv->len], 1, cap - hv->len, fp )) ) {
+        if ( (hv->len += got) < cap )
+            continue;
+        if ( cap > SIZE_MAX / 2 - 1 ) {
+            errno = EFBIG;            /* cannot be addressed       */
+            return false;
+        }
+        if ( NULL == (try = realloc( hv->data, 2 * cap + 1 )) )
+            return false;
+        hv->data = try;
+        cap *= 2;
+    }
+    if ( ferror( fp ) )
+        return false;
+    hv->data[ hv->len ] = '\0';
+
+    return true;
+}
+
+#ifdef HV_POSIX
+/*********************************************************//**
+ * Map len bytes of the file fd read-only: at an address aligned to
+ * HV_HUGELEN if that long (so that huge pages may map it), by mapping
+ * it over a reservation that long more, whose ends are then unmapped.
+ *************************************************************
+ */
+static void *hv_map( int fd, size_t len )
+{
+    unsigned char *resv, *at;
+    size_t  lead;
+
+    if ( len < HV_HUGELEN || len > SIZE_MAX - HV_HUGELEN )
+        return mmap( NULL, len, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+    resv = mmap( NULL, len + HV_HUGELEN, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+    if ( MAP_FAILED == resv )
+        return mmap( NULL, len, PROT_READ, MAP_PRIVATE, fd, 0 );
+    lead = (HV_HUGELEN - (size_t) ((uintptr_t) resv % HV_HUGELEN)) % HV_HUGELEN;
+    at   = mmap( resv + lead, len, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0 );
+    if ( MAP_FAILED == at ) {
+        munmap( resv, len + HV_HUGELEN );
+        return MAP_FAILED;
+    }
+    if ( lead > 0 )
+        munmap( resv, lead );
+    munmap( at + len, HV_HUGELEN - lead );
+
+    return at;
+}
+#endif
+
+/*********************************************************//**
+ * Open the file fname: mapped, or (unless maponly) read in memory if
+ * it cannot be mapped. Return NULL on error (or if not mappable).
+ *************************************************************
+ */
+HvFile *hv_open( const char *fname, _Bool maponly )
+{
+    HvFile  *hv;
+    FILE    *fp;
+
+    if ( !fname || '\0' == *fname ) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if ( NULL == (hv = calloc( 1, sizeof(HvFile) )) )
+        return NULL;
+    hv->fd = -1;
+
+#ifdef HV_POSIX
+    {
+        off_t size;
+        void  *data;
+        int   fd;
+
+        if ( -1 == (fd = open(fname, O_RDONLY)) )
+            goto ret_failure;
+        if ( (size = fd_size( fd )) > 0 ) {        /* not pipes, char devices ... */
+            if ( (unsigned long long) size >= SIZE_MAX ) {
+                close( fd );
+                errno = EFBIG;            /* cannot be addressed       */
+                goto ret_failure;
+            }
+            data = hv_map( fd, (size_t) size );
+            if ( MAP_FAILED != data ) {
+                hv->data     = data;
+                hv->len      = (size_t) size;
+                hv->ismapped = true;
+                hv->fd       = fd;            /* kept, for hv_extract()    */
+                fcntl( fd, F_SETFD, FD_CLOEXEC );
+                hv_advise( hv, HV_ADVISE_PATTERN | HV_ADVISE_HUGE );
+                return hv;
+            }
+            close( fd );
+        }
+        else
+            close( fd );
+    }
+#endif
+    if ( maponly ) {
+        errno = ENOTSUP;
+        goto ret_failure;
+    }
+
+    if ( NULL == (fp = fopen( fname, "rb" )) )
+        goto ret_failure;
+    if ( !hv_readall( hv, fp ) ) {
+        fclose( fp );
+        goto ret_failure;
+    }
+    fclose( fp );
+
+    return hv;
+
+ret_failure:
+    hv_close( hv );
+    return NULL;
+}
+
+/*********************************************************//**
+ * Close hv (its data are no longer valid).
+ *************************************************************
+ */
+void hv_close( HvFile *hv )
+{
+    const int err = errno;
+
+    if ( !hv )
+        return;
+#ifdef HV_POSIX
+    if ( -1 != hv->fd )
+        close( hv->fd );
+    if ( hv->ismapped )
+        munmap( hv->data, hv->len );
+    else
+#endif
+        free( hv->data );
+    free( hv );
+    errno = err;                /* keep that of a failed open */
+
+    return;
+}
+
+/*********************************************************//**
+ * Return the bytes of hv, in place (hv_size() of them).
+ *************************************************************
+ */
+const unsigned char *hv_data( const HvFile *hv )
+{
+    return hv->data;
+}
+
+size_t hv_size( const HvFile *hv )
+{
+    return hv->len;
+}
+
+/*********************************************************//**
+ * Copy up to n bytes of hv at off into dst. Return the # copied.
+ *************************************************************
+ */
+size_t hv_read( const HvFile *hv, size_t off, void *dst, size_t n )
+{
+    if ( off >= hv->len )
+        return 0;
+    n = myMIN( n, hv->len - off );
+    memcpy( dst, &hv->data[off], n );
+    return n;
+}
+
+/*********************************************************//**
+ * Release the pages of hv held in memory, if mapped (they are paged
+ * in again, from the OS cache, when read). The data stay valid.
+ *************************************************************
+ */
+void hv_release( const HvFile *hv )
+{
+#ifdef HV_POSIX
+    if ( hv->ismapped && hv->len > 0 )
+        madvise( hv->data, hv->len, MADV_DONTNEED );
+#else
+    (void) hv;
+#endif
+    return;
+}
+
+/*********************************************************//**
+ * Advise the mapping of hv (if mapped) as the HV_ADVISE_ flags say:
+ * read at random if at least HV_SCANMIN bytes (else as the kernel
+ * sees fit), and by huge pages. Files are opened advised both ways.
+ *************************************************************
+ */
+void hv_advise( HvFile *hv, unsigned flags )
+{
+    hv->advice = flags;
+#ifdef HV_POSIX
+    if ( !hv->ismapped || 0 == hv->len )
+        return;
+    madvise( hv->data, hv->len,            /* (the scans of smaller ones are not) */
+        (flags & HV_ADVISE_PATTERN) && hv->len >= HV_SCANMIN ? MADV_RANDOM : MADV_NORMAL );
+#if defined(MADV_HUGEPAGE)
+    if ( hv->len >= HV_HUGELEN )
+        madvise( hv->data, hv->len, (flags & HV_ADVISE_HUGE) ? MADV_HUGEPAGE : MADV_NOHUGEPAGE );
+#endif
+#endif
+    return;
+}
+
+#ifdef HV_POSIX
+/*********************************************************//**
+ * Note which pages of the windows [w,last] of the scan s (as far as
+ * its range goes) are cached, unless noted already: before they are
+ * read. The windows noted are kept in a row (those skipped are noted
+ * as they are now).
+ *************************************************************
+ */
+static void hv_scan_note( HvScanState *s, size_t w, size_t last )
+{
+    const size_t pg = (size_t) sysconf( _SC_PAGESIZE );
+    size_t  from, to;
+
+    if ( s->noted && w >= s->wfirst )        /* in a row (what was skipped, now) */
+        w = myMAX( w, s->wlast + 1 );
+    else if ( s->noted )
+        last = s->wfirst - 1;
+    if ( w > last )
+        return;
+    from = myMAX( w * HV_SCANWINDOW, s->from );
+    to   = last >= s->to / HV_SCANWINDOW ? s->to : myMIN( (last + 1) * HV_SCANWINDOW, s->to );
+    if ( from >= to )
+        return;
+    if ( 0 != mincore( &s->hv->data[from], to - from, &s->cached[(from - s->from) / pg] ) )
+        memset( &s->cached[(from - s->from) / pg], 1, (to - from + pg - 1) / pg );    /* keep them */
+
+    s->wfirst = s->noted ? myMIN( s->wfirst, w ) : w;
+    s->wlast  = s->noted ? myMAX( s->wlast, last ) : last;
+    s->noted  = true;
+    return;
+}
+
+/*********************************************************//**
+ * Give back the pages of [from,to) of the mapping scanned by s (in
+ * the windows it noted), and drop from the page cache those that
+ * were not cached before.
+ *************************************************************
+ */
+static void hv_scan_drop( HvScanState *s, size_t from, size_t to )
+{
+    const size_t pg = (size_t) sysconf( _SC_PAGESIZE );
+    size_t  p, q;
+
+    if ( !s->noted )
+        return;
+    from = myMAX( from, myMAX( s->wfirst * HV_SCANWINDOW, s->from ) );
+    to   = myMIN( to, myMIN( (s->wlast + 1) * HV_SCANWINDOW, s->to ) );
+    if ( from >= to )
+        return;
+    madvise( &s->hv->data[from], to - from, MADV_DONTNEED );
+
+    /* in runs of pages not cached before */
+    for (p = (from - s->from) / pg; s->from + p * pg < to; p = q)
+    {
+        for (; s->from + p * pg < to && (s->cached[p] & 1); p++)
+            ;
+        for (q = p; s->from + q * pg < to && !(s->cached[q] & 1); q++)
+            ;
+        if ( q > p )
+            posix_fadvise( s->hv->fd, (off_t) (s->from + p * pg), (off_t) ((q - p) * pg),
+                           POSIX_FADV_DONTNEED );
+    }
+    return;
+}
+
+/*********************************************************//**
+ * Have the window w of the scan s (if any of it is in its range) read
+ * ahead, noting it first.
+ *************************************************************
+ */
+static void hv_scan_window( HvScanState *s, size_t w )
+{
+    const size_t from = myMAX( w * HV_SCANWINDOW, s->start );
+    const size_t to   = myMIN( (w + 1) * HV_SCANWINDOW, s->end );
+
+    hv_scan_note( s, w, w );
+    if ( from < to ) {
+        madvise( &s->hv->data[from], to - from, MADV_WILLNEED );
+    }
+    return;
+}
+#endif
+
+/*********************************************************//**
+ * Start scanning the bytes [from,to) of hv, if mapped, advised, and
+ * long enough to bother (else s does nothing): advise them read
+ * sequentially. Tell where the scan is by hv_scan_at(), and that it
+ * is over by hv_scan_end(). What is given back spans the huge pages
+ * the scan is in (of the page cache: given back whole, or not at all).
+ *************************************************************
+ */
+void hv_scan_begin( HvScan *scan, const HvFile *hv, size_t from, size_t to )
+{
+    memset( scan, 0, sizeof(HvScan) );
+#ifdef HV_POSIX
+    {
+        HvScanState *s = (HvScanState *) (void *) scan;
+        const size_t pg = (size_t) sysconf( _SC_PAGESIZE );
+
+        to = hv ? myMIN( to, hv->len ) : 0;
+        if ( !hv || !hv->ismapped || !(hv->advice & HV_ADVISE_PATTERN) || from >= to
+            || to - from < HV_SCANMIN
+        )
+            return;
+        s->start = from / pg * pg;
+        s->end   = to;
+        s->from  = from / HV_HUGELEN * HV_HUGELEN;
+        s->to    = to > hv->len - HV_HUGELEN ? hv->len : (to + HV_HUGELEN - 1) / HV_HUGELEN * HV_HUGELEN;
+        if ( NULL == (s->cached = malloc( (s->to - s->from + pg - 1) / pg )) )
+            return;
+        s->hv     = hv;
+        s->window = HV_NOTFOUND;
+        madvise( &hv->data[s->start], s->end - s->start, MADV_SEQUENTIAL );
+    }
+#else
+    (void) hv;
+    (void) from;
+    (void) to;
+#endif
+    return;
+}
+
+/*********************************************************//**
+ * The scan s has got to off. Once in a window of its own, have the
+ * next window (in the direction it goes: forward, unless it starts
+ * in its last one) read ahead, and give back the one it left. An off
+ * of HV_NOTFOUND tells that it reads its range at once (in parallel,
+ * say), to be given back by hv_scan_end().
+ *************************************************************
+ */
+void hv_scan_at( HvScan *scan, size_t off )
+{
+#ifdef HV_POSIX
+    HvScanState *s = (HvScanState *) (void *) scan;
+    size_t  w;
+
+    if ( !s->hv )
+        return;
+    if ( HV_NOTFOUND == off ) {
+        hv_scan_note( s, s->from / HV_SCANWINDOW, (s->to - 1) / HV_SCANWINDOW );
+        return;
+    }
+    if ( (w = off / HV_SCANWINDOW) == s->window )
+        return;
+
+    if ( HV_NOTFOUND == s->window ) {        /* the 1st one: which way? */
+        s->backward = w == (s->end - 1) / HV_SCANWINDOW && w > s->start / HV_SCANWINDOW;
+        if ( s->backward )            /* read ahead by us only */
+            madvise( &s->hv->data[s->start], s->end - s->start, MADV_RANDOM );
+        hv_scan_window( s, w );
+    }
+    else {
+        s->backward = w < s->window;
+        hv_scan_note( s, w, w );
+        hv_scan_drop( s, s->window * HV_SCANWINDOW, (s->window + 1) * HV_SCANWINDOW );
+    }
+    if ( !s->backward )
+        hv_scan_window( s, w + 1 );
+    else if ( w > 0 )
+        hv_scan_window( s, w - 1 );
+    s->window = w;
+#else
+    (void) scan;
+    (void) off;
+#endif
+    return;
+}
+
+/*********************************************************//**
+ * The scan s is over: give back what it read or read ahead (see
+ * hv_scan_drop(): but for the pages still being read, which stay
+ * cached), and advise its range read at random again.
+ *************************************************************
+ */
+void hv_scan_end( HvScan *scan )
+{
+#ifdef HV_POSIX
+    HvScanState *s = (HvScanState *) (void *) scan;
+
+    if ( !s->hv )
+        return;
+    hv_scan_drop( s, s->from, s->to );
+    madvise( &s->hv->data[s->start], s->end - s->start, MADV_RANDOM );
+    free( s->cached );
+    s->cached = NULL;
+    s->hv     = NULL;
+#else
+    (void) scan;
+#endif
+    return;
+}
+
+/*********************************************************//**
+ * Write the n bytes of hv at from into the file fname (created, or
+ * truncated). Mapped files are copied by the kernel, file to file, so
+ * no byte passes through user space (nor is paged into it): with
+ * copy_file_range(), which may even share the blocks on filesystems
+ * that can (reflinks), else sendfile(). Only if neither works (other
+ * systems, or files read in memory) are they written from memory.
+ *************************************************************
+ */
+_Bool hv_extract( const HvFile *hv, size_t from, size_t n, const char *fname )
+{
+    FILE    *fp;
+
+    if ( from > hv->len || n > hv->len - from ) {
+        errno = EINVAL;
+        return false;
+    }
+
+#if defined(__linux__)
+    if ( -1 != hv->fd ) {
+        loff_t  in = (loff_t) from;
+        off_t   off;
+        ssize_t done = 0;
+        _Bool   cfr = true;            /* copy_file_range() works?  */
+        int     out;
+
+        if ( -1 == (out = open( fname, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666 )) )
+            return false;
+        while ( n > 0 ) {
+            if ( cfr ) {
+                done = copy_file_range( hv->fd, &in, out, NULL, myMIN( n, (size_t) SSIZE_MAX ), 0 );
+                if ( done <= 0 ) {            /* e.g. across filesystems  */
+                    cfr = false;
+                    continue;
+                }
+            }
+            else {
+                off  = (off_t) in;
+                done = sendfile( out, hv->fd, &off, myMIN( n, (size_t) 0x7FFFF000 ) );
+                if ( done <= 0 )
+                    break;
+                in = (loff_t) off;
+            }
+            n -= (size_t) done;
+        }
+        /* what the kernel could not copy is written from memory */
+        while ( n > 0 && (done = write( out, &hv->data[in], myMIN( n, (size_t) HV_READLEN ) )) > 0 ) {
+            in += done;
+            n  -= (size_t) done;
+        }
+        return 0 == close( out ) && 0 == n;
+    }
+#endif
+
+    if ( NULL == (fp = fopen( fname, "wb" )) )
+        return false;
+    if ( n != fwrite( &hv->data[from], 1, n, fp ) ) {
+        fclose( fp );
+        return false;
+    }
+    return 0 == fclose( fp );
+}
+
+/*********************************************************//**
+ * Return the # of rows & pages of hv, the row of the byte at off,
+ * and the offset of the 1st byte of a row or page (clamped to the
+ * last one, like the viewer does).
+ *************************************************************
+ */
+size_t hv_nrows( const HvFile *hv )
+{
+    return hv->len / FMT_NCOLS + (hv->len % FMT_NCOLS != 0 ? 1 : 0);
+}
+
+size_t hv_npages( const HvFile *hv )
+{
+    const size_t nrows = hv_nrows( hv );
+    return nrows / FMT_PGLINES + (nrows % FMT_PGLINES != 0 ? 1 : 0);
+}
+
+size_t hv_row_of( const HvFile *hv, size_t off )
+{
+    return BT2ROW( off, hv->len, hv_nrows( hv ) );
+}
+
+size_t hv_row_off( const HvFile *hv, size_t row )
+{
+    return ROW2BT( row, hv_nrows( hv ) );
+}
+
+size_t hv_page_off( const HvFile *hv, size_t page )
+{
+    return ROW2BT( PG2ROW( page, hv_npages( hv ) ), hv_nrows( hv ) );
+}
+
+/*********************************************************//**
+ * Return the offset of the 1st occurrence of pat[0..n) in hv at or
+ * after from, or of the last one at or before from if backward, or
+ * HV_NOTFOUND if there is none.
+ *************************************************************
+ */
+size_t hv_find( const HvFile *hv, size_t from, const void *pat, size_t n, _Bool backward )
+{
+    const unsigned char *p = pat;
+    size_t i;
+
+    HvScan  scan;
+
+    if ( 0 == n || n > hv->len )
+        return HV_NOTFOUND;
+
+    if ( !backward ) {
+        if ( from > hv->len - n )
+            return HV_NOTFOUND;
+        hv_scan_begin( &scan, hv, from, hv->len );
+        for (i = from; i <= hv->len - n; i += HV_SCANWINDOW) {
+            size_t  at;
+
+            hv_scan_at( &scan, i );
+            at = bulk_find( &hv->data[i], myMIN( HV_SCANWINDOW + n - 1, hv->len - i ), p, n );
+            if ( BULK_NONE != at ) {
+                hv_scan_end( &scan );
+                return i + at;
+            }
+        }
+        hv_scan_end( &scan );
+        return HV_NOTFOUND;
+    }
+
+    from = myMIN( from, hv->len - n );
+    hv_scan_begin( &scan, hv, 0, from + n );
+    hv_scan_at( &scan, from + n - 1 );
+    for (i = from + 1; i-- > 0; ) {
+        if ( HV_SCANWINDOW - 1 == i % HV_SCANWINDOW )
+            hv_scan_at( &scan, i );
+        if ( hv->data[i] == p[0] && 0 == memcmp( &hv->data[i], p, n ) )
+            break;
+    }
+    hv_scan_end( &scan );
+    return (size_t) -1 == i ? HV_NOTFOUND : i;
+}
+
+/*********************************************************//**
+ * Hash the bytes [from,to) of hv with alg (crc32, crc32c, xxh64, md5,
+ * sha1 or sha256), in parallel, into hex (of hexlen >= HV_HEXLEN).
+ *************************************************************
+ */
+_Bool hv_hash( const HvFile *hv, const char *alg, size_t from, size_t to,
+               char *hex, size_t hexlen )
+{
+    const int a = hash_byname( alg );
+    HvScan  scan;
+    _Bool   ok;
+
+    if ( a < 0 || hexlen < HASH_HEXLEN || from > to || to > hv->len ) {
+        errno = EINVAL;
+        return false;
+    }
+    hv_scan_begin( &scan, hv, from, to );
+    hv_scan_at( &scan, HV_NOTFOUND );        /* hashed in parallel */
+    ok = hash_data( a, &hv->data[from], to - from, hv_ncpus(), hex );
+    hv_scan_end( &scan );
+    return ok;
+}
+
+/*********************************************************//**
+ * Format the n bytes (up to FMT_NCOLS) at offset off as a row of the
+ * viewer (uncolored), with an offset column ofstw digits wide, into
+ * dst (of dstlen chars, '\0' terminated if dstlen > 0). Return its
+ * length, which is >= dstlen if dst was too short (like snprintf).
+ *************************************************************
+ */
+size_t hv_format_bytes( const unsigned char *bytes, size_t n, unsigned long long off,
+                        int ofstw, unsigned flags, char *dst, size_t dstlen )
+{
+    static const char hexdigits[] = "0123456789ABCDEF";
+    char    row[ HV_ROWMAX + 16 ], *p = row;
+    size_t  i, len;
+    int     d;
+
+    n     = myMIN( n, (size_t) FMT_NCOLS );
+    ofstw = myMIN( myMAX( ofstw, 1 ), 16 );
+
+    /* offset */
+    *p++ = (flags & HV_FMT_CURSOR) ? '*' : ' ';
+    for (d = ofstw; d-- > 0; )
+        *p++ = hexdigits[ (off >> (4 * d)) & 0xF ];
+    *p++ = ' ';
+
+    /* bytes in hex, grouped */
+    for (i=0; i < FMT_NCOLS; i++) {
+        if ( i != 0 && i % FMT_GRPCOLS == 0 && i < n )
+            *p++ = ' ';
+        if ( i < n ) {
+            *p++ = hexdigits[ bytes[i] >> 4 ];
+            *p++ = hexdigits[ bytes[i] & 0xF ];
+        }
+        else {
+            *p++ = ' ';
+            *p++ = ' ';
+        }
+        *p++ = ' ';
+    }
+    *p++ = ' ';
+
+    /* bytes as chars */
+    for (i=0; i < n; i++) {
+        const int c = bytes[i];
+        const _Bool printable = (flags & HV_FMT_XASCII) ? c > 31 : (c > 31 && c < 127);
+        *p++ = printable ? (char) c : '.';
+    }
+    for (; i < FMT_NCOLS; i++)
+        *p++ = ' ';
+
+    len = (size_t) (p - row);
+    if ( dstlen > 0 ) {
+        const size_t m = myMIN( len, dstlen - 1 );
+        memcpy( dst, row, m );
+        dst[m] = '\0';
+    }
+    return len;
+}
+
+/*********************************************************//**
+ * Format the row of hv starting at off (any offset; none past the
+ * end, where dst is left empty) into dst, as hv_format_bytes() does.
+ *************************************************************
+ */
+size_t hv_format_row( const HvFile *hv, size_t off, unsigned flags, char *dst, size_t dstlen )
+{
+    if ( off >= hv->len ) {
+        if ( dstlen > 0 )
+            *dst = '\0';
+        return 0;
+    }
+    return hv_format_bytes( &hv->data[off], myMIN( (size_t) FMT_NCOLS, hv->len - off ), off,
+                            hv_ofst_width( hv->len ), flags, dst, dstlen );
+}
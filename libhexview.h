@@ -0,0 +1,141 @@
+#ifndef LIBHEXVIEW_H                /* start of inclusion guard */
+#define LIBHEXVIEW_H
+
+#include <stddef.h>
+
+/* -----------------------------------
+ * libhexview: the engine of the viewer, as a C library
+ * -----------------------------------
+ *
+ * A file is opened into a handle (HvFile), mapped when it can be.
+ * Its bytes are read in place (hv_data(): zero-copy) or copied out,
+ * searched, hashed, and formatted as the viewer's rows into buffers
+ * of the caller. Handles are never changed once open (but by
+ * hv_advise()), and nothing is kept anywhere else: any # of threads
+ * may use separate handles (or the same one) at once. On failure,
+ * functions set errno.
+ *
+ * Mappings are advised to be read at random (& by huge pages), but
+ * for the range of a scan, from hv_scan_begin() to hv_scan_end():
+ * read ahead by windows as it goes (hv_scan_at()), and given back
+ * behind it, along with the pages it brought into the page cache.
+ * hv_find() & hv_hash() scan so.
+ */
+
+#define HV_NCOLS        16        /* bytes per row (FMT_NCOLS)          */
+#define HV_PGLINES        21        /* rows per page (FMT_PGLINES)        */
+#define HV_ROWMAX        128        /* max chars of a formatted row (+'\0') */
+#define HV_HEXLEN        65        /* max chars of a hex digest (+'\0')  */
+#define HV_NOTFOUND        ((size_t)-1)    /* no such offset                     */
+
+enum HvFmtFlags {
+    HV_FMT_XASCII   = 0x1,            /* show chars > 127 (else as '.')     */
+    HV_FMT_CURSOR   = 0x2            /* mark the row as the cursor's ('*') */
+};
+
+enum HvAdvice {
+    HV_ADVISE_PATTERN = 0x1,            /* advise how it is read (random/scans) */
+    HV_ADVISE_HUGE    = 0x2            /* map it by huge pages, if it can be */
+};
+
+typedef struct HvFile HvFile;            /* opaque */
+
+#define HV_SCANWORDS        12        /* size of an HvScan, in pointers     */
+
+typedef struct HvScan {                /* a scan of a file (see above) */
+    void        *opaque[ HV_SCANWORDS ];    /* the library's only         */
+} HvScan;
+
+/* -----------------------------------
+ * Functions
+ * -----------------------------------
+ *
+ * Offsets & lengths are in bytes. Functions returning an offset
+ * return HV_NOTFOUND for none; those returning a pointer, NULL on
+ * error; those returning _Bool, false on error.
+ */
+
+/* The version string of the library (static). */
+const char  *hv_version( void );
+
+/* The # of online processors (at least 1): the threads hv_hash() uses. */
+unsigned    hv_ncpus( void );
+
+/* The size of the file fname, or -1: ESPIPE if it has none (a pipe, a
+ * char device ...: read it to its end to size it, as hv_open() does). */
+long long   hv_filesize( const char *fname );
+
+/* The # of hex digits of the offsets of nbytes of data, as the viewer
+ * shows them (8 at least). */
+int         hv_ofst_width( unsigned long long nbytes );
+
+/* Open the file fname, mapped; if it cannot be (a pipe, an empty file
+ * ...), read into memory to its end instead, or with maponly fail
+ * with ENOTSUP. The handle is the caller's, to hv_close(). */
+HvFile      *hv_open( const char *fname, _Bool maponly );
+
+/* Close hv (NULL does nothing): its data are gone, errno is kept. */
+void        hv_close( HvFile *hv );
+
+/* The hv_size() bytes of hv, in place (valid until hv_close()). */
+const unsigned char *hv_data( const HvFile *hv );
+size_t      hv_size( const HvFile *hv );
+
+/* Copy up to n bytes of hv at off into dst: return the # copied (0
+ * at or past the end). */
+size_t      hv_read( const HvFile *hv, size_t off, void *dst, size_t n );
+
+/* Give back the memory of the pages of hv (if mapped): hv_data() stays
+ * valid, paged in again from the OS cache as read. */
+void        hv_release( const HvFile *hv );
+
+/* Write the n bytes of hv at from into the file fname (created, or
+ * truncated): EINVAL if past the end of hv. */
+_Bool       hv_extract( const HvFile *hv, size_t from, size_t n, const char *fname );
+
+/* Advise hv (if mapped) as the HV_ADVISE_ flags say (both, once open). */
+void        hv_advise( HvFile *hv, unsigned flags );
+
+/* Scan [from,to) of hv (NULL: a scan that does nothing), telling where
+ * it is by hv_scan_at(): at HV_NOTFOUND if it reads the range at once
+ * (in parallel, say). Every hv_scan_begin() must be ended by
+ * hv_scan_end(), which frees what the scan holds (s itself is the
+ * caller's, e.g. on its stack). */
+void        hv_scan_begin( HvScan *s, const HvFile *hv, size_t from, size_t to );
+void        hv_scan_at( HvScan *s, size_t off );
+void        hv_scan_end( HvScan *s );
+
+/* The # of rows & pages of hv (as viewed), the row of the byte at off,
+ * and the offset of the 1st byte of a row or a page (past the last
+ * one: of the last one). */
+size_t      hv_nrows( const HvFile *hv );
+size_t      hv_npages( const HvFile *hv );
+size_t      hv_row_of( const HvFile *hv, size_t off );
+size_t      hv_row_off( const HvFile *hv, size_t row );
+size_t      hv_page_off( const HvFile *hv, size_t page );
+
+/* The offset of the 1st occurrence of pat[0..n) at from or after, or
+ * if backward of the last one starting at from or before (from past
+ * the end: at the end), or HV_NOTFOUND (n of 0 included; errno is not
+ * set). */
+size_t      hv_find( const HvFile *hv, size_t from, const void *pat, size_t n, _Bool backward );
+
+/* Hash [from,to) of hv by alg (crc32, crc32c, xxh64, md5, sha1 or
+ * sha256), on hv_ncpus() threads, into hex: hexlen >= HV_HEXLEN, else
+ * (or an unknown alg, or a bad range) EINVAL. */
+_Bool       hv_hash( const HvFile *hv, const char *alg, size_t from, size_t to,
+                     char *hex, size_t hexlen );
+
+/* Format the n bytes (up to HV_NCOLS) of offset off as a row of the
+ * viewer (uncolored), its offsets ofstw hex digits wide (1 to 16), into
+ * dst: '\0' terminated if dstlen > 0, and cut short if dstlen is not
+ * more than the length of the row. Return that length (as snprintf()
+ * does: if >= dstlen, dst was too short; HV_ROWMAX is long enough). */
+size_t      hv_format_bytes( const unsigned char *bytes, size_t n, unsigned long long off,
+                             int ofstw, unsigned flags, char *dst, size_t dstlen );
+
+/* Format the row of hv starting at off (any offset: past the end, as
+ * an empty string, of length 0) as hv_format_bytes() does. */
+size_t      hv_format_row( const HvFile *hv, size_t off, unsigned flags, char *dst, size_t dstlen );
+
+#endif                        /* end of inclusion guard            */
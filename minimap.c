@@ -0,0 +1,360 @@
+/*****************************************************//**
+ * @brief   Lazily built multi-resolution summary of a buffer.
+ * @file    minimap.c
+ * @par Language:
+ *      C (ANSI C99) + POSIX threads & GCC atomic builtins
+ *
+ * @remark  Level 0 summarizes leaflen bytes per node, every next level
+ *      merges pairs of nodes of the level below, up to a single root.
+ *      A background thread summarizes the leaves in file order and
+ *      merges upwards whatever it can. Queries never wait for it: a
+ *      node whose children are ready is merged on the spot, and
+ *      anything else is estimated from a few samples of its bytes.
+ *      Merged entropies are the length-weighted mean of the children
+ *      (a lower bound of the real entropy, good enough for an overview).
+ *********************************************************
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "hexview.h"
+#include "entropy.h"
+#include "minimap.h"
+
+enum MmState {
+    MM_EMPTY = 0,                /* not summarized yet                 */
+    MM_BUSY,                    /* being summarized by some thread    */
+    MM_READY                    /* summarized                         */
+};
+
+#define MM_DEPTH        2        /* max levels merged on demand        */
+
+/*********************************************************//**
+ * Fill a node from the histogram of n bytes.
+ *************************************************************
+ */
+static void node_from_hist( const uint64_t *hist, uint64_t n, MmNode *node )
+{
+    if ( 0 == n ) {
+        memset( node, 0, sizeof(MmNode) );
+        return;
+    }
+
+    node->zero  = (float) hist[0] / n;
+    node->print = (float) ent_printable( hist ) / n;
+    node->bits  = (float) entmap_bits( hist, n );
+
+    return;
+}
+
+/*********************************************************//**
+ * Return the length of the bytes node i of level lv stands for.
+ *************************************************************
+ */
+static size_t node_len( const Minimap *mm, unsigned lv, size_t i )
+{
+    const size_t from = i * (mm->leaflen << lv);
+
+    if ( from >= mm->len )
+        return 0;
+    return myMIN( mm->len - from, mm->leaflen << lv );
+}
+
+/*********************************************************//**
+ * Atomically claim an empty node (false if some thread already has it).
+ *************************************************************
+ */
+static _Bool node_claim( Minimap *mm, unsigned lv, size_t i )
+{
+    unsigned char expected = MM_EMPTY;
+
+    return __atomic_compare_exchange_n(
+        &mm->state[lv][i], &expected, MM_BUSY, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED
+    );
+}
+
+static _Bool node_ready( const Minimap *mm, unsigned lv, size_t i )
+{
+    return MM_READY == __atomic_load_n( &mm->state[lv][i], __ATOMIC_ACQUIRE );
+}
+
+static void node_publish( Minimap *mm, unsigned lv, size_t i )
+{
+    __atomic_store_n( &mm->state[lv][i], MM_READY, __ATOMIC_RELEASE );
+}
+
+/*********************************************************//**
+ * Summarize leaf i from its bytes, unless some thread already did.
+ *************************************************************
+ */
+static _Bool leaf_compute( Minimap *mm, size_t i )
+{
+    uint64_t hist[256] = {0};
+    const size_t n = node_len( mm, 0, i );
+
+    if ( !node_claim(mm, 0, i) )
+        return node_ready( mm, 0, i );
+
+    ent_histogram( &mm->data[ i * mm->leaflen ], n, hist );
+    node_from_hist( hist, n, &mm->nodes[0][i] );
+    node_publish( mm, 0, i );
+    __atomic_add_fetch( &mm->ndone, 1, __ATOMIC_RELAXED );
+
+    return true;
+}
+
+/*********************************************************//**
+ * Merge node i of level lv from its children, if they are ready.
+ *************************************************************
+ */
+static _Bool node_merge( Minimap *mm, unsigned lv, size_t i )
+{
+    const size_t left = 2*i, right = 2*i + 1;
+    const _Bool  hasright = right < mm->nnodes[lv-1];
+    double       wl, wr;
+    MmNode       *l, *r, *node;
+
+    if ( !node_ready(mm, lv-1, left) || (hasright && !node_ready(mm, lv-1, right)) )
+        return false;
+    if ( !node_claim(mm, lv, i) )
+        return node_ready( mm, lv, i );
+
+    l    = &mm->nodes[lv-1][left];
+    r    = hasright ? &mm->nodes[lv-1][right] : l;
+    node = &mm->nodes[lv][i];
+    wl   = (double) node_len( mm, lv-1, left );
+    wr   = hasright ? (double) node_len( mm, lv-1, right ) : 0.0;
+
+    node->zero  = (float)( (l->zero  * wl + r->zero  * wr) / (wl + wr) );
+    node->print = (float)( (l->print * wl + r->print * wr) / (wl + wr) );
+    node->bits  = (float)( (l->bits  * wl + r->bits  * wr) / (wl + wr) );
+    node_publish( mm, lv, i );
+
+    return true;
+}
+
+/*********************************************************//**
+ * Get the summary of node i of level lv into out, computing it from
+ * at most depth levels below if needed. False if it is not available.
+ *************************************************************
+ */
+static _Bool node_get( Minimap *mm, unsigned lv, size_t i, int depth, MmNode *out )
+{
+    if ( !node_ready(mm, lv, i) )
+    {
+        if ( 0 == lv ) {
+            if ( depth < 0 || !leaf_compute(mm, i) )
+                return false;
+        }
+        else {
+            MmNode tmp;
+            if ( depth <= 0
+                || !node_get(mm, lv-1, 2*i, depth-1, &tmp)
+                || (2*i+1 < mm->nnodes[lv-1] && !node_get(mm, lv-1, 2*i+1, depth-1, &tmp))
+                || !node_merge(mm, lv, i)
+            )
+                return false;
+        }
+    }
+
+    *out = mm->nodes[lv][i];
+    return true;
+}
+
+/*********************************************************//**
+ * Estimate the summary of [from,to) from MM_NSAMPLES evenly spread
+ * samples of MM_SAMPLELEN bytes.
+ *************************************************************
+ */
+static void region_sample( const Minimap *mm, size_t from, size_t to, MmNode *out )
+{
+    uint64_t hist[256] = {0}, n = 0;
+    const size_t gap = (to - from) / MM_NSAMPLES;
+    int s;
+
+    for (s=0; s < MM_NSAMPLES; s++)
+    {
+        const size_t at = from + s * gap;
+        const size_t len = myMIN( (size_t) MM_SAMPLELEN, to - at );
+        ent_histogram( &mm->data[at], len, hist );
+        n += len;
+    }
+    node_from_hist( hist, n, out );
+
+    return;
+}
+
+/*********************************************************//**
+ * Thread entry: summarize all leaves in order, merging upwards.
+ *************************************************************
+ */
+static void *minimap_refine( void *arg )
+{
+    Minimap  *mm = arg;
+    size_t   i, j;
+    unsigned lv;
+
+    for (i=0; i < mm->nnodes[0] && !mm->stop; i++)
+    {
+        leaf_compute( mm, i );
+        for (lv=1, j=i/2; lv < mm->nlevels && node_merge(mm, lv, j); lv++, j /= 2)
+            ;
+    }
+
+    /* whatever was left behind by queries (busy at the time) */
+    for (lv=1; lv < mm->nlevels && !mm->stop; lv++)
+        for (j=0; j < mm->nnodes[lv]; j++)
+            node_merge( mm, lv, j );
+
+    return NULL;
+}
+
+/*********************************************************//**
+ * Set up the (empty) pyramid of len bytes of data, and start
+ * refining it in the background if so requested.
+ *************************************************************
+ */
+_Bool minimap_init( Minimap *mm, const unsigned char *data, size_t len, _Bool refine )
+{
+    unsigned lv;
+    size_t   n;
+
+    if ( !mm || !data )
+        return false;
+    memset( mm, 0, sizeof(Minimap) );
+
+    mm->data = data;
+    mm->len  = len;
+    for (mm->leaflen = MM_LEAFLEN; len / mm->leaflen > MM_MAXLEAVES; mm->leaflen *= 2)
+        ;
+
+    n = len / mm->leaflen + (len % mm->leaflen != 0);
+    for (lv=0; lv < MM_MAXLEVELS; lv++)
+    {
+        mm->nnodes[lv] = n > 0 ? n : 1;
+        mm->nodes[lv]  = calloc( mm->nnodes[lv], sizeof(MmNode) );
+        mm->state[lv]  = calloc( mm->nnodes[lv], sizeof(unsigned char) );
+        mm->nlevels    = lv + 1;
+        if ( !mm->nodes[lv] || !mm->state[lv] ) {
+            minimap_cleanup( mm );
+            return false;
+        }
+        if ( n <= 1 )
+            break;
+        n = n / 2 + (n % 2);
+    }
+
+    if ( refine && len > 0 )
+        mm->running = (0 == pthread_create( &mm->tid, NULL, minimap_refine, mm ));
+
+    return true;
+}
+
+/*********************************************************//**
+ * Get into out the best summary of [from,to) available right now,
+ * without waiting for the background refinement.
+ *************************************************************
+ */
+void minimap_region( Minimap *mm, size_t from, size_t to, MmNode *out )
+{
+    double   wsum = 0.0, zero = 0.0, print = 0.0, bits = 0.0;
+    size_t   nodelen, i;
+    unsigned lv;
+
+    memset( out, 0, sizeof(MmNode) );
+    if ( !mm || !mm->nodes[0] || from >= mm->len )
+        return;
+    to = myMIN( to, mm->len );
+    if ( to <= from )
+        return;
+
+    /* regions up to a leaf are cheap enough to summarize directly */
+    if ( to - from <= mm->leaflen ) {
+        uint64_t hist[256] = {0};
+        ent_histogram( &mm->data[from], to - from, hist );
+        node_from_hist( hist, to - from, out );
+        return;
+    }
+
+    /* the coarsest level whose nodes are not larger than the region */
+    for (lv=0; lv+1 < mm->nlevels && (mm->leaflen << (lv+1)) <= to - from; lv++)
+        ;
+    nodelen = mm->leaflen << lv;
+
+    for (i=from / nodelen; i <= (to-1) / nodelen; i++)
+    {
+        const size_t nfrom = myMAX( from, i * nodelen );
+        const size_t nto   = myMIN( to, (i+1) * nodelen );
+        const double w     = (double)(nto - nfrom);
+        MmNode node;
+
+        if ( !node_get(mm, lv, i, MM_DEPTH, &node) )
+            region_sample( mm, nfrom, nto, &node );
+
+        zero  += node.zero * w;
+        print += node.print * w;
+        bits  += node.bits * w;
+        wsum  += w;
+    }
+
+    out->zero  = (float)(zero / wsum);
+    out->print = (float)(print / wsum);
+    out->bits  = (float)(bits / wsum);
+
+    return;
+}
+
+/*********************************************************//**
+ * Return the enum EntClass a summary falls in.
+ *************************************************************
+ */
+int minimap_class( const MmNode *node )
+{
+    if ( node->zero >= 0.999f )
+        return ENT_ZERO;
+    if ( node->print >= ENT_TEXTRATIO )
+        return ENT_TEXT;
+    if ( node->bits > ENT_HIGHBITS )
+        return ENT_HIGH;
+    if ( node->bits < ENT_LOWBITS )
+        return ENT_LOW;
+
+    return ENT_MID;
+}
+
+/*********************************************************//**
+ * Return the share (0.0 to 1.0) of leaves summarized so far.
+ *************************************************************
+ */
+double minimap_progress( const Minimap *mm )
+{
+    if ( !mm || 0 == mm->nnodes[0] )
+        return 0.0;
+    return (double) __atomic_load_n( &mm->ndone, __ATOMIC_RELAXED ) / mm->nnodes[0];
+}
+
+/*********************************************************//**
+ * Stop the background refinement (if any) & free the pyramid.
+ *************************************************************
+ */
+void minimap_cleanup( Minimap *mm )
+{
+    unsigned lv;
+
+    if ( !mm )
+        return;
+
+    if ( mm->running ) {
+        mm->stop = 1;
+        pthread_join( mm->tid, NULL );
+    }
+    for (lv=0; lv < mm->nlevels; lv++) {
+        free( mm->nodes[lv] );
+        free( mm->state[lv] );
+    }
+    memset( mm, 0, sizeof(Minimap) );
+
+    return;
+}
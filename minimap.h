@@ -0,0 +1,45 @@
+#ifndef MINIMAP_H                /* start of inclusion guard */
+#define MINIMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/* -----------------------------------
+ * Multi-resolution summary (mipmap-like pyramid) of a buffer
+ * -----------------------------------
+ */
+
+#define MM_LEAFLEN        (64*1024)    /* min bytes summarized by a leaf     */
+#define MM_MAXLEAVES        (1024*1024)    /* leaves grow to stay below this     */
+#define MM_MAXLEVELS        48        /* enough for any 64-bit length       */
+#define MM_NSAMPLES        4        /* # of samples to estimate a region  */
+#define MM_SAMPLELEN        1024        /* length of each sample, in bytes    */
+
+typedef struct MmNode {
+    float   zero;                /* share of zero bytes                */
+    float   print;                /* share of printable bytes           */
+    float   bits;                /* entropy, in bits per byte          */
+} MmNode;
+
+typedef struct Minimap {
+    const unsigned char *data;        /* the summarized data                */
+    size_t      len;            /* ... and its length                 */
+    size_t      leaflen;        /* bytes per leaf (a power of 2)      */
+    unsigned    nlevels;        /* level 0 are leaves, last the root  */
+    size_t      nnodes[ MM_MAXLEVELS ];    /* # of nodes per level               */
+    MmNode      *nodes[ MM_MAXLEVELS ];    /* the nodes of each level            */
+    unsigned char *state[ MM_MAXLEVELS ];  /* enum MmState of each node          */
+    size_t      ndone;            /* # of leaves summarized so far      */
+    pthread_t   tid;            /* the background refiner             */
+    _Bool       running;        /* ... is it started?                 */
+    volatile int stop;            /* ... should it stop?                */
+} Minimap;
+
+_Bool   minimap_init( Minimap *mm, const unsigned char *data, size_t len, _Bool refine );
+void    minimap_region( Minimap *mm, size_t from, size_t to, MmNode *out );
+int     minimap_class( const MmNode *node );
+double  minimap_progress( const Minimap *mm );
+void    minimap_cleanup( Minimap *mm );
+
+#endif                        /* end of inclusion guard            */
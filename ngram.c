@@ -0,0 +1,523 @@
+/*****************************************************//**
+ * @brief   Frequent n-grams & duplicate blocks, by heavy-hitter sketches.
+ * @file    ngram.c
+ * @par Language:
+ *      C (ANSI C99) + POSIX threads
+ *
+ * @remark  The data are split into chunks (a whole # of blocks each),
+ *      counted on a work-stealing pool (pool.c) into sketches of their
+ *      own, which are then merged into those of the whole data, one
+ *      chunk at a time (Misra-Gries sketches add up, their errors too).
+ *      A sketch is a hash table of up to cap keys & their counts: once
+ *      full, all the counts are lowered by their median (found in O(cap))
+ *      and the keys left with none are dropped, so half of it at least
+ *      is free again: O(1) per key, amortized. Runs of the same n-gram
+ *      (e.g. of zeros) are counted as they end, all at once, and other
+ *      n-grams are let in the sketch of a chunk only when seen before,
+ *      as told by a bitmap of those seen (a doorkeeper, cleared once an
+ *      8th full): most n-grams of random data are seen once, & cost a
+ *      bit set only. Where some were seen 1st is kept too (in a table
+ *      of fewer slots, so that it stays in the CPU cache): an n-gram
+ *      let in is counted twice if found there, from there, so that
+ *      the 1st sighting is not lost, nor its offset. Each n-gram goes
+ *      uncounted once per bitmap cleared (& once per chunk) at most,
+ *      which adds to the error of the sketch.
+ *********************************************************
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "hexview.h"
+#include "hash.h"
+#include "pool.h"
+#include "ngram.h"
+
+#define NGRAM_CHUNKLEN      (16*1024*1024)    /* bytes counted per job (about)      */
+#define NGRAM_NPAIRS        65536        /* distinct 2-grams                   */
+#define NGRAM_DOORBITS      20        /* log2 of the bits of a doorkeeper ...  */
+#define NGRAM_DOORKEYS      ((1U << NGRAM_DOORBITS) / 8)  /* ... cleared once so many set */
+#define NGRAM_FIRSTBITS     14        /* log2 of the 1st sightings kept ... */
+#define NGRAM_FIRSTOFF      0xFFFFFFFFULL   /* ... as a tag & offset (+1, or 0) */
+
+typedef struct SketchSlot {
+    uint64_t    key;
+    unsigned long long count;        /* 0: a free slot                     */
+    size_t      off;            /* 1st offset of key since counted    */
+} SketchSlot;
+
+typedef struct Sketch {
+    SketchSlot  *slots;            /* a table of 2*cap slots at least ...*/
+    size_t      mask;            /* ... (a power of 2, less 1)         */
+    size_t      cap, n;            /* ... holding n keys, cap at most    */
+    unsigned long long err;        /* counts are low by this at most     */
+    SketchSlot  *spare;            /* the keys kept while reduced ...    */
+    unsigned long long *counts;        /* ... & the counts, for their median */
+    uint64_t    *door;            /* keys seen (if a doorkeeper) ...    */
+    size_t      ndoor;            /* ... since cleared ...              */
+    uint64_t    *firsts;        /* ... where some were 1st (tag, off) */
+    const unsigned char *data;        /* ... in the data from base ...      */
+    size_t      base, glen;        /* ... as keys of glen bytes          */
+} Sketch;
+
+typedef struct SketchRun {
+    uint64_t    key;            /* a key found ...                    */
+    unsigned long long n;        /* ... so many times in a row ...     */
+    size_t      off;            /* ... from here                      */
+} SketchRun;
+
+typedef struct NgramCtx {
+    const unsigned char *data;
+    size_t      len, blocklen, chunklen;
+    pthread_mutex_t lock;        /* of all below                       */
+    unsigned long long *pairs;        /* 2-grams: counts ...                */
+    size_t      *pairoffs;        /* ... & 1st offsets                  */
+    Sketch      grams[2];        /* 4 & 8-grams                        */
+    Sketch      blocks;            /* hashes of the blocks               */
+    _Bool       failed;            /* out of memory                      */
+} NgramCtx;
+
+static void sketch_cleanup( Sketch *s )
+{
+    free( s->slots );
+    free( s->spare );
+    free( s->counts );
+    free( s->door );
+    free( s->firsts );
+    memset( s, 0, sizeof(Sketch) );
+}
+
+/*********************************************************//**
+ * Make s a sketch of cap keys, letting only the keys seen before in
+ * if door is true (its data, base & glen are then the caller's to set).
+ *************************************************************
+ */
+static _Bool sketch_init( Sketch *s, size_t cap, _Bool door )
+{
+    size_t  nslots = 2;
+
+    memset( s, 0, sizeof(Sketch) );
+    while ( nslots < 2 * cap )
+        nslots <<= 1;
+    s->slots  = calloc( nslots, sizeof(SketchSlot) );
+    s->spare  = malloc( cap * sizeof(SketchSlot) );
+    s->counts = malloc( cap * sizeof(unsigned long long) );
+    s->mask   = nslots - 1;
+    s->cap    = cap;
+    if ( door ) {
+        s->door   = calloc( (1U << NGRAM_DOORBITS) / 64, sizeof(uint64_t) );
+        s->firsts = calloc( 1U << NGRAM_FIRSTBITS, sizeof(uint64_t) );
+        s->err    = 1;                /* uncounted once, before cleared */
+    }
+    if ( !s->slots || !s->spare || !s->counts || (door && (!s->door || !s->firsts)) ) {
+        sketch_cleanup( s );
+        return false;
+    }
+    return true;
+}
+
+static inline size_t sketch_hash( const Sketch *s, uint64_t key )
+{
+    key *= 0x9E3779B97F4A7C15ULL;
+    return (size_t) (key ^ (key >> 29)) & s->mask;
+}
+
+/*********************************************************//**
+ * Return the k-th least of the n counts a[] (reordering them).
+ *************************************************************
+ */
+static unsigned long long sketch_select( unsigned long long *a, size_t n, size_t k )
+{
+    long long lo = 0, hi = (long long) n - 1, i, j;
+
+    while ( lo < hi )
+    {
+        const unsigned long long pivot = a[ lo + (hi - lo) / 2 ];
+        for (i=lo, j=hi; i <= j; ) {
+            while ( a[i] < pivot )
+                i++;
+            while ( a[j] > pivot )
+                j--;
+            if ( i <= j ) {
+                const unsigned long long t = a[i];
+                a[i++] = a[j];
+                a[j--] = t;
+            }
+        }
+        if ( (long long) k <= j )
+            hi = j;
+        else if ( (long long) k >= i )
+            lo = i;
+        else
+            break;
+    }
+    return a[k];
+}
+
+/*********************************************************//**
+ * Lower all the counts of a full sketch by their median, dropping the
+ * keys left with none (half of them at least).
+ *************************************************************
+ */
+static void sketch_reduce( Sketch *s )
+{
+    unsigned long long d;
+    size_t  i, n, kept, at;
+
+    for (n=0, i=0; i <= s->mask; i++)
+        if ( s->slots[i].count ) {
+            s->counts[n]  = s->slots[i].count;
+            s->spare[n++] = s->slots[i];
+        }
+    d = sketch_select( s->counts, n, n / 2 );
+
+    memset( s->slots, 0, (s->mask + 1) * sizeof(SketchSlot) );
+    for (kept=0, i=0; i < n; i++)
+        if ( s->spare[i].count > d ) {
+            for (at = sketch_hash( s, s->spare[i].key ); s->slots[at].count; at = (at + 1) & s->mask)
+                ;
+            s->slots[at] = s->spare[i];
+            s->slots[at].count -= d;
+            kept++;
+        }
+    s->n    = kept;
+    s->err += d;
+}
+
+/*********************************************************//**
+ * Count key n more times, found at off 1st.
+ *************************************************************
+ */
+static void sketch_add( Sketch *s, uint64_t key, unsigned long long n, size_t off )
+{
+    size_t  at;
+
+    for (;;)
+    {
+        for (at = sketch_hash( s, key ); s->slots[at].count; at = (at + 1) & s->mask)
+            if ( s->slots[at].key == key ) {
+                s->slots[at].count += n;
+                s->slots[at].off    = myMIN( s->slots[at].off, off );
+                return;
+            }
+        if ( s->n < s->cap ) {
+            s->slots[at].key   = key;
+            s->slots[at].count = n;
+            s->slots[at].off   = off;
+            s->n++;
+            return;
+        }
+        sketch_reduce( s );
+    }
+}
+
+/*********************************************************//**
+ * Add the counts of the sketch from into the sketch to.
+ *************************************************************
+ */
+static void sketch_merge( Sketch *to, const Sketch *from )
+{
+    size_t  i;
+
+    for (i=0; i <= from->mask; i++)
+        if ( from->slots[i].count )
+            sketch_add( to, from->slots[i].key, from->slots[i].count, from->slots[i].off );
+    to->err += from->err;
+}
+
+/*********************************************************//**
+ * Count key, found at off & let in by the doorkeeper of s: twice, from
+ * there, if *first tells (by its tag) that it was seen 1st there, & is
+ * then told of no more (never counted twice, so counts stay low, not
+ * high). Out of line: most keys of random data are never let in.
+ *************************************************************
+ */
+static void sketch_seen( Sketch *s, uint64_t key, size_t off, uint64_t *first, uint64_t tag )
+{
+    const size_t at = (size_t) (*first & NGRAM_FIRSTOFF);
+    uint64_t was = 0;
+
+    if ( at && (*first & ~NGRAM_FIRSTOFF) == tag ) {
+        memcpy( &was, &s->data[ s->base + at - 1 ], s->glen );
+        if ( was == key ) {
+            sketch_add( s, key, 2, s->base + at - 1 );
+            *first = 0;
+            return;
+        }
+    }
+    sketch_add( s, key, 1, off );
+}
+
+/*********************************************************//**
+ * Count key found once at off, unless the doorkeeper of s (if any) has
+ * not seen it before: then it has, & where (see sketch_seen()), unless
+ * told of another key since.
+ *************************************************************
+ */
+static inline void sketch_once( Sketch *s, uint64_t key, size_t off )
+{
+    const uint64_t hh  = key * 0xC2B2AE3D27D4EB4FULL;
+    const size_t  h   = (size_t) (hh >> (64 - NGRAM_DOORBITS));
+    const uint64_t bit = 1ULL << (h & 63);
+    uint64_t *first;
+
+    if ( !s->door ) {
+        sketch_add( s, key, 1, off );
+        return;
+    }
+    first = &s->firsts[ h >> (NGRAM_DOORBITS - NGRAM_FIRSTBITS) ];
+    if ( s->door[ h >> 6 ] & bit ) {
+        sketch_seen( s, key, off, first, hh << 32 );
+        return;
+    }
+    s->door[ h >> 6 ] |= bit;
+    *first = off - s->base < NGRAM_FIRSTOFF ? hh << 32 | (off - s->base + 1) : 0;
+    if ( ++s->ndoor == NGRAM_DOORKEYS ) {
+        memset( s->door, 0, (1U << NGRAM_DOORBITS) / 8 );
+        s->ndoor = 0;
+        s->err++;
+    }
+}
+
+/*********************************************************//**
+ * Count the run r (if any) into the sketch s.
+ *************************************************************
+ */
+static inline void sketch_flush( Sketch *s, const SketchRun *r )
+{
+    if ( r->n > 1 )
+        sketch_add( s, r->key, r->n, r->off );
+    else if ( r->n )
+        sketch_once( s, r->key, r->off );
+}
+
+/*********************************************************//**
+ * Count key found at off into the run r, or count the run into the
+ * sketch s & start another one if key ends it.
+ *************************************************************
+ */
+static inline void sketch_run( Sketch *s, SketchRun *r, uint64_t key, size_t off )
+{
+    if ( r->n && r->key == key ) {
+        r->n++;
+        return;
+    }
+    sketch_flush( s, r );
+    r->key = key;
+    r->n   = 1;
+    r->off = off;
+}
+
+/*********************************************************//**
+ * Put an n-gram (its count & 1st offset) in place into the list of the
+ * most frequent ones, if it is frequent enough.
+ *************************************************************
+ */
+static void ngram_rank( NgramHit *top, size_t *ntop, const void *gram, size_t glen,
+                        unsigned long long count, size_t off )
+{
+    size_t  i;
+
+    if ( count < 2 || (*ntop == NGRAM_NTOP && count <= top[ NGRAM_NTOP-1 ].count) )
+        return;
+    if ( *ntop < NGRAM_NTOP )
+        (*ntop)++;
+    for (i=*ntop-1; i > 0 && top[i-1].count < count; i--)
+        top[i] = top[i-1];
+    memset( top[i].gram, 0, sizeof(top[i].gram) );
+    memcpy( top[i].gram, gram, glen );
+    top[i].count = count;
+    top[i].off   = off;
+}
+
+/*********************************************************//**
+ * Count the job-th chunk of the data (a job of the pool): its n-grams
+ * (those starting in it) & its blocks, into sketches of its own, then
+ * into those of the whole data.
+ *************************************************************
+ */
+static void ngram_job( size_t job, void *ctx )
+{
+    NgramCtx    *c = ctx;
+    const unsigned char *data = c->data;
+    const size_t lo = job * c->chunklen, hi = myMIN( lo + c->chunklen, c->len );
+    unsigned long long *pairs = calloc( NGRAM_NPAIRS, sizeof(unsigned long long) );
+    size_t      *pairoffs = malloc( NGRAM_NPAIRS * sizeof(size_t) );
+    Sketch      grams[2], blocks;
+    SketchRun   runs[2];
+    unsigned char digest[ HASH_MAXLEN ];
+    HashCtx     hctx;
+    uint64_t    g4 = 0, g8, key;
+    size_t      i, k, end8;
+    _Bool       ok;
+
+    memset( runs, 0, sizeof(runs) );
+    ok = sketch_init( &grams[0], NGRAM_NSLOTS, true );
+    ok = sketch_init( &grams[1], NGRAM_NSLOTS, true ) && ok;
+    ok = sketch_init( &blocks, myMIN( c->chunklen / c->blocklen, NGRAM_NBLOCKSLOTS ), false ) && ok;
+    if ( !ok || !pairs || !pairoffs ) {
+        pthread_mutex_lock( &c->lock );
+        c->failed = true;
+        pthread_mutex_unlock( &c->lock );
+        goto ret;
+    }
+    for (k=0; k < 2; k++) {
+        grams[k].data = data;
+        grams[k].base = lo;
+        grams[k].glen = NGRAM_LEN(k+1);
+    }
+
+    /* the n-grams: all 3 while 8 bytes are left, then the shorter ones */
+    end8 = c->len >= 8 ? myMIN( hi, c->len - 7 ) : lo;
+    for (i=lo; i < end8; i++) {
+        const unsigned pair = (unsigned) data[i] << 8 | data[i+1];
+        if ( 0 == pairs[pair]++ )
+            pairoffs[pair] = i;
+        memcpy( &g4, &data[i], 4 );
+        sketch_run( &grams[0], &runs[0], g4, i );
+        memcpy( &g8, &data[i], 8 );
+        sketch_run( &grams[1], &runs[1], g8, i );
+    }
+    for (i=myMAX( lo, end8 ); i < hi && i + 2 <= c->len; i++) {
+        const unsigned pair = (unsigned) data[i] << 8 | data[i+1];
+        if ( 0 == pairs[pair]++ )
+            pairoffs[pair] = i;
+        if ( i + 4 <= c->len ) {
+            memcpy( &g4, &data[i], 4 );
+            sketch_run( &grams[0], &runs[0], g4, i );
+        }
+    }
+    for (k=0; k < 2; k++)
+        sketch_flush( &grams[k], &runs[k] );
+
+    /* the (whole) blocks */
+    for (i=lo; i < hi && i + c->blocklen <= c->len; i += c->blocklen) {
+        hash_init( &hctx, HASH_XXH64 );
+        hash_update( &hctx, &data[i], c->blocklen );
+        hash_final( &hctx, digest );
+        for (key=0, k=0; k < 8; k++)
+            key = key << 8 | digest[k];
+        sketch_add( &blocks, key, 1, i );
+    }
+
+    pthread_mutex_lock( &c->lock );
+    for (k=0; k < NGRAM_NPAIRS; k++)
+        if ( pairs[k] ) {
+            c->pairoffs[k] = c->pairs[k] ? myMIN( c->pairoffs[k], pairoffs[k] ) : pairoffs[k];
+            c->pairs[k]   += pairs[k];
+        }
+    sketch_merge( &c->grams[0], &grams[0] );
+    sketch_merge( &c->grams[1], &grams[1] );
+    sketch_merge( &c->blocks, &blocks );
+    pthread_mutex_unlock( &c->lock );
+
+ret:
+    sketch_cleanup( &blocks );
+    sketch_cleanup( &grams[1] );
+    sketch_cleanup( &grams[0] );
+    free( pairoffs );
+    free( pairs );
+    return;
+}
+
+/*********************************************************//**
+ * Find the most frequent 2, 4 & 8-grams of data[0..len) & its most
+ * repeated blocks of blocklen bytes (0 for NGRAM_BLOCKLEN) into ng,
+ * on up to nthreads threads. Offsets are from data.
+ *************************************************************
+ */
+_Bool ngram_scan( const unsigned char *data, size_t len, size_t blocklen,
+                  unsigned nthreads, Ngrams *ng )
+{
+    NgramCtx    c;
+    const Sketch *s;
+    unsigned char gram[8];
+    size_t      i, k;
+    _Bool       ok = false;
+
+    if ( !data || !ng )
+        return false;
+    memset( ng, 0, sizeof(Ngrams) );
+    memset( &c, 0, sizeof(NgramCtx) );
+    if ( 0 == blocklen )
+        blocklen = NGRAM_BLOCKLEN;
+    if ( blocklen < NGRAM_MINBLOCKLEN ) {
+        errno = EINVAL;
+        return false;
+    }
+
+    c.data     = data;
+    c.len      = len;
+    c.blocklen = blocklen;
+    c.chunklen = blocklen * myMAX( 1, NGRAM_CHUNKLEN / blocklen );
+    c.pairs    = calloc( NGRAM_NPAIRS, sizeof(unsigned long long) );
+    c.pairoffs = calloc( NGRAM_NPAIRS, sizeof(size_t) );
+    pthread_mutex_init( &c.lock, NULL );
+    if ( !c.pairs || !c.pairoffs
+        || !sketch_init( &c.grams[0], NGRAM_NSLOTS, false )
+        || !sketch_init( &c.grams[1], NGRAM_NSLOTS, false )
+        || !sketch_init( &c.blocks, NGRAM_NBLOCKSLOTS, false )
+        || !pool_run( (len + c.chunklen - 1) / c.chunklen, nthreads, ngram_job, &c, NULL )
+    ) {
+        errno = ENOMEM;
+        goto ret;
+    }
+    if ( c.failed ) {
+        errno = ENOMEM;
+        goto ret;
+    }
+
+    /* the most frequent n-grams of each length */
+    for (k=0; k < NGRAM_NLENS; k++)
+        ng->total[k] = len >= NGRAM_LEN(k) ? len - NGRAM_LEN(k) + 1 : 0;
+    for (i=0; i < NGRAM_NPAIRS; i++)
+        if ( c.pairs[i] ) {
+            gram[0] = (unsigned char) (i >> 8);
+            gram[1] = (unsigned char) i;
+            ngram_rank( ng->top[0], &ng->ntop[0], gram, 2, c.pairs[i], c.pairoffs[i] );
+        }
+    for (k=1; k < NGRAM_NLENS; k++) {
+        s = &c.grams[k-1];
+        ng->maxerr[k] = s->err;
+        for (i=0; i <= s->mask; i++)
+            if ( s->slots[i].count )
+                ngram_rank( ng->top[k], &ng->ntop[k], &s->slots[i].key,
+                            NGRAM_LEN(k), s->slots[i].count, s->slots[i].off );
+    }
+
+    /* the most repeated blocks */
+    s = &c.blocks;
+    ng->blocklen = blocklen;
+    ng->nblocks  = len / blocklen;
+    ng->exact    = (0 == s->err);
+    for (i=0; i <= s->mask; i++)
+    {
+        const SketchSlot *slot = &s->slots[i];
+        if ( slot->count < 2 )
+            continue;
+        ng->nrepeats += slot->count - 1;
+        if ( ng->ndups == NGRAM_NDUPS && slot->count <= ng->dups[ NGRAM_NDUPS-1 ].count )
+            continue;
+        if ( ng->ndups < NGRAM_NDUPS )
+            ng->ndups++;
+        for (k=ng->ndups-1; k > 0 && ng->dups[k-1].count < slot->count; k--)
+            ng->dups[k] = ng->dups[k-1];
+        ng->dups[k].hash  = slot->key;
+        ng->dups[k].count = slot->count;
+        ng->dups[k].off   = slot->off;
+    }
+    ok = true;
+
+ret:
+    sketch_cleanup( &c.blocks );
+    sketch_cleanup( &c.grams[1] );
+    sketch_cleanup( &c.grams[0] );
+    pthread_mutex_destroy( &c.lock );
+    free( c.pairoffs );
+    free( c.pairs );
+    return ok;
+}
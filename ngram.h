@@ -0,0 +1,61 @@
+#ifndef NGRAM_H                    /* start of inclusion guard */
+#define NGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* -----------------------------------
+ * Frequent n-grams & duplicate blocks, by heavy-hitter sketches
+ * -----------------------------------
+ *
+ * The 2-grams (byte pairs) at every offset are counted exactly, the 4
+ * & 8-grams by heavy-hitter (Misra-Gries) sketches of NGRAM_NSLOTS
+ * counters each: every n-gram occurring more than about 2/NGRAM_NSLOTS
+ * of the time is kept, counted low by maxerr at most (so those found
+ * no more than maxerr times may be missed, & those found once are left
+ * out), at an offset that is the 1st one if maxerr is 0 (& mostly, if
+ * found twice or more within 16 Mb of it). The aligned
+ * blocks of blocklen bytes are hashed (XXH64) into such a sketch too,
+ * of NGRAM_NBLOCKSLOTS counters: with no more distinct blocks than
+ * that, every repeated one is found (exact), else the most repeated
+ * ones. So the memory taken is bounded, however big the data are.
+ */
+
+#define NGRAM_NLENS         3        /* n-gram lengths counted ...         */
+#define NGRAM_LEN(i)        (2U << (i))    /* ... 2, 4 & 8 bytes                 */
+#define NGRAM_NTOP          16        /* max n-grams reported per length    */
+#define NGRAM_NSLOTS        4096        /* counters of an n-gram sketch       */
+#define NGRAM_BLOCKLEN      4096        /* default block length, in bytes     */
+#define NGRAM_MINBLOCKLEN   8        /* min block length, in bytes         */
+#define NGRAM_NBLOCKSLOTS   (256*1024)    /* counters of the block sketch       */
+#define NGRAM_NDUPS         64        /* max repeated blocks reported       */
+
+typedef struct NgramHit {
+    unsigned char gram[8];        /* NGRAM_LEN() bytes ...              */
+    unsigned long long count;        /* ... found so many times (at least) */
+    size_t      off;            /* ... one here (the 1st, if !maxerr) */
+} NgramHit;
+
+typedef struct NgramDup {
+    uint64_t    hash;            /* XXH64 of a block ...               */
+    unsigned long long count;        /* ... found so many times (at least) */
+    size_t      off;            /* ... one here (the 1st, if exact)   */
+} NgramDup;
+
+typedef struct Ngrams {
+    NgramHit    top[ NGRAM_NLENS ][ NGRAM_NTOP ];  /* most frequent, best 1st ... */
+    size_t      ntop[ NGRAM_NLENS ];    /* ... & how many, per length         */
+    unsigned long long total[ NGRAM_NLENS ];  /* n-grams counted ...          */
+    unsigned long long maxerr[ NGRAM_NLENS ]; /* ... low by this at most      */
+    size_t      blocklen;        /* length of the blocks hashed ...    */
+    unsigned long long nblocks;        /* ... their # ...                    */
+    unsigned long long nrepeats;    /* ... those repeating an earlier one */
+    _Bool       exact;            /* ... all of them found              */
+    NgramDup    dups[ NGRAM_NDUPS ];    /* most repeated blocks, best 1st ... */
+    size_t      ndups;            /* ... & how many                     */
+} Ngrams;
+
+_Bool   ngram_scan( const unsigned char *data, size_t len, size_t blocklen,
+                    unsigned nthreads, Ngrams *ng );
+
+#endif                        /* end of inclusion guard            */
@@ -0,0 +1,206 @@
+/*****************************************************//**
+ * @brief   Record sizes: periodic structure, by byte autocorrelation.
+ * @file    period.c
+ * @par Language:
+ *      C (ANSI C99) + POSIX threads
+ *
+ * @remark  The data are sampled in windows spread evenly over them
+ *      (all of them, if short), and every stride compares each window
+ *      with the bytes a stride later, 16 at a time (bulk_matches()),
+ *      so a lag sweep costs PERIOD_SAMPLELEN bytes per stride however
+ *      big the data are. The strides are swept in blocks, run on a
+ *      work-stealing pool (pool.c), each block going through the
+ *      windows one at a time so that a window stays in the cache for
+ *      all the strides of the block.
+ *********************************************************
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "hexview.h"
+#include "bulk.h"
+#include "entropy.h"
+#include "pool.h"
+#include "period.h"
+
+#define PERIOD_LAGBLOCK     64        /* strides swept per job              */
+#define PERIOD_MINPEAK      0.001        /* peaks lower than this are noise    */
+#define PERIOD_SELFPEAK     0.5        /* strides peak so much of their score at least */
+#define PERIOD_FUNDAMENTAL  0.5        /* divisors peaking at all their multiples & scoring so much of a stride replace it */
+#define PERIOD_MINRATIO     0.1        /* strides scoring less than so much of the best are left out */
+
+typedef struct PeriodCtx {
+    const unsigned char *data;
+    size_t      *wins;            /* offsets of the windows sampled ... */
+    size_t      nwins, winlen;        /* ... their # & length               */
+    size_t      nlags;            /* strides 1..nlags counted ...       */
+    unsigned long long *counts;        /* ... into counts[1..nlags]          */
+} PeriodCtx;
+
+typedef struct PeriodCand {
+    double      score;
+    size_t      stride;
+} PeriodCand;
+
+/*********************************************************//**
+ * Count the matches of the job-th block of strides (a job of the pool).
+ *************************************************************
+ */
+static void period_job( size_t job, void *ctx )
+{
+    PeriodCtx *c = ctx;
+    const size_t first = 1 + job * PERIOD_LAGBLOCK;
+    const size_t last  = myMIN( first + PERIOD_LAGBLOCK, c->nlags + 1 );
+    size_t  w, lag;
+
+    for (w=0; w < c->nwins; w++) {
+        const unsigned char *win = &c->data[ c->wins[w] ];
+        for (lag=first; lag < last; lag++)
+            c->counts[lag] += bulk_matches( win, &win[lag], c->winlen );
+    }
+    return;
+}
+
+static int period_cmpcand( const void *a, const void *b )
+{
+    const PeriodCand *x = a, *y = b;
+
+    if ( x->score != y->score )
+        return x->score > y->score ? -1 : 1;
+    return x->stride < y->stride ? -1 : x->stride > y->stride;
+}
+
+/*********************************************************//**
+ * Find the record sizes of data[0..len) up to maxstride bytes (0 for
+ * PERIOD_MAXSTRIDE) into p, on up to nthreads threads. None are found
+ * in data too short, or without periodic structure.
+ *************************************************************
+ */
+_Bool period_detect( const unsigned char *data, size_t len, size_t maxstride,
+                     unsigned nthreads, Period *p )
+{
+    PeriodCtx   c;
+    PeriodCand  *cands = NULL;
+    uint64_t    hist[256] = {0};
+    double      *m = NULL, *peak = NULL, *score = NULL, noise, sum;
+    size_t      usable, ncands = 0, i, k, r, d;
+    _Bool       ok = false;
+
+    if ( !data || !p )
+        return false;
+    memset( p, 0, sizeof(Period) );
+    memset( &c, 0, sizeof(PeriodCtx) );
+
+    /* strides are scored by 2 multiples at least (& the next ones) */
+    if ( 0 == maxstride )
+        maxstride = PERIOD_MAXSTRIDE;
+    if ( len < 12 || (maxstride = myMIN( maxstride, (len / 2 - 2) / 2 )) < 2 )
+        return true;
+    p->maxstride = maxstride;
+    c.data   = data;
+    c.nlags  = 2 * maxstride + 1;
+    usable   = len - c.nlags;
+    if ( usable <= PERIOD_SAMPLELEN ) {
+        c.nwins  = usable / PERIOD_WINLEN + (usable % PERIOD_WINLEN != 0);
+        c.winlen = usable / c.nwins;
+    }
+    else {
+        c.nwins  = PERIOD_SAMPLELEN / PERIOD_WINLEN;
+        c.winlen = PERIOD_WINLEN;
+    }
+
+    c.wins   = malloc( c.nwins * sizeof(size_t) );
+    c.counts = calloc( c.nlags + 1, sizeof(unsigned long long) );
+    m        = malloc( (c.nlags + 1) * sizeof(double) );
+    peak     = calloc( c.nlags + 1, sizeof(double) );
+    score    = calloc( c.nlags + 1, sizeof(double) );
+    cands    = malloc( c.nlags * sizeof(PeriodCand) );
+    if ( !c.wins || !c.counts || !m || !peak || !score || !cands )
+        goto ret;
+
+    for (i=0; i < c.nwins; i++) {
+        c.wins[i] = (usable <= PERIOD_SAMPLELEN || c.nwins < 2)
+            ? i * c.winlen
+            : (size_t) ((unsigned long long) i * (usable - c.winlen) / (c.nwins - 1));
+        ent_histogram( &data[ c.wins[i] ], c.winlen, hist );
+    }
+    if ( !pool_run( (c.nlags + PERIOD_LAGBLOCK - 1) / PERIOD_LAGBLOCK, nthreads, period_job, &c, NULL ) )
+        goto ret;
+
+    /* the share of bytes matching at each stride, & at random */
+    p->nsampled = (unsigned long long) c.nwins * c.winlen;
+    for (i=0; i < 256; i++)
+        p->chance += ((double) hist[i] / p->nsampled) * ((double) hist[i] / p->nsampled);
+    m[0] = 1.0;
+    for (i=1; i <= c.nlags; i++)
+        m[i] = (double) c.counts[i] / p->nsampled;
+
+    /* how much each stride peaks over the next ones, & its multiples do */
+    for (r=2; r < c.nlags; r++)
+        peak[r] = m[r] - (m[r-1] + m[r+1]) / 2;
+    for (r=2; r <= maxstride; r++) {
+        for (k=1; k * r < c.nlags; k++)
+            score[r] += peak[ k * r ];
+        score[r] /= k - 1;
+    }
+
+    /* above the noise of sampling (6 sigmas) */
+    noise = PERIOD_MINPEAK + 6.0 * sqrt( p->chance * (1.0 - p->chance) / p->nsampled );
+    for (r=2; r <= maxstride; r++)
+        if ( score[r] > noise && peak[r] > noise && peak[r] >= PERIOD_SELFPEAK * score[r] ) {
+            cands[ ncands ].score  = score[r];
+            cands[ ncands++ ].stride = r;
+        }
+    qsort( cands, ncands, sizeof(PeriodCand), period_cmpcand );
+
+    for (i=0; i < ncands && p->ntop < PERIOD_NTOP; i++)
+    {
+        /* the least divisor scoring about as well is the record size */
+        r = cands[i].stride;
+        for (d=2; d <= r / 2; d++)
+            if ( 0 == r % d && score[d] >= PERIOD_FUNDAMENTAL * score[r] ) {
+                for (k=1; k * d < c.nlags && peak[ k * d ] > noise; k++)
+                    ;
+                if ( k * d >= c.nlags ) {
+                    r = d;
+                    break;
+                }
+            }
+        for (k=0; k < p->ntop && 0 != r % p->top[k].stride; k++)
+            ;
+        if ( k < p->ntop                /* a multiple of a better one ... */
+            || (p->ntop > 0 && score[r] < PERIOD_MINRATIO * score[ p->top[0].stride ])
+        )
+            continue;                /* ... or scoring much lower     */
+
+        p->top[ p->ntop ].stride = r;
+        p->top[ p->ntop ].match  = m[r];
+        p->ntop++;
+    }
+
+    /* how sure: the share of the score of all of them (& of the noise) */
+    for (sum = noise, k=0; k < p->ntop; k++)
+        sum += score[ p->top[k].stride ];
+    for (k=0; k < p->ntop; k++)
+        p->top[k].confidence = score[ p->top[k].stride ] / sum;
+    for (k=1; k < p->ntop; k++)            /* the best 1st */
+        for (i=k; i > 0 && p->top[i].confidence > p->top[i-1].confidence; i--) {
+            PeriodHit t = p->top[i];
+            p->top[i]   = p->top[i-1];
+            p->top[i-1] = t;
+        }
+    ok = true;
+
+ret:
+    free( cands );
+    free( score );
+    free( peak );
+    free( m );
+    free( c.counts );
+    free( c.wins );
+    return ok;
+}
@@ -0,0 +1,43 @@
+#ifndef PERIOD_H                    /* start of inclusion guard */
+#define PERIOD_H
+
+#include <stddef.h>
+
+/* -----------------------------------
+ * Record sizes: periodic structure, by byte autocorrelation
+ * -----------------------------------
+ *
+ * For every stride (lag) 1..2*maxstride+1, the share of the bytes equal
+ * to the one a stride later is counted over a sample of the data (all
+ * of it, up to PERIOD_SAMPLELEN bytes). Records of n bytes make that
+ * share peak at n & its multiples: strides are ranked by how much it
+ * peaks on average at their multiples over the strides next to them,
+ * those it peaks at all the multiples of standing for their multiples,
+ * and multiples of a better stride are left out. How sure one is
+ * is its share of the scores of all the strides found (& of the noise
+ * of sampling): near 1 if it stands alone.
+ */
+
+#define PERIOD_MAXSTRIDE    2048        /* default longest stride looked for  */
+#define PERIOD_SAMPLELEN    (1024*1024)      /* max bytes compared per stride ...  */
+#define PERIOD_WINLEN       (16*1024)        /* ... in windows of so many          */
+#define PERIOD_NTOP         8        /* max strides reported               */
+
+typedef struct PeriodHit {
+    size_t      stride;            /* a record size ...                  */
+    double      confidence;        /* ... how sure (0..1)                */
+    double      match;            /* bytes equal a stride later (0..1)  */
+} PeriodHit;
+
+typedef struct Period {
+    PeriodHit   top[ PERIOD_NTOP ];    /* the strides found, best 1st ...    */
+    size_t      ntop;            /* ... & how many                     */
+    size_t      maxstride;        /* longest stride looked for          */
+    double      chance;            /* bytes equal by chance (0..1)       */
+    unsigned long long nsampled;    /* bytes compared per stride          */
+} Period;
+
+_Bool   period_detect( const unsigned char *data, size_t len, size_t maxstride,
+                       unsigned nthreads, Period *p );
+
+#endif                        /* end of inclusion guard            */
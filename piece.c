@@ -0,0 +1,598 @@
+/*****************************************************//**
+ * @brief   Editable view of read-only data, by a piece table.
+ * @file    piece.c
+ * @par Language:
+ *      C (ANSI C99) + POSIX file i/o (when available)
+ *
+ * @remark  The edited data is a list of pieces, each a stretch of either
+ *      the original data (which is never written) or of an add buffer
+ *      which only ever grows. Overwriting, inserting & deleting all
+ *      replace a few pieces with at most 3 new ones, so every edit
+ *      costs O(1) memory whatever its length and the size of the data.
+ *      A range filled with a pattern is a single piece too, repeating
+ *      the pattern (kept in the add buffer) as it is read.
+ *      Each edit remembers the pieces it replaced and the ones it put
+ *      in their place, which is all undo & redo need (without limit).
+ *********************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "hexview.h"
+#include "bulk.h"
+#include "piece.h"
+
+#ifdef HV_POSIX
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+/*********************************************************//**
+ * Set up the editing of orig[0..len) (no edits yet).
+ *************************************************************
+ */
+_Bool piece_init( PieceTable *pt, const unsigned char *orig, size_t len )
+{
+    if ( !pt || (!orig && len) )
+        return false;
+    memset( pt, 0, sizeof(PieceTable) );
+
+    pt->orig    = orig;
+    pt->origlen = len;
+    pt->len     = len;
+    if ( 0 == len )
+        return true;
+
+    if ( NULL == (pt->pieces = malloc( 16 * sizeof(Piece) )) )
+        return false;
+    pt->cap = 16;
+    pt->pieces[0].pos = 0;
+    pt->pieces[0].off = 0;
+    pt->pieces[0].len = len;
+    pt->pieces[0].src = PIECE_ORIG;
+    pt->pieces[0].period = 0;
+    pt->npieces = 1;
+
+    return true;
+}
+
+/*********************************************************//**
+ * Return the index of the piece holding the byte at off (off < len).
+ *************************************************************
+ */
+static size_t piece_find( const PieceTable *pt, size_t off )
+{
+    size_t lo = 0, hi = pt->npieces;
+
+    while ( hi - lo > 1 ) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if ( pt->pieces[mid].pos <= off )
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/*********************************************************//**
+ * Copy up to n bytes of the edited data, starting at off, into dst.
+ * Return the # of bytes copied.
+ *************************************************************
+ */
+size_t piece_read( const PieceTable *pt, size_t off, unsigned char *dst, size_t n )
+{
+    size_t i, done;
+
+    if ( off >= pt->len )
+        return 0;
+    n = myMIN( n, pt->len - off );
+
+    for (i = piece_find(pt, off), done=0; done < n; i++)
+    {
+        const Piece *p = &pt->pieces[i];
+        const size_t skip = off + done - p->pos;
+        const size_t k = myMIN( p->len - skip, n - done );
+
+        if ( PIECE_FILL == p->src )
+            bulk_fill( &dst[done], k, &pt->add[p->off], p->period, skip );
+        else
+            memcpy( &dst[done], (PIECE_ADD == p->src ? pt->add : pt->orig) + p->off + skip, k );
+        done += k;
+    }
+
+    return n;
+}
+
+/*********************************************************//**
+ * Replace the nrem pieces starting at index at with the nins pieces
+ * of ins, and update the offsets of every piece from at onwards.
+ *************************************************************
+ */
+static _Bool piece_splice( PieceTable *pt, size_t at, size_t nrem, const Piece *ins, size_t nins )
+{
+    const size_t n = pt->npieces - nrem + nins;
+    size_t i, pos;
+
+    if ( n > pt->cap ) {
+        const size_t cap = myMAX( 2 * pt->cap, n );
+        Piece *try = realloc( pt->pieces, cap * sizeof(Piece) );
+        if ( !try )
+            return false;
+        pt->pieces = try;
+        pt->cap    = cap;
+    }
+
+    memmove( &pt->pieces[at + nins], &pt->pieces[at + nrem],
+             (pt->npieces - at - nrem) * sizeof(Piece) );
+    memcpy( &pt->pieces[at], ins, nins * sizeof(Piece) );
+    pt->npieces = n;
+
+    pos = at > 0 ? pt->pieces[at-1].pos + pt->pieces[at-1].len : 0;
+    for (i=at; i < n; i++) {
+        pt->pieces[i].pos = pos;
+        pos += pt->pieces[i].len;
+    }
+    pt->len = pos;
+
+    return true;
+}
+
+/*********************************************************//**
+ * Make room for n more bytes at the end of the add buffer, and return
+ * a pointer to it (valid until the next edit), or NULL if out of
+ * memory. The bytes stored there are used by piece_commit().
+ *************************************************************
+ */
+unsigned char *piece_reserve( PieceTable *pt, size_t n )
+{
+    if ( n > pt->addcap - pt->addlen ) {
+        size_t cap = pt->addcap ? pt->addcap : 4096;
+        unsigned char *try;
+        while ( cap - pt->addlen < n )
+            cap *= 2;
+        if ( NULL == (try = realloc( pt->add, cap )) )
+            return NULL;
+        pt->add    = try;
+        pt->addcap = cap;
+    }
+    return &pt->add[pt->addlen];
+}
+
+/*********************************************************//**
+ * Append n bytes to the add buffer.
+ *************************************************************
+ */
+static _Bool piece_append( PieceTable *pt, const unsigned char *data, size_t n )
+{
+    unsigned char *room = piece_reserve( pt, n );
+
+    if ( !room )
+        return false;
+    memcpy( room, data, n );
+    pt->addlen += n;
+
+    return true;
+}
+
+/*********************************************************//**
+ * Record an edit (dropping the undone ones, which cannot be redone
+ * any more).
+ *************************************************************
+ */
+static _Bool piece_record( PieceTable *pt, size_t at, const Piece *old, size_t nold,
+                           const Piece *new, size_t nnew )
+{
+    PieceEdit *e;
+
+    while ( pt->nedits > pt->ndone )
+        free( pt->edits[--pt->nedits].old );
+
+    if ( pt->nedits == pt->capedits ) {
+        const size_t cap = pt->capedits ? 2 * pt->capedits : 64;
+        PieceEdit *try = realloc( pt->edits, cap * sizeof(PieceEdit) );
+        if ( !try )
+            return false;
+        pt->edits    = try;
+        pt->capedits = cap;
+    }
+
+    e = &pt->edits[pt->nedits];
+    if ( NULL == (e->old = malloc( (nold + nnew) * sizeof(Piece) )) )
+        return false;
+    e->new  = e->old + nold;
+    memcpy( e->old, old, nold * sizeof(Piece) );
+    memcpy( e->new, new, nnew * sizeof(Piece) );
+    e->at   = at;
+    e->nold = nold;
+    e->nnew = nnew;
+    pt->nedits++;
+
+    return true;
+}
+
+/*********************************************************//**
+ * Replace dellen bytes at off with the piece ins (if not NULL; its
+ * pos is ignored), recording the edit. The add buffer is truncated
+ * back to addlen on failure.
+ *************************************************************
+ */
+static _Bool piece_edit( PieceTable *pt, size_t off, size_t dellen, const Piece *ins, size_t addlen )
+{
+    size_t i, j, end, nnew = 0;
+    Piece  new[3];
+
+    dellen = myMIN( dellen, pt->len - off );
+    end = off + dellen;
+
+    /* pieces [i,j) overlap the deleted bytes, or hold off if inserting inside one */
+    i = off < pt->len ? piece_find( pt, off ) : pt->npieces;
+    j = i;
+    if ( 0 == dellen && i < pt->npieces && pt->pieces[i].pos < off )
+        j = i + 1;
+    while ( j < pt->npieces && pt->pieces[j].pos < end )
+        j++;
+
+    /* what is left of the 1st piece, the new one, what is left of the last */
+    if ( i < j && pt->pieces[i].pos < off ) {
+        new[nnew] = pt->pieces[i];
+        new[nnew++].len = off - pt->pieces[i].pos;
+    }
+    if ( ins ) {
+        new[nnew] = *ins;
+        new[nnew++].pos = off;
+    }
+    if ( i < j && pt->pieces[j-1].pos + pt->pieces[j-1].len > end ) {
+        const Piece *last = &pt->pieces[j-1];
+        const size_t skip = end - last->pos;
+
+        new[nnew] = *last;
+        new[nnew].pos = end;
+        new[nnew].len = last->pos + last->len - end;
+        if ( PIECE_FILL != last->src )
+            new[nnew].off = last->off + skip;
+        else if ( 0 != skip % last->period ) {    /* the pattern, rotated */
+            unsigned char *room = piece_reserve( pt, last->period );
+            if ( !room )
+                goto ret_failure;
+            bulk_fill( room, last->period, &pt->add[last->off], last->period, skip );
+            new[nnew].off = pt->addlen;
+            pt->addlen += last->period;
+        }
+        nnew++;
+    }
+
+    if ( !piece_record( pt, i, &pt->pieces[i], j - i, new, nnew ) )
+        goto ret_failure;
+    if ( !piece_splice( pt, i, j - i, new, nnew ) ) {
+        free( pt->edits[--pt->nedits].old );
+        goto ret_failure;
+    }
+    pt->ndone = pt->nedits;
+
+    return true;
+
+ret_failure:
+    pt->addlen = addlen;
+    return false;
+}
+
+/*********************************************************//**
+ * Replace dellen bytes at off with inslen bytes of data (so with
+ * dellen == inslen it overwrites, with dellen 0 it inserts and with
+ * inslen 0 it deletes).
+ *************************************************************
+ */
+_Bool piece_replace( PieceTable *pt, size_t off, size_t dellen,
+                     const unsigned char *data, size_t inslen )
+{
+    const size_t addlen = pt ? pt->addlen : 0;
+    Piece  ins;
+
+    if ( !pt || off > pt->len || (!data && inslen) )
+        return false;
+    if ( 0 == inslen )
+        return 0 == dellen || off == pt->len || piece_edit( pt, off, dellen, NULL, addlen );
+
+    if ( !piece_append( pt, data, inslen ) )
+        return false;
+    ins.off    = addlen;
+    ins.len    = inslen;
+    ins.src    = PIECE_ADD;
+    ins.period = 0;
+
+    return piece_edit( pt, off, dellen, &ins, addlen );
+}
+
+/*********************************************************//**
+ * Replace dellen bytes at off with the inslen bytes stored in the
+ * room made by piece_reserve().
+ *************************************************************
+ */
+_Bool piece_commit( PieceTable *pt, size_t off, size_t dellen, size_t inslen )
+{
+    const size_t addlen = pt ? pt->addlen : 0;
+    Piece  ins;
+
+    if ( !pt || off > pt->len || inslen > pt->addcap - pt->addlen )
+        return false;
+    if ( 0 == inslen )
+        return piece_replace( pt, off, dellen, NULL, 0 );
+
+    pt->addlen += inslen;
+    ins.off    = addlen;
+    ins.len    = inslen;
+    ins.src    = PIECE_ADD;
+    ins.period = 0;
+
+    return piece_edit( pt, off, dellen, &ins, addlen );
+}
+
+/*********************************************************//**
+ * Overwrite len bytes at off with pat[0..patlen) repeated (past the
+ * end, the data grows). Only the pattern is stored.
+ *************************************************************
+ */
+_Bool piece_fill( PieceTable *pt, size_t off, size_t len,
+                  const unsigned char *pat, size_t patlen )
+{
+    const size_t addlen = pt ? pt->addlen : 0;
+    Piece  ins;
+
+    if ( !pt || off > pt->len || !pat || 0 == patlen || patlen > (unsigned)-1 )
+        return false;
+    if ( 0 == len )
+        return true;
+
+    if ( !piece_append( pt, pat, patlen ) )
+        return false;
+    ins.off    = addlen;
+    ins.len    = len;
+    ins.src    = PIECE_FILL;
+    ins.period = (unsigned) patlen;
+
+    return piece_edit( pt, off, len, &ins, addlen );
+}
+
+/*********************************************************//**
+ * Undo the last done edit. Return false if there is none.
+ *************************************************************
+ */
+_Bool piece_undo( PieceTable *pt )
+{
+    const PieceEdit *e;
+
+    if ( !pt || 0 == pt->ndone )
+        return false;
+
+    e = &pt->edits[pt->ndone-1];
+    if ( !piece_splice( pt, e->at, e->nnew, e->old, e->nold ) )
+        return false;
+    pt->ndone--;
+
+    return true;
+}
+
+/*********************************************************//**
+ * Redo the last undone edit. Return false if there is none.
+ *************************************************************
+ */
+_Bool piece_redo( PieceTable *pt )
+{
+    const PieceEdit *e;
+
+    if ( !pt || pt->ndone == pt->nedits )
+        return false;
+
+    e = &pt->edits[pt->ndone];
+    if ( !piece_splice( pt, e->at, e->nold, e->new, e->nnew ) )
+        return false;
+    pt->ndone++;
+
+    return true;
+}
+
+/*********************************************************//**
+ * Return true if the edited data differs from the original (as far
+ * as the edits go: undoing all of them makes it clean again).
+ *************************************************************
+ */
+_Bool piece_dirty( const PieceTable *pt )
+{
+    return pt && pt->ndone > 0;
+}
+
+#ifdef HV_POSIX
+/*********************************************************//**
+ * Write all of n bytes to fd at off (or at its current offset, if
+ * off is (off_t)-1).
+ *************************************************************
+ */
+static _Bool piece_write( int fd, const unsigned char *p, size_t n, off_t off )
+{
+    while ( n > 0 ) {
+        const ssize_t k = (off == (off_t)-1) ? write( fd, p, myMIN(n, (size_t)PIECE_IOLEN) )
+                                            : pwrite( fd, p, myMIN(n, (size_t)PIECE_IOLEN), off );
+        if ( k < 0 ) {
+            if ( EINTR == errno )
+                continue;
+            return false;
+        }
+        p += k;
+        n -= k;
+        if ( off != (off_t)-1 )
+            off += k;
+    }
+    return true;
+}
+
+/*********************************************************//**
+ * Write only the overwritten bytes back into the original file
+ * (only valid when no original byte has moved).
+ *************************************************************
+ */
+static _Bool piece_save_inplace( const PieceTable *pt, const char *fname )
+{
+    unsigned char *chunk = NULL;
+    size_t i, off, n;
+    int    fd;
+
+    if ( -1 == (fd = open( fname, O_WRONLY )) )
+        return false;
+    if ( NULL == (chunk = malloc( PIECE_IOLEN )) )
+        goto ret_failure;
+
+    for (i=0; i < pt->npieces; i++)
+    {
+        const Piece *p = &pt->pieces[i];
+        if ( PIECE_ORIG == p->src )
+            continue;
+        for (off = p->pos; off < p->pos + p->len; off += n) {
+            n = piece_read( pt, off, chunk, myMIN( p->pos + p->len - off, (size_t) PIECE_IOLEN ) );
+            if ( !piece_write( fd, chunk, n, (off_t) off ) )
+                goto ret_failure;
+        }
+    }
+    if ( 0 != fsync( fd ) )
+        goto ret_failure;
+
+    free( chunk );
+    return 0 == close( fd );
+
+ret_failure:
+    free( chunk );
+    close( fd );
+    return false;
+}
+
+/*********************************************************//**
+ * Write the whole edited data to a temp file next to fname, and
+ * rename it to fname (so fname is replaced at once, or not at all).
+ *************************************************************
+ */
+static _Bool piece_save_rename( const PieceTable *pt, const char *fname )
+{
+    const size_t len = strlen( fname );
+    unsigned char *chunk = NULL;
+    char   *tmp = NULL;
+    struct stat st;
+    size_t off, n;
+    mode_t mode;
+    int    fd = -1;
+
+    if ( 0 == stat( fname, &st ) )
+        mode = st.st_mode & 07777;
+    else {
+        mode = umask( 0 );
+        umask( mode );
+        mode = 0666 & ~mode;
+    }
+
+    if ( NULL == (tmp = malloc( len + sizeof(".XXXXXX") )) )
+        goto ret_failure;
+    memcpy( tmp, fname, len );
+    memcpy( &tmp[len], ".XXXXXX", sizeof(".XXXXXX") );
+    if ( -1 == (fd = mkstemp( tmp )) ) {
+        free( tmp );
+        tmp = NULL;
+        goto ret_failure;
+    }
+
+    if ( NULL == (chunk = malloc( PIECE_IOLEN )) )
+        goto ret_failure;
+    for (off=0; off < pt->len; off += n) {
+        n = piece_read( pt, off, chunk, PIECE_IOLEN );
+        if ( !piece_write( fd, chunk, n, (off_t)-1 ) )
+            goto ret_failure;
+    }
+    if ( 0 != fchmod( fd, mode ) || 0 != fsync( fd ) )
+        goto ret_failure;
+    if ( 0 != close( fd ) ) {
+        fd = -1;
+        goto ret_failure;
+    }
+    fd = -1;
+    if ( 0 != rename( tmp, fname ) )
+        goto ret_failure;
+
+    free( chunk );
+    free( tmp );
+    return true;
+
+ret_failure:
+    if ( fd != -1 )
+        close( fd );
+    if ( tmp ) {
+        unlink( tmp );
+        free( tmp );
+    }
+    free( chunk );
+    return false;
+}
+#endif
+
+/*********************************************************//**
+ * Save the edited data into fname. If inplace (fname holds the
+ * original data) and the edits only overwrote bytes, only those are
+ * written; otherwise the file is rewritten in full, via a temp file.
+ * On failure, errno tells why.
+ *************************************************************
+ */
+_Bool piece_save( const PieceTable *pt, const char *fname, _Bool inplace )
+{
+    size_t i;
+
+    if ( !pt || !fname || !*fname )
+        return false;
+
+    for (i=0; inplace && i < pt->npieces; i++)
+        if ( PIECE_ORIG == pt->pieces[i].src && pt->pieces[i].off != pt->pieces[i].pos )
+            inplace = false;
+    inplace = inplace && pt->len == pt->origlen;
+
+#ifdef HV_POSIX
+    return inplace ? piece_save_inplace( pt, fname ) : piece_save_rename( pt, fname );
+#else
+    {
+        unsigned char *chunk = malloc( PIECE_IOLEN );
+        FILE   *fp = NULL;
+        size_t off, n;
+        _Bool  ok = false;
+
+        (void) inplace;
+        if ( chunk && NULL != (fp = fopen( fname, "wb" )) ) {
+            for (ok=true, off=0; ok && off < pt->len; off += n) {
+                n  = piece_read( pt, off, chunk, PIECE_IOLEN );
+                ok = (n == fwrite( chunk, 1, n, fp ));
+            }
+            ok = (0 == fclose( fp )) && ok;
+        }
+        free( chunk );
+        return ok;
+    }
+#endif
+}
+
+/*********************************************************//**
+ * Free everything but the original data.
+ *************************************************************
+ */
+void piece_cleanup( PieceTable *pt )
+{
+    size_t i;
+
+    if ( !pt )
+        return;
+
+    for (i=0; i < pt->nedits; i++)
+        free( pt->edits[i].old );
+    free( pt->edits );
+    free( pt->pieces );
+    free( pt->add );
+    memset( pt, 0, sizeof(PieceTable) );
+
+    return;
+}
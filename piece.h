@@ -0,0 +1,60 @@
+#ifndef PIECE_H                    /* start of inclusion guard */
+#define PIECE_H
+
+#include <stddef.h>
+
+/* -----------------------------------
+ * Editable view of read-only data (a piece table)
+ * -----------------------------------
+ */
+
+#define PIECE_IOLEN        (1024*1024)    /* bytes per write when saving        */
+
+enum PieceSrc {
+    PIECE_ORIG = 0,                /* bytes of the original data         */
+    PIECE_ADD,                    /* bytes of the append-only add buffer */
+    PIECE_FILL                    /* a pattern of the add buffer, repeated */
+};
+
+typedef struct Piece {
+    size_t      pos;            /* offset in the edited data          */
+    size_t      off;            /* offset in its source               */
+    size_t      len;            /* # of bytes                         */
+    unsigned char src;            /* enum PieceSrc                      */
+    unsigned    period;            /* pattern length (PIECE_FILL only)   */
+} Piece;
+
+typedef struct PieceEdit {
+    size_t      at;            /* 1st piece replaced                 */
+    Piece       *old, *new;        /* pieces before & after the change   */
+    size_t      nold, nnew;        /* ... and their #                    */
+} PieceEdit;
+
+typedef struct PieceTable {
+    const unsigned char *orig;        /* the original data (never written)  */
+    size_t      origlen;        /* ... and its length                 */
+    unsigned char *add;            /* inserted & overwritten bytes       */
+    size_t      addlen, addcap;        /* # of used & allocated add bytes    */
+    Piece       *pieces;        /* the edited data, in order          */
+    size_t      npieces, cap;        /* # of used & allocated pieces       */
+    size_t      len;            /* length of the edited data          */
+    PieceEdit   *edits;            /* undo (done) & redo (undone) edits  */
+    size_t      nedits, ndone;        /* # of recorded & done edits         */
+    size_t      capedits;        /* # of allocated edits               */
+} PieceTable;
+
+_Bool   piece_init( PieceTable *pt, const unsigned char *orig, size_t len );
+size_t  piece_read( const PieceTable *pt, size_t off, unsigned char *dst, size_t n );
+_Bool   piece_replace( PieceTable *pt, size_t off, size_t dellen,
+                       const unsigned char *data, size_t inslen );
+_Bool   piece_fill( PieceTable *pt, size_t off, size_t len,
+                    const unsigned char *pat, size_t patlen );
+unsigned char *piece_reserve( PieceTable *pt, size_t n );
+_Bool   piece_commit( PieceTable *pt, size_t off, size_t dellen, size_t inslen );
+_Bool   piece_undo( PieceTable *pt );
+_Bool   piece_redo( PieceTable *pt );
+_Bool   piece_dirty( const PieceTable *pt );
+_Bool   piece_save( const PieceTable *pt, const char *fname, _Bool inplace );
+void    piece_cleanup( PieceTable *pt );
+
+#endif                        /* end of inclusion guard            */
@@ -0,0 +1,172 @@
+/*****************************************************//**
+ * @brief   A work-stealing pool of threads, running numbered jobs.
+ * @file    pool.c
+ * @par Language:
+ *      C (ANSI C99) + POSIX threads
+ *
+ * @remark  Every thread owns a run of jobs [lo,hi), behind a lock of
+ *      its own: it takes its jobs from the front (lo), one at a time,
+ *      so jobs are run in order but where stolen. Out of jobs, it
+ *      looks for the thread with the longest run left (unlocked, as a
+ *      hint) and takes the back half of it (the last job, if one is
+ *      left), which becomes its own run. Thieves hold one lock at a
+ *      time, & owners only theirs, so there is no lock order to keep.
+ *      Runs only shrink or are split, so once no thread has any job
+ *      left (the ones running aside), none will: the threads return.
+ *      Threads that could not be started just have their runs stolen.
+ *********************************************************
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "hexview.h"
+#include "pool.h"
+
+typedef struct PoolWorker {
+    pthread_mutex_t lock;       /* of its run ...                     */
+    size_t      lo, hi;         /* ... of jobs [lo,hi)                */
+    struct Pool *pool;
+} PoolWorker;
+
+typedef struct Pool {
+    PoolJob     fn;
+    void        *ctx;
+    PoolWorker  *workers;
+    unsigned    nworkers;
+    unsigned long long nsteals;
+} Pool;
+
+/*********************************************************//**
+ * Take the next job of the worker w into *job. Return false if its
+ * run is over.
+ *************************************************************
+ */
+static _Bool pool_take( PoolWorker *w, size_t *job )
+{
+    _Bool got;
+
+    pthread_mutex_lock( &w->lock );
+    if ( (got = w->lo < w->hi) )
+        *job = w->lo++;
+    pthread_mutex_unlock( &w->lock );
+    return got;
+}
+
+/*********************************************************//**
+ * Steal the back half of the longest run (but w's, which is over) as
+ * the run of w, and take its 1st job into *job. Return false if there
+ * is no job left to steal.
+ *************************************************************
+ */
+static _Bool pool_steal( PoolWorker *w, size_t *job )
+{
+    Pool    *pool = w->pool;
+    PoolWorker *v;
+    size_t  most, n, lo, hi;
+    unsigned i, vi;
+
+    for (;;)
+    {
+        for (most = 0, vi = 0, i = 0; i < pool->nworkers; i++) {
+            v = &pool->workers[i];
+            n = v->hi > v->lo ? v->hi - v->lo : 0;    /* a hint: not locked */
+            if ( v != w && n > most ) {
+                most = n;
+                vi   = i;
+            }
+        }
+        if ( 0 == most )
+            return false;
+
+        v = &pool->workers[vi];
+        pthread_mutex_lock( &v->lock );
+        if ( v->lo >= v->hi ) {            /* taken meanwhile: again */
+            pthread_mutex_unlock( &v->lock );
+            continue;
+        }
+        hi    = v->hi;
+        lo    = v->lo + (v->hi - v->lo) / 2;
+        v->hi = lo;
+        pthread_mutex_unlock( &v->lock );
+
+        __sync_fetch_and_add( &pool->nsteals, 1ULL );
+        pthread_mutex_lock( &w->lock );
+        w->lo = lo + 1;
+        w->hi = hi;
+        pthread_mutex_unlock( &w->lock );
+        *job = lo;
+        return true;
+    }
+}
+
+static void *pool_worker( void *arg )
+{
+    PoolWorker *w = arg;
+    size_t  job;
+
+    while ( pool_take( w, &job ) || pool_steal( w, &job ) )
+        w->pool->fn( job, w->pool->ctx );
+    return NULL;
+}
+
+/*********************************************************//**
+ * Run the jobs 0..njobs-1 by calling fn( job, ctx ) on up to nthreads
+ * threads (the calling one included), until all of them are run. If
+ * stats is not NULL, tell how they were run into it.
+ *************************************************************
+ */
+_Bool pool_run( size_t njobs, unsigned nthreads, PoolJob fn, void *ctx, PoolStats *stats )
+{
+    Pool    pool;
+    pthread_t *tids;
+    unsigned t, nstarted = 0;
+
+    if ( !fn )
+        return false;
+    if ( nthreads < 1 )
+        nthreads = 1;
+    if ( nthreads > njobs )
+        nthreads = njobs > 0 ? (unsigned) njobs : 1;
+
+    memset( &pool, 0, sizeof(Pool) );
+    pool.fn       = fn;
+    pool.ctx      = ctx;
+    pool.nworkers = nthreads;
+    pool.workers  = calloc( nthreads, sizeof(PoolWorker) );
+    tids          = calloc( nthreads, sizeof(pthread_t) );
+    if ( !pool.workers || !tids ) {
+        free( pool.workers );
+        free( tids );
+        return false;
+    }
+
+    for (t=0; t < nthreads; t++) {
+        PoolWorker *w = &pool.workers[t];
+        pthread_mutex_init( &w->lock, NULL );
+        w->lo   = njobs * t / nthreads;
+        w->hi   = njobs * (t + 1) / nthreads;
+        w->pool = &pool;
+    }
+
+    /* the calling thread is the 1st worker */
+    for (t=1; t < nthreads; t++, nstarted++)
+        if ( 0 != pthread_create( &tids[t], NULL, pool_worker, &pool.workers[t] ) )
+            break;
+    pool_worker( &pool.workers[0] );
+    for (t=1; t <= nstarted; t++)
+        pthread_join( tids[t], NULL );
+
+    if ( stats ) {
+        stats->nthreads = nstarted + 1;
+        stats->nsteals  = pool.nsteals;
+    }
+    for (t=0; t < nthreads; t++)
+        pthread_mutex_destroy( &pool.workers[t].lock );
+    free( pool.workers );
+    free( tids );
+
+    return true;
+}
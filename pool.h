@@ -0,0 +1,27 @@
+#ifndef POOL_H                        /* start of inclusion guard */
+#define POOL_H
+
+#include <stddef.h>
+
+/* -----------------------------------
+ * A work-stealing pool of threads, running numbered jobs
+ * -----------------------------------
+ *
+ * The jobs 0..njobs-1 are dealt to the threads in runs (thread t is
+ * dealt the t-th run of about njobs/nthreads of them), and each one
+ * runs its own in order. A thread done with its run steals the back
+ * half of the longest run left, so all of them keep busy to the end
+ * however long the jobs take. The calling thread is one of
+ * them: pool_run() returns once all the jobs are run.
+ */
+
+typedef void (*PoolJob)( size_t job, void *ctx );
+
+typedef struct PoolStats {
+    unsigned    nthreads;           /* threads that ran jobs              */
+    unsigned long long nsteals;     /* runs stolen                        */
+} PoolStats;
+
+_Bool   pool_run( size_t njobs, unsigned nthreads, PoolJob fn, void *ctx, PoolStats *stats );
+
+#endif                        /* end of inclusion guard            */
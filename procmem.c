@@ -0,0 +1,429 @@
+/*****************************************************//**
+ * @brief   The memory of a live process, read on demand.
+ * @file    procmem.c
+ * @par Language:
+ *      C (ANSI C99) (+ Linux /proc, process_vm_readv & sigaction)
+ *
+ * @remark  The regions listed by /proc/<pid>/maps that can be read are
+ *      laid end to end into a mirror: an anonymous mapping reserved
+ *      with no access, so it costs no memory until its pages are read
+ *      (& its offsets are contiguous, as the callers' data must be).
+ *      Touching a page not read yet faults: the SIGSEGV handler reads
+ *      the PROCMEM_WINDOW pages around it (those not read yet) & lets
+ *      the access go on, so any code scanning the data (searches,
+ *      hashes, strings ...) reads the process as it goes. Callers may
+ *      also fetch a range at once, or read it again (e.g. the screen
+ *      being viewed, to show the process live). Either way, every page
+ *      is a pair of iovecs, and up to PROCMEM_BATCH pages are read by
+ *      one process_vm_readv() call (resuming past any page that cannot
+ *      be read, which is zeroed). Once more than maxresident bytes are
+ *      held, they are all given back (& read again when touched).
+ *********************************************************
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE                /* process_vm_readv */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include "hexview.h"
+#include "procmem.h"
+
+#if defined(__linux__)
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+#define PROCMEM_BATCH        1024        /* max pages per process_vm_readv() (IOV_MAX) */
+#define PROCMEM_MAXOPEN        16        /* max processes mirrored at once     */
+
+#define FETCHED(pm, p)        ((pm)->fetched[(p) >> 3] & (1U << ((p) & 7)))
+
+static ProcMem *procs[ PROCMEM_MAXOPEN ];    /* the mirrors the handler serves */
+static _Bool   handling = false;        /* the handler installed?             */
+static volatile int lock = 0;            /* guards the mirrors' pages          */
+
+/*********************************************************//**
+ * Take & release the lock of the pages (a spin lock: it is taken in
+ * the SIGSEGV handler, by any thread).
+ *************************************************************
+ */
+static void procmem_lock( void )
+{
+    while ( __sync_lock_test_and_set( &lock, 1 ) )
+        ;
+    return;
+}
+
+static void procmem_unlock( void )
+{
+    __sync_lock_release( &lock );
+    return;
+}
+
+/*********************************************************//**
+ * Give back all the pages of the mirror read so far (lock held).
+ *************************************************************
+ */
+static void procmem_dropall( ProcMem *pm )
+{
+    madvise( pm->data, pm->len, MADV_DONTNEED );
+    mprotect( pm->data, pm->len, PROT_NONE );
+    memset( pm->fetched, 0, (pm->len / pm->pagelen + 7) / 8 );
+    pm->nresident = 0;
+    return;
+}
+
+/*********************************************************//**
+ * Read the pages [first,last] of the mirror from the process: those
+ * not read yet, or all of them if refresh, and page force anyway (the
+ * lock is taken). Pages that cannot be read are zeroed. Return false
+ * if the process cannot be read at all (gone, or not allowed).
+ *************************************************************
+ */
+static _Bool procmem_pages( ProcMem *pm, size_t first, size_t last, _Bool refresh, size_t force )
+{
+    struct iovec local[ PROCMEM_BATCH ], remote[ PROCMEM_BATCH ];
+    const ProcRegion *r;
+    size_t  p, i, n, nnew = 0;
+    ssize_t got;
+    _Bool   ok = true;
+
+    procmem_lock();
+
+    /* make room (all at once: the pages touched last are read again) */
+    for (p=first; p <= last; p++)
+        nnew += !FETCHED( pm, p );
+    if ( (pm->nresident + nnew) * pm->pagelen > pm->maxresident )
+        procmem_dropall( pm );
+    if ( 0 != mprotect( &pm->data[first * pm->pagelen], (last - first + 1) * pm->pagelen,
+                        PROT_READ | PROT_WRITE )
+    ) {
+        procmem_unlock();
+        return false;
+    }
+
+    r = procmem_region( pm, first * pm->pagelen );
+    for (p=first; p <= last; )
+    {
+        /* a batch of pages: to their place in the mirror, from the process */
+        for (n=0; p <= last && n < PROCMEM_BATCH; p++)
+        {
+            if ( FETCHED( pm, p ) && !refresh && p != force )
+                continue;
+            while ( p * pm->pagelen >= r->off + r->len )
+                r++;
+            local[n].iov_base  = &pm->data[p * pm->pagelen];
+            remote[n].iov_base = (void *) (uintptr_t) (r->addr + (p * pm->pagelen - r->off));
+            local[n].iov_len   = remote[n].iov_len = pm->pagelen;
+            n++;
+            if ( !FETCHED( pm, p ) ) {
+                pm->fetched[p >> 3] |= 1U << (p & 7);
+                pm->nresident++;
+            }
+        }
+
+        /* read them, going on past any page that cannot be read */
+        for (i=0; i < n; )
+        {
+            got = ok ? process_vm_readv( pm->pid, &local[i], n - i, &remote[i], n - i, 0 ) : -1;
+            pm->nreads += ok;
+            if ( got < 0 && (ESRCH == errno || EPERM == errno) )
+                ok = false;
+            if ( got > 0 ) {
+                pm->npages += (size_t) got / pm->pagelen;
+                i += (size_t) got / pm->pagelen;
+            }
+            if ( i < n )
+                memset( local[i++].iov_base, 0, pm->pagelen );
+        }
+    }
+
+    procmem_unlock();
+    return ok;
+}
+
+/*********************************************************//**
+ * The SIGSEGV handler: read the window of pages around the address
+ * faulted at, if it is in a mirror, or else fault again as if there
+ * was no handler.
+ *************************************************************
+ */
+static void procmem_fault( int sig, siginfo_t *si, void *uctx )
+{
+    const unsigned char *at = si->si_addr;
+    const int saved = errno;
+    size_t  i, page, first;
+
+    (void) uctx;
+    for (i=0; i < PROCMEM_MAXOPEN; i++)
+    {
+        ProcMem *pm = procs[i];
+
+        if ( !pm || at < pm->data || at >= pm->data + pm->len )
+            continue;
+        page  = (size_t) (at - pm->data) / pm->pagelen;
+        first = page - page % PROCMEM_WINDOW;
+        procmem_pages( pm, first, myMIN( first + PROCMEM_WINDOW, pm->len / pm->pagelen ) - 1,
+                       false, page );
+        errno = saved;
+        return;
+    }
+
+    signal( sig, SIG_DFL );
+    errno = saved;
+    return;
+}
+
+/*********************************************************//**
+ * Add a readable region of the maps of a process to the mirror.
+ *************************************************************
+ */
+static _Bool procmem_add( ProcMem *pm, size_t *cap, unsigned long long from,
+                          unsigned long long to, const char *perms, const char *name )
+{
+    ProcRegion *r;
+
+    if ( pm->nregions == *cap ) {
+        const size_t newcap = *cap ? 2 * *cap : 64;
+        if ( NULL == (r = realloc( pm->regions, newcap * sizeof(ProcRegion) )) )
+            return false;
+        pm->regions = r;
+        *cap = newcap;
+    }
+
+    r = &pm->regions[ pm->nregions++ ];
+    r->addr = from;
+    r->off  = pm->len;
+    r->len  = (size_t) (to - from);
+    memcpy( r->perms, perms, 4 );
+    r->perms[4] = '\0';
+    strncpy( r->name, name, PROCMEM_NAMELEN - 1 );
+    r->name[ PROCMEM_NAMELEN - 1 ] = '\0';
+    pm->len += r->len;
+
+    return true;
+}
+
+/*********************************************************//**
+ * Mirror the memory of the process pid (nothing is read yet, but the
+ * 1st page, to make sure it can be), holding at most maxresident bytes
+ * of it in memory (PROCMEM_MAXRESIDENT if 0). Return NULL on failure.
+ *************************************************************
+ */
+ProcMem *procmem_open( int pid, size_t maxresident )
+{
+    char    line[ 512 + PROCMEM_NAMELEN ], perms[5];
+    unsigned long long from, to;
+    ProcMem *pm = NULL;
+    FILE    *fp = NULL;
+    size_t  cap = 0, i;
+    int     name;
+
+    for (i=0; i < PROCMEM_MAXOPEN && procs[i]; i++)
+        ;
+    if ( PROCMEM_MAXOPEN == i ) {
+        errno = EMFILE;
+        return NULL;
+    }
+
+    snprintf( line, sizeof(line), "/proc/%d/maps", pid );
+    if ( NULL == (fp = fopen( line, "r" )) || NULL == (pm = calloc( 1, sizeof(ProcMem) )) )
+        goto ret_failure;
+    pm->pid         = pid;
+    pm->pagelen     = (size_t) sysconf( _SC_PAGESIZE );
+    pm->maxresident = maxresident ? maxresident : PROCMEM_MAXRESIDENT;
+    pm->maxresident = myMAX( pm->maxresident, 2 * PROCMEM_WINDOW * pm->pagelen );
+
+    /* from-to perms offset dev inode [name]: the readable ones (but the kernel's) */
+    while ( fgets( line, sizeof(line), fp ) )
+    {
+        name = 0;
+        if ( 3 != sscanf( line, "%llx-%llx %4s %*x %*x:%*x %*u %n", &from, &to, perms, &name )
+            || 'r' != perms[0] || to <= from
+        )
+            continue;
+        line[ strcspn( line, "\n" ) ] = '\0';
+        if ( 0 == strncmp( &line[name], "[vvar", 5 ) || 0 == strcmp( &line[name], "[vsyscall]" ) )
+            continue;
+        if ( !procmem_add( pm, &cap, from, to, perms, &line[name] ) )
+            goto ret_failure;
+    }
+    fclose( fp );
+    fp = NULL;
+    if ( 0 == pm->len ) {
+        errno = ENOENT;
+        goto ret_failure;
+    }
+
+    /* the mirror (no memory taken yet) & which of its pages were read */
+    pm->data = mmap( NULL, pm->len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+    if ( MAP_FAILED == pm->data ) {
+        pm->data = NULL;
+        goto ret_failure;
+    }
+    if ( NULL == (pm->fetched = calloc( (pm->len / pm->pagelen + 7) / 8, 1 )) )
+        goto ret_failure;
+    if ( !procmem_pages( pm, 0, 0, false, 0 ) )
+        goto ret_failure;
+
+    if ( !handling ) {
+        struct sigaction sa;
+        memset( &sa, 0, sizeof(sa) );
+        sa.sa_sigaction = procmem_fault;
+        sa.sa_flags     = SA_SIGINFO | SA_RESTART;
+        sigemptyset( &sa.sa_mask );
+        if ( 0 != sigaction( SIGSEGV, &sa, NULL ) )
+            goto ret_failure;
+        handling = true;
+    }
+    procs[i] = pm;
+
+    return pm;
+
+ret_failure:
+    if ( fp )
+        fclose( fp );
+    procmem_close( pm );
+    return NULL;
+}
+
+/*********************************************************//**
+ * Stop mirroring the memory of a process (& free the mirror).
+ *************************************************************
+ */
+void procmem_close( ProcMem *pm )
+{
+    const int saved = errno;
+    size_t i;
+
+    if ( !pm )
+        return;
+    for (i=0; i < PROCMEM_MAXOPEN; i++)
+        if ( procs[i] == pm )
+            procs[i] = NULL;
+    if ( pm->data )
+        munmap( pm->data, pm->len );
+    free( pm->fetched );
+    free( pm->regions );
+    free( pm );
+
+    errno = saved;
+    return;
+}
+
+/*********************************************************//**
+ * Read the pages of the bytes [off,off+n) of the mirror (at most
+ * maxresident of them) from the process, in as few calls as can be:
+ * those not read yet, or all of them if refresh.
+ *************************************************************
+ */
+_Bool procmem_fetch( ProcMem *pm, size_t off, size_t n, _Bool refresh )
+{
+    size_t first, last;
+
+    if ( off >= pm->len || 0 == n )
+        return true;
+    first = off / pm->pagelen;
+    last  = (myMIN( n, pm->len - off ) + off - 1) / pm->pagelen;
+    last  = myMIN( last, first + pm->maxresident / pm->pagelen - 1 );
+
+    return procmem_pages( pm, first, last, refresh, (size_t) -1 );
+}
+
+/*********************************************************//**
+ * Give back all the pages of the mirror read so far.
+ *************************************************************
+ */
+void procmem_drop( ProcMem *pm )
+{
+    procmem_lock();
+    procmem_dropall( pm );
+    procmem_unlock();
+    return;
+}
+
+#else                        /* no /proc, no process_vm_readv */
+
+ProcMem *procmem_open( int pid, size_t maxresident )
+{
+    (void) pid;
+    (void) maxresident;
+    errno = ENOTSUP;
+    return NULL;
+}
+
+void procmem_close( ProcMem *pm )
+{
+    (void) pm;
+    return;
+}
+
+_Bool procmem_fetch( ProcMem *pm, size_t off, size_t n, _Bool refresh )
+{
+    (void) pm;
+    (void) off;
+    (void) n;
+    (void) refresh;
+    return false;
+}
+
+void procmem_drop( ProcMem *pm )
+{
+    (void) pm;
+    return;
+}
+#endif
+
+/*********************************************************//**
+ * Return the region of the mirror where offset off is (the last one,
+ * if past its end).
+ *************************************************************
+ */
+const ProcRegion *procmem_region( const ProcMem *pm, size_t off )
+{
+    size_t lo = 0, hi = pm->nregions - 1, mid;
+
+    while ( lo < hi ) {
+        mid = lo + (hi - lo + 1) / 2;
+        if ( pm->regions[mid].off <= off )
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return &pm->regions[lo];
+}
+
+/*********************************************************//**
+ * Convert an offset of the mirror to the address of the process it
+ * mirrors, or back (HV_NOTFOUND if the address is not mirrored).
+ *************************************************************
+ */
+unsigned long long procmem_addr( const ProcMem *pm, size_t off )
+{
+    const ProcRegion *r = procmem_region( pm, off );
+    return r->addr + (off - r->off);
+}
+
+size_t procmem_offset( const ProcMem *pm, unsigned long long addr )
+{
+    size_t lo = 0, hi = pm->nregions - 1, mid;
+
+    while ( lo < hi ) {
+        mid = lo + (hi - lo + 1) / 2;
+        if ( pm->regions[mid].addr <= addr )
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    if ( addr < pm->regions[lo].addr || addr - pm->regions[lo].addr >= pm->regions[lo].len )
+        return (size_t) -1;
+    return pm->regions[lo].off + (size_t) (addr - pm->regions[lo].addr);
+}
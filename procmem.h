@@ -0,0 +1,49 @@
+#ifndef PROCMEM_H                    /* start of inclusion guard */
+#define PROCMEM_H
+
+#include <stddef.h>
+
+/* -----------------------------------
+ * The memory of a live process, as one sparse address space
+ * -----------------------------------
+ *
+ * The regions of /proc/<pid>/maps that can be read are laid end to
+ * end into a mirror (reserved, not backed by memory): offset off of
+ * the mirror is the address procmem_addr() of the process. Its pages
+ * are read from the process on demand (by process_vm_readv(), many
+ * pages per call), as they are first touched or when fetched again,
+ * and given back once more than maxresident bytes of them are held.
+ */
+
+#define PROCMEM_NAMELEN        64        /* max chars of a region's name (+'\0') */
+#define PROCMEM_WINDOW        64        /* pages read at once, on a page fault */
+#define PROCMEM_MAXRESIDENT    (256*1024*1024)    /* default max bytes held in memory  */
+
+typedef struct ProcRegion {
+    unsigned long long addr;        /* where it is in the process ...     */
+    size_t      off, len;        /* ... & in the mirror                */
+    char        perms[5];        /* e.g. "rw-p"                        */
+    char        name[ PROCMEM_NAMELEN ];  /* file, [heap], [stack] ... or "" */
+} ProcRegion;
+
+typedef struct ProcMem {
+    int         pid;
+    ProcRegion  *regions;        /* sorted by address (& offset)       */
+    size_t      nregions;
+    unsigned char *data;        /* the mirror ...                     */
+    size_t      len;            /* ... of len bytes                   */
+    unsigned char *fetched;        /* 1 bit per page of it, if read      */
+    size_t      pagelen, nresident, maxresident;
+    unsigned long long nreads, npages;    /* process_vm_readv() calls & pages read */
+} ProcMem;
+
+ProcMem *procmem_open( int pid, size_t maxresident );
+void    procmem_close( ProcMem *pm );
+_Bool   procmem_fetch( ProcMem *pm, size_t off, size_t n, _Bool refresh );
+void    procmem_drop( ProcMem *pm );
+
+const ProcRegion *procmem_region( const ProcMem *pm, size_t off );
+unsigned long long procmem_addr( const ProcMem *pm, size_t off );
+size_t  procmem_offset( const ProcMem *pm, unsigned long long addr );
+
+#endif                        /* end of inclusion guard            */
@@ -0,0 +1,834 @@
+/*****************************************************//**
+ * @brief   Serving files to local clients, over a Unix domain socket.
+ * @file    server.c
+ * @par Language:
+ *      C (ANSI C99) (+ POSIX sockets, poll & threads)
+ *
+ * @remark  The server keeps the files its clients open mapped (or in
+ *      memory) for as long as it runs, up to SERVER_MAXFILES of them
+ *      (those not open by any client are closed least recently used
+ *      first, past that), with the digests hashed of each one cached:
+ *      a file opened by many clients, or many times, is loaded just
+ *      once, & its pages stay in the OS cache. It is reopened (& its
+ *      digests dropped) once the file changes, as a SERVER_OPEN finds
+ *      by its stat(); the bytes of a file that shrank under a handle
+ *      still open to it are an EIO (not a SIGBUS). The main thread polls
+ *      the socket & the clients connected, handing each request to a
+ *      pool of threads (a client is polled again once its request is
+ *      replied to), so idle clients cost no thread, and busy ones are
+ *      served in parallel. Requests & replies are a fixed ServerMsg
+ *      and a payload (see server.h), read & written whole. SIGINT or
+ *      SIGTERM stop the server, removing its socket.
+ *********************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <setjmp.h>
+
+#include "hexview.h"
+#include "libhexview.h"
+#include "server.h"
+
+#ifdef HV_POSIX
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+
+#define SERVER_TIMEOUT        10        /* secs a request may take to arrive  */
+#define SERVER_ALGLEN        16        /* max chars of a hash alg (+'\0')    */
+
+typedef struct Digest {
+    char        alg[ SERVER_ALGLEN ];
+    uint64_t    from, to;        /* of the bytes [from,to) ...         */
+    char        hex[ HV_HEXLEN ];    /* ... hashed by alg                  */
+} Digest;
+
+typedef struct SrvFile {
+    char        *path;            /* absolute, as opened by clients     */
+    HvFile      *hv;
+    struct stat st;            /* the file opened (see server_sameid) */
+    _Bool       stale;            /* path is another file (or changed)  */
+    unsigned    refs;            /* # of client handles to it          */
+    unsigned long used;            /* when it was last opened            */
+    pthread_mutex_t lock;        /* guards its digests                 */
+    Digest      digests[ SERVER_NDIGESTS ];
+    unsigned    ndigests, next;        /* # cached & the one replaced next   */
+} SrvFile;
+
+typedef struct SrvConn {
+    int         fd;            /* -1 if the slot is free             */
+    _Bool       busy;            /* a request of it is being served    */
+    SrvFile     *files[ SERVER_MAXHANDLES ];  /* by handle             */
+} SrvConn;
+
+typedef struct Worker {
+    pthread_t   tid;
+    unsigned char *req, *rep;        /* payloads (SERVER_MAXLEN+1 each)    */
+} Worker;
+
+static struct {
+    pthread_mutex_t lock;        /* guards all but the workers' own    */
+    pthread_cond_t  ready;        /* requests queued (or stopping)      */
+    SrvFile     *files[ SERVER_MAXFILES ];
+    size_t      nfiles;
+    unsigned long clock;        /* stamps files opened                */
+    SrvConn     conns[ SERVER_MAXCONNS ];
+    size_t      queue[ SERVER_MAXCONNS ];  /* conns with a request ...  */
+    size_t      qhead, qlen;        /* ... as a ring                      */
+    _Bool       stopping;
+    int         wake[2];        /* workers wake the poller through it */
+    unsigned long long nreqs;        /* # of requests served               */
+} srv;
+
+static volatile sig_atomic_t stop = 0;
+static __thread sigjmp_buf *busjmp = NULL;  /* where a worker's SIGBUS goes */
+
+/*********************************************************//**
+ * Ask the server to stop.
+ *************************************************************
+ */
+static void on_stop( int sig )
+{
+    (void) sig;
+    stop = 1;
+    return;
+}
+
+/*********************************************************//**
+ * A page of a file mapped is past its end (it shrank): fail the
+ * request of the worker touching it, or else crash as we would have.
+ *************************************************************
+ */
+static void on_bus( int sig )
+{
+    if ( busjmp )
+        siglongjmp( *busjmp, 1 );
+    signal( sig, SIG_DFL );
+    raise( sig );
+    return;
+}
+
+/*********************************************************//**
+ * Read n bytes from fd into buf (all of them). Return the # read: less
+ * than n only at end of input, or on error.
+ *************************************************************
+ */
+static size_t server_readall( int fd, void *buf, size_t n )
+{
+    size_t  done = 0;
+    ssize_t r;
+
+    while ( done < n ) {
+        if ( (r = read( fd, (char *) buf + done, n - done )) < 0 ) {
+            if ( EINTR == errno )
+                continue;
+            break;
+        }
+        if ( 0 == r )
+            break;
+        done += (size_t) r;
+    }
+    return done;
+}
+
+/*********************************************************//**
+ * Write the n bytes of buf to the socket fd (all of them, with no
+ * SIGPIPE if the peer is gone). Return false on error.
+ *************************************************************
+ */
+static _Bool server_writeall( int fd, const void *buf, size_t n )
+{
+    size_t  done = 0;
+    ssize_t w;
+
+    while ( done < n ) {
+        if ( (w = send( fd, (const char *) buf + done, n - done, MSG_NOSIGNAL )) < 0 ) {
+            if ( EINTR == errno )
+                continue;
+            return false;
+        }
+        done += (size_t) w;
+    }
+    return true;
+}
+
+/*********************************************************//**
+ * Drop a handle to f (locked). Files stay open until evicted.
+ *************************************************************
+ */
+static void server_unref( SrvFile *f )
+{
+    if ( f && f->refs > 0 )
+        f->refs--;
+    return;
+}
+
+/*********************************************************//**
+ * Close f (not open by any client; unlocked).
+ *************************************************************
+ */
+static void server_closefile( SrvFile *f )
+{
+    hv_close( f->hv );
+    pthread_mutex_destroy( &f->lock );
+    free( f->path );
+    free( f );
+    return;
+}
+
+/*********************************************************//**
+ * Is st the very file f was opened as (as the cache of entropy.c
+ * tells it: same device, inode, size & time modified)?
+ *************************************************************
+ */
+static _Bool server_sameid( const SrvFile *f, const struct stat *st )
+{
+    return f->st.st_dev == st->st_dev && f->st.st_ino == st->st_ino
+        && f->st.st_size == st->st_size
+        && f->st.st_mtim.tv_sec == st->st_mtim.tv_sec
+        && f->st.st_mtim.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+/*********************************************************//**
+ * Look up the file path, as st, among those open (locked): return it
+ * with a handle more to it, or NULL. Those open as path but no longer
+ * st are stale: closed if open by no client, else left to them.
+ *************************************************************
+ */
+static SrvFile *server_findfile( const char *path, const struct stat *st )
+{
+    SrvFile *f;
+    size_t  i;
+
+    for (i=0; i < srv.nfiles; )
+    {
+        f = srv.files[i];
+        if ( f->stale || 0 != strcmp( f->path, path ) )
+            ;
+        else if ( server_sameid( f, st ) ) {
+            f->refs++;
+            f->used = ++srv.clock;
+            return f;
+        }
+        else
+            f->stale = true;
+        if ( f->stale && 0 == f->refs ) {
+            srv.files[i] = srv.files[ --srv.nfiles ];
+            server_closefile( f );
+            continue;
+        }
+        i++;
+    }
+    return NULL;
+}
+
+/*********************************************************//**
+ * Return the file path open by the server, opening it if not, or if
+ * it changed since (& one of those open by no client, least recently
+ * used, closed to make room if need be) with a handle more to it, or
+ * NULL on error.
+ *************************************************************
+ */
+static SrvFile *server_openfile( const char *path )
+{
+    SrvFile *f = NULL, *evicted = NULL;
+    size_t  i, lru = SERVER_MAXFILES;
+    struct stat st;
+
+    if ( -1 == stat( path, &st ) )
+        return NULL;
+    pthread_mutex_lock( &srv.lock );
+    f = server_findfile( path, &st );
+    pthread_mutex_unlock( &srv.lock );
+    if ( f )
+        return f;
+
+    /* open it unlocked (reading it into memory may take long) */
+    if ( NULL == (f = calloc( 1, sizeof(SrvFile) )) )
+        return NULL;
+    if ( NULL == (f->path = malloc( strlen(path) + 1 )) ) {
+        free( f );
+        return NULL;
+    }
+    strcpy( f->path, path );
+    f->st = st;                /* changed meanwhile? reopened next time */
+    if ( NULL == (f->hv = hv_open( path, false )) ) {
+        free( f->path );
+        free( f );
+        return NULL;
+    }
+    pthread_mutex_init( &f->lock, NULL );
+
+    pthread_mutex_lock( &srv.lock );
+    {
+        SrvFile *other = server_findfile( path, &st );
+
+        if ( other ) {                /* opened meanwhile? use that */
+            pthread_mutex_unlock( &srv.lock );
+            server_closefile( f );
+            return other;
+        }
+    }
+    if ( SERVER_MAXFILES == srv.nfiles ) {
+        for (i=0; i < srv.nfiles; i++)
+            if ( 0 == srv.files[i]->refs
+                && (SERVER_MAXFILES == lru || srv.files[i]->used < srv.files[lru]->used)
+            )
+                lru = i;
+        if ( SERVER_MAXFILES == lru ) {
+            pthread_mutex_unlock( &srv.lock );
+            server_closefile( f );
+            errno = EMFILE;
+            return NULL;
+        }
+        evicted = srv.files[lru];
+        srv.files[lru] = srv.files[ --srv.nfiles ];
+    }
+    f->refs = 1;
+    f->used = ++srv.clock;
+    srv.files[ srv.nfiles++ ] = f;
+    pthread_mutex_unlock( &srv.lock );
+
+    if ( evicted )
+        server_closefile( evicted );
+    return f;
+}
+
+/*********************************************************//**
+ * Hash [from,to) of f with alg into hex, or copy the digest cached
+ * (if the file did not change since it was opened: else the digests
+ * are dropped, & no more cached).
+ *************************************************************
+ */
+static _Bool server_hash( SrvFile *f, const char *alg, uint64_t from, uint64_t to, char *hex )
+{
+    struct stat st;
+    Digest  *d;
+    unsigned i;
+    _Bool   same;
+
+    same = 0 == stat( f->path, &st ) && server_sameid( f, &st );
+    pthread_mutex_lock( &f->lock );
+    if ( !same )
+        f->ndigests = f->next = 0;
+    for (i=0; i < f->ndigests; i++) {
+        d = &f->digests[i];
+        if ( d->from == from && d->to == to && 0 == strcmp( d->alg, alg ) ) {
+            strcpy( hex, d->hex );
+            pthread_mutex_unlock( &f->lock );
+            return true;
+        }
+    }
+    pthread_mutex_unlock( &f->lock );
+
+    if ( strlen( alg ) >= SERVER_ALGLEN || from > to || to > hv_size( f->hv ) ) {
+        errno = EINVAL;
+        return false;
+    }
+    if ( !hv_hash( f->hv, alg, (size_t) from, (size_t) to, hex, HV_HEXLEN ) )
+        return false;
+    if ( !same )
+        return true;
+
+    pthread_mutex_lock( &f->lock );
+    d = &f->digests[ f->next ];
+    strcpy( d->alg, alg );
+    d->from = from;
+    d->to   = to;
+    strcpy( d->hex, hex );
+    f->next = (f->next + 1) % SERVER_NDIGESTS;
+    if ( f->ndigests < SERVER_NDIGESTS )
+        f->ndigests++;
+    pthread_mutex_unlock( &f->lock );
+
+    return true;
+}
+
+/*********************************************************//**
+ * Serve a request of the client c, read into msg & w->req. Return the
+ * length of the payload of its reply (in w->rep), with msg updated to
+ * be the reply (of status an errno, on error: EIO if the file shrank
+ * under the bytes asked for).
+ *************************************************************
+ */
+static size_t server_do( SrvConn *c, ServerMsg *msg, Worker *w )
+{
+    SrvFile * volatile f = NULL;    /* (kept past a siglongjmp) */
+    size_t  len = 0, i;
+    sigjmp_buf jb;
+
+    msg->status = 0;
+    if ( SERVER_OPEN != msg->op ) {
+        pthread_mutex_lock( &srv.lock );
+        f = msg->file < SERVER_MAXHANDLES ? c->files[ msg->file ] : NULL;
+        pthread_mutex_unlock( &srv.lock );
+        if ( !f ) {
+            msg->status = EBADF;
+            return 0;
+        }
+    }
+    errno = 0;
+
+    if ( sigsetjmp( jb, 1 ) ) {        /* SIGBUS, reading f */
+        busjmp = NULL;
+        msg->status = EIO;
+        return 0;
+    }
+    busjmp = &jb;
+
+    switch ( msg->op )
+    {
+    case SERVER_OPEN:
+        if ( '/' != w->req[0] ) {
+            errno = EINVAL;            /* the server has a cwd of its own */
+            break;
+        }
+        for (i=0; i < SERVER_MAXHANDLES && c->files[i]; i++)
+            ;
+        if ( SERVER_MAXHANDLES == i ) {
+            errno = EMFILE;
+            break;
+        }
+        if ( NULL == (f = server_openfile( (const char *) w->req )) )
+            break;
+        pthread_mutex_lock( &srv.lock );
+        c->files[i] = f;
+        pthread_mutex_unlock( &srv.lock );
+        msg->file = (uint32_t) i;
+        msg->n    = hv_size( f->hv );
+        break;
+
+    case SERVER_CLOSE:
+        pthread_mutex_lock( &srv.lock );
+        server_unref( f );
+        c->files[ msg->file ] = NULL;
+        pthread_mutex_unlock( &srv.lock );
+        break;
+
+    case SERVER_ROWS: {
+        const size_t size = hv_size( f->hv );
+        uint64_t off = msg->off;
+
+        for (i=0; i < msg->n && off < size; i++, off += HV_NCOLS) {
+            if ( len + HV_ROWMAX + 1 > SERVER_MAXLEN )
+                break;
+            len += hv_format_row( f->hv, (size_t) off, msg->flags & HV_FMT_XASCII,
+                                  (char *) &w->rep[len], HV_ROWMAX );
+            w->rep[ len++ ] = '\n';
+        }
+        msg->n = i;
+        break;
+    }
+
+    case SERVER_READ:
+        len = msg->off < hv_size( f->hv )
+            ? hv_read( f->hv, (size_t) msg->off, w->rep, (size_t) myMIN( msg->n, (uint64_t) SERVER_MAXLEN ) )
+            : 0;
+        break;
+
+    case SERVER_FIND:
+        msg->off = hv_find( f->hv, (size_t) myMIN( msg->off, (uint64_t) SIZE_MAX ),
+                            w->req, msg->len, msg->flags & SERVER_BACKWARD );
+        break;
+
+    case SERVER_HASH:
+        if ( server_hash( f, (const char *) w->req, msg->off, msg->n, (char *) w->rep ) )
+            len = strlen( (char *) w->rep );
+        break;
+
+    default:
+        errno = EINVAL;
+    }
+    busjmp = NULL;
+
+    msg->status = errno;
+    return msg->status ? 0 : len;
+}
+
+/*********************************************************//**
+ * Serve a request of the client c (whose socket is ready). Return
+ * false if the client is gone (or broke the protocol).
+ *************************************************************
+ */
+static _Bool server_serve( SrvConn *c, Worker *w )
+{
+    ServerMsg msg;
+    size_t  len;
+
+    if ( sizeof(msg) != server_readall( c->fd, &msg, sizeof(msg) ) )
+        return false;
+    if ( msg.len > SERVER_MAXLEN || server_readall( c->fd, w->req, msg.len ) != msg.len )
+        return false;
+    w->req[ msg.len ] = '\0';            /* paths & algs are c-strings */
+
+    len = server_do( c, &msg, w );
+    msg.len = (uint32_t) len;
+
+    return server_writeall( c->fd, &msg, sizeof(msg) )
+        && server_writeall( c->fd, w->rep, len );
+}
+
+/*********************************************************//**
+ * Disconnect the client c (locked).
+ *************************************************************
+ */
+static void server_drop( SrvConn *c )
+{
+    size_t i;
+
+    for (i=0; i < SERVER_MAXHANDLES; i++) {
+        server_unref( c->files[i] );
+        c->files[i] = NULL;
+    }
+    close( c->fd );
+    c->fd   = -1;
+    c->busy = false;
+    return;
+}
+
+/*********************************************************//**
+ * A thread of the pool: serve the requests queued, one at a time.
+ *************************************************************
+ */
+static void *server_worker( void *arg )
+{
+    Worker  *w = arg;
+
+    for (;;)
+    {
+        SrvConn *c;
+        _Bool   alive;
+
+        pthread_mutex_lock( &srv.lock );
+        while ( 0 == srv.qlen && !srv.stopping )
+            pthread_cond_wait( &srv.ready, &srv.lock );
+        if ( srv.stopping ) {
+            pthread_mutex_unlock( &srv.lock );
+            break;
+        }
+        c = &srv.conns[ srv.queue[ srv.qhead ] ];
+        srv.qhead = (srv.qhead + 1) % SERVER_MAXCONNS;
+        srv.qlen--;
+        pthread_mutex_unlock( &srv.lock );
+
+        alive = server_serve( c, w );
+
+        pthread_mutex_lock( &srv.lock );
+        srv.nreqs++;
+        if ( alive )
+            c->busy = false;
+        else
+            server_drop( c );
+        pthread_mutex_unlock( &srv.lock );
+        if ( write( srv.wake[1], "", 1 ) < 0 ) {    /* poll it again */
+            /* the pipe is full: the poller is awake anyway */
+        }
+    }
+
+    return NULL;
+}
+
+/*********************************************************//**
+ * Create the socket sockname, listening (replacing a stale one, left
+ * by a server that is no longer running). Return it, or -1 on error.
+ *************************************************************
+ */
+static int server_listen( const char *sockname )
+{
+    struct sockaddr_un addr;
+    int     fd, peer;
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+    if ( strlen( sockname ) >= sizeof(addr.sun_path) ) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy( addr.sun_path, sockname );
+
+    if ( -1 != (peer = server_connect( sockname )) ) {
+        close( peer );
+        errno = EADDRINUSE;            /* another server is on it */
+        return -1;
+    }
+    unlink( sockname );
+
+    if ( -1 == (fd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 )) )
+        return -1;
+    if ( -1 == bind( fd, (struct sockaddr *) &addr, sizeof(addr) )
+        || -1 == listen( fd, SOMAXCONN )
+    ) {
+        close( fd );
+        return -1;
+    }
+    return fd;
+}
+
+/*********************************************************//**
+ * Accept a client on the socket lfd (locked).
+ *************************************************************
+ */
+static void server_accept( int lfd )
+{
+    const struct timeval tv = { SERVER_TIMEOUT, 0 };
+    size_t  i;
+    int     fd;
+
+    if ( -1 == (fd = accept( lfd, NULL, NULL )) )
+        return;
+    for (i=0; i < SERVER_MAXCONNS && -1 != srv.conns[i].fd; i++)
+        ;
+    if ( SERVER_MAXCONNS == i ) {        /* full: turned away */
+        close( fd );
+        return;
+    }
+    fcntl( fd, F_SETFD, FD_CLOEXEC );
+    setsockopt( fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv) );
+    memset( &srv.conns[i], 0, sizeof(SrvConn) );
+    srv.conns[i].fd = fd;
+
+    return;
+}
+
+/*********************************************************//**
+ * Serve the files clients ask for on the socket sockname, with a pool
+ * of nthreads (at least SERVER_MINTHREADS), until stopped (by SIGINT
+ * or SIGTERM). Return false on error.
+ *************************************************************
+ */
+_Bool server_run( const char *sockname, unsigned nthreads )
+{
+    static struct pollfd fds[ 2 + SERVER_MAXCONNS ];
+    size_t  which[ SERVER_MAXCONNS ];
+    Worker  *workers = NULL;
+    struct sigaction sa;
+    unsigned t, nstarted = 0;
+    int     lfd = -1, err = 0;
+    _Bool   ok = false;
+    size_t  i;
+
+    memset( &srv, 0, sizeof(srv) );
+    srv.wake[0] = srv.wake[1] = -1;
+    for (i=0; i < SERVER_MAXCONNS; i++)
+        srv.conns[i].fd = -1;
+    nthreads = myMAX( nthreads, SERVER_MINTHREADS );    /* long requests hold up no one */
+
+    if ( -1 == (lfd = server_listen( sockname )) )
+        return false;
+    if ( -1 == pipe( srv.wake ) )
+        goto ret_failure;
+    fcntl( srv.wake[0], F_SETFL, O_NONBLOCK );
+    fcntl( srv.wake[1], F_SETFL, O_NONBLOCK );
+    pthread_mutex_init( &srv.lock, NULL );
+    pthread_cond_init( &srv.ready, NULL );
+
+    /* stop on SIGINT/SIGTERM (interrupting poll), ignore SIGPIPE */
+    memset( &sa, 0, sizeof(sa) );
+    sa.sa_handler = on_stop;
+    sigemptyset( &sa.sa_mask );
+    sigaction( SIGINT, &sa, NULL );
+    sigaction( SIGTERM, &sa, NULL );
+    sa.sa_handler = on_bus;
+    sigaction( SIGBUS, &sa, NULL );
+    signal( SIGPIPE, SIG_IGN );
+
+    if ( NULL == (workers = calloc( nthreads, sizeof(Worker) )) )
+        goto ret_failure;
+    for (t=0; t < nthreads; t++) {
+        if ( NULL == (workers[t].req = malloc( SERVER_MAXLEN + 1 ))
+            || NULL == (workers[t].rep = malloc( SERVER_MAXLEN + 1 ))
+            || 0 != pthread_create( &workers[t].tid, NULL, server_worker, &workers[t] )
+        )
+            goto ret_failure;
+        nstarted++;
+    }
+    fprintf( stderr, "%s: serving on %s (%u threads)\n", NAME_VERSION, sockname, nthreads );
+
+    while ( !stop )
+    {
+        size_t  nfds = 0, nconns = 0;
+        char    drain[64];
+
+        fds[nfds].fd = lfd;        fds[nfds++].events = POLLIN;
+        fds[nfds].fd = srv.wake[0]; fds[nfds++].events = POLLIN;
+        pthread_mutex_lock( &srv.lock );
+        for (i=0; i < SERVER_MAXCONNS; i++)
+            if ( -1 != srv.conns[i].fd && !srv.conns[i].busy ) {
+                fds[nfds].fd       = srv.conns[i].fd;
+                fds[nfds++].events = POLLIN;
+                which[ nconns++ ]  = i;
+            }
+        pthread_mutex_unlock( &srv.lock );
+
+        if ( poll( fds, (nfds_t) nfds, -1 ) < 0 ) {
+            if ( EINTR == errno )
+                continue;
+            err = errno;
+            break;
+        }
+
+        while ( read( srv.wake[0], drain, sizeof(drain) ) > 0 )
+            ;
+        pthread_mutex_lock( &srv.lock );
+        if ( fds[0].revents & POLLIN )
+            server_accept( lfd );
+        for (i=0; i < nconns; i++)
+            if ( fds[2+i].revents & (POLLIN | POLLHUP | POLLERR) ) {
+                srv.conns[ which[i] ].busy = true;
+                srv.queue[ (srv.qhead + srv.qlen++) % SERVER_MAXCONNS ] = which[i];
+                pthread_cond_signal( &srv.ready );
+            }
+        pthread_mutex_unlock( &srv.lock );
+    }
+
+    if ( (ok = (0 == err)) )
+        fprintf( stderr, "%s: stopped, after %llu requests\n", NAME_VERSION, srv.nreqs );
+
+ret_failure:
+    if ( !ok && !err )
+        err = errno;
+    if ( nstarted > 0 ) {
+        pthread_mutex_lock( &srv.lock );
+        srv.stopping = true;
+        for (i=0; i < SERVER_MAXCONNS; i++)        /* unblock the workers */
+            if ( -1 != srv.conns[i].fd )
+                shutdown( srv.conns[i].fd, SHUT_RDWR );
+        pthread_cond_broadcast( &srv.ready );
+        pthread_mutex_unlock( &srv.lock );
+        for (t=0; t < nstarted; t++)
+            pthread_join( workers[t].tid, NULL );
+    }
+    for (t=0; workers && t < nthreads; t++) {
+        free( workers[t].req );
+        free( workers[t].rep );
+    }
+    free( workers );
+
+    for (i=0; i < SERVER_MAXCONNS; i++)
+        if ( -1 != srv.conns[i].fd )
+            server_drop( &srv.conns[i] );
+    for (i=0; i < srv.nfiles; i++)
+        server_closefile( srv.files[i] );
+    srv.nfiles = 0;
+    if ( -1 != srv.wake[0] ) {
+        close( srv.wake[0] );
+        close( srv.wake[1] );
+        pthread_cond_destroy( &srv.ready );
+        pthread_mutex_destroy( &srv.lock );
+    }
+    close( lfd );
+    unlink( sockname );
+
+    errno = err;
+    return ok;
+}
+
+/*********************************************************//**
+ * Connect to the server on the socket sockname. Return the socket of
+ * the connection, or -1 on error.
+ *************************************************************
+ */
+int server_connect( const char *sockname )
+{
+    struct sockaddr_un addr;
+    int     fd;
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+    if ( strlen( sockname ) >= sizeof(addr.sun_path) ) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy( addr.sun_path, sockname );
+
+    if ( -1 == (fd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 )) )
+        return -1;
+    if ( -1 == connect( fd, (struct sockaddr *) &addr, sizeof(addr) ) ) {
+        const int err = errno;
+        close( fd );
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+/*********************************************************//**
+ * Send the request msg (of msg->len bytes of payload) to the server
+ * connected on fd, and read its reply into msg, & up to replymax bytes
+ * of its payload into reply (msg->len tells how many it had). Return
+ * false on error (the errno of the reply, if it failed).
+ *************************************************************
+ */
+_Bool server_call( int fd, ServerMsg *msg, const void *payload, void *reply, size_t replymax )
+{
+    char    drain[4096];
+    size_t  got, left;
+
+    if ( msg->len > SERVER_MAXLEN ) {
+        errno = EMSGSIZE;
+        return false;
+    }
+    msg->status = 0;
+    if ( !server_writeall( fd, msg, sizeof(*msg) ) || !server_writeall( fd, payload, msg->len ) )
+        return false;
+    errno = 0;
+
+    if ( sizeof(*msg) != server_readall( fd, msg, sizeof(*msg) ) )
+        goto ret_eof;
+    got = myMIN( (size_t) msg->len, replymax );
+    if ( server_readall( fd, reply, got ) != got )
+        goto ret_eof;
+    for (left = msg->len - got; left > 0; left -= got)    /* past replymax */
+        if ( 0 == (got = server_readall( fd, drain, myMIN( left, sizeof(drain) ) )) )
+            goto ret_eof;
+
+    if ( 0 != msg->status ) {
+        errno = msg->status;
+        return false;
+    }
+    return true;
+
+ret_eof:
+    if ( 0 == errno )
+        errno = ECONNRESET;
+    return false;
+}
+
+#else                        /* no Unix domain sockets */
+
+_Bool server_run( const char *sockname, unsigned nthreads )
+{
+    (void) sockname;
+    (void) nthreads;
+    errno = ENOTSUP;
+    return false;
+}
+
+int server_connect( const char *sockname )
+{
+    (void) sockname;
+    errno = ENOTSUP;
+    return -1;
+}
+
+_Bool server_call( int fd, ServerMsg *msg, const void *payload, void *reply, size_t replymax )
+{
+    (void) fd;
+    (void) msg;
+    (void) payload;
+    (void) reply;
+    (void) replymax;
+    errno = ENOTSUP;
+    return false;
+}
+#endif
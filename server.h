@@ -0,0 +1,62 @@
+#ifndef SERVER_H                    /* start of inclusion guard */
+#define SERVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* -----------------------------------
+ * Serving files over a Unix domain socket (& the client side of it)
+ * -----------------------------------
+ *
+ * Every request & reply is a ServerMsg, followed by its len bytes of
+ * payload (in host byte order: both ends are on the same machine).
+ * A reply has the op of its request, and a status of 0 or an errno.
+ *
+ *   op             request                         reply
+ *   SERVER_OPEN    payload: absolute path          file: handle, n: size
+ *   SERVER_CLOSE   file                            -
+ *   SERVER_ROWS    file, off: 1st row's offset,    payload: the rows, as
+ *                  n: # of rows, flags: HV_FMT_    the viewer's ('\n' after each)
+ *   SERVER_READ    file, off, n (<= SERVER_MAXLEN) payload: the bytes
+ *   SERVER_FIND    file, off: from, flags: SERVER_ off: the match, or
+ *                  BACKWARD, payload: the pattern  HV_NOTFOUND
+ *   SERVER_HASH    file, off: from, n: to,         payload: the hex digest
+ *                  payload: the alg (as for -hash)
+ */
+
+#define SERVER_MAXLEN        (4*1024*1024)    /* max payload of a message           */
+#define SERVER_MAXCONNS        256        /* max clients connected at once      */
+#define SERVER_MAXHANDLES    16        /* max files open per client          */
+#define SERVER_MAXFILES        64        /* max files kept open (& mapped)     */
+#define SERVER_NDIGESTS        32        /* digests cached per file            */
+#define SERVER_MINTHREADS    4        /* min threads serving requests       */
+
+enum ServerOp {
+    SERVER_OPEN = 1,
+    SERVER_CLOSE,
+    SERVER_ROWS,
+    SERVER_READ,
+    SERVER_FIND,
+    SERVER_HASH,
+    SERVER_NOPS
+};
+
+#define SERVER_BACKWARD        0x100        /* flags of SERVER_FIND               */
+
+typedef struct ServerMsg {
+    uint16_t    op;            /* enum ServerOp                      */
+    uint16_t    flags;
+    int32_t     status;            /* replies: 0, or an errno            */
+    uint32_t    file;            /* handle of a file open by the client */
+    uint32_t    len;            /* bytes of payload following         */
+    uint64_t    off;
+    uint64_t    n;
+} ServerMsg;
+
+_Bool   server_run( const char *sockname, unsigned nthreads );
+
+int     server_connect( const char *sockname );
+_Bool   server_call( int fd, ServerMsg *msg, const void *payload,
+                     void *reply, size_t replymax );
+
+#endif                        /* end of inclusion guard            */
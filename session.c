@@ -0,0 +1,208 @@
+/*****************************************************//**
+ * @brief   Recording & replaying sessions of viewer commands.
+ * @file    session.c
+ * @par Language:
+ *      C (ANSI C99) (+ POSIX dup2, for replaying to a null terminal)
+ *
+ * @remark  A session is recorded as a line per command, as typed in
+ *      the viewer: the ms since the session started, a TAB, and the
+ *      command (an empty one repeats the last). The time is optional
+ *      when replaying, so sessions may be written by hand or by a
+ *      script too. Replaying feeds the commands to the viewer as if
+ *      typed, as fast as it takes them, with everything it prints
+ *      sent nowhere (but counted). Every step (a command, the screen
+ *      it redraws & the prompt for the next one) is timed, and a JSON
+ *      line of its latency & output bytes is printed to stdout,
+ *      followed by one of the totals & percentiles of them all.
+ *********************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "hexview.h"
+#include "session.h"
+
+#ifdef HV_POSIX
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+/*********************************************************//**
+ * Start recording the commands of the session into fname.
+ *************************************************************
+ */
+_Bool session_record( Session *s, const char *fname )
+{
+    memset( s, 0, sizeof(*s) );
+    if ( NULL == (s->fp = fopen( fname, "w" )) )
+        return false;
+    setvbuf( s->fp, NULL, _IOLBF, 0 );    /* kept if the viewer dies */
+    s->start = stats_now();
+
+    return true;
+}
+
+/*********************************************************//**
+ * Record the command cmd (as read: "\n" repeats the last one).
+ *************************************************************
+ */
+void session_recorded( Session *s, const char *cmd )
+{
+    if ( !s->fp || s->replaying )
+        return;
+    fprintf( s->fp, "%.3f\t%s\n", (stats_now() - s->start) / 1e3, '\n' == *cmd ? "" : cmd );
+    s->nsteps++;
+    return;
+}
+
+/*********************************************************//**
+ * Start replaying the session recorded in fname: the results go to
+ * (a copy of) stdout, while stdout & stdin become the null device.
+ *************************************************************
+ */
+_Bool session_replay( Session *s, const char *fname )
+{
+    memset( s, 0, sizeof(*s) );
+    if ( NULL == (s->fp = fopen( fname, "r" )) )
+        return false;
+    s->replaying = true;
+    s->report = stderr;
+
+#ifdef HV_POSIX
+    {
+        int fd, null;
+
+        fflush( stdout );
+        if ( -1 == (fd = dup( STDOUT_FILENO )) || NULL == (s->report = fdopen( fd, "w" )) )
+            goto ret_failure;
+        if ( -1 == (null = open( "/dev/null", O_RDWR )) )
+            goto ret_failure;
+        if ( -1 == dup2( null, STDOUT_FILENO ) || -1 == dup2( null, STDIN_FILENO ) ) {
+            close( null );
+            goto ret_failure;
+        }
+        close( null );
+    }
+#endif
+    s->start = stats_now();
+
+    return true;
+
+#ifdef HV_POSIX
+ret_failure:
+    if ( s->report && stderr != s->report )
+        fclose( s->report );
+    fclose( s->fp );
+    memset( s, 0, sizeof(*s) );
+    return false;
+#endif
+}
+
+/*********************************************************//**
+ * End the step in progress (if any), reporting it.
+ *************************************************************
+ */
+static void session_endstep( Session *s )
+{
+    unsigned long long out;
+    double  us;
+
+    if ( '\0' == *s->cmd || !stats_on )
+        return;
+
+    us  = stats_now() - s->span.start;
+    out = stats_outbytes() - s->span.out;
+    stats_end( &s->span, STATS_STEP );
+    s->nsteps++;
+    s->out += out;
+
+    fprintf( s->report, "{\"step\":%llu,\"cmd\":", s->nsteps );
+    stats_json( s->report, '\n' == *s->cmd ? "" : s->cmd );
+    if ( s->at >= 0 )
+        fprintf( s->report, ",\"rec_ms\":%.3f", s->at );
+    fprintf( s->report, ",\"ms\":%.3f,\"out\":%llu}\n", us / 1e3, out );
+
+    *s->cmd = '\0';
+    return;
+}
+
+/*********************************************************//**
+ * End the step in progress, and read the command of the next one into
+ * cmd (of maxlen chars). Return false when the session is over.
+ *************************************************************
+ */
+_Bool session_next( Session *s, char *cmd, size_t maxlen )
+{
+    char    line[ SESSION_LINELEN ], *tab, *end;
+    const char *p = line;
+
+    if ( !s->fp || !s->replaying )
+        return false;
+    session_endstep( s );
+
+    if ( !fgets( line, sizeof(line), s->fp ) )
+        return false;
+    line[ strcspn( line, "\r\n" ) ] = '\0';
+
+    /* the time it was recorded at (if any) */
+    s->at = -1.0;
+    if ( NULL != (tab = strchr( line, '\t' )) ) {
+        const double at = strtod( line, &end );
+        if ( end == tab ) {
+            s->at = at;
+            p = tab + 1;
+        }
+    }
+
+    if ( '\0' == *p )                /* ENTER: repeat the last one */
+        p = "\n";
+    strncpy( cmd, p, maxlen - 1 );
+    cmd[ maxlen - 1 ] = '\0';
+    strcpy( s->cmd, cmd );
+
+    if ( stats_on )
+        stats_begin( &s->span );
+
+    return true;
+}
+
+/*********************************************************//**
+ * End the session: when replaying, report the step in progress (if
+ * any) & the totals of them all.
+ *************************************************************
+ */
+void session_close( Session *s )
+{
+    if ( !s->fp )
+        return;
+
+    if ( s->replaying ) {
+        const StatsHist *h, *load;
+
+        session_endstep( s );
+        h    = stats_hist( STATS_STEP );
+        load = stats_hist( STATS_LOAD );
+        fprintf( s->report, "{\"steps\":%llu,\"total_ms\":%.3f,\"mean_ms\":%.3f,"
+            "\"p50_ms\":%.3f,\"p99_ms\":%.3f,\"max_ms\":%.3f,\"out\":%llu,\"load_ms\":%.3f}\n",
+            s->nsteps,
+            h ? h->sum / 1e3 : 0.0,
+            h && h->n ? h->sum / h->n / 1e3 : 0.0,
+            h ? stats_percentile( h, 0.50 ) / 1e3 : 0.0,
+            h ? stats_percentile( h, 0.99 ) / 1e3 : 0.0,
+            h ? h->max / 1e3 : 0.0,
+            s->out,
+            load ? load->sum / 1e3 : 0.0
+        );
+        if ( stderr != s->report )
+            fclose( s->report );
+        else
+            fflush( s->report );
+    }
+    fclose( s->fp );
+    memset( s, 0, sizeof(*s) );
+
+    return;
+}
@@ -0,0 +1,33 @@
+#ifndef SESSION_H                    /* start of inclusion guard */
+#define SESSION_H
+
+#include <stdio.h>
+
+#include "stats.h"
+
+/* -----------------------------------
+ * Recording & replaying sessions of viewer commands
+ * -----------------------------------
+ */
+
+#define SESSION_LINELEN        (1024+64)    /* max line of a recorded session     */
+
+typedef struct Session {
+    FILE    *fp;            /* commands recorded (or to replay)   */
+    _Bool   replaying;        /* replaying fp (else recording it)   */
+    FILE    *report;        /* replay: results of the steps       */
+    double  start;            /* when the session started (in us)   */
+    unsigned long long nsteps;    /* # of commands so far ...           */
+    unsigned long long out;        /* ... & bytes they output            */
+    StatsSpan span;            /* replay: the step in progress ...   */
+    double  at;            /* ... when it was recorded (in ms)   */
+    char    cmd[ SESSION_LINELEN ];  /* ... & its command           */
+} Session;
+
+_Bool   session_record( Session *s, const char *fname );
+void    session_recorded( Session *s, const char *cmd );
+_Bool   session_replay( Session *s, const char *fname );
+_Bool   session_next( Session *s, char *cmd, size_t maxlen );
+void    session_close( Session *s );
+
+#endif                        /* end of inclusion guard            */
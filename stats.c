@@ -0,0 +1,313 @@
+/*****************************************************//**
+ * @brief   Timing instrumentation: latency histograms & trace events.
+ * @file    stats.c
+ * @par Language:
+ *      C (ANSI C99) (+ POSIX clock_gettime, glibc fopencookie)
+ *
+ * @remark  Spans of time (loading, rendering a screen, running each
+ *      command) are added to a histogram per slot, whose buckets
+ *      split every power of 2 of microseconds in STATS_SUBBUCKETS
+ *      (so percentiles are within ~9% of the exact ones, in fixed
+ *      memory however many spans are timed). The bytes written to
+ *      stdout are counted by a stream that replaces it (glibc only),
+ *      and each span may be written to a Chrome trace-event file as
+ *      it ends. Nothing is done unless stats_init() was called: the
+ *      STATS_ macros test stats_on, and that is all.
+ *********************************************************
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE                /* fopencookie */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+
+#include "hexview.h"
+#include "stats.h"
+
+#ifdef HV_POSIX
+#include <unistd.h>
+#include <sys/types.h>
+#endif
+
+_Bool stats_on = false;
+
+static StatsHist *hists[ STATS_NSLOTS ];
+static FILE   *trace = NULL;            /* trace events (if asked) */
+static unsigned long nevents = 0;
+static double epoch = 0.0;            /* when instrumenting started */
+static _Bool  counting = false;            /* stdout bytes counted? */
+static unsigned long long outbytes = 0;
+
+/*********************************************************//**
+ * Return the time in us.
+ *************************************************************
+ */
+double stats_now( void )
+{
+#ifdef HV_POSIX
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+#else
+    return (double) clock() * 1e6 / CLOCKS_PER_SEC;
+#endif
+}
+
+/*********************************************************//**
+ * Print the c-string s as a JSON string (of trace events, session
+ * reports & batch results alike).
+ *************************************************************
+ */
+void stats_json( FILE *out, const char *s )
+{
+    fputc( '"', out );
+    for (; *s; s++) {
+        if ( '"' == *s || '\\' == *s )
+            fprintf( out, "\\%c", *s );
+        else if ( (unsigned char) *s < 0x20 )
+            fprintf( out, "\\u%04x", (unsigned) *s );
+        else
+            fputc( *s, out );
+    }
+    fputc( '"', out );
+    return;
+}
+
+#if defined(_GNU_SOURCE) && defined(HV_POSIX)
+/*********************************************************//**
+ * Write function of the stream replacing stdout: to fd 1, counting.
+ *************************************************************
+ */
+static ssize_t stats_write( void *cookie, const char *buf, size_t n )
+{
+    size_t  done = 0;
+    ssize_t w;
+
+    (void) cookie;
+    while ( done < n ) {
+        if ( (w = write( STDOUT_FILENO, &buf[done], n - done )) < 0 ) {
+            if ( EINTR == errno )
+                continue;
+            break;
+        }
+        done += (size_t) w;
+    }
+    outbytes += done;
+
+    return (0 == done && n > 0) ? -1 : (ssize_t) done;
+}
+#endif
+
+/*********************************************************//**
+ * Start instrumenting: writing trace events into tracefname (unless
+ * NULL) and, if countout, counting the bytes written to stdout.
+ *************************************************************
+ */
+_Bool stats_init( const char *tracefname, _Bool countout )
+{
+    if ( tracefname ) {
+        if ( NULL == (trace = fopen( tracefname, "w" )) )
+            return false;
+        fputs( "{\"traceEvents\":[\n", trace );
+    }
+
+#if defined(_GNU_SOURCE) && defined(HV_POSIX)
+    if ( countout ) {
+        cookie_io_functions_t io = { NULL, stats_write, NULL, NULL };
+        FILE *fp;
+
+        fflush( stdout );
+        if ( NULL != (fp = fopencookie( NULL, "w", io )) ) {
+            setvbuf( fp, NULL, isatty( STDOUT_FILENO ) ? _IOLBF : _IOFBF, BUFSIZ );
+            stdout   = fp;
+            counting = true;
+        }
+    }
+#else
+    (void) countout;
+#endif
+
+    epoch    = stats_now();
+    stats_on = true;
+
+    return true;
+}
+
+/*********************************************************//**
+ * Return the # of bytes written to stdout so far (0 if not counted).
+ *************************************************************
+ */
+unsigned long long stats_outbytes( void )
+{
+    if ( counting )
+        fflush( stdout );
+    return outbytes;
+}
+
+/*********************************************************//**
+ * Start timing a span.
+ *************************************************************
+ */
+void stats_begin( StatsSpan *span )
+{
+    span->out   = stats_outbytes();
+    span->start = stats_now();
+    return;
+}
+
+/*********************************************************//**
+ * Return the name of a slot (the key of a command, for commands).
+ *************************************************************
+ */
+static const char *stats_name( int slot, char *name )
+{
+    if ( STATS_LOAD == slot )
+        return "load";
+    if ( STATS_RENDER == slot )
+        return "render";
+    if ( STATS_STEP == slot )
+        return "step";
+    if ( slot > ' ' && slot < 0x7F )
+        sprintf( name, "cmd %c", slot );
+    else
+        sprintf( name, "cmd 0x%02X", (unsigned) slot );
+    return name;
+}
+
+/*********************************************************//**
+ * Stop timing a span, adding it to the histogram of slot (& to the
+ * trace, if any).
+ *************************************************************
+ */
+void stats_end( const StatsSpan *span, int slot )
+{
+    const unsigned long long out = stats_outbytes() - span->out;
+    const double us = stats_now() - span->start;
+    StatsHist   *h;
+    int         b = 0, e;
+
+    if ( slot < 0 || slot >= STATS_NSLOTS )
+        return;
+    if ( !hists[slot] && NULL == (hists[slot] = calloc( 1, sizeof(StatsHist) )) )
+        return;
+    h = hists[slot];
+
+    /* bucket: power of 2 of us, then which sub-bucket of it */
+    if ( us >= 1.0 ) {
+        const double m = frexp( us, &e );    /* us = m * 2^e, m in [0.5,1) */
+        b = (e - 1) * STATS_SUBBUCKETS + (int) ((2.0 * m - 1.0) * STATS_SUBBUCKETS);
+        b = myMIN( b, STATS_NBUCKETS - 1 );
+    }
+    h->buckets[b]++;
+    h->n++;
+    h->sum += us;
+    h->max  = myMAX( h->max, us );
+    h->out += out;
+
+    if ( trace && nevents < STATS_MAXEVENTS ) {
+        char name[16];
+        const char *s = stats_name( slot, name );
+        fprintf( trace, "%s{\"name\":", nevents++ ? ",\n" : "" );
+        stats_json( trace, s );
+        fprintf( trace, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+            "\"pid\":1,\"tid\":1,\"args\":{\"out\":%llu}}",
+            slot < 256 ? "cmd" : stats_name( slot, name ), span->start - epoch, us, out );
+    }
+
+    return;
+}
+
+/*********************************************************//**
+ * Return the histogram of slot (NULL if nothing was timed in it).
+ *************************************************************
+ */
+const StatsHist *stats_hist( int slot )
+{
+    return (slot < 0 || slot >= STATS_NSLOTS) ? NULL : hists[slot];
+}
+
+/*********************************************************//**
+ * Return the p'th percentile (p in [0,1]) of the spans of h, in us:
+ * the middle of the bucket it falls in (capped to the max span).
+ *************************************************************
+ */
+double stats_percentile( const StatsHist *h, double p )
+{
+    const unsigned long long rank = (unsigned long long) ceil( p * h->n );
+    unsigned long long seen = 0;
+    int b;
+
+    for (b=0; b < STATS_NBUCKETS; b++)
+        if ( (seen += h->buckets[b]) >= myMAX( rank, 1ULL ) ) {
+            const double lo = 0 == b ? 0.0
+                : ldexp( 1.0 + (double) (b % STATS_SUBBUCKETS) / STATS_SUBBUCKETS, b / STATS_SUBBUCKETS );
+            const double hi = ldexp( 1.0 + (double) (b % STATS_SUBBUCKETS + 1) / STATS_SUBBUCKETS,
+                                     b / STATS_SUBBUCKETS );
+            return myMIN( (lo + hi) / 2, h->max );
+        }
+    return h->max;
+}
+
+/*********************************************************//**
+ * Print the stats of every slot timed (in ms) to out.
+ *************************************************************
+ */
+void stats_report( FILE *out )
+{
+    char name[16];
+    int  slot, order;
+
+    if ( !stats_on )
+        return;
+
+    if ( counting )
+        fprintf( out, "# stats: %llu bytes written to stdout\n", stats_outbytes() );
+    fprintf( out, "# %-9s %8s %11s %9s %9s %9s %9s %12s\n",
+        "WHAT", "COUNT", "TOTAL-MS", "MEAN-MS", "P50-MS", "P99-MS", "MAX-MS", "OUT-BYTES" );
+
+    /* load & render 1st, then the commands */
+    for (order=0; order < STATS_NSLOTS; order++)
+    {
+        const StatsHist *h;
+
+        slot = order < STATS_NSLOTS - 256 ? 256 + order : order - (STATS_NSLOTS - 256);
+        if ( NULL == (h = hists[slot]) || 0 == h->n )
+            continue;
+        fprintf( out, "  %-9s %8llu %11.3f %9.3f %9.3f %9.3f %9.3f %12llu\n",
+            stats_name( slot, name ), h->n, h->sum / 1e3, h->sum / h->n / 1e3,
+            stats_percentile( h, 0.50 ) / 1e3, stats_percentile( h, 0.99 ) / 1e3,
+            h->max / 1e3, h->out
+        );
+    }
+    fflush( out );
+
+    return;
+}
+
+/*********************************************************//**
+ * Stop instrumenting: complete the trace & free the histograms.
+ *************************************************************
+ */
+void stats_cleanup( void )
+{
+    int slot;
+
+    if ( trace ) {
+        fputs( "\n]}\n", trace );
+        fclose( trace );
+        trace = NULL;
+    }
+    for (slot=0; slot < STATS_NSLOTS; slot++) {
+        free( hists[slot] );
+        hists[slot] = NULL;
+    }
+    stats_on = false;
+
+    return;
+}
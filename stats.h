@@ -0,0 +1,60 @@
+#ifndef STATS_H                    /* start of inclusion guard */
+#define STATS_H
+
+#include <stdio.h>
+
+/* -----------------------------------
+ * Timing instrumentation (latency histograms & trace events)
+ * -----------------------------------
+ */
+
+#define STATS_SUBBUCKETS    8        /* histogram buckets per power of 2   */
+#define STATS_NBUCKETS        (40 * STATS_SUBBUCKETS)  /* 1us up to ~12 days  */
+#define STATS_MAXEVENTS        1000000        /* max trace events written           */
+
+enum StatsSlot {
+    STATS_LOAD  = 256,            /* 0..255: commands, by their key     */
+    STATS_RENDER,            /* a screen (header & rows)           */
+    STATS_STEP,                /* a replayed command, redrawn        */
+    STATS_NSLOTS
+};
+
+typedef struct StatsHist {
+    unsigned long long n;        /* # of timed spans ...               */
+    double      sum, max;        /* ... their total & max (in us)      */
+    unsigned long long out;        /* ... bytes they output              */
+    unsigned long long buckets[ STATS_NBUCKETS ];  /* ... by duration   */
+} StatsHist;
+
+typedef struct StatsSpan {
+    double      start;            /* when it started (in us)            */
+    unsigned long long out;        /* bytes output before it             */
+} StatsSpan;
+
+extern _Bool stats_on;                /* instrumenting at all?              */
+
+/* spans cost nothing (but a test) when not instrumenting */
+#define STATS_BEGIN( span )                        \
+do {                                    \
+    if ( stats_on )                            \
+        stats_begin( &(span) );                        \
+} while (0)
+
+#define STATS_END( span, slot )                        \
+do {                                    \
+    if ( stats_on )                            \
+        stats_end( &(span), (slot) );                    \
+} while (0)
+
+_Bool   stats_init( const char *tracefname, _Bool countout );
+double  stats_now( void );
+void    stats_begin( StatsSpan *span );
+void    stats_end( const StatsSpan *span, int slot );
+unsigned long long stats_outbytes( void );
+double  stats_percentile( const StatsHist *h, double p );
+const StatsHist *stats_hist( int slot );
+void    stats_report( FILE *out );
+void    stats_json( FILE *out, const char *s );
+void    stats_cleanup( void );
+
+#endif                        /* end of inclusion guard            */
@@ -0,0 +1,355 @@
+/*****************************************************//**
+ * @brief   Fast extraction of printable strings from a byte buffer.
+ * @file    strscan.c
+ * @par Language:
+ *      C (ANSI C99) + POSIX threads (SSE2 intrinsics when available)
+ *
+ * @remark  The buffer is split in nthreads contiguous chunks. A string
+ *      belongs to the chunk where its 1st byte lies, so every thread
+ *      skips a run that started in the previous chunk and keeps
+ *      scanning past the end of its own chunk until its last run
+ *      is over. This way no string is lost or reported twice.
+ *********************************************************
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "strscan.h"
+
+/* is c printable the way GNU strings sees it (7-bit printable or TAB) */
+#define ISPRINT7(c)    ( ((c) >= 0x20 && (c) <= 0x7E) || (c) == '\t' )
+
+/* chunks smaller than this are not worth a thread of their own */
+#define STR_MINCHUNK    (1024 * 1024)
+
+typedef struct StrJob {
+    const unsigned char *data;    /* the whole buffer                   */
+    size_t  len;            /* ... and its length                 */
+    size_t  from, to;        /* the chunk this job is in charge of */
+    size_t  minlen;            /* min # of chars per reported string */
+    unsigned kinds;            /* bitmask of enum StrKind            */
+    StrList list;            /* the hits of this job               */
+    _Bool   failed;            /* out of memory?                     */
+} StrJob;
+
+/*********************************************************//**
+ * Append a hit to a StrList (growing it when needed).
+ *************************************************************
+ */
+static _Bool strlist_add( StrList *list, size_t off, size_t len, unsigned char kind )
+{
+    if ( list->n == list->cap )
+    {
+        size_t  cap = list->cap ? 2 * list->cap : 1024;
+        StrHit  *try = realloc( list->hits, cap * sizeof(StrHit) );
+        if ( !try )
+            return false;
+        list->hits = try;
+        list->cap  = cap;
+    }
+
+    list->hits[ list->n ].off  = off;
+    list->hits[ list->n ].len  = len;
+    list->hits[ list->n ].kind = kind;
+    list->n++;
+
+    return true;
+}
+
+/*********************************************************//**
+ * Return a bitmask with bit i set if data[i] is printable (i < 64).
+ *************************************************************
+ */
+static inline uint64_t mask64_printable( const unsigned char *data )
+{
+#if defined(__SSE2__)
+    const __m128i lo  = _mm_set1_epi8( 0x1F );
+    const __m128i hi  = _mm_set1_epi8( 0x7F );
+    const __m128i tab = _mm_set1_epi8( '\t' );
+    uint64_t mask = 0;
+    int i;
+
+    for (i=0; i < 4; i++)
+    {
+        /* signed compares: bytes >= 0x80 are negative, thus not printable */
+        __m128i v = _mm_loadu_si128( (const __m128i *) &data[16*i] );
+        __m128i p = _mm_and_si128( _mm_cmpgt_epi8(v, lo), _mm_cmplt_epi8(v, hi) );
+        p = _mm_or_si128( p, _mm_cmpeq_epi8(v, tab) );
+        mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(p) << (16*i);
+    }
+    return mask;
+#else
+    uint64_t mask = 0;
+    int i;
+
+    for (i=0; i < 64; i++)
+        mask |= (uint64_t)(ISPRINT7(data[i]) != 0) << i;
+    return mask;
+#endif
+}
+
+/*********************************************************//**
+ * Report the ASCII runs starting in [from,to), 64 bytes per step.
+ *************************************************************
+ */
+static _Bool scan_ascii( StrJob *job )
+{
+    const unsigned char *data = job->data;
+    const size_t len = job->len;
+    size_t  base = job->from, runstart = 0;
+    _Bool   inrun = false;
+
+    /* a run crossing into our chunk belongs to the previous one */
+    if ( base > 0 && ISPRINT7(data[base-1]) )
+        while ( base < len && ISPRINT7(data[base]) )
+            base++;
+
+    while ( base < len && (inrun || base < job->to) )
+    {
+        uint64_t mask;
+        unsigned pos = 0, nbits = 64;
+
+        if ( len - base >= 64 )
+            mask = mask64_printable( &data[base] );
+        else {
+            nbits = len - base;
+            for (mask=0; pos < nbits; pos++)
+                mask |= (uint64_t)(ISPRINT7(data[base+pos]) != 0) << pos;
+            pos = 0;
+        }
+
+        while ( pos < nbits )
+        {
+            uint64_t rest = inrun ? ~mask >> pos : mask >> pos;
+
+            if ( nbits < 64 )        /* ignore bits past the end   */
+                rest &= (1ULL << (nbits - pos)) - 1;
+            if ( 0 == rest )
+                break;
+
+            pos += __builtin_ctzll( rest );
+            if ( inrun ) {            /* a run just ended           */
+                if ( base + pos - runstart >= job->minlen
+                    && !strlist_add(&job->list, runstart, base + pos - runstart, STR_ASCII)
+                )
+                    return false;
+                inrun = false;
+                if ( base + pos >= job->to )
+                    return true;
+            }
+            else {                /* a run just started         */
+                if ( base + pos >= job->to )
+                    return true;
+                runstart = base + pos;
+                inrun = true;
+            }
+        }
+        base += nbits;
+    }
+
+    if ( inrun && len - runstart >= job->minlen )    /* run hit the end */
+        return strlist_add( &job->list, runstart, len - runstart, STR_ASCII );
+
+    return true;
+}
+
+/*********************************************************//**
+ * Report the UTF-16LE runs (printable, 0x00 pairs) starting in [from,to).
+ *************************************************************
+ */
+static _Bool scan_utf16( StrJob *job )
+{
+    const unsigned char *data = job->data;
+    const size_t len = job->len;
+    unsigned parity;
+
+#define ISCHAR16(i)    ( (i) + 1 < len && ISPRINT7(data[i]) && 0 == data[(i)+1] )
+
+    /* runs may start on even or odd offsets: scan both alignments */
+    for (parity=0; parity < 2; parity++)
+    {
+        size_t i = job->from + ((job->from & 1) != parity);
+
+        /* a run crossing into our chunk belongs to the previous one */
+        if ( i >= 2 && ISCHAR16(i-2) )
+            while ( ISCHAR16(i) )
+                i += 2;
+
+        while ( i < job->to && i < len )
+        {
+            size_t start;
+
+            if ( !ISCHAR16(i) ) {
+                i += 2;
+                continue;
+            }
+            for (start=i; ISCHAR16(i); i += 2)
+                ;
+            if ( (i - start) / 2 >= job->minlen
+                && !strlist_add(&job->list, start, i - start, STR_UTF16)
+            )
+                return false;
+        }
+    }
+#undef ISCHAR16
+
+    return true;
+}
+
+/*********************************************************//**
+ * qsort() callback ordering hits by offset.
+ *************************************************************
+ */
+static int cmp_hits( const void *a, const void *b )
+{
+    const StrHit *x = a, *y = b;
+
+    if ( x->off != y->off )
+        return x->off < y->off ? -1 : 1;
+    return (int)x->kind - (int)y->kind;
+}
+
+/*********************************************************//**
+ * Thread entry: scan one chunk.
+ *************************************************************
+ */
+static void *strscan_job( void *arg )
+{
+    StrJob *job = arg;
+
+    if ( (job->kinds & STR_ASCII) && !scan_ascii(job) )
+        job->failed = true;
+    if ( !job->failed && (job->kinds & STR_UTF16) && !scan_utf16(job) )
+        job->failed = true;
+
+    /* both kinds are interleaved: sort them (ASCII alone is already) */
+    if ( !job->failed && (job->kinds & STR_UTF16) && job->list.n > 1 )
+        qsort( job->list.hits, job->list.n, sizeof(StrHit), cmp_hits );
+
+    return NULL;
+}
+
+/*********************************************************//**
+ * Extract into out all runs of at least minlen printable chars
+ * of the requested kinds, using up to nthreads threads. The hits
+ * come out sorted by offset.
+ *************************************************************
+ */
+_Bool strscan( const unsigned char *data, size_t len, size_t minlen,
+               unsigned kinds, unsigned nthreads, StrList *out )
+{
+    StrJob      *jobs = NULL;
+    pthread_t   *tids = NULL;
+    size_t      chunk, total = 0;
+    unsigned    i, nstarted = 0;
+    _Bool       success = true;
+
+    if ( !data || !out )
+        return false;
+    memset( out, 0, sizeof(StrList) );
+
+    if ( minlen < 1 )
+        minlen = 1;
+    if ( nthreads < 1 )
+        nthreads = 1;
+    if ( len / nthreads < STR_MINCHUNK )
+        nthreads = len / STR_MINCHUNK > 0 ? len / STR_MINCHUNK : 1;
+
+    jobs = calloc( nthreads, sizeof(StrJob) );
+    tids = calloc( nthreads, sizeof(pthread_t) );
+    if ( !jobs || !tids ) {
+        success = false;
+        goto ret;
+    }
+
+    chunk = len / nthreads;
+    for (i=0; i < nthreads; i++)
+    {
+        jobs[i].data   = data;
+        jobs[i].len    = len;
+        jobs[i].from   = i * chunk;
+        jobs[i].to     = (i == nthreads-1) ? len : (i+1) * chunk;
+        jobs[i].minlen = minlen;
+        jobs[i].kinds  = kinds;
+    }
+
+    /* the calling thread takes care of the 1st chunk itself */
+    for (i=1; i < nthreads; i++, nstarted++)
+        if ( 0 != pthread_create( &tids[i], NULL, strscan_job, &jobs[i] ) )
+            break;
+    strscan_job( &jobs[0] );
+    for (i=1; i <= nstarted; i++)
+        pthread_join( tids[i], NULL );
+
+    /* couldn't start all threads? do the rest here */
+    for (i=nstarted+1; i < nthreads; i++)
+        strscan_job( &jobs[i] );
+
+    /* concatenate the per-chunk lists (they are already in order) */
+    for (i=0; i < nthreads; i++) {
+        success = success && !jobs[i].failed;
+        total += jobs[i].list.n;
+    }
+    if ( success && total > 0 )
+    {
+        if ( NULL == (out->hits = malloc( total * sizeof(StrHit) )) )
+            success = false;
+        for (i=0; success && i < nthreads; i++) {
+            memcpy( &out->hits[out->n], jobs[i].list.hits, jobs[i].list.n * sizeof(StrHit) );
+            out->n += jobs[i].list.n;
+        }
+        out->cap = total;
+    }
+
+ret:
+    for (i=0; jobs && i < nthreads; i++)
+        free( jobs[i].list.hits );
+    free( jobs );
+    free( tids );
+    if ( !success )
+        strlist_cleanup( out );
+
+    return success;
+}
+
+/*********************************************************//**
+ * Copy the text of a hit into s as a c-string (UTF-16 runs are
+ * narrowed to their low bytes). Return the # of chars copied.
+ *************************************************************
+ */
+size_t strscan_text( const unsigned char *data, const StrHit *hit, char *s, size_t maxlen )
+{
+    size_t i, n = 0;
+    const size_t step = (hit->kind == STR_UTF16) ? 2 : 1;
+
+    if ( !data || !hit || !s || maxlen < 1 )
+        return 0;
+
+    for (i=0; i < hit->len && n < maxlen-1; i += step)
+        s[n++] = (char) data[ hit->off + i ];
+    s[n] = '\0';
+
+    return n;
+}
+
+/*********************************************************//**
+ *
+ *************************************************************
+ */
+void strlist_cleanup( StrList *list )
+{
+    if ( !list )
+        return;
+
+    free( list->hits );
+    memset( list, 0, sizeof(StrList) );
+    return;
+}
@@ -0,0 +1,38 @@
+#ifndef STRSCAN_H                /* start of inclusion guard */
+#define STRSCAN_H
+
+#include <stddef.h>
+
+/* -----------------------------------
+ * Printable-string extraction (a built-in "strings")
+ * -----------------------------------
+ */
+
+#define STR_MINLEN        4        /* default min # of chars in a string */
+
+enum StrKind {
+    STR_ASCII   = 0x01,            /* runs of printable 7-bit chars      */
+    STR_UTF16   = 0x02            /* runs of printable UTF-16LE chars   */
+};
+
+#define NAME_STRKIND(k)                            \
+    ( (k) == STR_ASCII ? 'a' : (k) == STR_UTF16 ? 'u' : '?' )
+
+typedef struct StrHit {
+    size_t          off;        /* file offset of the 1st byte        */
+    size_t          len;        /* length in bytes (not in chars)     */
+    unsigned char   kind;       /* STR_ASCII or STR_UTF16             */
+} StrHit;
+
+typedef struct StrList {
+    StrHit  *hits;            /* hits, sorted by offset             */
+    size_t  n, cap;            /* # of used & allocated hits         */
+} StrList;
+
+_Bool   strscan( const unsigned char *data, size_t len, size_t minlen,
+                 unsigned kinds, unsigned nthreads, StrList *out );
+size_t  strscan_text( const unsigned char *data, const StrHit *hit,
+                      char *s, size_t maxlen );
+void    strlist_cleanup( StrList *list );
+
+#endif                        /* end of inclusion guard            */
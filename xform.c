@@ -0,0 +1,323 @@
+/*****************************************************//**
+ * @brief   Lazily transformed views of data (decoded/deobfuscated).
+ * @file    xform.c
+ * @par Language:
+ *      C (ANSI C99)
+ *
+ * @remark  Every transform maps fixed units of source bytes to fixed
+ *      units of transformed ones (8:8 bytes for XOR, swaps & nibbles,
+ *      4:3 for base64, 2:1 for hex), so any transformed byte is found
+ *      from its offset alone and nothing is transformed until read.
+ *      Reads go through a small cache of whole transformed pages,
+ *      evicting the least recently used one, so redrawing the screen
+ *      or searching back & forth transforms every page once. The cache
+ *      is one for all the views (of any # of open files), so its size
+ *      is bounded however many of them there are; their pages are told
+ *      apart by the view owning them.
+ *      Base64 & hex text is expected to be contiguous: characters
+ *      out of their alphabet decode as zero bits.
+ *********************************************************
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hexview.h"
+#include "bulk.h"
+#include "xform.h"
+
+static XformCache shared;            /* the pages of all the views */
+
+static const char *xform_names[ XF_NKINDS ] = {
+    "none", "xor", "swap16", "swap32", "swap64", "nibble", "base64", "hex"
+};
+
+/*********************************************************//**
+ * Return the enum XformKind named name (base64 may be given as b64),
+ * or -1 if there is none.
+ *************************************************************
+ */
+int xform_byname( const char *name )
+{
+    int kind;
+
+    if ( !name )
+        return -1;
+    if ( 0 == strcmp(name, "b64") )
+        return XF_BASE64;
+    for (kind=0; kind < XF_NKINDS; kind++)
+        if ( 0 == strcmp(name, xform_names[kind]) )
+            return kind;
+    return -1;
+}
+
+/*********************************************************//**
+ * Return the name of an enum XformKind.
+ *************************************************************
+ */
+const char *xform_name( int kind )
+{
+    return (kind >= 0 && kind < XF_NKINDS) ? xform_names[kind] : "?";
+}
+
+/*********************************************************//**
+ * Return the value of a base64 or hex digit (0 if it is not one).
+ *************************************************************
+ */
+static unsigned b64_value( unsigned char c )
+{
+    if ( c >= 'A' && c <= 'Z' ) return c - 'A';
+    if ( c >= 'a' && c <= 'z' ) return c - 'a' + 26;
+    if ( c >= '0' && c <= '9' ) return c - '0' + 52;
+    if ( c == '+' || c == '-' ) return 62;    /* standard or url-safe */
+    if ( c == '/' || c == '_' ) return 63;
+    return 0;
+}
+
+static unsigned hex_value( unsigned char c )
+{
+    if ( c >= '0' && c <= '9' ) return c - '0';
+    if ( c >= 'a' && c <= 'f' ) return c - 'a' + 10;
+    if ( c >= 'A' && c <= 'F' ) return c - 'A' + 10;
+    return 0;
+}
+
+/*********************************************************//**
+ * Set up the view of the inlen bytes of a source starting at from
+ * (read by src, given ctx), transformed by kind (with key, for XOR).
+ *************************************************************
+ */
+_Bool xform_init( Xform *x, int kind, const unsigned char *key, size_t keylen,
+                  size_t from, size_t inlen, XformSrc src, const void *ctx )
+{
+    if ( !x || !src || kind <= XF_NONE || kind >= XF_NKINDS
+        || (XF_XOR == kind && (!key || 0 == keylen || keylen > XFORM_MAXKEYLEN))
+    )
+        return false;
+    memset( x, 0, sizeof(Xform) );
+
+    x->kind  = kind;
+    x->from  = from;
+    x->inlen = inlen;
+    x->src   = src;
+    x->ctx   = ctx;
+    if ( XF_XOR == kind ) {
+        memcpy( x->key, key, keylen );
+        x->keylen = keylen;
+    }
+
+    switch ( kind ) {
+    case XF_BASE64:
+        x->inunit  = 4;
+        x->outunit = 3;
+        x->len     = inlen / 4 * 3 + (inlen % 4 > 1 ? inlen % 4 - 1 : 0);
+        if ( 0 == inlen % 4 && inlen >= 4 ) {    /* drop what '=' pads */
+            unsigned char pad[2];
+            if ( 2 == src( ctx, from + inlen - 2, pad, 2 ) )
+                x->len -= ('=' == pad[1]) + ('=' == pad[1] && '=' == pad[0]);
+        }
+        break;
+    case XF_HEX:
+        x->inunit  = 2;
+        x->outunit = 1;
+        x->len     = inlen / 2;
+        break;
+    default:
+        x->inunit  = 8;
+        x->outunit = 8;
+        x->len     = inlen;
+        break;
+    }
+
+    if ( !shared.in && NULL == (shared.in = malloc( XFORM_PAGEUNITS * XFORM_MAXUNIT )) )
+        return false;
+    x->cache = &shared;
+    shared.nviews++;
+
+    return true;
+}
+
+/*********************************************************//**
+ * Transform n source bytes of in into out, the 1st of them being at
+ * offset off of the view. Return the # of transformed bytes.
+ *************************************************************
+ */
+static size_t xform_apply( const Xform *x, const unsigned char *in, size_t n,
+                           unsigned char *out, size_t off )
+{
+    size_t i, w;
+
+    switch ( x->kind )
+    {
+    case XF_XOR:
+        bulk_logic( out, in, n, BULK_XOR, x->key, x->keylen, off );
+        return n;
+
+    case XF_SWAP16:
+    case XF_SWAP32:
+    case XF_SWAP64:
+        w = (XF_SWAP16 == x->kind) ? 2 : (XF_SWAP32 == x->kind) ? 4 : 8;
+        for (i=0; i + w <= n; i += w) {
+            if ( 2 == w ) {
+                uint16_t v; memcpy( &v, &in[i], 2 ); v = __builtin_bswap16( v ); memcpy( &out[i], &v, 2 );
+            } else if ( 4 == w ) {
+                uint32_t v; memcpy( &v, &in[i], 4 ); v = __builtin_bswap32( v ); memcpy( &out[i], &v, 4 );
+            } else {
+                uint64_t v; memcpy( &v, &in[i], 8 ); v = __builtin_bswap64( v ); memcpy( &out[i], &v, 8 );
+            }
+        }
+        memcpy( &out[i], &in[i], n - i );    /* a partial word: as is */
+        return n;
+
+    case XF_NIBBLE:
+        for (i=0; i < n; i++)
+            out[i] = (unsigned char)( (in[i] << 4) | (in[i] >> 4) );
+        return n;
+
+    case XF_BASE64:
+        for (i=0, w=0; i + 1 < n; i += 4) {
+            const uint32_t v = b64_value(in[i]) << 18 | b64_value(in[i+1]) << 12
+                    | (i + 2 < n ? b64_value(in[i+2]) << 6 : 0)
+                    | (i + 3 < n ? b64_value(in[i+3]) : 0);
+            out[w++] = (unsigned char)(v >> 16);
+            if ( i + 2 < n )
+                out[w++] = (unsigned char)(v >> 8);
+            if ( i + 3 < n )
+                out[w++] = (unsigned char) v;
+        }
+        return w;
+
+    case XF_HEX:
+        for (i=0; i + 1 < n; i += 2)
+            out[i/2] = (unsigned char)( hex_value(in[i]) << 4 | hex_value(in[i+1]) );
+        return n / 2;
+    }
+
+    return 0;
+}
+
+/*********************************************************//**
+ * Return the cached page # pageno of the view, transforming it into
+ * the least recently used cache slot if it is not cached.
+ *************************************************************
+ */
+static const XformPage *xform_page( const Xform *x, size_t pageno )
+{
+    XformCache *cache = x->cache;
+    const size_t pagein  = XFORM_PAGEUNITS * x->inunit;
+    const size_t pageout = XFORM_PAGEUNITS * x->outunit;
+    XformPage  *lru = &cache->pages[0];
+    size_t     i, n;
+
+    for (i=0; i < XFORM_NPAGES; i++)
+    {
+        XformPage *p = &cache->pages[i];
+        if ( p->len && p->owner == x && p->pageno == pageno ) {
+            p->stamp = ++cache->clock;
+            return p;
+        }
+        if ( p->stamp < lru->stamp )
+            lru = p;
+    }
+
+    if ( !lru->data && NULL == (lru->data = malloc( XFORM_PAGEUNITS * XFORM_MAXUNIT )) )
+        return NULL;
+
+    n = myMIN( pagein, x->inlen - pageno * pagein );
+    n = x->src( x->ctx, x->from + pageno * pagein, cache->in, n );
+    n = xform_apply( x, cache->in, n, lru->data, pageno * pageout );
+
+    lru->owner  = x;
+    lru->pageno = pageno;
+    lru->len    = myMIN( n, x->len - pageno * pageout );
+    lru->stamp  = ++cache->clock;
+
+    return lru->len ? lru : NULL;
+}
+
+/*********************************************************//**
+ * Copy up to n transformed bytes, starting at off, into dst. Return
+ * the # of bytes copied.
+ *************************************************************
+ */
+size_t xform_read( const Xform *x, size_t off, unsigned char *dst, size_t n )
+{
+    const size_t pageout = XFORM_PAGEUNITS * x->outunit;
+    size_t done;
+
+    if ( !x->cache || off >= x->len )
+        return 0;
+    n = myMIN( n, x->len - off );
+
+    for (done=0; done < n; )
+    {
+        const XformPage *p = xform_page( x, (off + done) / pageout );
+        const size_t skip = (off + done) % pageout;
+        size_t k;
+
+        if ( !p || skip >= p->len )
+            break;
+        k = myMIN( p->len - skip, n - done );
+        memcpy( &dst[done], &p->data[skip], k );
+        done += k;
+    }
+
+    return done;
+}
+
+/*********************************************************//**
+ * Return the offset in the view of the byte transformed from the
+ * source byte at srcoff (or the nearest one).
+ *************************************************************
+ */
+size_t xform_fromsrc( const Xform *x, size_t srcoff )
+{
+    const size_t rel = srcoff > x->from ? srcoff - x->from : 0;
+    const size_t off = rel / x->inunit * x->outunit + (rel % x->inunit) * x->outunit / x->inunit;
+
+    return x->len > 0 ? myMIN( off, x->len - 1 ) : 0;
+}
+
+/*********************************************************//**
+ * Return the offset in the source of the 1st byte transformed into
+ * the byte at off of the view.
+ *************************************************************
+ */
+size_t xform_tosrc( const Xform *x, size_t off )
+{
+    return x->from + off / x->outunit * x->inunit + (off % x->outunit) * x->inunit / x->outunit;
+}
+
+/*********************************************************//**
+ * Drop the cached pages of the view (& free the cache, if it was the
+ * last one using it).
+ *************************************************************
+ */
+void xform_cleanup( Xform *x )
+{
+    XformCache *cache;
+    size_t i;
+
+    if ( !x )
+        return;
+
+    if ( NULL != (cache = x->cache) ) {
+        for (i=0; i < XFORM_NPAGES; i++)
+            if ( cache->pages[i].owner == x ) {
+                cache->pages[i].owner = NULL;
+                cache->pages[i].len   = 0;
+                cache->pages[i].stamp = 0;    /* reused 1st */
+            }
+        if ( 0 == --cache->nviews ) {
+            for (i=0; i < XFORM_NPAGES; i++)
+                free( cache->pages[i].data );
+            free( cache->in );
+            memset( cache, 0, sizeof(XformCache) );
+        }
+    }
+    memset( x, 0, sizeof(Xform) );
+
+    return;
+}
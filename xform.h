@@ -0,0 +1,67 @@
+#ifndef XFORM_H                    /* start of inclusion guard */
+#define XFORM_H
+
+#include <stddef.h>
+
+/* -----------------------------------
+ * Lazily transformed views of data (decoded/deobfuscated)
+ * -----------------------------------
+ */
+
+#define XFORM_PAGEUNITS        1024        /* transform units per cached page    */
+#define XFORM_NPAGES        64        /* # of cached pages (LRU), shared by all views */
+#define XFORM_MAXUNIT        8        /* max bytes of a transform unit      */
+#define XFORM_MAXKEYLEN        64        /* max bytes of an XOR key            */
+
+enum XformKind {
+    XF_NONE = 0,                /* the data as they are               */
+    XF_XOR,                    /* XOR-ed with a repeated key         */
+    XF_SWAP16,                    /* 16-bit words byte-swapped          */
+    XF_SWAP32,                    /* 32-bit words byte-swapped          */
+    XF_SWAP64,                    /* 64-bit words byte-swapped          */
+    XF_NIBBLE,                    /* nibbles of each byte swapped       */
+    XF_BASE64,                    /* base64 text decoded                */
+    XF_HEX,                    /* hex digit pairs decoded            */
+    XF_NKINDS
+};
+
+/* reads n bytes of the source at off into dst, returns the # read */
+typedef size_t (*XformSrc)( const void *ctx, size_t off, unsigned char *dst, size_t n );
+
+typedef struct XformPage {
+    const struct Xform *owner;        /* of which view ...                  */
+    size_t      pageno;            /* ... which page ...                 */
+    size_t      len;            /* ... # of its bytes (0: unused)     */
+    unsigned long stamp;        /* ... when last used                 */
+    unsigned char *data;        /* ... and its transformed bytes      */
+} XformPage;
+
+typedef struct XformCache {
+    XformPage   pages[ XFORM_NPAGES ];
+    unsigned char *in;            /* source bytes of a page             */
+    unsigned long clock;        /* stamps page uses                   */
+    unsigned    nviews;            /* # of views sharing it              */
+} XformCache;
+
+typedef struct Xform {
+    int         kind;            /* enum XformKind                     */
+    unsigned char key[ XFORM_MAXKEYLEN ];  /* XOR key ...               */
+    size_t      keylen;            /* ... and its length                 */
+    size_t      from, inlen;        /* transformed source bytes           */
+    size_t      len;            /* # of transformed bytes             */
+    size_t      inunit, outunit;    /* source bytes per transformed ones  */
+    XformSrc    src;            /* reads the source ...               */
+    const void  *ctx;            /* ... given this                     */
+    XformCache  *cache;            /* the transformed pages (shared)     */
+} Xform;
+
+int     xform_byname( const char *name );
+const char *xform_name( int kind );
+_Bool   xform_init( Xform *x, int kind, const unsigned char *key, size_t keylen,
+                    size_t from, size_t inlen, XformSrc src, const void *ctx );
+size_t  xform_read( const Xform *x, size_t off, unsigned char *dst, size_t n );
+size_t  xform_fromsrc( const Xform *x, size_t srcoff );
+size_t  xform_tosrc( const Xform *x, size_t off );
+void    xform_cleanup( Xform *x );
+
+#endif                        /* end of inclusion guard            */